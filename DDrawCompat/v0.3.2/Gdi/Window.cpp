@@ -1,8 +1,7 @@
 #define WIN32_LEAN_AND_MEAN
 #define CINTERFACE
 
-#include <algorithm>
-#include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <dwmapi.h>
@@ -38,6 +37,7 @@ namespace
 		BYTE alpha;
 		bool isLayered;
 		bool isVisibleRegionChanged;
+		DWORD updateId;
 
 		Window(HWND hwnd)
 			: hwnd(hwnd)
@@ -49,16 +49,18 @@ namespace
 			, alpha(255)
 			, isLayered(true)
 			, isVisibleRegionChanged(false)
+			, updateId(0)
 		{
 		}
 	};
 
 	const RECT REGION_OVERRIDE_MARKER_RECT = { 32000, 32000, 32001, 32001 };
 
-	std::map<HWND, Window> g_windows;
+	std::unordered_map<HWND, Window> g_windows;
 	std::vector<Window*> g_windowZOrder;
+	DWORD g_updateId = 0;
 
-	std::map<HWND, Window>::iterator addWindow(HWND hwnd)
+	std::unordered_map<HWND, Window>::iterator addWindow(HWND hwnd)
 	{
 		DWMNCRENDERINGPOLICY ncRenderingPolicy = DWMNCRP_DISABLED;
 		DwmSetWindowAttribute(hwnd, DWMWA_NCRENDERING_POLICY, &ncRenderingPolicy, sizeof(ncRenderingPolicy));
@@ -200,6 +202,7 @@ namespace
 		{
 			it = addWindow(hwnd);
 		}
+		it->second.updateId = g_updateId;
 		g_windowZOrder.push_back(&it->second);
 
 		const LONG exStyle = CALL_ORIG_FUNC(GetWindowLongA)(hwnd, GWL_EXSTYLE);
@@ -528,11 +531,12 @@ namespace Gdi
 			{
 				D3dDdi::ScopedCriticalSection lock;
 				g_windowZOrder.clear();
+				++g_updateId;
 				EnumWindows(updateWindow, reinterpret_cast<LPARAM>(&context));
 
 				for (auto it = g_windows.begin(); it != g_windows.end();)
 				{
-					if (g_windowZOrder.end() == std::find(g_windowZOrder.begin(), g_windowZOrder.end(), &it->second))
+					if (it->second.updateId != g_updateId)
 					{
 						if (it->second.presentationWindow)
 						{
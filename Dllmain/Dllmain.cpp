@@ -234,6 +234,14 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 			}
 		}
 		Config.SetConfig();			// Finish setting up config
+		if (Config.EnableTraceLogging && !Config.DisableLogging)
+		{
+			Logging::Trace::Start();
+		}
+		if (Config.EnableApiProfiling && !Config.DisableLogging)
+		{
+			Logging::Profiler::Start();
+		}
 		Logging::LogComputerManufacturer();
 		Logging::LogVideoCard();
 		Logging::LogOSVersion();
@@ -675,6 +683,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 		}
 		break;
 	case DLL_THREAD_DETACH:
+		// Free this thread's trace ring once it is written
+		Logging::Trace::ThreadDetach();
+
 #ifdef DDRAWCOMPAT
 		// Unload and Unhook DDrawCompat
 		if (DDrawCompat::IsEnabled())
@@ -716,6 +727,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 		// Stop threads
 		Fullscreen::StopThread();
 		WriteMemory::StopThread();
+		DeviceStateSnapshot::StopThread();
+		Logging::Trace::Stop();
+		Logging::Profiler::Stop();
 
 		// Unload DdrawWrapper
 		if (Config.Dd7to9)
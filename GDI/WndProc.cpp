@@ -286,6 +286,12 @@ LRESULT CALLBACK WndProc::Handler(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lPa
 		AppWndProcInstance->SetInactive();
 	}
 
+	// Track window changes so cached window data can be invalidated
+	if (hWnd == hWndInstance && (Msg == WM_MOVE || Msg == WM_SIZE || Msg == WM_WINDOWPOSCHANGED || Msg == WM_SHOWWINDOW || Msg == WM_DISPLAYCHANGE))
+	{
+		AppWndProcInstance->GetDataStruct()->WindowChangeCount++;
+	}
+
 	// Handle Direct3D9 device creation
 	if (Msg == WM_APP_CREATE_D3D9_DEVICE && WM_MAKE_KEY(hWnd, wParam) == lParam)
 	{
@@ -13,6 +13,7 @@ namespace WndProc
 		std::atomic<bool> IsDirect3D9 = false;
 		std::atomic<bool> IsCreatingDevice = false;
 		std::atomic<bool> IsExclusiveMode = false;
+		std::atomic<DWORD> WindowChangeCount = 0;		// Incremented when the window moves, resizes or changes visibility
 	};
 
 	extern bool SwitchingResolution;
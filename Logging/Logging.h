@@ -7,8 +7,80 @@
 namespace Logging
 {
 	void InitLog();
+
+	// Binary call trace, records are written to a per-thread ring and decoded by a background thread
+	namespace Trace
+	{
+		constexpr DWORD MaxArgs = 9;
+
+		extern bool IsEnabled;
+		void Start();
+		void Stop();
+		void ThreadDetach();
+		WORD RegisterSite(const char* Function, const char* ArgNames);
+		void RecordArgs(WORD SiteId, const DWORD_PTR* Args, DWORD ArgCount);
+
+		template <typename... Args>
+		inline void Record(WORD SiteId, Args... args)
+		{
+			static_assert(sizeof...(args) <= MaxArgs, "Too many trace arguments!");
+			const DWORD_PTR Data[] = { 0, (DWORD_PTR)args... };
+			RecordArgs(SiteId, Data + 1, sizeof...(args));
+		}
+	}
+
+	// API call latency histograms, dumped to the log periodically and on exit
+	namespace Profiler
+	{
+		extern bool IsEnabled;
+		void Start();
+		void Stop();
+		WORD RegisterSite(const char* Function);
+		void RecordTime(WORD SiteId, LONGLONG Ticks);
+		LONGLONG GetTicks();
+
+		class ScopedTimer
+		{
+		private:
+			WORD SiteId = 0;
+			LONGLONG StartTicks = 0;
+
+		public:
+			void Start(WORD Id)
+			{
+				SiteId = Id;
+				StartTicks = GetTicks();
+			}
+			~ScopedTimer()
+			{
+				if (StartTicks)
+				{
+					RecordTime(SiteId, GetTicks() - StartTicks);
+				}
+			}
+		};
+	}
 }
 
+// Records raw arguments on hot paths, when disabled this is a single branch
+#define LOG_TRACE(...) \
+	do { \
+		if (Logging::Trace::IsEnabled) \
+		{ \
+			static const WORD TraceSiteId = Logging::Trace::RegisterSite(__FUNCTION__, #__VA_ARGS__); \
+			Logging::Trace::Record(TraceSiteId, __VA_ARGS__); \
+		} \
+	} while (0)
+
+// Times the enclosing scope, when disabled this is a single branch
+#define PROFILE_SCOPE() \
+	Logging::Profiler::ScopedTimer ProfileScopedTimer; \
+	if (Logging::Profiler::IsEnabled) \
+	{ \
+		static const WORD ProfileSiteId = Logging::Profiler::RegisterSite(__FUNCTION__); \
+		ProfileScopedTimer.Start(ProfileSiteId); \
+	}
+
 #pragma warning (disable: 26812)
 typedef enum _DDFOURCC {} DDFOURCC;
 typedef enum _DDERR {} DDERR;
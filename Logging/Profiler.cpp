@@ -0,0 +1,281 @@
+/**
+* Copyright (C) 2025 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <intrin.h>
+#include "Logging.h"
+
+namespace Logging
+{
+	namespace Profiler
+	{
+		constexpr LONG MaxSites = 1024;
+		constexpr DWORD DumpIntervalMS = 30000;
+
+		// Four sub-buckets per power of two, keeps the percentile error under 25%
+		constexpr DWORD SubBucketBits = 2;
+		constexpr DWORD SubBuckets = 1 << SubBucketBits;
+		constexpr DWORD NumBuckets = 48 * SubBuckets;
+
+		struct PROFILESITE
+		{
+			const char* Function = nullptr;
+			volatile LONG Count = 0;
+			volatile LONGLONG TotalTicks = 0;
+			volatile LONGLONG MaxTicks = 0;
+			volatile LONG Buckets[NumBuckets] = {};
+		};
+
+		struct SITESTATS
+		{
+			const char* Function;
+			LONG Count;
+			LONGLONG TotalTicks;
+			LONGLONG MaxTicks;
+			LONGLONG P50;
+			LONGLONG P95;
+			LONGLONG P99;
+		};
+
+		bool IsEnabled = false;
+		PROFILESITE* volatile Sites[MaxSites] = {};
+		volatile LONG SiteCount = 0;
+		LARGE_INTEGER Frequency = {};
+		HANDLE hDumpThread = nullptr;
+		HANDLE hStopEvent = nullptr;
+
+		// Function declarations
+		DWORD GetBucket(LONGLONG Ticks);
+		LONGLONG GetBucketValue(DWORD Bucket);
+		void Dump();
+		DWORD WINAPI DumpThreadFunction(LPVOID);
+	}
+}
+
+void Logging::Profiler::Start()
+{
+	if (IsEnabled || hDumpThread)
+	{
+		return;
+	}
+
+	QueryPerformanceFrequency(&Frequency);
+
+	hStopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	hDumpThread = CreateThread(nullptr, 0, DumpThreadFunction, nullptr, 0, nullptr);
+	if (!hDumpThread)
+	{
+		Logging::Log() << __FUNCTION__ << " Error: failed to create profiler thread!";
+		CloseHandle(hStopEvent);
+		hStopEvent = nullptr;
+		return;
+	}
+
+	Logging::Log() << __FUNCTION__ << " API profiling enabled";
+
+	IsEnabled = true;
+}
+
+void Logging::Profiler::Stop()
+{
+	if (!hDumpThread)
+	{
+		return;
+	}
+
+	// Stop new samples, sites are left allocated since other threads may still be inside a timed call
+	IsEnabled = false;
+
+	SetEvent(hStopEvent);
+	WaitForSingleObject(hDumpThread, INFINITE);
+	CloseHandle(hDumpThread);
+	CloseHandle(hStopEvent);
+	hDumpThread = nullptr;
+	hStopEvent = nullptr;
+
+	Dump();
+}
+
+WORD Logging::Profiler::RegisterSite(const char* Function)
+{
+	LONG SiteId = InterlockedIncrement(&SiteCount) - 1;
+	if (SiteId >= MaxSites)
+	{
+		InterlockedDecrement(&SiteCount);
+		return (WORD)-1;
+	}
+
+	PROFILESITE* Site = new PROFILESITE;
+	Site->Function = Function;
+	InterlockedExchangePointer((PVOID volatile*)&Sites[SiteId], Site);
+
+	return (WORD)SiteId;
+}
+
+LONGLONG Logging::Profiler::GetTicks()
+{
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	return Counter.QuadPart;
+}
+
+// Log-linear bucket index, values below SubBuckets get their own bucket
+DWORD Logging::Profiler::GetBucket(LONGLONG Ticks)
+{
+	if (Ticks < (LONGLONG)SubBuckets)
+	{
+		return (Ticks < 0) ? 0 : (DWORD)Ticks;
+	}
+
+	DWORD Msb;
+	if (!_BitScanReverse(&Msb, (DWORD)(Ticks >> 32)))
+	{
+		_BitScanReverse(&Msb, (DWORD)Ticks);
+	}
+	else
+	{
+		Msb += 32;
+	}
+
+	DWORD Bucket = (Msb - SubBucketBits + 1) * SubBuckets + (DWORD)((Ticks >> (Msb - SubBucketBits)) & (SubBuckets - 1));
+	return min(Bucket, NumBuckets - 1);
+}
+
+// Midpoint of the range covered by a bucket
+LONGLONG Logging::Profiler::GetBucketValue(DWORD Bucket)
+{
+	if (Bucket < SubBuckets)
+	{
+		return Bucket;
+	}
+
+	DWORD Shift = Bucket / SubBuckets - 1;
+	LONGLONG Low = (LONGLONG)(SubBuckets + Bucket % SubBuckets) << Shift;
+	return Low + ((1LL << Shift) >> 1);
+}
+
+void Logging::Profiler::RecordTime(WORD SiteId, LONGLONG Ticks)
+{
+	if (SiteId >= MaxSites || !Sites[SiteId])
+	{
+		return;
+	}
+
+	PROFILESITE& Site = *Sites[SiteId];
+
+	InterlockedIncrement(&Site.Buckets[GetBucket(Ticks)]);
+	InterlockedIncrement(&Site.Count);
+	InterlockedExchangeAdd64(&Site.TotalTicks, Ticks);
+
+	LONGLONG MaxTicks = Site.MaxTicks;
+	while (Ticks > MaxTicks)
+	{
+		LONGLONG Prev = InterlockedCompareExchange64(&Site.MaxTicks, Ticks, MaxTicks);
+		if (Prev == MaxTicks)
+		{
+			break;
+		}
+		MaxTicks = Prev;
+	}
+}
+
+// Logs the stats collected since the last dump, most expensive methods first
+void Logging::Profiler::Dump()
+{
+	std::vector<SITESTATS> Stats;
+
+	LONG Count = min(SiteCount, MaxSites);
+	for (LONG x = 0; x < Count; x++)
+	{
+		PROFILESITE* Site = Sites[x];
+		if (!Site || !Site->Count)
+		{
+			continue;
+		}
+
+		// Take and reset the counters, samples recorded while this runs land in the next dump
+		LONG Buckets[NumBuckets];
+		LONG Total = 0;
+		for (DWORD y = 0; y < NumBuckets; y++)
+		{
+			Buckets[y] = InterlockedExchange(&Site->Buckets[y], 0);
+			Total += Buckets[y];
+		}
+		InterlockedExchange(&Site->Count, 0);
+
+		SITESTATS Entry = {};
+		Entry.P50 = Entry.P95 = Entry.P99 = -1;
+		Entry.Function = Site->Function;
+		Entry.Count = Total;
+		Entry.TotalTicks = InterlockedExchange64(&Site->TotalTicks, 0);
+		Entry.MaxTicks = InterlockedExchange64(&Site->MaxTicks, 0);
+
+		if (!Total)
+		{
+			continue;
+		}
+
+		const LONG Rank50 = (LONG)(Total * 0.50);
+		const LONG Rank95 = (LONG)(Total * 0.95);
+		const LONG Rank99 = (LONG)(Total * 0.99);
+		LONG Seen = 0;
+		for (DWORD y = 0; y < NumBuckets; y++)
+		{
+			if (!Buckets[y])
+			{
+				continue;
+			}
+			Seen += Buckets[y];
+			if (Seen > Rank50 && Entry.P50 < 0) Entry.P50 = GetBucketValue(y);
+			if (Seen > Rank95 && Entry.P95 < 0) Entry.P95 = GetBucketValue(y);
+			if (Seen > Rank99 && Entry.P99 < 0) Entry.P99 = GetBucketValue(y);
+		}
+
+		Stats.push_back(Entry);
+	}
+
+	if (Stats.empty())
+	{
+		return;
+	}
+
+	std::sort(Stats.begin(), Stats.end(), [](const SITESTATS& a, const SITESTATS& b) { return a.TotalTicks > b.TotalTicks; });
+
+	const double TicksToUS = 1000000.0 / Frequency.QuadPart;
+
+	for (const SITESTATS& Entry : Stats)
+	{
+		Logging::Log() << "Profiler: " << Entry.Function <<
+			" calls = " << Entry.Count <<
+			" total = " << Entry.TotalTicks * TicksToUS / 1000.0 << "ms" <<
+			" avg = " << Entry.TotalTicks * TicksToUS / Entry.Count << "us" <<
+			" p50 = " << Entry.P50 * TicksToUS << "us" <<
+			" p95 = " << Entry.P95 * TicksToUS << "us" <<
+			" p99 = " << Entry.P99 * TicksToUS << "us" <<
+			" max = " << Entry.MaxTicks * TicksToUS << "us";
+	}
+}
+
+DWORD WINAPI Logging::Profiler::DumpThreadFunction(LPVOID)
+{
+	while (WaitForSingleObject(hStopEvent, DumpIntervalMS) == WAIT_TIMEOUT)
+	{
+		Dump();
+	}
+
+	return 0;
+}
@@ -0,0 +1,291 @@
+/**
+* Copyright (C) 2025 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <sstream>
+#include "Logging.h"
+
+namespace Logging
+{
+	namespace Trace
+	{
+		// Must be a power of two
+		constexpr LONG RingSize = 2048;
+		constexpr LONG MaxSites = 4096;
+		constexpr DWORD FlushIntervalMS = 100;
+
+		struct TRACERECORD
+		{
+			LONGLONG Timestamp;
+			WORD SiteId;
+			WORD ArgCount;
+			DWORD_PTR Args[MaxArgs];
+		};
+
+		// Single producer (owning thread) and single consumer (flush thread)
+		struct TRACERING
+		{
+			TRACERING* Next = nullptr;
+			DWORD ThreadID = 0;
+			volatile LONG Head = 0;		// Written by producer
+			volatile LONG Tail = 0;		// Written by consumer
+			LONG Dropped = 0;			// Written by producer
+			LONG DroppedReported = 0;	// Written by consumer
+			volatile LONG IsDetached = FALSE;	// Owning thread exited, the consumer frees the ring
+			TRACERECORD Records[RingSize] = {};
+		};
+
+		struct TRACESITE
+		{
+			const char* Function;
+			const char* ArgNames;
+		};
+
+		bool IsEnabled = false;
+		DWORD TlsIndex = TLS_OUT_OF_INDEXES;
+		TRACERING* volatile RingList = nullptr;
+		TRACESITE Sites[MaxSites] = {};
+		volatile LONG SiteCount = 0;
+		LARGE_INTEGER StartTime = {};
+		LARGE_INTEGER Frequency = {};
+		HANDLE hFlushThread = nullptr;
+		HANDLE hStopEvent = nullptr;
+
+		// Function declarations
+		TRACERING* CreateRing();
+		void Flush();
+		DWORD WINAPI FlushThreadFunction(LPVOID);
+	}
+}
+
+void Logging::Trace::Start()
+{
+	if (IsEnabled || hFlushThread)
+	{
+		return;
+	}
+
+	TlsIndex = TlsAlloc();
+	if (TlsIndex == TLS_OUT_OF_INDEXES)
+	{
+		Logging::Log() << __FUNCTION__ << " Error: failed to allocate trace TLS index!";
+		return;
+	}
+
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&StartTime);
+
+	hStopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	hFlushThread = CreateThread(nullptr, 0, FlushThreadFunction, nullptr, 0, nullptr);
+	if (!hFlushThread)
+	{
+		Logging::Log() << __FUNCTION__ << " Error: failed to create trace flush thread!";
+		CloseHandle(hStopEvent);
+		hStopEvent = nullptr;
+		return;
+	}
+
+	Logging::Log() << __FUNCTION__ << " Trace logging enabled";
+
+	IsEnabled = true;
+}
+
+void Logging::Trace::Stop()
+{
+	if (!hFlushThread)
+	{
+		return;
+	}
+
+	// Stop new records, the rings are left allocated since other threads may still be writing
+	IsEnabled = false;
+
+	SetEvent(hStopEvent);
+	WaitForSingleObject(hFlushThread, INFINITE);
+	CloseHandle(hFlushThread);
+	CloseHandle(hStopEvent);
+	hFlushThread = nullptr;
+	hStopEvent = nullptr;
+
+	Flush();
+}
+
+// Hands the calling thread's ring to the flush thread, which frees it after writing its last records
+void Logging::Trace::ThreadDetach()
+{
+	if (TlsIndex == TLS_OUT_OF_INDEXES)
+	{
+		return;
+	}
+
+	TRACERING* Ring = (TRACERING*)TlsGetValue(TlsIndex);
+	if (Ring)
+	{
+		TlsSetValue(TlsIndex, nullptr);
+		InterlockedExchange(&Ring->IsDetached, TRUE);
+	}
+}
+
+WORD Logging::Trace::RegisterSite(const char* Function, const char* ArgNames)
+{
+	LONG SiteId = InterlockedIncrement(&SiteCount) - 1;
+	if (SiteId >= MaxSites)
+	{
+		InterlockedDecrement(&SiteCount);
+		return (WORD)-1;
+	}
+
+	Sites[SiteId].ArgNames = ArgNames;
+	MemoryBarrier();
+	Sites[SiteId].Function = Function;
+
+	return (WORD)SiteId;
+}
+
+Logging::Trace::TRACERING* Logging::Trace::CreateRing()
+{
+	TRACERING* Ring = new TRACERING;
+	Ring->ThreadID = GetCurrentThreadId();
+	TlsSetValue(TlsIndex, Ring);
+
+	// Push to list of rings, only the flush thread removes rings so a simple push is enough
+	TRACERING* Head;
+	do {
+		Head = RingList;
+		Ring->Next = Head;
+	} while (InterlockedCompareExchangePointer((PVOID volatile*)&RingList, Ring, Head) != Head);
+
+	return Ring;
+}
+
+void Logging::Trace::RecordArgs(WORD SiteId, const DWORD_PTR* Args, DWORD ArgCount)
+{
+	if (SiteId >= MaxSites || TlsIndex == TLS_OUT_OF_INDEXES)
+	{
+		return;
+	}
+
+	TRACERING* Ring = (TRACERING*)TlsGetValue(TlsIndex);
+	if (!Ring)
+	{
+		Ring = CreateRing();
+	}
+
+	// Drop record if the flush thread has not caught up
+	LONG Head = Ring->Head;
+	if (Head - Ring->Tail >= RingSize)
+	{
+		Ring->Dropped++;
+		return;
+	}
+
+	TRACERECORD& Record = Ring->Records[Head & (RingSize - 1)];
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	Record.Timestamp = Counter.QuadPart;
+	Record.SiteId = SiteId;
+	Record.ArgCount = (WORD)min(ArgCount, MaxArgs);
+	for (DWORD x = 0; x < Record.ArgCount; x++)
+	{
+		Record.Args[x] = Args[x];
+	}
+
+	// Publish record
+	InterlockedExchange(&Ring->Head, Head + 1);
+}
+
+// Decodes all pending records to the log file
+void Logging::Trace::Flush()
+{
+	TRACERING* Prev = nullptr;
+	for (TRACERING* Ring = RingList, *Next = nullptr; Ring; Ring = Next)
+	{
+		// Checked first, a detached ring gets no more records after the flag is set
+		const bool IsDetached = (Ring->IsDetached != FALSE);
+		MemoryBarrier();
+
+		LONG Head = Ring->Head;
+		LONG Tail = Ring->Tail;
+
+		for (; Tail != Head; Tail++)
+		{
+			const TRACERECORD& Record = Ring->Records[Tail & (RingSize - 1)];
+			const TRACESITE& Site = Sites[Record.SiteId];
+
+			std::ostringstream Line;
+			Line << "Trace [" << Ring->ThreadID << "] " <<
+				(double)((Record.Timestamp - StartTime.QuadPart) * 1000.0 / Frequency.QuadPart) << "ms " <<
+				((Site.Function) ? Site.Function : "Unknown") << "(";
+
+			// Match each argument with its name from the call site
+			const char* Name = (Site.ArgNames) ? Site.ArgNames : "";
+			for (DWORD x = 0; x < Record.ArgCount; x++)
+			{
+				while (*Name == ' ' || *Name == ',')
+				{
+					Name++;
+				}
+				const char* NameEnd = strchr(Name, ',');
+				size_t NameLength = (NameEnd) ? (size_t)(NameEnd - Name) : strlen(Name);
+
+				Line << ((x) ? ", " : "") << std::string(Name, NameLength) << " = " << (void*)Record.Args[x];
+
+				Name += NameLength;
+			}
+			Line << ")";
+
+			Logging::Log() << Line.str().c_str();
+		}
+
+		// Release records back to the producer
+		InterlockedExchange(&Ring->Tail, Tail);
+
+		LONG Dropped = Ring->Dropped;
+		if (Dropped != Ring->DroppedReported)
+		{
+			Logging::Log() << "Trace [" << Ring->ThreadID << "] Warning: dropped " << (Dropped - Ring->DroppedReported) << " records!";
+			Ring->DroppedReported = Dropped;
+		}
+
+		Next = Ring->Next;
+		if (!IsDetached)
+		{
+			Prev = Ring;
+			continue;
+		}
+
+		// Unlink the ring, other threads only ever push new rings to the head of the list
+		if (Prev)
+		{
+			Prev->Next = Next;
+		}
+		else if (InterlockedCompareExchangePointer((PVOID volatile*)&RingList, Next, Ring) != Ring)
+		{
+			for (Prev = RingList; Prev->Next != Ring; Prev = Prev->Next) {}
+			Prev->Next = Next;
+		}
+		delete Ring;
+	}
+}
+
+DWORD WINAPI Logging::Trace::FlushThreadFunction(LPVOID)
+{
+	while (WaitForSingleObject(hStopEvent, FlushIntervalMS) == WAIT_TIMEOUT)
+	{
+		Flush();
+	}
+
+	return 0;
+}
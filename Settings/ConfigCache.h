@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Settings
+{
+	// Save value functions for the binary snapshot
+	template <typename T>
+	void SaveValue(std::string& data, const T* setting)
+	{
+		data.append(reinterpret_cast<const char*>(setting), sizeof(T));
+	}
+	inline void SaveValue(std::string& data, const std::string* setting)
+	{
+		DWORD size = (DWORD)setting->size();
+		SaveValue(data, &size);
+		data.append(*setting);
+	}
+	inline void SaveValue(std::string& data, const std::vector<std::string>* setting)
+	{
+		DWORD size = (DWORD)setting->size();
+		SaveValue(data, &size);
+		for (const std::string& entry : *setting)
+		{
+			SaveValue(data, &entry);
+		}
+	}
+
+	// Load value functions for the binary snapshot
+	template <typename T>
+	bool LoadValue(const char*& pos, const char* end, T* setting)
+	{
+		if ((size_t)(end - pos) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(setting, pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+	inline bool LoadValue(const char*& pos, const char* end, std::string* setting)
+	{
+		DWORD size = 0;
+		if (!LoadValue(pos, end, &size) || (size_t)(end - pos) < size)
+		{
+			return false;
+		}
+		setting->assign(pos, size);
+		pos += size;
+		return true;
+	}
+	inline bool LoadValue(const char*& pos, const char* end, std::vector<std::string>* setting)
+	{
+		DWORD size = 0;
+		if (!LoadValue(pos, end, &size) || (size_t)(end - pos) < size * sizeof(DWORD))
+		{
+			return false;
+		}
+		setting->resize(size);
+		for (std::string& entry : *setting)
+		{
+			if (!LoadValue(pos, end, &entry))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Finds the last value given to a setting without parsing the whole config, following the line rules of Parse.
+	// Block comments are not skipped, so this can only find a value that Parse would ignore, never miss one.
+	inline bool FindSettingValue(const char* szCfg, const char* name, std::string& value)
+	{
+		const size_t NameLength = strlen(name);
+		bool Found = false;
+
+		for (const char* line = szCfg; *line;)
+		{
+			const char* LineEnd = strchr(line, '\n');
+			if (!LineEnd)
+			{
+				LineEnd = line + strlen(line);
+			}
+
+			// INI style comments must be at the start of the line
+			const char* str = line + strspn(line, "\x20\t\r");
+			if (*line != ';' && *line != '#' && (size_t)(LineEnd - str) > NameLength && _strnicmp(str, name, NameLength) == 0)
+			{
+				str += NameLength;
+				str += strspn(str, "\x20\t\r");
+				if (str < LineEnd && (*str == '=' || *str == ':'))
+				{
+					str++;
+					str += strspn(str, "\x20\t\r");
+
+					// Value ends at the line end or a // comment, without trailing whitespace
+					const char* end = str;
+					while (end < LineEnd && !(end[0] == '/' && end[1] == '/'))
+					{
+						end++;
+					}
+					while (end > str && (end[-1] == '\x20' || end[-1] == '\t' || end[-1] == '\r'))
+					{
+						end--;
+					}
+					if (end > str)
+					{
+						value.assign(str, end);
+						Found = true;
+					}
+				}
+			}
+
+			line = (*LineEnd) ? LineEnd + 1 : LineEnd;
+		}
+
+		return Found;
+	}
+}
@@ -17,8 +17,9 @@
 #include <regex>
 #include <algorithm>
 #include "Settings.h"
-#include "External\Hooking.Patterns\Hooking.Patterns.h"
+#include "ConfigCache.h"
 #include "Dllmain\Dllmain.h"
+#include "Utils\Utils.h"
 #include "Wrappers\wrapper.h"
 #include "Logging\Logging.h"
 
@@ -28,7 +29,9 @@ namespace Settings
 {
 	// Config
 	bool ConfigLoaded = false;
+	bool ConfigCacheLoaded = false;
 	char configpath[MAX_PATH] = {};
+	bool PatternCacheValid = false;				// Cached pattern offsets belong to the currently loaded exe image
 
 	// Declare variables
 	bool WrapperModeIncorrect = false;
@@ -62,6 +65,15 @@ namespace Settings
 	void SetValue(char*, char*, double*);
 	void SetValue(char*, char*, bool*);
 	void __stdcall ParseCallback(char*, char*);
+	void ParseConfig(char*);
+	void ResolvePatterns();
+	void GetModuleImageInfo(DWORD&, DWORD&, DWORD&);
+	bool LoadConfigCache(ULONGLONG);
+	void SaveConfigCache(ULONGLONG);
+	void SaveConfigData(std::string&);
+#ifdef _DEBUG
+	void VerifyConfigCache(const char*);
+#endif
 	void SetDefaultConfigSettings();
 	UINT GetWrapperMode(std::string *name);
 }
@@ -70,19 +82,32 @@ namespace Settings
 	visit(Force16bitColor) \
 	visit(Force32bitColor)
 
+#define VISIT_LEGACY_SETTINGS(visit) \
+	visit(AutoFrameSkip) \
+	visit(DdrawOverrideRefreshRate) \
+	visit(DSoundCtrl) \
+	visit(DDrawCompatExperimental) \
+	visit(DDrawCompat30) \
+	visit(DDrawCompat31)
+
+// Each setting name is a case label, so the compiler rejects any hash collision between settings
 #define SET_LOCAL_VALUE(functionName) \
-	if (!_stricmp(name, #functionName)) \
-	{ \
-		SetValue(name, value, &functionName); \
-		return; \
-	}
+	case HashSettingName(#functionName): \
+		if (!_stricmp(name, #functionName)) \
+		{ \
+			SetValue(name, value, &functionName); \
+			return; \
+		} \
+		break;
 
 #define SET_VALUE(functionName) \
-	if (!_stricmp(name, #functionName)) \
-	{ \
-		SetValue(name, value, &Config.functionName); \
-		return; \
-	}
+	case HashSettingName(#functionName): \
+		if (!_stricmp(name, #functionName)) \
+		{ \
+			SetValue(name, value, &Config.functionName); \
+			return; \
+		} \
+		break;
 
 #define SET_APPCOMPATDATA_VALUE(functionName) \
 	if (!_stricmp(name, #functionName)) \
@@ -94,9 +119,131 @@ namespace Settings
 #define CLEAR_VALUE(functionName) \
 	ClearValue(&Config.functionName);
 
+#define CLEAR_LOCAL_VALUE(functionName) \
+	ClearValue(&functionName);
+
 #define CLEAR_APPCOMPATDATA_VALUE(functionName) \
 	ClearValue(&Config.DXPrimaryEmulation[AppCompatDataType.functionName]);
 
+#define SAVE_LOCAL_VALUE(functionName) \
+	SaveValue(data, &functionName);
+
+#define SAVE_VALUE(functionName) \
+	SaveValue(data, &Config.functionName);
+
+#define SAVE_APPCOMPATDATA_VALUE(functionName) \
+	SaveValue(data, &Config.DXPrimaryEmulation[AppCompatDataType.functionName]);
+
+#define LOAD_LOCAL_VALUE(functionName) \
+	LoadValue(pos, end, &functionName) &&
+
+#define LOAD_VALUE(functionName) \
+	LoadValue(pos, end, &Config.functionName) &&
+
+#define LOAD_APPCOMPATDATA_VALUE(functionName) \
+	LoadValue(pos, end, &Config.DXPrimaryEmulation[AppCompatDataType.functionName]) &&
+
+#define SETTING_NAME_STRING(functionName) \
+	#functionName ","
+
+// Case-insensitive FNV-1a hash of a setting name
+constexpr DWORD HashSettingName(const char* str)
+{
+	DWORD hash = 2166136261u;
+	for (; *str; str++)
+	{
+		hash = (hash ^ (DWORD)(unsigned char)((*str >= 'A' && *str <= 'Z') ? *str + ('a' - 'A') : *str)) * 16777619u;
+	}
+	return hash;
+}
+
+// Binary config snapshot
+#define CONFIG_CACHE_MAGIC		0x43575844	// 'DXWC'
+#define CONFIG_CACHE_VERSION	2
+
+// Changes whenever a setting is added, removed or reordered
+static constexpr DWORD ConfigCacheLayout = HashSettingName(
+	VISIT_CONFIG_SETTINGS(SETTING_NAME_STRING)
+	VISIT_APPCOMPATDATA_SETTINGS(SETTING_NAME_STRING)
+	VISIT_LOCAL_SETTINGS(SETTING_NAME_STRING)
+	VISIT_LEGACY_SETTINGS(SETTING_NAME_STRING)) ^ (DWORD)sizeof(CONFIG);
+
+struct CONFIGCACHEHEADER
+{
+	DWORD Magic = CONFIG_CACHE_MAGIC;
+	DWORD Version = CONFIG_CACHE_VERSION;
+	DWORD Layout = ConfigCacheLayout;
+	DWORD FileSize = 0;
+	FILETIME LastWriteTime = {};
+	ULONGLONG ContentHash = 0;
+	DWORD ModuleTimeDateStamp = 0;
+	DWORD ModuleCheckSum = 0;
+	DWORD ModuleSizeOfImage = 0;
+	DWORD DataSize = 0;
+};
+
+namespace Settings
+{
+	// Save and load functions for the pattern entries, the other types are in ConfigCache.h
+	void SaveValue(std::string& data, const MEMORYINFO* setting)
+	{
+		// Pattern addresses are saved as an offset into the exe image
+		void* AddressPointer = (setting->PatternString.size() && setting->AddressPointer) ?
+			(void*)((BYTE*)setting->AddressPointer - (BYTE*)GetModuleHandle(nullptr)) : setting->AddressPointer;
+		SaveValue(data, &AddressPointer);
+		SaveValue(data, &setting->PatternString);
+		DWORD size = (DWORD)setting->Bytes.size();
+		SaveValue(data, &size);
+		data.append(reinterpret_cast<const char*>(setting->Bytes.data()), size);
+	}
+	void SaveValue(std::string& data, const std::vector<MEMORYINFO>* setting)
+	{
+		DWORD size = (DWORD)setting->size();
+		SaveValue(data, &size);
+		for (const MEMORYINFO& entry : *setting)
+		{
+			SaveValue(data, &entry);
+		}
+	}
+
+	bool LoadValue(const char*& pos, const char* end, MEMORYINFO* setting)
+	{
+		DWORD size = 0;
+		if (!LoadValue(pos, end, &setting->AddressPointer) || !LoadValue(pos, end, &setting->PatternString) ||
+			!LoadValue(pos, end, &size) || (size_t)(end - pos) < size)
+		{
+			return false;
+		}
+		setting->Bytes.assign(pos, pos + size);
+		pos += size;
+
+		// Reuse cached pattern offset if the exe image is unchanged and the bytes still match, otherwise it gets scanned again
+		if (setting->PatternString.size())
+		{
+			void* AddressPointer = (setting->AddressPointer) ? (BYTE*)GetModuleHandle(nullptr) + (size_t)setting->AddressPointer : nullptr;
+			setting->AddressPointer = (PatternCacheValid && Utils::CheckPattern(AddressPointer, setting->PatternString)) ? AddressPointer : nullptr;
+		}
+		return true;
+	}
+	bool LoadValue(const char*& pos, const char* end, std::vector<MEMORYINFO>* setting)
+	{
+		DWORD size = 0;
+		if (!LoadValue(pos, end, &size) || (size_t)(end - pos) < size * sizeof(DWORD))
+		{
+			return false;
+		}
+		setting->resize(size);
+		for (MEMORYINFO& entry : *setting)
+		{
+			if (!LoadValue(pos, end, &entry))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
 // Checks if a string value exists in a string array
 bool Settings::IfStringExistsInList(const char* szValue, std::vector<std::string> szList, bool CaseSensitive)
 {
@@ -287,19 +434,17 @@ void __stdcall Settings::ParseCallback(char* name, char* value)
 		Config.DisableMaxWindowedModeNotSet = false;
 	}
 
-	// For legacy settings
-	SET_LOCAL_VALUE(AutoFrameSkip);
-	SET_LOCAL_VALUE(DdrawOverrideRefreshRate);
-	SET_LOCAL_VALUE(DSoundCtrl);
-	SET_LOCAL_VALUE(DDrawCompatExperimental);
-	SET_LOCAL_VALUE(DDrawCompat30);
-	SET_LOCAL_VALUE(DDrawCompat31);
+	switch (HashSettingName(name))
+	{
+		// For legacy settings
+		VISIT_LEGACY_SETTINGS(SET_LOCAL_VALUE);
 
-	// Set Value of local settings
-	VISIT_LOCAL_SETTINGS(SET_LOCAL_VALUE);
+		// Set Value of local settings
+		VISIT_LOCAL_SETTINGS(SET_LOCAL_VALUE);
 
-	// Set Value of normal config settings
-	VISIT_CONFIG_SETTINGS(SET_VALUE);
+		// Set Value of normal config settings
+		VISIT_CONFIG_SETTINGS(SET_VALUE);
+	}
 
 	// Set Value of AppCompatData LockColorkey setting
 	if (!_stricmp(name, "LockColorkey"))
@@ -335,15 +480,14 @@ void __stdcall Settings::ParseCallback(char* name, char* value)
 	}
 	if (!_stricmp(name, "PatternString"))
 	{
-		std::string PatterString(value);
-		auto pattern = hook::pattern(value);
 		if (Config.MemoryInfo.size() < AddressPointerCount + 1)
 		{
 			MEMORYINFO newMemoryInfo;
 			Config.MemoryInfo.push_back(newMemoryInfo);
 		}
+		// Address is found later by ResolvePatterns() so all patterns are scanned in a single pass
 		Config.MemoryInfo[AddressPointerCount].PatternString.assign(value);
-		Config.MemoryInfo[AddressPointerCount++].AddressPointer = pattern.size() > 0UL ? pattern.get(0).get<uint32_t*>(0) : nullptr;
+		Config.MemoryInfo[AddressPointerCount++].AddressPointer = nullptr;
 		return;
 	}
 	if (!_stricmp(name, "BytesToWrite"))
@@ -361,6 +505,230 @@ void __stdcall Settings::ParseCallback(char* name, char* value)
 	Logging::Log() << "Warning. Config setting not recognized: " << name;
 }
 
+// Parse config file, or load it from the binary snapshot if the file has not changed
+void Settings::ParseConfig(char* szCfg)
+{
+	ConfigLoaded = true;
+
+	// Snapshot is only read or written when the config enables it
+	std::string CacheValue;
+	const bool IsCacheEnabled = FindSettingValue(szCfg, "ConfigCache", CacheValue) && IsValueEnabled(&CacheValue[0]);
+
+	// Hash before parsing since the parser modifies the string
+	ULONGLONG ContentHash = 14695981039346656037ull;
+	for (const char* str = szCfg; IsCacheEnabled && *str; str++)
+	{
+		ContentHash = (ContentHash ^ (unsigned char)*str) * 1099511628211ull;
+	}
+
+	if (IsCacheEnabled && LoadConfigCache(ContentHash))
+	{
+		ConfigCacheLoaded = true;
+		ResolvePatterns();
+#ifdef _DEBUG
+		VerifyConfigCache(szCfg);
+#endif
+		return;
+	}
+
+	Parse(szCfg, ParseCallback);
+
+	ResolvePatterns();
+
+	if (IsCacheEnabled && Config.ConfigCache)
+	{
+		SaveConfigCache(ContentHash);
+	}
+}
+
+// Find the address of all patterns that have not been resolved yet
+void Settings::ResolvePatterns()
+{
+	std::vector<std::string> Patterns;
+	std::vector<MEMORYINFO*> Entries;
+	for (MEMORYINFO& entry : Config.MemoryInfo)
+	{
+		if (entry.PatternString.size() && !entry.AddressPointer)
+		{
+			Patterns.push_back(entry.PatternString);
+			Entries.push_back(&entry);
+		}
+	}
+
+	if (Patterns.empty())
+	{
+		return;
+	}
+
+	std::vector<void*> Results;
+	Utils::FindPatterns(GetModuleHandle(nullptr), Patterns, Results);
+
+	for (size_t x = 0; x < Entries.size(); x++)
+	{
+		Entries[x]->AddressPointer = Results[x];
+	}
+}
+
+// Get values that identify the exe image, used to validate cached pattern offsets
+void Settings::GetModuleImageInfo(DWORD& TimeDateStamp, DWORD& CheckSum, DWORD& SizeOfImage)
+{
+	PIMAGE_DOS_HEADER pDosHeader = (PIMAGE_DOS_HEADER)GetModuleHandle(nullptr);
+	PIMAGE_NT_HEADERS pNtHeader = (PIMAGE_NT_HEADERS)((char*)pDosHeader + pDosHeader->e_lfanew);
+	TimeDateStamp = pNtHeader->FileHeader.TimeDateStamp;
+	CheckSum = pNtHeader->OptionalHeader.CheckSum;
+	SizeOfImage = pNtHeader->OptionalHeader.SizeOfImage;
+}
+
+// Load parsed config from binary snapshot
+bool Settings::LoadConfigCache(ULONGLONG ContentHash)
+{
+	WIN32_FILE_ATTRIBUTE_DATA FileData = {};
+	if (!GetFileAttributesExA(configpath, GetFileExInfoStandard, &FileData))
+	{
+		return false;
+	}
+
+	std::string cachepath = std::string(configpath) + ".cache";
+	char* szCache = Read(&cachepath[0]);
+	if (!szCache)
+	{
+		return false;
+	}
+
+	bool Result = false;
+	bool Loading = false;
+	WIN32_FILE_ATTRIBUTE_DATA CacheData = {};
+	CONFIGCACHEHEADER Header, CachedHeader;
+	if (GetFileAttributesExA(cachepath.c_str(), GetFileExInfoStandard, &CacheData) && CacheData.nFileSizeLow >= sizeof(CONFIGCACHEHEADER))
+	{
+		memcpy(&CachedHeader, szCache, sizeof(CONFIGCACHEHEADER));
+
+		// Verify snapshot matches this build and this config file
+		if (CachedHeader.Magic == Header.Magic && CachedHeader.Version == Header.Version && CachedHeader.Layout == Header.Layout &&
+			CachedHeader.FileSize == FileData.nFileSizeLow && CompareFileTime(&CachedHeader.LastWriteTime, &FileData.ftLastWriteTime) == 0 &&
+			CachedHeader.ContentHash == ContentHash && CachedHeader.DataSize == CacheData.nFileSizeLow - sizeof(CONFIGCACHEHEADER))
+		{
+			Loading = true;
+
+			DWORD TimeDateStamp, CheckSum, SizeOfImage;
+			GetModuleImageInfo(TimeDateStamp, CheckSum, SizeOfImage);
+			PatternCacheValid = (CachedHeader.ModuleTimeDateStamp == TimeDateStamp && CachedHeader.ModuleCheckSum == CheckSum &&
+				CachedHeader.ModuleSizeOfImage == SizeOfImage);
+
+			const char* pos = szCache + sizeof(CONFIGCACHEHEADER);
+			const char* end = pos + CachedHeader.DataSize;
+
+			Result = VISIT_CONFIG_SETTINGS(LOAD_VALUE)
+				VISIT_APPCOMPATDATA_SETTINGS(LOAD_APPCOMPATDATA_VALUE)
+				VISIT_LOCAL_SETTINGS(LOAD_LOCAL_VALUE)
+				VISIT_LEGACY_SETTINGS(LOAD_LOCAL_VALUE)
+				LoadValue(pos, end, &Config.DisableMaxWindowedModeNotSet) &&
+				LoadValue(pos, end, &Config.VerifyMemoryInfo) &&
+				LoadValue(pos, end, &Config.MemoryInfo) &&
+				LoadValue(pos, end, &AddressPointerCount) &&
+				LoadValue(pos, end, &BytesToWriteCount) &&
+				pos == end;
+		}
+	}
+	free(szCache);
+
+	// Snapshot was only partly loaded, start over from defaults
+	if (Loading && !Result)
+	{
+		VISIT_LOCAL_SETTINGS(CLEAR_LOCAL_VALUE);
+		VISIT_LEGACY_SETTINGS(CLEAR_LOCAL_VALUE);
+		ClearConfigSettings();
+		SetDefaultConfigSettings();
+	}
+
+	return Result;
+}
+
+// Save parsed config as binary snapshot
+void Settings::SaveConfigCache(ULONGLONG ContentHash)
+{
+	WIN32_FILE_ATTRIBUTE_DATA FileData = {};
+	if (!GetFileAttributesExA(configpath, GetFileExInfoStandard, &FileData))
+	{
+		return;
+	}
+
+	std::string data;
+	SaveConfigData(data);
+
+	CONFIGCACHEHEADER Header;
+	Header.FileSize = FileData.nFileSizeLow;
+	Header.LastWriteTime = FileData.ftLastWriteTime;
+	Header.ContentHash = ContentHash;
+	GetModuleImageInfo(Header.ModuleTimeDateStamp, Header.ModuleCheckSum, Header.ModuleSizeOfImage);
+	Header.DataSize = (DWORD)data.size();
+
+	// The game folder may be read-only so failures are ignored
+	std::string cachepath = std::string(configpath) + ".cache";
+	HANDLE hFile = CreateFileA(cachepath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		DWORD dwBytesWritten = 0;
+		if (!WriteFile(hFile, &Header, sizeof(Header), &dwBytesWritten, nullptr) ||
+			!WriteFile(hFile, data.data(), (DWORD)data.size(), &dwBytesWritten, nullptr))
+		{
+			CloseHandle(hFile);
+			DeleteFileA(cachepath.c_str());
+			return;
+		}
+		CloseHandle(hFile);
+	}
+}
+
+// Serialize all parsed settings in snapshot order
+void Settings::SaveConfigData(std::string& data)
+{
+	VISIT_CONFIG_SETTINGS(SAVE_VALUE);
+	VISIT_APPCOMPATDATA_SETTINGS(SAVE_APPCOMPATDATA_VALUE);
+	VISIT_LOCAL_SETTINGS(SAVE_LOCAL_VALUE);
+	VISIT_LEGACY_SETTINGS(SAVE_LOCAL_VALUE);
+	SaveValue(data, &Config.DisableMaxWindowedModeNotSet);
+	SaveValue(data, &Config.VerifyMemoryInfo);
+	SaveValue(data, &Config.MemoryInfo);
+	SaveValue(data, &AddressPointerCount);
+	SaveValue(data, &BytesToWriteCount);
+}
+
+#ifdef _DEBUG
+// Parse the config file again and check that it gives the same settings as the snapshot
+void Settings::VerifyConfigCache(const char* szCfg)
+{
+	std::string CachedData;
+	SaveConfigData(CachedData);
+
+	VISIT_LOCAL_SETTINGS(CLEAR_LOCAL_VALUE);
+	VISIT_LEGACY_SETTINGS(CLEAR_LOCAL_VALUE);
+	ClearConfigSettings();
+	SetDefaultConfigSettings();
+
+	// Parser modifies the string so parse a copy
+	std::string szCopy(szCfg);
+	Parse(&szCopy[0], ParseCallback);
+	ResolvePatterns();
+
+	std::string ParsedData;
+	SaveConfigData(ParsedData);
+
+	// Parsed settings are kept either way, remove the snapshot so it gets rebuilt
+	if (CachedData != ParsedData)
+	{
+		size_t Offset = 0;
+		while (Offset < CachedData.size() && Offset < ParsedData.size() && CachedData[Offset] == ParsedData[Offset])
+		{
+			Offset++;
+		}
+		Logging::Log() << __FUNCTION__ << " Error: config cache does not match parsed config at offset " << Offset <<
+			"! Cached size: " << CachedData.size() << " Parsed size: " << ParsedData.size();
+		DeleteFileA((std::string(configpath) + ".cache").c_str());
+	}
+}
+#endif
+
 // Clear pointers
 void Settings::ClearValue(void** setting)
 {
@@ -549,8 +917,7 @@ void CONFIG::Init()
 	// Parce config file
 	if (szCfg)
 	{
-		ConfigLoaded = true;
-		Parse(szCfg, ParseCallback);
+		ParseConfig(szCfg);
 		free(szCfg);
 	}
 	// If cannot load config file check for default config
@@ -566,8 +933,7 @@ void CONFIG::Init()
 		// Parce config file
 		if (szCfg)
 		{
-			ConfigLoaded = true;
-			Parse(szCfg, ParseCallback);
+			ParseConfig(szCfg);
 			free(szCfg);
 		}
 	}
@@ -623,7 +989,7 @@ void CONFIG::SetConfig()
 	// If config file was read
 	if (ConfigLoaded)
 	{
-		Logging::Log() << "Reading config file: " << configpath;
+		Logging::Log() << "Reading config file: " << configpath << ((ConfigCacheLoaded) ? " (from cache)" : "");
 	}
 	else
 	{
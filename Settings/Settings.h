@@ -11,7 +11,11 @@
 #define VISIT_CONFIG_SETTINGS(visit) \
 	visit(AnisotropicFiltering) \
 	visit(AntiAliasing) \
+	visit(AudioBufferCacheSize) \
 	visit(AudioClipDetection) \
+	visit(AudioConvertStaticBuffers) \
+	visit(AudioCursorResyncMS) \
+	visit(AudioDefer3DUpdatesMS) \
 	visit(AudioFadeOutDelayMS) \
 	visit(CustomResolutionWidth) \
 	visit(CustomResolutionHeight) \
@@ -34,6 +38,7 @@
 	visit(DdrawEmulateLock) \
 	visit(DdrawFillSurfaceColor) \
 	visit(DdrawForceMipMapAutoGen) \
+	visit(DdrawDeferMipMapLevels) \
 	visit(DdrawFlipFillColor) \
 	visit(DdrawRemoveScanlines) \
 	visit(DdrawRemoveInterlacing) \
@@ -45,6 +50,7 @@
 	visit(DdrawIntegerScalingClamp) \
 	visit(DdrawLimitDisplayModeCount) \
 	visit(DdrawLimitTextureFormats) \
+	visit(DdrawLogFrameStats) \
 	visit(DdrawMaintainAspectRatio) \
 	visit(DdrawOverrideBitMode) \
 	visit(DdrawOverrideWidth) \
@@ -62,24 +68,31 @@
 	visit(DsoundHookSystem32) \
 	visit(SetSwapEffectShim) \
 	visit(DeviceLookupCacheTime) \
+	visit(DeviceStateSnapshotMS) \
 	visit(DisableGameUX) \
 	visit(DisableHighDPIScaling) \
 	visit(DisableLogging) \
 	visit(DirectShowEmulation) \
 	visit(CacheClipPlane) \
+	visit(ConfigCache) \
 	visit(EnvironmentMapCubeFix) \
 	visit(ConvertToDirectDraw7) \
 	visit(ConvertToDirect3D7) \
+	visit(EnableApiProfiling) \
 	visit(EnableDdrawWrapper) \
 	visit(EnableD3d9Wrapper) \
 	visit(EnableDinput8Wrapper) \
 	visit(EnableDsoundWrapper) \
 	visit(EnableImgui) \
 	visit(EnableOpenDialogHook) \
+	visit(EnableTextureDirtyTracking) \
+	visit(EnableUPDrawBuffering) \
+	visit(EnableTraceLogging) \
 	visit(EnableVSync) \
 	visit(EnableWindowMode) \
 	visit(ExcludeProcess) \
 	visit(ForceDirect3D9On12) \
+	visit(ForceDynamicBufferLockFlags) \
 	visit(ForceExclusiveFullscreen) \
 	visit(ForceMixedVertexProcessing) \
 	visit(ForceSystemMemVertexCache) \
@@ -121,10 +134,12 @@
 	visit(PrimaryBufferBits) \
 	visit(PrimaryBufferChannels) \
 	visit(PrimaryBufferSamples) \
+	visit(QueryPollBackoff) \
 	visit(RealDllPath) \
 	visit(ResetMemoryAfter) \
 	visit(ResetScreenRes) \
 	visit(LimitStateBlocks) \
+	visit(OptimizeStateBlocks) \
 	visit(RunProcess) \
 	visit(SendAltEnter) \
 	visit(SetFullScreenLayer) \
@@ -247,6 +262,7 @@ struct CONFIG
 	bool DdrawDisableDirect3DCaps = false;		// Disable caps for Direct3D to try and force the game to use DirectDraw instaed of Direct3D
 	bool DdrawLimitTextureFormats = false;		// Limits the number of texture formats sent to the program, some games crash when you feed them with too many textures
 	bool DdrawLimitDisplayModeCount = false;	// Limits the number of display modes sent to program, some games crash when you feed them with too many resolutions
+	DWORD DdrawLogFrameStats = 0;				// Logs the average draw statistics per frame every this many frames when using Dd7to9, 0 disables it
 	DWORD DdrawOverrideBitMode = 0;				// Forces DirectX to use specified bit mode: 8, 16, 24, 32
 	DWORD DdrawOverrideWidth = 0;				// Force Direct3d9 to use this width when using Dd7to9
 	DWORD DdrawOverrideHeight = 0;				// Force Direct3d9 to use this height when using Dd7to9
@@ -254,6 +270,7 @@ struct CONFIG
 	DWORD DdrawOverrideStencilFormat = 0;		// Force Direct3d9 to use this AutoStencilFormat when using Dd7to9
 	DWORD DdrawFlipFillColor = 0;				// Color used to fill the primary surface before flipping
 	bool DdrawForceMipMapAutoGen = false;		// Force Direct3d9 to use this AutoStencilFormat when using Dd7to9
+	bool DdrawDeferMipMapLevels = false;		// Creates MipMap textures with only the top level until a lower level is used
 	bool DdrawEnableMouseHook = false;			// Allow to hook into mouse to limit it to the chosen resolution
 	DWORD DdrawHookSystem32 = 0;				// Hooks the ddraw.dll file in the Windows System32 folder
 	DWORD D3d8HookSystem32 = 0;					// Hooks the d3d8.dll file in the Windows System32 folder
@@ -262,10 +279,12 @@ struct CONFIG
 	DWORD Dinput8HookSystem32 = 0;				// Hooks the dinput8.dll file in the Windows System32 folder
 	DWORD DsoundHookSystem32 = 0;				// Hooks the dsound.dll file in the Windows System32 folder
 	DWORD DeviceLookupCacheTime = 0;			// Number of seconds to cache the DeviceEnum callback data
+	DWORD DeviceStateSnapshotMS = 0;			// Polls acquired keyboards and joysticks on a background thread so GetDeviceState reads the latest snapshot
 	bool DirectShowEmulation = false;			// Emulates DirectShow APIs
 	bool DisableGameUX = false;					// Disables the Microsoft Game Explorer which can sometimes cause high CPU in rundll32.exe and hang the game process
 	bool DisableHighDPIScaling = false;			// Disables display scaling on high DPI settings
 	bool DisableLogging = false;				// Disables the logging file
+	bool ConfigCache = false;					// Saves a binary snapshot of the parsed config so unchanged ini files load without parsing
 	DWORD SetSwapEffectShim = 0;				// Disables the call to d3d9.dll 'Direct3D9SetSwapEffectUpgradeShim' to switch present mode
 	DWORD CacheClipPlane = 0;					// Caches the ClipPlane for Direct3D9 to fix an issue in d3d9 on Windows 8 and newer
 	DWORD EnvironmentMapCubeFix = 0;			// Fixes environment cube maps when no texture is applied, issue exists in d3d8
@@ -273,18 +292,23 @@ struct CONFIG
 	bool ConvertToDirect3D7 = false;			// Converts Direct3D 1-6 to Direct3D 7
 	DWORD CustomResolutionWidth = 0;			// Custom resolution width when using LimitDisplayModeCount, resolution must be supported by video card and monitor
 	DWORD CustomResolutionHeight = 0;			// Custom resolution height when using LimitDisplayModeCount, resolution must be supported by video card and monitor
+	bool EnableApiProfiling = false;			// Times wrapped API calls and periodically logs per-method latency percentiles
 	bool EnableDdrawWrapper = false;			// Enables the ddraw wrapper
 	DWORD EnableD3d9Wrapper = 0;				// Enables the d3d9 wrapper
 	bool EnableDinput8Wrapper = false;			// Enables the dinput8 wrapper
 	bool EnableDsoundWrapper = false;			// Enables the dsound wrapper
 	bool EnableImgui = false;					// Enables imgui for debugging
 	bool EnableOpenDialogHook = false;			// Enables the hooks for the open dialog box
+	bool EnableTextureDirtyTracking = false;	// Diffs whole-texture locks on managed d3d9 textures so only changed rows are re-uploaded
+	bool EnableUPDrawBuffering = false;			// Copies d3d9 DrawPrimitiveUP and DrawIndexedPrimitiveUP data to wrapper-owned dynamic buffers
+	bool EnableTraceLogging = false;			// Records hot API calls to a per-thread binary ring that is decoded to the log by a background thread
 	bool EnableWindowMode = false;				// Enables WndMode for d3d9 wrapper
 	bool EnableVSync = false;					// Enables VSync for d3d9 wrapper
 	bool FixHighFrequencyMouse = false;			// Gets the latest mouse status by merging the DirectInput buffer data
 	float MouseMovementFactor = 1.0f;			// Sets the mouse movement speed factor, requires enabling FixHighFrequencyMouse
 	DWORD MouseMovementPadding = 0;				// Adds extra mouse movement to overcome issues with input deadzone in some games, requires enabling FixHighFrequencyMouse
 	bool ForceDirect3D9On12 = false;			// Forces Direct3D9 to use CreateDirect3D9On12
+	bool ForceDynamicBufferLockFlags = false;	// Adds D3DLOCK_NOOVERWRITE or D3DLOCK_DISCARD to plain locks on dynamic write-only buffers in d3d9
 	bool ForceExclusiveFullscreen = false;		// Forces exclusive fullscreen mode in d3d9
 	bool ForceMixedVertexProcessing = false;	// Forces Mixed mode for vertex processing in d3d9
 	bool ForceSystemMemVertexCache = false;		// Forces System Memory caching for vertexes in d3d9
@@ -304,6 +328,7 @@ struct CONFIG
 	bool ProcessExcluded = false;				// Set if this process is excluded from dxwrapper functions
 	bool ResetScreenRes = false;				// Reset the screen resolution on close
 	DWORD LimitStateBlocks = 0;					// Reuses state block interfaces to prevent memory leaks
+	bool OptimizeStateBlocks = false;			// Records d3d9 state blocks as sparse lists and only applies states that differ from the current state
 	bool SendAltEnter = false;					// Sends an Alt+Enter message to the wind to tell it to go into fullscreen, requires FullScreen
 	bool WaitForProcess = false;				// Waits for process to end before continuing, requires FullScreen
 	bool WaitForWindowChanges = false;			// Waits for window handle to stabilize before setting fullsreen, requires FullScreen
@@ -320,6 +345,7 @@ struct CONFIG
 	DWORD SetFullScreenLayer = 0;				// The layer to be selected for fullscreen, requires FullScreen
 	DWORD AnisotropicFiltering = 0;				// Enable Anisotropic Filtering for d3d9
 	DWORD AntiAliasing = 0;						// Enable AntiAliasing for d3d9 CreateDevice
+	DWORD QueryPollBackoff = 0;					// Number of back-to-back d3d9 query GetData polls before the wrapper starts yielding, 0 disables
 	DWORD RealWrapperMode = 0;					// Internal wrapper mode
 	MEMORYINFO VerifyMemoryInfo;				// Memory used for verification before hot patching
 	std::string WinVersionLie = "";				// Using DDrawCompat WinVersionLie to tell the OS a different OS
@@ -357,8 +383,12 @@ struct CONFIG
 	DWORD PrimaryBufferBits = 0;
 	DWORD PrimaryBufferSamples = 0;
 	DWORD PrimaryBufferChannels = 0;
+	DWORD AudioBufferCacheSize = 0;
 	bool AudioClipDetection = false;
+	bool AudioConvertStaticBuffers = false;
+	DWORD AudioCursorResyncMS = 0;
 	DWORD AudioFadeOutDelayMS = 0;
+	DWORD AudioDefer3DUpdatesMS = 0;
 	bool FixSpeakerConfigType = false;
 	bool StoppedDriverWorkaround = false;
 };
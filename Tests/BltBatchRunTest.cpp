@@ -0,0 +1,288 @@
+#include <deque>
+#include <mutex>
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "ddraw/BltBatchRun.h"
+
+// Software surface, sprites are copied with an optional source color key like CopySurface does
+struct MOCKSURFACE
+{
+	LONG Width, Height;
+	std::vector<DWORD> Pixels;
+	DWORD ColorKey = 0xFF00FF;
+	std::mutex CriticalSection;
+
+	MOCKSURFACE(LONG Width, LONG Height) : Width(Width), Height(Height), Pixels((size_t)Width * Height) {}
+
+	LPDIRECTDRAWSURFACE GetInterface()
+	{
+		return reinterpret_cast<LPDIRECTDRAWSURFACE>(this);
+	}
+
+	void CopySurface(const MOCKSURFACE& Src, const RECT& SrcRect, const RECT& DestRect, bool IsColorKey)
+	{
+		for (LONG y = 0; y < SrcRect.bottom - SrcRect.top; y++)
+		{
+			const DWORD* pSrc = &Src.Pixels[(size_t)(SrcRect.top + y) * Src.Width + SrcRect.left];
+			DWORD* pDest = &Pixels[(size_t)(DestRect.top + y) * Width + DestRect.left];
+			for (LONG x = 0; x < SrcRect.right - SrcRect.left; x++)
+			{
+				if (!IsColorKey || pSrc[x] != Src.ColorKey)
+				{
+					pDest[x] = pSrc[x];
+				}
+			}
+		}
+	}
+};
+
+// Destination that follows the steps m_IDirectDrawSurfaceX takes for each Blt and for each BltBatchCopy run
+struct MOCKDEST : MOCKSURFACE
+{
+	std::vector<MOCKSURFACE*> SurfaceTable;		// Stands in for the address lookup table search done by Blt
+	DWORD SetupCount = 0;
+
+	MOCKDEST(LONG Width, LONG Height) : MOCKSURFACE(Width, Height) {}
+
+	MOCKSURFACE* FindSurface(LPDIRECTDRAWSURFACE lpDDSrcSurface)
+	{
+		SetupCount++;
+		for (MOCKSURFACE* pSurface : SurfaceTable)
+		{
+			if (pSurface->GetInterface() == lpDDSrcSurface)
+			{
+				return pSurface;
+			}
+		}
+		return nullptr;
+	}
+
+	HRESULT Blt(const DDBLTBATCH& Entry)
+	{
+		MOCKSURFACE* pSrc = FindSurface(Entry.lpDDSSrc);
+		if (!pSrc)
+		{
+			return E_FAIL;
+		}
+		std::lock_guard<std::mutex> Lock(pSrc->CriticalSection);
+		CopySurface(*pSrc, *Entry.lprSrc, *Entry.lprDest, (Entry.dwFlags & DDBLT_KEYSRC) != 0);
+		return S_OK;
+	}
+
+	HRESULT BltBatchCopy(const DDBLTBATCH* lpDDBltBatch, DWORD dwCount)
+	{
+		MOCKSURFACE* pSrc = FindSurface(lpDDBltBatch[0].lpDDSSrc);
+		if (!pSrc)
+		{
+			return E_FAIL;
+		}
+		const bool IsColorKey = (lpDDBltBatch[0].dwFlags & DDBLT_KEYSRC) != 0;
+		std::lock_guard<std::mutex> Lock(pSrc->CriticalSection);
+		for (DWORD x = 0; x < dwCount; x++)
+		{
+			CopySurface(*pSrc, *lpDDBltBatch[x].lprSrc, *lpDDBltBatch[x].lprDest, IsColorKey);
+		}
+		return S_OK;
+	}
+
+	HRESULT BltBatch(const DDBLTBATCH* lpDDBltBatch, DWORD dwCount)
+	{
+		std::lock_guard<std::mutex> Lock(CriticalSection);
+		for (DWORD x = 0; x < dwCount; )
+		{
+			DWORD RunCount = BltBatchRun::GetCopyRunLength(&lpDDBltBatch[x], dwCount - x);
+			HRESULT hr;
+			if (RunCount > 1)
+			{
+				hr = BltBatchCopy(&lpDDBltBatch[x], RunCount);
+			}
+			else
+			{
+				RunCount = 1;
+				hr = Blt(lpDDBltBatch[x]);
+			}
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+			x += RunCount;
+		}
+		return S_OK;
+	}
+
+	// What BltBatch did before, a full Blt for each entry
+	HRESULT BltEach(const DDBLTBATCH* lpDDBltBatch, DWORD dwCount)
+	{
+		std::lock_guard<std::mutex> Lock(CriticalSection);
+		for (DWORD x = 0; x < dwCount; x++)
+		{
+			if (FAILED(Blt(lpDDBltBatch[x])))
+			{
+				return E_FAIL;
+			}
+		}
+		return S_OK;
+	}
+};
+
+// Sprite batch from a few texture atlases, SortedRuns controls how many sprites in a row share an atlas
+struct SPRITEBATCH
+{
+	std::vector<RECT> SrcRects, DestRects;
+	std::vector<DDBLTBATCH> Entries;
+
+	SPRITEBATCH(std::mt19937& Random, std::vector<MOCKSURFACE*>& Atlases, const MOCKSURFACE& Dest, DWORD Count, DWORD SortedRuns, LONG Size = 16) :
+		SrcRects(Count), DestRects(Count), Entries(Count)
+	{
+		for (DWORD x = 0; x < Count; x++)
+		{
+			MOCKSURFACE* pAtlas = Atlases[(x / SortedRuns) % Atlases.size()];
+			const LONG SrcX = (LONG)(Random() % (pAtlas->Width / Size)) * Size;
+			const LONG SrcY = (LONG)(Random() % (pAtlas->Height / Size)) * Size;
+			const LONG DestX = (LONG)(Random() % (Dest.Width - Size));
+			const LONG DestY = (LONG)(Random() % (Dest.Height - Size));
+			SrcRects[x] = { SrcX, SrcY, SrcX + Size, SrcY + Size };
+			DestRects[x] = { DestX, DestY, DestX + Size, DestY + Size };
+			Entries[x] = { &DestRects[x], pAtlas->GetInterface(), &SrcRects[x], DDBLT_WAIT | DDBLT_KEYSRC, nullptr };
+		}
+	}
+};
+
+static void FillAtlas(std::mt19937& Random, MOCKSURFACE& Atlas)
+{
+	for (DWORD& Pixel : Atlas.Pixels)
+	{
+		Pixel = (Random() % 4) ? (DWORD)Random() & 0xFFFFFF : Atlas.ColorKey;
+	}
+}
+
+TEST_CASE(RunsOnlyGroupAdjacentCopiesFromOneSource)
+{
+	MOCKSURFACE A(16, 16), B(16, 16);
+	RECT Rect = { 0, 0, 4, 4 };
+	const DDBLTBATCH Batch[] = {
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, B.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT | DDBLT_KEYSRC, nullptr },
+		{ &Rect, A.GetInterface(), &Rect, DDBLT_WAIT | DDBLT_KEYSRC, nullptr },
+	};
+
+	CHECK_EQUAL(3u, BltBatchRun::GetCopyRunLength(&Batch[0], 7));
+	CHECK_EQUAL(2u, BltBatchRun::GetCopyRunLength(&Batch[1], 6));
+	CHECK_EQUAL(1u, BltBatchRun::GetCopyRunLength(&Batch[3], 4));
+	CHECK_EQUAL(1u, BltBatchRun::GetCopyRunLength(&Batch[4], 3));
+	CHECK_EQUAL(2u, BltBatchRun::GetCopyRunLength(&Batch[5], 2));
+	CHECK_EQUAL(2u, BltBatchRun::GetCopyRunLength(&Batch[0], 2));
+	CHECK_EQUAL(0u, BltBatchRun::GetCopyRunLength(&Batch[0], 0));
+}
+
+TEST_CASE(OtherBltsAreNotGrouped)
+{
+	MOCKSURFACE A(16, 16);
+	RECT Rect = { 0, 0, 4, 4 };
+	const DWORD OtherFlags[] = { DDBLT_COLORFILL, DDBLT_ROP, DDBLT_DDFX, DDBLT_DONOTWAIT };
+	for (DWORD Flag : OtherFlags)
+	{
+		const DDBLTBATCH Batch[] = {
+			{ &Rect, A.GetInterface(), &Rect, (DWORD)(DDBLT_WAIT | Flag), nullptr },
+			{ &Rect, A.GetInterface(), &Rect, (DWORD)(DDBLT_WAIT | Flag), nullptr },
+		};
+		CHECK_EQUAL(0u, BltBatchRun::GetCopyRunLength(Batch, 2));
+	}
+
+	// Color fills have no source surface
+	const DDBLTBATCH Fill[] = {
+		{ &Rect, nullptr, nullptr, DDBLT_WAIT, nullptr },
+		{ &Rect, nullptr, nullptr, DDBLT_WAIT, nullptr },
+	};
+	CHECK_EQUAL(0u, BltBatchRun::GetCopyRunLength(Fill, 2));
+}
+
+TEST_CASE(BatchedRunsMatchPerEntryBlt)
+{
+	std::mt19937 Random(43);
+	MOCKSURFACE A(128, 128), B(128, 64), C(64, 64);
+	FillAtlas(Random, A);
+	FillAtlas(Random, B);
+	FillAtlas(Random, C);
+	std::vector<MOCKSURFACE*> Atlases = { &A, &B, &C };
+
+	// Overlapping sprites, the result depends on the order of the entries
+	for (DWORD SortedRuns : { 1u, 3u, 50u })
+	{
+		MOCKDEST Batched(160, 120), Each(160, 120);
+		Batched.SurfaceTable = Atlases;
+		Each.SurfaceTable = Atlases;
+
+		SPRITEBATCH Sprites(Random, Atlases, Batched, 300, SortedRuns);
+		CHECK_EQUAL(S_OK, Batched.BltBatch(Sprites.Entries.data(), 300));
+		CHECK_EQUAL(S_OK, Each.BltEach(Sprites.Entries.data(), 300));
+		CHECK(Batched.Pixels == Each.Pixels);
+
+		// One source lookup for each run instead of each entry
+		CHECK_EQUAL(300u, Each.SetupCount);
+		CHECK_EQUAL((SortedRuns == 1) ? 300u : (300u + SortedRuns - 1) / SortedRuns, Batched.SetupCount);
+	}
+}
+
+TEST_CASE(UnknownSourceStopsBatch)
+{
+	MOCKSURFACE A(16, 16), Unknown(16, 16);
+	MOCKDEST Dest(16, 16);
+	Dest.SurfaceTable = { &A };
+	RECT Rect = { 0, 0, 4, 4 };
+	const DDBLTBATCH Batch[] = {
+		{ &Rect, Unknown.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+		{ &Rect, Unknown.GetInterface(), &Rect, DDBLT_WAIT, nullptr },
+	};
+	CHECK_EQUAL(E_FAIL, Dest.BltBatch(Batch, 2));
+}
+
+static void BenchmarkSprites(DWORD SortedRuns)
+{
+	std::mt19937 Random(1);
+	std::deque<MOCKSURFACE> Atlases;
+	std::vector<MOCKSURFACE*> AtlasList;
+	for (DWORD x = 0; x < 12; x++)
+	{
+		Atlases.emplace_back(256, 256);
+		FillAtlas(Random, Atlases.back());
+		AtlasList.push_back(&Atlases.back());
+	}
+
+	// The lookup table holds every surface the game created, not only the atlases
+	std::deque<MOCKSURFACE> OtherSurfaces;
+	MOCKDEST Dest(640, 480);
+	for (DWORD x = 0; x < 200; x++)
+	{
+		OtherSurfaces.emplace_back(1, 1);
+		Dest.SurfaceTable.push_back(&OtherSurfaces.back());
+	}
+	Dest.SurfaceTable.insert(Dest.SurfaceTable.end(), AtlasList.begin(), AtlasList.end());
+
+	SPRITEBATCH Sprites(Random, AtlasList, Dest, 1000, SortedRuns, 8);
+
+	const double Batched = TestHarness::Measure(200, [&]()
+	{
+		Dest.BltBatch(Sprites.Entries.data(), 1000);
+	});
+	const double Each = TestHarness::Measure(200, [&]()
+	{
+		Dest.BltEach(Sprites.Entries.data(), 1000);
+	});
+	std::printf("    1000 8x8 sprites, runs of %u: %.1f us batched, %.1f us per entry\n", SortedRuns, Batched / 1000.0, Each / 1000.0);
+}
+
+BENCHMARK_CASE(SpriteBatchInterleavedAtlases)
+{
+	BenchmarkSprites(1);
+}
+
+BENCHMARK_CASE(SpriteBatchSortedByAtlas)
+{
+	BenchmarkSprites(100);
+}
@@ -0,0 +1,209 @@
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "Settings/ConfigCache.h"
+
+using namespace Settings;
+
+// Settings of every type the snapshot stores, filled from a synthetic ini
+struct SYNTHETICCONFIG
+{
+	std::vector<DWORD> Numbers;
+	std::vector<float> Floats;
+	std::vector<bool> Flags;
+	std::vector<std::string> Strings;
+	std::vector<std::vector<std::string>> Lists;
+
+	bool operator==(const SYNTHETICCONFIG& other) const
+	{
+		return Numbers == other.Numbers && Floats == other.Floats && Flags == other.Flags && Strings == other.Strings && Lists == other.Lists;
+	}
+};
+
+constexpr DWORD SettingCount = 400;
+
+// Large ini with comments, sections, repeated settings and mixed whitespace and line endings
+static std::string MakeIni(std::mt19937& Random)
+{
+	std::string Ini = "; Synthetic config\r\n[Compatibility]\n";
+	for (DWORD Pass = 0; Pass < 3; Pass++)
+	{
+		for (DWORD x = 0; x < SettingCount; x++)
+		{
+			const std::string Index = std::to_string(x);
+			switch (Random() % 6)
+			{
+			case 0:
+				Ini += "; Number" + Index + " = 99\n";
+				break;
+			case 1:
+				Ini += "# Float" + Index + " = 99\n";
+				break;
+			case 2:
+				Ini += "// String" + Index + " = commented\n";
+				break;
+			default:
+				break;
+			}
+			Ini += "Number" + Index + " = " + std::to_string(Random() % 100000) + "\r\n";
+			Ini += "\tFloat" + Index + "\t=\t" + std::to_string((Random() % 1000) / 8.0f) + "  // quarter steps\n";
+			Ini += "Flag" + Index + ":" + ((Random() % 2) ? "1" : "0") + "\n";
+			Ini += "String" + Index + " = Value " + std::to_string(Random()) + " with spaces   \n";
+			Ini += "List" + Index + " = a" + std::to_string(Random() % 7) + ",b,c\n\n";
+		}
+		Ini += "[Pass" + std::to_string(Pass) + "]\n";
+	}
+	return Ini;
+}
+
+static SYNTHETICCONFIG ParseIni(const std::string& Ini)
+{
+	SYNTHETICCONFIG Config;
+	for (DWORD x = 0; x < SettingCount; x++)
+	{
+		const std::string Index = std::to_string(x);
+		std::string Value;
+
+		CHECK(FindSettingValue(Ini.c_str(), ("Number" + Index).c_str(), Value));
+		Config.Numbers.push_back((DWORD)strtoul(Value.c_str(), nullptr, 10));
+		CHECK(FindSettingValue(Ini.c_str(), ("Float" + Index).c_str(), Value));
+		Config.Floats.push_back(strtof(Value.c_str(), nullptr));
+		CHECK(FindSettingValue(Ini.c_str(), ("Flag" + Index).c_str(), Value));
+		Config.Flags.push_back(atoi(Value.c_str()) > 0);
+		CHECK(FindSettingValue(Ini.c_str(), ("String" + Index).c_str(), Value));
+		Config.Strings.push_back(Value);
+		CHECK(FindSettingValue(Ini.c_str(), ("List" + Index).c_str(), Value));
+		std::vector<std::string> List;
+		for (size_t Start = 0, End; Start <= Value.size(); Start = End + 1)
+		{
+			End = Value.find(',', Start);
+			End = (End == std::string::npos) ? Value.size() : End;
+			List.push_back(Value.substr(Start, End - Start));
+		}
+		Config.Lists.push_back(List);
+	}
+	return Config;
+}
+
+static void SaveConfig(std::string& Data, const SYNTHETICCONFIG& Config)
+{
+	for (DWORD x = 0; x < SettingCount; x++)
+	{
+		const bool Flag = Config.Flags[x];
+		SaveValue(Data, &Config.Numbers[x]);
+		SaveValue(Data, &Config.Floats[x]);
+		SaveValue(Data, &Flag);
+		SaveValue(Data, &Config.Strings[x]);
+		SaveValue(Data, &Config.Lists[x]);
+	}
+}
+
+// Same all-or-nothing check as LoadConfigCache
+static bool LoadConfig(const std::string& Data, SYNTHETICCONFIG& Config)
+{
+	const char* pos = Data.data();
+	const char* end = pos + Data.size();
+
+	Config = SYNTHETICCONFIG();
+	for (DWORD x = 0; x < SettingCount; x++)
+	{
+		DWORD Number = 0;
+		float Float = 0.0f;
+		bool Flag = false;
+		std::string String;
+		std::vector<std::string> List;
+		if (!LoadValue(pos, end, &Number) || !LoadValue(pos, end, &Float) || !LoadValue(pos, end, &Flag) ||
+			!LoadValue(pos, end, &String) || !LoadValue(pos, end, &List))
+		{
+			return false;
+		}
+		Config.Numbers.push_back(Number);
+		Config.Floats.push_back(Float);
+		Config.Flags.push_back(Flag);
+		Config.Strings.push_back(String);
+		Config.Lists.push_back(List);
+	}
+	return pos == end;
+}
+
+TEST_CASE(LargeIniRoundTripsThroughTheSnapshot)
+{
+	std::mt19937 Random(42);
+	const std::string Ini = MakeIni(Random);
+	CHECK(Ini.size() > 64 * 1024);
+
+	const SYNTHETICCONFIG Parsed = ParseIni(Ini);
+	CHECK(Parsed.Strings[0].find("Value ") == 0);
+	CHECK(Parsed.Strings[0].back() != ' ');
+	CHECK_EQUAL(3u, (DWORD)Parsed.Lists[0].size());
+
+	std::string Data;
+	SaveConfig(Data, Parsed);
+
+	SYNTHETICCONFIG Loaded;
+	CHECK(LoadConfig(Data, Loaded));
+	CHECK(Loaded == Parsed);
+
+	// Saving what was loaded gives the same bytes
+	std::string Again;
+	SaveConfig(Again, Loaded);
+	CHECK(Again == Data);
+}
+
+TEST_CASE(TruncatedOrPaddedSnapshotIsRejected)
+{
+	std::mt19937 Random(7);
+	const SYNTHETICCONFIG Parsed = ParseIni(MakeIni(Random));
+	std::string Data;
+	SaveConfig(Data, Parsed);
+
+	SYNTHETICCONFIG Loaded;
+	bool AnyLoaded = false;
+	for (size_t Size = 0; Size < Data.size(); Size += 1 + Size / 64)
+	{
+		AnyLoaded = AnyLoaded || LoadConfig(Data.substr(0, Size), Loaded);
+	}
+	CHECK(!AnyLoaded);
+	CHECK(!LoadConfig(Data.substr(0, Data.size() - 1), Loaded));
+	CHECK(!LoadConfig(Data + '\0', Loaded));
+
+	// String length that runs past the end
+	std::string Bad;
+	const std::string Entry = "abc";
+	SaveValue(Bad, &Entry);
+	Bad[0] = 100;
+	const char* pos = Bad.data();
+	std::string Value;
+	CHECK(!LoadValue(pos, Bad.data() + Bad.size(), &Value));
+}
+
+TEST_CASE(ConfigCacheSettingIsFoundBeforeParsing)
+{
+	std::string Value;
+
+	CHECK(!FindSettingValue("", "ConfigCache", Value));
+	CHECK(!FindSettingValue("ConfigCacheSize = 1\n", "ConfigCache", Value));
+	CHECK(!FindSettingValue("; ConfigCache = 1\n# ConfigCache = 1\n// ConfigCache = 1\n", "ConfigCache", Value));
+	CHECK(!FindSettingValue("ConfigCache =   \r\n", "ConfigCache", Value));
+	CHECK(!FindSettingValue("Other = 1 // ConfigCache = 1\n", "ConfigCache", Value));
+
+	CHECK(FindSettingValue("[General]\r\n  configcache\t= 1\r\n", "ConfigCache", Value) && Value == "1");
+	CHECK(FindSettingValue("ConfigCache : on // enabled\n", "ConfigCache", Value) && Value == "on");
+	CHECK(FindSettingValue("ConfigCache=1", "ConfigCache", Value) && Value == "1");
+
+	// Last value wins like in Parse
+	CHECK(FindSettingValue("ConfigCache = 1\nConfigCache = 0\n", "ConfigCache", Value) && Value == "0");
+}
+
+BENCHMARK_CASE(FindSettingValueInLargeIni)
+{
+	std::mt19937 Random(1);
+	const std::string Ini = MakeIni(Random) + "ConfigCache = 1\n";
+
+	std::string Value;
+	const double Time = TestHarness::Measure(200, [&]() {
+		FindSettingValue(Ini.c_str(), "ConfigCache", Value);
+	});
+
+	std::printf("    %u KB ini: %8.1f us per lookup\n", (unsigned)(Ini.size() / 1024), Time / 1e3);
+}
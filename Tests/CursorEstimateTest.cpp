@@ -0,0 +1,210 @@
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "dsound/CursorEstimate.h"
+
+static constexpr LONGLONG Frequency = 10000000;		// Performance counter ticks per second
+
+// Looping buffer on a simulated clock. The driver only moves its cursors once per period, so they trail the real
+// playback position by up to one period, and the write cursor leads the play cursor by a fixed amount.
+struct MOCKDRIVER
+{
+	DWORD BufferBytes;
+	DWORD BlockAlign;
+	DWORD SamplesPerSec;
+	LONGLONG Period;
+	DWORD WriteLead;
+	LONGLONG StartTime = 0;
+	DWORD StartCursor = 0;
+	DWORD QueryCount = 0;
+
+	MOCKDRIVER(DWORD Bytes, DWORD Align, DWORD Rate, DWORD PeriodMS = 10) :
+		BufferBytes(Bytes), BlockAlign(Align), SamplesPerSec(Rate), Period(Frequency * PeriodMS / 1000),
+		WriteLead((Rate * 15 / 1000) * Align) {}
+
+	ULONGLONG GetPlayedBytes(LONGLONG Now) const
+	{
+		return (ULONGLONG)(Now - StartTime) * SamplesPerSec / Frequency * BlockAlign;
+	}
+
+	// Real position of the playback at Now
+	DWORD GetTruePosition(LONGLONG Now) const
+	{
+		return (DWORD)((StartCursor + GetPlayedBytes(Now)) % BufferBytes);
+	}
+
+	void GetCurrentPosition(LONGLONG Now, DWORD& PlayCursor, DWORD& WriteCursor)
+	{
+		QueryCount++;
+		const LONGLONG Updated = StartTime + (Now - StartTime) / Period * Period;
+		PlayCursor = GetTruePosition(Updated);
+		WriteCursor = (PlayCursor + WriteLead) % BufferBytes;
+	}
+
+	void SetCurrentPosition(LONGLONG Now, DWORD Cursor)
+	{
+		StartTime = Now;
+		StartCursor = Cursor;
+	}
+};
+
+// Same steps as m_IDirectSoundBuffer8::GetCurrentPosition with AudioCursorResyncMS set
+struct MOCKBUFFER
+{
+	MOCKDRIVER& Driver;
+	CURSORESTIMATE CursorEstimate;
+	DWORD ResyncMS;
+
+	MOCKBUFFER(MOCKDRIVER& Driver, DWORD ResyncMS) : Driver(Driver), ResyncMS(ResyncMS) {}
+
+	void GetCurrentPosition(LONGLONG Now, DWORD& PlayCursor, DWORD& WriteCursor)
+	{
+		if (CursorEstimate.Get(Now, Frequency, ResyncMS, PlayCursor, WriteCursor))
+		{
+			return;
+		}
+		Driver.GetCurrentPosition(Now, PlayCursor, WriteCursor);
+		if (!CursorEstimate.IsFormatSet)
+		{
+			CursorEstimate.SetFormat(Driver.BufferBytes, Driver.BlockAlign, Driver.SamplesPerSec);
+		}
+		CursorEstimate.Sync(PlayCursor, WriteCursor, Now);
+	}
+};
+
+// Distance from Cursor forward to Position in a looping buffer
+static DWORD GetDistance(DWORD Cursor, DWORD Position, DWORD BufferBytes)
+{
+	return (Position + BufferBytes - Cursor) % BufferBytes;
+}
+
+TEST_CASE(EstimateNeverOvertakesPlayback)
+{
+	MOCKDRIVER Driver(44100 * 4, 4, 44100);
+	MOCKBUFFER Buffer(Driver, 20);
+
+	DWORD MaxBehind = 0;
+	for (LONGLONG Now = 0; Now < Frequency * 3; Now += Frequency / 1000 + 137)
+	{
+		DWORD PlayCursor, WriteCursor;
+		Buffer.GetCurrentPosition(Now, PlayCursor, WriteCursor);
+
+		// Behind the real position by less than a driver period plus a block
+		const DWORD Behind = GetDistance(PlayCursor, Driver.GetTruePosition(Now), Driver.BufferBytes);
+		CHECK(Behind <= 441 * 4 + 4);
+		MaxBehind = max(MaxBehind, Behind);
+
+		CHECK_EQUAL(0u, PlayCursor % 4);
+		CHECK_EQUAL(Driver.WriteLead, GetDistance(PlayCursor, WriteCursor, Driver.BufferBytes));
+	}
+	CHECK(MaxBehind > 0);
+}
+
+TEST_CASE(DriverQueriedOncePerResyncInterval)
+{
+	MOCKDRIVER Driver(22050 * 2 * 2, 4, 22050);
+	MOCKBUFFER Buffer(Driver, 20);
+
+	// Game polling every 0.1 ms for one second
+	for (LONGLONG Now = 0; Now < Frequency; Now += Frequency / 10000)
+	{
+		DWORD PlayCursor, WriteCursor;
+		Buffer.GetCurrentPosition(Now, PlayCursor, WriteCursor);
+	}
+	CHECK_EQUAL(50u, Driver.QueryCount);
+}
+
+TEST_CASE(CursorWrapsAroundBuffer)
+{
+	MOCKDRIVER Driver(4410 * 4, 4, 44100);		// 100 ms buffer
+	MOCKBUFFER Buffer(Driver, 50);
+	Driver.SetCurrentPosition(0, Driver.BufferBytes - 400);
+
+	DWORD PlayCursor, WriteCursor;
+	Buffer.GetCurrentPosition(0, PlayCursor, WriteCursor);
+	CHECK_EQUAL(Driver.BufferBytes - 400, PlayCursor);
+
+	// 5 ms later the cursor has wrapped past the end
+	Buffer.GetCurrentPosition(Frequency * 5 / 1000, PlayCursor, WriteCursor);
+	CHECK_EQUAL(1u, Driver.QueryCount);
+	CHECK_EQUAL(220u * 4 - 400, PlayCursor);
+	CHECK(PlayCursor < Driver.BufferBytes && WriteCursor < Driver.BufferBytes);
+}
+
+TEST_CASE(InvalidateForcesDriverQuery)
+{
+	MOCKDRIVER Driver(44100 * 4, 4, 44100);
+	MOCKBUFFER Buffer(Driver, 100);
+
+	DWORD PlayCursor, WriteCursor;
+	Buffer.GetCurrentPosition(0, PlayCursor, WriteCursor);
+	Buffer.GetCurrentPosition(Frequency / 100, PlayCursor, WriteCursor);
+	CHECK_EQUAL(1u, Driver.QueryCount);
+
+	// SetCurrentPosition moves the cursor, the estimate must not be used
+	Driver.SetCurrentPosition(Frequency / 50, 8000);
+	Buffer.CursorEstimate.Invalidate(false);
+	Buffer.GetCurrentPosition(Frequency / 50, PlayCursor, WriteCursor);
+	CHECK_EQUAL(2u, Driver.QueryCount);
+	CHECK_EQUAL(8000u, PlayCursor);
+
+	// SetFrequency changes the rate, the format is read again on the next sync
+	Buffer.CursorEstimate.Invalidate(true);
+	CHECK(!Buffer.CursorEstimate.IsFormatSet);
+	Driver.SamplesPerSec = 22050;
+	Driver.SetCurrentPosition(Frequency / 20, 0);
+	Buffer.GetCurrentPosition(Frequency / 20, PlayCursor, WriteCursor);
+	Buffer.GetCurrentPosition(Frequency / 20 + Frequency / 100, PlayCursor, WriteCursor);
+	CHECK_EQUAL(3u, Driver.QueryCount);
+	CHECK_EQUAL(220u * 4, PlayCursor);
+}
+
+TEST_CASE(ClockGoingBackwardsResyncs)
+{
+	CURSORESTIMATE Estimate;
+	Estimate.SetFormat(1000, 4, 1000);
+	Estimate.Sync(100, 200, Frequency);
+
+	DWORD PlayCursor, WriteCursor;
+	CHECK(Estimate.Get(Frequency, Frequency, 20, PlayCursor, WriteCursor));
+	CHECK(!Estimate.Get(Frequency - 1, Frequency, 20, PlayCursor, WriteCursor));
+	CHECK(!Estimate.Get(Frequency + Frequency / 50, Frequency, 20, PlayCursor, WriteCursor));
+}
+
+TEST_CASE(BadCursorsOrFormatAreNotEstimated)
+{
+	CURSORESTIMATE Estimate;
+	DWORD PlayCursor, WriteCursor;
+
+	// No format yet
+	Estimate.Sync(100, 200, 0);
+	CHECK(!Estimate.Get(0, Frequency, 20, PlayCursor, WriteCursor));
+
+	Estimate.SetFormat(0, 4, 44100);
+	CHECK(!Estimate.IsFormatSet);
+	Estimate.SetFormat(1000, 0, 44100);
+	CHECK(!Estimate.IsFormatSet);
+
+	Estimate.SetFormat(1000, 4, 44100);
+	Estimate.Sync(1000, 200, 0);
+	CHECK(!Estimate.Get(0, Frequency, 20, PlayCursor, WriteCursor));
+	Estimate.Sync(100, 1200, 0);
+	CHECK(!Estimate.Get(0, Frequency, 20, PlayCursor, WriteCursor));
+
+	Estimate.Sync(100, 200, 0);
+	CHECK(Estimate.Get(0, Frequency, 20, PlayCursor, WriteCursor));
+}
+
+BENCHMARK_CASE(EstimatedPollCost)
+{
+	MOCKDRIVER Driver(44100 * 4, 4, 44100);
+	MOCKBUFFER Buffer(Driver, 20);
+	LONGLONG Now = 0;
+	DWORD PlayCursor, WriteCursor;
+
+	const double Time = TestHarness::Measure(1000000, [&]()
+	{
+		Now += Frequency / 100000;
+		Buffer.GetCurrentPosition(Now, PlayCursor, WriteCursor);
+	});
+	std::printf("    poll: %.1f ns, %u driver queries for 1000000 polls over %.0f ms\n", Time, Driver.QueryCount, Now * 1000.0 / Frequency);
+}
@@ -0,0 +1,226 @@
+#include <string>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "dsound/Deferred3DUpdates.h"
+
+// Proxy listener that records the calls made on it, in order
+struct MOCKLISTENER
+{
+	std::vector<std::string>& Calls;
+	std::string Name;
+	ULONG Ref = 1;
+	bool IsFreed = false;
+
+	MOCKLISTENER(std::vector<std::string>& CallLog, const char* ListenerName) : Calls(CallLog), Name(ListenerName) {}
+
+	HRESULT CommitDeferredSettings()
+	{
+		CHECK(!IsFreed);
+		Calls.push_back(Name + ".CommitDeferredSettings");
+		return DS_OK;
+	}
+	ULONG AddRef()
+	{
+		CHECK(!IsFreed);
+		return ++Ref;
+	}
+	ULONG Release()
+	{
+		CHECK(!IsFreed);
+		if (--Ref == 0)
+		{
+			IsFreed = true;
+			Calls.push_back(Name + ".Free");
+		}
+		return Ref;
+	}
+};
+
+// Forwards a parameter the same way Deferred3DUpdates::SetParameter does
+static void SetParameter(DEFERRED3DSTATE<MOCKLISTENER>& State, void* pDevice, std::vector<std::string>& Calls, const char* Name, DWORD dwApply)
+{
+	if (dwApply == DS3D_DEFERRED)
+	{
+		State.SetAppDeferred(pDevice);
+	}
+	const bool IsDeferred = State.DeferUpdate(pDevice, dwApply, true);
+	Calls.push_back(std::string(Name) + ((dwApply == DS3D_DEFERRED) ? "(DEFERRED)" : "(IMMEDIATE)"));
+	if (IsDeferred)
+	{
+		State.SetPending(pDevice);
+	}
+}
+
+static bool IsEqual(const std::vector<std::string>& Calls, const std::vector<std::string>& Expected)
+{
+	if (Calls != Expected)
+	{
+		for (const auto& entry : Calls)
+		{
+			std::printf("    call: %s\n", entry.c_str());
+		}
+		return false;
+	}
+	return true;
+}
+
+TEST_CASE(ImmediateUpdatesAreCommittedOncePerTick)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device = 0;
+	MOCKLISTENER Listener(Calls, "Listener");
+
+	State.AddListener(&Device, &Listener);
+	SetParameter(State, &Device, Calls, "Buffer1.SetPosition", DS3D_IMMEDIATE);
+	SetParameter(State, &Device, Calls, "Buffer2.SetPosition", DS3D_IMMEDIATE);
+	SetParameter(State, &Device, Calls, "Listener.SetVelocity", DS3D_IMMEDIATE);
+	State.CommitAll();
+	State.CommitAll();
+
+	CHECK(IsEqual(Calls, {
+		"Buffer1.SetPosition(DEFERRED)",
+		"Buffer2.SetPosition(DEFERRED)",
+		"Listener.SetVelocity(DEFERRED)",
+		"Listener.CommitDeferredSettings" }));
+}
+
+TEST_CASE(QueryCommitsBeforeReading)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device = 0;
+	MOCKLISTENER Listener(Calls, "Listener");
+
+	State.AddListener(&Device, &Listener);
+	SetParameter(State, &Device, Calls, "Buffer.SetPosition", DS3D_IMMEDIATE);
+	State.Commit(&Device);
+	Calls.push_back("Buffer.GetPosition");
+	State.Commit(&Device);
+	Calls.push_back("Buffer.GetVelocity");
+
+	CHECK(IsEqual(Calls, {
+		"Buffer.SetPosition(DEFERRED)",
+		"Listener.CommitDeferredSettings",
+		"Buffer.GetPosition",
+		"Buffer.GetVelocity" }));
+}
+
+TEST_CASE(ApplicationDeferredUpdatesAreLeftToTheApplication)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device = 0;
+	MOCKLISTENER Listener(Calls, "Listener");
+
+	State.AddListener(&Device, &Listener);
+	SetParameter(State, &Device, Calls, "Buffer.SetPosition", DS3D_IMMEDIATE);
+	SetParameter(State, &Device, Calls, "Buffer.SetVelocity", DS3D_DEFERRED);
+	SetParameter(State, &Device, Calls, "Buffer.SetMode", DS3D_IMMEDIATE);
+	State.CommitAll();
+	State.Commit(&Device);
+	CHECK(State.IsAppDeferred(&Device));
+
+	// Application commits through the listener
+	Calls.push_back("Listener.CommitDeferredSettings");
+	State.ClearAppDeferred(&Device);
+	SetParameter(State, &Device, Calls, "Buffer.SetPosition", DS3D_IMMEDIATE);
+	State.CommitAll();
+
+	CHECK(IsEqual(Calls, {
+		"Buffer.SetPosition(DEFERRED)",
+		"Listener.CommitDeferredSettings",
+		"Buffer.SetVelocity(DEFERRED)",
+		"Buffer.SetMode(IMMEDIATE)",
+		"Listener.CommitDeferredSettings",
+		"Buffer.SetPosition(DEFERRED)",
+		"Listener.CommitDeferredSettings" }));
+}
+
+TEST_CASE(DeviceWithoutListenerIsNotDeferred)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device1 = 0, Device2 = 0;
+	MOCKLISTENER Listener(Calls, "Listener1");
+
+	State.AddListener(&Device1, &Listener);
+	SetParameter(State, &Device2, Calls, "Device2.Buffer.SetPosition", DS3D_IMMEDIATE);
+	SetParameter(State, &Device1, Calls, "Device1.Buffer.SetPosition", DS3D_IMMEDIATE);
+	State.CommitAll();
+
+	CHECK(IsEqual(Calls, {
+		"Device2.Buffer.SetPosition(IMMEDIATE)",
+		"Device1.Buffer.SetPosition(DEFERRED)",
+		"Listener1.CommitDeferredSettings" }));
+}
+
+TEST_CASE(DevicesAreCommittedThroughTheirOwnListener)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device1 = 0, Device2 = 0;
+	MOCKLISTENER Listener1(Calls, "Listener1"), Listener2(Calls, "Listener2");
+
+	State.AddListener(&Device1, &Listener1);
+	State.AddListener(&Device2, &Listener2);
+	SetParameter(State, &Device2, Calls, "Device2.Buffer.SetPosition", DS3D_IMMEDIATE);
+	State.Commit(&Device1);
+	State.Commit(&Device2);
+
+	CHECK(IsEqual(Calls, {
+		"Device2.Buffer.SetPosition(DEFERRED)",
+		"Listener2.CommitDeferredSettings" }));
+}
+
+TEST_CASE(SecondListenerStopsDeferring)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device = 0;
+	MOCKLISTENER Listener1(Calls, "Listener1"), Listener2(Calls, "Listener2");
+
+	State.AddListener(&Device, &Listener1);
+	SetParameter(State, &Device, Calls, "Buffer.SetPosition", DS3D_IMMEDIATE);
+	State.AddListener(&Device, &Listener2);
+	SetParameter(State, &Device, Calls, "Buffer.SetVelocity", DS3D_IMMEDIATE);
+	State.RemoveListener(&Device, &Listener2);
+	SetParameter(State, &Device, Calls, "Buffer.SetMode", DS3D_IMMEDIATE);
+	State.CommitAll();
+
+	CHECK(IsEqual(Calls, {
+		"Buffer.SetPosition(DEFERRED)",
+		"Listener1.CommitDeferredSettings",
+		"Buffer.SetVelocity(IMMEDIATE)",
+		"Buffer.SetMode(DEFERRED)",
+		"Listener1.CommitDeferredSettings" }));
+}
+
+TEST_CASE(ReleaseCommitsBeforeTheLastReference)
+{
+	std::vector<std::string> Calls;
+	DEFERRED3DSTATE<MOCKLISTENER> State;
+	int Device = 0;
+	MOCKLISTENER Listener(Calls, "Listener");
+	Listener.Ref = 2;
+
+	State.AddListener(&Device, &Listener);
+	SetParameter(State, &Device, Calls, "Buffer.SetPosition", DS3D_IMMEDIATE);
+
+	// Not the last reference, pending updates stay deferred
+	CHECK_EQUAL(1u, State.ReleaseListener(&Device, &Listener));
+	CHECK(!State.IsEmpty());
+
+	CHECK_EQUAL(0u, State.ReleaseListener(&Device, &Listener));
+	CHECK(State.IsEmpty());
+
+	// Timer ticks after the release must not reach the freed listener
+	SetParameter(State, &Device, Calls, "Buffer.SetVelocity", DS3D_IMMEDIATE);
+	State.CommitAll();
+
+	CHECK(IsEqual(Calls, {
+		"Buffer.SetPosition(DEFERRED)",
+		"Listener.CommitDeferredSettings",
+		"Listener.Free",
+		"Buffer.SetVelocity(IMMEDIATE)" }));
+}
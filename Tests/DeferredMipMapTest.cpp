@@ -0,0 +1,274 @@
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "ddraw/DeferredMipMap.h"
+
+// Device that only records what would be allocated on the GPU
+struct MOCKDEVICE
+{
+	DWORD TextureCount = 0;
+	ULONGLONG TextureBytes = 0;
+
+	ULONGLONG CreateTexture(DWORD Width, DWORD Height, DWORD Levels, DWORD BytesPerPixel)
+	{
+		ULONGLONG Bytes = 0;
+		for (DWORD x = 0; x < Levels; x++)
+		{
+			Bytes += (ULONGLONG)DeferredMipMap::GetLevelSize(Width, x) * DeferredMipMap::GetLevelSize(Height, x) * BytesPerPixel;
+		}
+		TextureCount++;
+		TextureBytes += Bytes;
+		return Bytes;
+	}
+
+	void ReleaseTexture(ULONGLONG Bytes)
+	{
+		TextureBytes -= Bytes;
+	}
+};
+
+// MipMap texture that follows the same steps as m_IDirectDrawSurfaceX for create, lock, GetDC and texture use
+struct MOCKSURFACE
+{
+	MOCKDEVICE& Device;
+	DWORD Width, Height, LevelCount;
+	bool IsDeferred = false;
+	bool IsLocked = false;
+	bool IsInDC = false;
+	bool IsUsingEmulation = false;
+	ULONGLONG TextureBytes = 0;
+	std::vector<ULONGLONG> EmulatedBytes;		// Emulated DC memory of each level below the top
+
+	static constexpr DWORD BytesPerPixel = 4;
+
+	MOCKSURFACE(MOCKDEVICE& Device, DWORD Width, DWORD Height, DWORD LevelCount, bool IsEnabled, bool IsAutoGen = false, bool IsDefaultPool = false) :
+		Device(Device), Width(Width), Height(Height), LevelCount(LevelCount), EmulatedBytes(LevelCount - 1, 0)
+	{
+		IsDeferred = DeferredMipMap::ShouldDefer(IsEnabled, IsAutoGen, LevelCount, IsDefaultPool);
+		TextureBytes = Device.CreateTexture(Width, Height, DeferredMipMap::GetCreateLevelCount(IsDeferred, LevelCount), BytesPerPixel);
+	}
+
+	HRESULT CreateDeferredMipMapLevels()
+	{
+		if (!IsDeferred)
+		{
+			return S_OK;
+		}
+		if (!DeferredMipMap::CanCreateChain(IsLocked, IsInDC))
+		{
+			return E_FAIL;
+		}
+		IsDeferred = false;
+		const ULONGLONG NewBytes = Device.CreateTexture(Width, Height, LevelCount, BytesPerPixel);
+		Device.ReleaseTexture(TextureBytes);
+		TextureBytes = NewBytes;
+		return S_OK;
+	}
+
+	HRESULT CheckDeferredMipMapLevels(DWORD MipMapLevel)
+	{
+		return (DeferredMipMap::IsChainRequired(IsDeferred, MipMapLevel) && FAILED(CreateDeferredMipMapLevels()) && IsDeferred) ? E_FAIL : S_OK;
+	}
+
+	HRESULT Lock(DWORD MipMapLevel)
+	{
+		if (FAILED(CheckDeferredMipMapLevels(MipMapLevel)))
+		{
+			return E_FAIL;
+		}
+		IsLocked = true;
+		return S_OK;
+	}
+
+	void Unlock()
+	{
+		IsLocked = false;
+	}
+
+	HRESULT GetDC(DWORD MipMapLevel)
+	{
+		if (MipMapLevel && DeferredMipMap::IsDCEmulated(IsUsingEmulation, false, false))
+		{
+			// Emulated memory for the level is created the first time it is used
+			ULONGLONG& Bytes = EmulatedBytes[MipMapLevel - 1];
+			if (!Bytes)
+			{
+				Bytes = (ULONGLONG)DeferredMipMap::GetLevelSize(Width, MipMapLevel) * DeferredMipMap::GetLevelSize(Height, MipMapLevel) * BytesPerPixel;
+			}
+		}
+		else if (FAILED(CheckDeferredMipMapLevels(MipMapLevel)))
+		{
+			return E_FAIL;
+		}
+		IsInDC = true;
+		return S_OK;
+	}
+
+	void ReleaseDC()
+	{
+		IsInDC = false;
+	}
+
+	// Drawing with a MipMap filter generates the levels, which needs the whole chain
+	void Draw(bool IsMipFilter)
+	{
+		if (IsMipFilter)
+		{
+			CreateDeferredMipMapLevels();
+		}
+	}
+
+	ULONGLONG GetEmulatedBytes() const
+	{
+		ULONGLONG Bytes = 0;
+		for (ULONGLONG Level : EmulatedBytes)
+		{
+			Bytes += Level;
+		}
+		return Bytes;
+	}
+};
+
+TEST_CASE(DeferOnlyManagedNonAutoGenChains)
+{
+	CHECK(DeferredMipMap::ShouldDefer(true, false, 9, false));
+	CHECK(!DeferredMipMap::ShouldDefer(false, false, 9, false));
+	CHECK(!DeferredMipMap::ShouldDefer(true, true, 9, false));
+	CHECK(!DeferredMipMap::ShouldDefer(true, false, 9, true));
+	CHECK(!DeferredMipMap::ShouldDefer(true, false, 1, false));
+	CHECK(!DeferredMipMap::ShouldDefer(true, false, 0, false));
+
+	CHECK_EQUAL(1u, DeferredMipMap::GetCreateLevelCount(true, 9));
+	CHECK_EQUAL(9u, DeferredMipMap::GetCreateLevelCount(false, 9));
+}
+
+TEST_CASE(LevelSizeNeverZero)
+{
+	CHECK_EQUAL(256u, DeferredMipMap::GetLevelSize(256, 0));
+	CHECK_EQUAL(2u, DeferredMipMap::GetLevelSize(256, 7));
+	CHECK_EQUAL(1u, DeferredMipMap::GetLevelSize(256, 8));
+	CHECK_EQUAL(1u, DeferredMipMap::GetLevelSize(64, 7));
+	CHECK_EQUAL(1u, DeferredMipMap::GetLevelSize(1, 3));
+	CHECK_EQUAL(1u, DeferredMipMap::GetLevelSize(0x80000000, 40));
+	CHECK_EQUAL(12u, DeferredMipMap::GetLevelSize(100, 3));
+}
+
+TEST_CASE(TopLevelUseKeepsChainDeferred)
+{
+	MOCKDEVICE Device;
+	MOCKSURFACE Surface(Device, 256, 256, 9, true);
+
+	CHECK(Surface.IsDeferred);
+	CHECK_EQUAL(256u * 256 * 4, Device.TextureBytes);
+
+	CHECK_EQUAL(S_OK, Surface.Lock(0));
+	Surface.Unlock();
+	CHECK_EQUAL(S_OK, Surface.GetDC(0));
+	Surface.ReleaseDC();
+	Surface.Draw(false);
+
+	CHECK(Surface.IsDeferred);
+	CHECK_EQUAL(1u, Device.TextureCount);
+	CHECK_EQUAL(256u * 256 * 4, Device.TextureBytes);
+}
+
+TEST_CASE(LowerLevelCreatesChainOnce)
+{
+	MOCKDEVICE Device;
+	MOCKSURFACE Surface(Device, 256, 128, 8, true);
+	MOCKDEVICE FullDevice;
+	MOCKSURFACE FullSurface(FullDevice, 256, 128, 8, false);
+
+	CHECK_EQUAL(S_OK, Surface.Lock(3));
+	Surface.Unlock();
+	CHECK(!Surface.IsDeferred);
+	CHECK_EQUAL(2u, Device.TextureCount);
+	CHECK_EQUAL(FullDevice.TextureBytes, Device.TextureBytes);
+
+	// Later levels reuse the chain
+	CHECK_EQUAL(S_OK, Surface.Lock(7));
+	Surface.Unlock();
+	CHECK_EQUAL(S_OK, Surface.GetDC(1));
+	Surface.ReleaseDC();
+	Surface.Draw(true);
+	CHECK_EQUAL(2u, Device.TextureCount);
+	CHECK_EQUAL(FullDevice.TextureBytes, Device.TextureBytes);
+}
+
+TEST_CASE(MipFilterDrawCreatesChain)
+{
+	MOCKDEVICE Device;
+	MOCKSURFACE Surface(Device, 64, 64, 7, true);
+
+	Surface.Draw(true);
+	CHECK(!Surface.IsDeferred);
+	CHECK_EQUAL(2u, Device.TextureCount);
+}
+
+TEST_CASE(ChainNotReplacedWhileTopLevelBusy)
+{
+	MOCKDEVICE Device;
+	MOCKSURFACE Surface(Device, 128, 128, 8, true);
+
+	// A lower level cannot be used while the top level is locked, the texture would be replaced under the lock
+	CHECK_EQUAL(S_OK, Surface.Lock(0));
+	CHECK_EQUAL(E_FAIL, Surface.CheckDeferredMipMapLevels(2));
+	CHECK(Surface.IsDeferred);
+	Surface.Unlock();
+
+	CHECK_EQUAL(S_OK, Surface.GetDC(0));
+	CHECK_EQUAL(E_FAIL, Surface.CheckDeferredMipMapLevels(1));
+	Surface.ReleaseDC();
+	CHECK_EQUAL(1u, Device.TextureCount);
+
+	CHECK_EQUAL(S_OK, Surface.Lock(2));
+	Surface.Unlock();
+	CHECK(!Surface.IsDeferred);
+	CHECK_EQUAL(2u, Device.TextureCount);
+}
+
+TEST_CASE(EmulatedDCMemoryPerLevelOnFirstUse)
+{
+	MOCKDEVICE Device;
+	MOCKSURFACE Surface(Device, 128, 64, 8, true);
+	Surface.IsUsingEmulation = true;
+
+	CHECK_EQUAL(0u, Surface.GetEmulatedBytes());
+
+	CHECK_EQUAL(S_OK, Surface.GetDC(2));
+	Surface.ReleaseDC();
+	CHECK_EQUAL(32u * 16 * 4, Surface.GetEmulatedBytes());
+
+	CHECK_EQUAL(S_OK, Surface.GetDC(2));
+	Surface.ReleaseDC();
+	CHECK_EQUAL(32u * 16 * 4, Surface.GetEmulatedBytes());
+
+	CHECK_EQUAL(S_OK, Surface.GetDC(7));
+	Surface.ReleaseDC();
+	CHECK_EQUAL(32u * 16 * 4 + 1 * 1 * 4, Surface.GetEmulatedBytes());
+
+	CHECK(DeferredMipMap::IsDCEmulated(false, true, false));
+	CHECK(DeferredMipMap::IsDCEmulated(false, false, true));
+	CHECK(!DeferredMipMap::IsDCEmulated(false, false, false));
+}
+
+TEST_CASE(TextureHeavyFootprint)
+{
+	// Textures that are only ever used at the top level save the quarter of the memory held by the lower levels
+	MOCKDEVICE Deferred, Full;
+	std::vector<MOCKSURFACE> DeferredSurfaces, FullSurfaces;
+	for (DWORD x = 0; x < 500; x++)
+	{
+		DeferredSurfaces.emplace_back(Deferred, 256, 256, 9, true);
+		FullSurfaces.emplace_back(Full, 256, 256, 9, false);
+	}
+	for (DWORD x = 0; x < 500; x++)
+	{
+		DeferredSurfaces[x].Lock(0);
+		DeferredSurfaces[x].Unlock();
+		DeferredSurfaces[x].Draw(false);
+	}
+
+	CHECK_EQUAL(500u * 256 * 256 * 4, Deferred.TextureBytes);
+	CHECK(Deferred.TextureBytes * 4 < Full.TextureBytes * 3 + 500 * 4 * 9);
+	CHECK(Deferred.TextureBytes * 4 > Full.TextureBytes * 3 - 500 * 4 * 9);
+}
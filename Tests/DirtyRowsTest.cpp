@@ -0,0 +1,178 @@
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "d3d9/DirtyRows.h"
+
+struct ROWRANGE
+{
+	UINT Start;
+	UINT End;
+};
+
+// Managed texture level, the runtime copy is what the application locks and the GPU copy only gets the dirty rows
+struct MOCKTEXTURE
+{
+	UINT Width, Height, BlockHeight;
+	size_t Pitch;
+	std::vector<BYTE> Runtime;
+	std::vector<BYTE> Gpu;
+	std::vector<BYTE> Shadow;
+	ULONGLONG UploadedBytes = 0;
+	DWORD DirtyRects = 0;
+
+	static constexpr UINT MergeGap = 8;
+
+	MOCKTEXTURE(UINT Width, UINT Height, UINT BytesPerBlock, UINT BlockHeight = 1) :
+		Width(Width), Height(Height), BlockHeight(BlockHeight), Pitch((size_t)((BlockHeight == 1) ? Width : Width / 4) * BytesPerBlock),
+		Runtime(Pitch * GetRows()), Gpu(Runtime), Shadow(Runtime) {}
+
+	UINT GetRows() const
+	{
+		return (Height + BlockHeight - 1) / BlockHeight;
+	}
+
+	// Same rect as m_IDirect3DTexture9::AddChangedRows, converted back to rows for the upload
+	void AddDirtyRect(UINT Top, UINT Bottom)
+	{
+		DirtyRects++;
+		for (UINT y = Top / BlockHeight; y < (Bottom + BlockHeight - 1) / BlockHeight; y++)
+		{
+			memcpy(Gpu.data() + y * Pitch, Runtime.data() + y * Pitch, Pitch);
+			UploadedBytes += Pitch;
+		}
+	}
+
+	void Unlock()
+	{
+		DiffDirtyRows(Shadow.data(), Runtime.data(), Pitch, GetRows(), MergeGap, [&](UINT Start, UINT End)
+		{
+			AddDirtyRect(Start * BlockHeight, min(End * BlockHeight, Height));
+		});
+	}
+};
+
+static std::vector<ROWRANGE> Diff(std::vector<BYTE>& Shadow, const std::vector<BYTE>& Bits, size_t Pitch, UINT MergeGap)
+{
+	std::vector<ROWRANGE> Ranges;
+	DiffDirtyRows(Shadow.data(), Bits.data(), Pitch, (UINT)(Bits.size() / Pitch), MergeGap, [&](UINT Start, UINT End)
+	{
+		Ranges.push_back({ Start, End });
+	});
+	return Ranges;
+}
+
+TEST_CASE(UnchangedLockAddsNothing)
+{
+	std::vector<BYTE> Bits(16 * 32, 7), Shadow(Bits);
+	CHECK(Diff(Shadow, Bits, 16, 8).empty());
+}
+
+TEST_CASE(ChangedRowsAreReportedAndCopied)
+{
+	std::vector<BYTE> Bits(16 * 64, 0), Shadow(Bits);
+	Bits[3 * 16 + 5] = 1;
+	Bits[40 * 16 + 15] = 1;
+	Bits[41 * 16] = 1;
+
+	const std::vector<ROWRANGE> Ranges = Diff(Shadow, Bits, 16, 0);
+	CHECK_EQUAL(2u, Ranges.size());
+	CHECK_EQUAL(3u, Ranges[0].Start);
+	CHECK_EQUAL(4u, Ranges[0].End);
+	CHECK_EQUAL(40u, Ranges[1].Start);
+	CHECK_EQUAL(42u, Ranges[1].End);
+	CHECK(Shadow == Bits);
+
+	// The shadow is current afterwards, the same data is not reported again
+	CHECK(Diff(Shadow, Bits, 16, 0).empty());
+}
+
+TEST_CASE(NearbyRangesAreMerged)
+{
+	std::vector<BYTE> Bits(4 * 64, 0), Shadow(Bits);
+	Bits[10 * 4] = 1;
+	Bits[19 * 4] = 1;		// Gap of 8 rows after row 10 is merged
+	Bits[29 * 4] = 1;		// Gap of 9 rows after row 19 is not
+	Bits[63 * 4] = 1;
+
+	const std::vector<ROWRANGE> Ranges = Diff(Shadow, Bits, 4, 8);
+	CHECK_EQUAL(3u, Ranges.size());
+	CHECK_EQUAL(10u, Ranges[0].Start);
+	CHECK_EQUAL(20u, Ranges[0].End);
+	CHECK_EQUAL(29u, Ranges[1].Start);
+	CHECK_EQUAL(30u, Ranges[1].End);
+	CHECK_EQUAL(63u, Ranges[2].Start);
+	CHECK_EQUAL(64u, Ranges[2].End);
+}
+
+TEST_CASE(GpuCopyMatchesAfterRandomLocks)
+{
+	std::mt19937 Random(37);
+	MOCKTEXTURE Texture(64, 100, 4);
+
+	for (DWORD Lock = 0; Lock < 500; Lock++)
+	{
+		const DWORD Writes = Random() % 6;
+		for (DWORD x = 0; x < Writes; x++)
+		{
+			Texture.Runtime[Random() % Texture.Runtime.size()] = (BYTE)Random();
+		}
+		Texture.Unlock();
+		CHECK(Texture.Gpu == Texture.Runtime);
+	}
+}
+
+TEST_CASE(BlockRowsCoverWholeDXTBlocks)
+{
+	// 64x30 DXT1 texture, 8 rows of 4x4 blocks with the last one cut to 2 pixel rows
+	MOCKTEXTURE Texture(64, 30, 8, 4);
+	CHECK_EQUAL(8u, Texture.GetRows());
+	CHECK_EQUAL(128u, Texture.Pitch);
+
+	Texture.Runtime[7 * Texture.Pitch + 3] = 0xFF;
+	Texture.Unlock();
+	CHECK_EQUAL(1u, Texture.DirtyRects);
+	CHECK_EQUAL(128u, Texture.UploadedBytes);
+	CHECK(Texture.Gpu == Texture.Runtime);
+}
+
+TEST_CASE(FewChangedRowsUploadLittle)
+{
+	MOCKTEXTURE Texture(256, 256, 4);
+
+	// Scrolling text line of a texture-based console
+	for (DWORD Frame = 0; Frame < 60; Frame++)
+	{
+		const UINT Row = (Frame * 16) % 240;
+		for (UINT y = Row; y < Row + 16; y++)
+		{
+			Texture.Runtime[y * Texture.Pitch + Frame % Texture.Pitch] ^= 0x5A;
+		}
+		Texture.Unlock();
+	}
+
+	CHECK(Texture.Gpu == Texture.Runtime);
+	CHECK_EQUAL(60u, Texture.DirtyRects);
+	CHECK_EQUAL(60u * 16 * Texture.Pitch, Texture.UploadedBytes);
+}
+
+BENCHMARK_CASE(DiffCostOfUnchangedLevel)
+{
+	MOCKTEXTURE Texture(1024, 1024, 4);
+	const double Time = TestHarness::Measure(200, [&]()
+	{
+		Texture.Unlock();
+	});
+	std::printf("    1024x1024 unchanged: %.1f us, full upload would be %u KB\n", Time / 1000.0, (UINT)(Texture.Runtime.size() / 1024));
+}
+
+BENCHMARK_CASE(DiffCostOfFewChangedRows)
+{
+	MOCKTEXTURE Texture(1024, 1024, 4);
+	DWORD Frame = 0;
+	const double Time = TestHarness::Measure(200, [&]()
+	{
+		Texture.Runtime[((Frame++ * 37) % 1024) * Texture.Pitch] ^= 1;
+		Texture.Unlock();
+	});
+	std::printf("    1024x1024 one row: %.1f us, %u KB uploaded over %u locks\n", Time / 1000.0, (UINT)(Texture.UploadedBytes / 1024), Frame);
+}
@@ -0,0 +1,249 @@
+#include <random>
+#include "WinTypes.h"
+#include "LoggingStub.h"
+#include "TestHarness.h"
+#include "d3d9/DynamicBufferLock.h"
+
+// Dynamic write-only buffer that models how the GPU sees the data for each lock flag. The application's view is
+// what it would see without promotion, every draw checks that the GPU reads the same bytes the application wrote.
+struct MOCKBUFFER
+{
+	DYNAMICBUFFERLOCK DynamicLock;
+	std::vector<BYTE> Storage;					// Contents the GPU reads
+	std::vector<BYTE> AppView;					// Contents the application expects
+	std::vector<bool> IsDefined;				// Application wrote the byte since its last own discard
+	std::vector<std::pair<UINT, UINT>> PendingDraws;	// Draws the GPU may still be reading
+	UINT Hazards = 0;
+	UINT BadReads = 0;
+
+	MOCKBUFFER(UINT Size) : Storage(Size, 0), AppView(Size, 0), IsDefined(Size, false)
+	{
+		DynamicLock.SetDesc(D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, Size);
+	}
+
+	DWORD Lock(UINT Offset, UINT Size, DWORD AppFlags)
+	{
+		const DWORD Flags = DynamicLock.PromoteFlags(Offset, Size, AppFlags);
+		const UINT End = Size ? Offset + Size : (UINT)Storage.size();
+
+		if (AppFlags & D3DLOCK_DISCARD)
+		{
+			std::fill(IsDefined.begin(), IsDefined.end(), false);
+		}
+		if (Flags & D3DLOCK_DISCARD)
+		{
+			// Renamed, draws in flight keep the old memory and the new memory has undefined contents
+			std::fill(Storage.begin(), Storage.end(), (BYTE)0xCD);
+			PendingDraws.clear();
+		}
+		else if (Flags & D3DLOCK_NOOVERWRITE)
+		{
+			for (const auto& Draw : PendingDraws)
+			{
+				if (Offset < Draw.second && Draw.first < End)
+				{
+					Hazards++;
+				}
+			}
+		}
+		else
+		{
+			// Waits until the GPU is done
+			PendingDraws.clear();
+		}
+		return Flags;
+	}
+
+	void Write(UINT Offset, UINT Size, BYTE Value)
+	{
+		for (UINT x = Offset; x < Offset + Size; x++)
+		{
+			Storage[x] = Value;
+			AppView[x] = Value;
+			IsDefined[x] = true;
+		}
+	}
+
+	void Draw(UINT Offset, UINT Size)
+	{
+		for (UINT x = Offset; x < Offset + Size; x++)
+		{
+			if (IsDefined[x] && Storage[x] != AppView[x])
+			{
+				BadReads++;
+				break;
+			}
+		}
+		PendingDraws.push_back({ Offset, Offset + Size });
+	}
+
+	void LockWriteDraw(UINT Offset, UINT Size, DWORD AppFlags, BYTE Value)
+	{
+		Lock(Offset, Size, AppFlags);
+		Write(Offset, Size ? Size : (UINT)Storage.size(), Value);
+		Draw(Offset, Size ? Size : (UINT)Storage.size());
+	}
+};
+
+TEST_CASE(AppendRunIsPromotedAndWrapsWithDiscard)
+{
+	MOCKBUFFER Buffer(1024);
+	BYTE Value = 1;
+
+	// Application discards once, then appends plain locks one after another and starts over at the end
+	Buffer.LockWriteDraw(0, 96, D3DLOCK_DISCARD, Value++);
+	for (UINT Pass = 0; Pass < 3; Pass++)
+	{
+		for (UINT Offset = (Pass == 0) ? 96 : 0; Offset + 96 <= 1024; Offset += 96)
+		{
+			Buffer.LockWriteDraw(Offset, 96, 0, Value++);
+		}
+	}
+
+	CHECK_EQUAL(0u, Buffer.Hazards);
+	CHECK_EQUAL(0u, Buffer.BadReads);
+	CHECK_EQUAL(0u, Buffer.DynamicLock.StallCount);
+	CHECK_EQUAL(2u, Buffer.DynamicLock.DiscardCount);
+	CHECK_EQUAL(3u * 9u, Buffer.DynamicLock.NoOverwriteCount);
+}
+
+TEST_CASE(WholeBufferFillIsNotFollowedByPromotion)
+{
+	MOCKBUFFER Buffer(1024);
+
+	// Everything was written, so a later partial lock may overwrite data that is still drawn
+	Buffer.LockWriteDraw(0, 0, 0, 1);
+	CHECK_EQUAL(1u, Buffer.DynamicLock.DiscardCount);
+	CHECK_EQUAL((DWORD)0, Buffer.Lock(512, 64, 0));
+	CHECK_EQUAL(1u, Buffer.DynamicLock.StallCount);
+}
+
+TEST_CASE(StallAcrossTheCursorMovesTheCursor)
+{
+	MOCKBUFFER Buffer(1024);
+
+	Buffer.LockWriteDraw(0, 64, D3DLOCK_DISCARD, 1);
+	Buffer.LockWriteDraw(32, 64, 0, 2);
+	CHECK_EQUAL(1u, Buffer.DynamicLock.StallCount);
+
+	// Overlaps the data just drawn, so it must not be written without waiting
+	CHECK_EQUAL((DWORD)0, Buffer.Lock(80, 16, 0));
+	CHECK_EQUAL((DWORD)D3DLOCK_NOOVERWRITE, Buffer.Lock(96, 16, 0));
+	CHECK_EQUAL(0u, Buffer.Hazards);
+}
+
+TEST_CASE(HeaderRewriteKeepsOlderData)
+{
+	MOCKBUFFER Buffer(1024);
+
+	Buffer.LockWriteDraw(0, 0, D3DLOCK_DISCARD, 1);
+	Buffer.LockWriteDraw(0, 64, D3DLOCK_DISCARD, 2);
+	Buffer.LockWriteDraw(64, 128, 0, 3);
+	Buffer.LockWriteDraw(192, 128, 0, 4);
+
+	// Rewrite the header while there is still room after the cursor, then draw from the older vertices
+	CHECK_EQUAL((DWORD)0, Buffer.Lock(0, 64, 0));
+	Buffer.Write(0, 64, 5);
+	Buffer.Draw(0, 64);
+	Buffer.Draw(64, 256);
+
+	CHECK_EQUAL(0u, Buffer.Hazards);
+	CHECK_EQUAL(0u, Buffer.BadReads);
+	CHECK_EQUAL(1u, Buffer.DynamicLock.StallCount);
+	CHECK_EQUAL(0u, Buffer.DynamicLock.DiscardCount);
+}
+
+TEST_CASE(PartialLockAtStartWithoutAppendRunStalls)
+{
+	MOCKBUFFER Buffer(1024);
+
+	// Without a known cursor nothing can be promoted
+	CHECK_EQUAL((DWORD)0, Buffer.Lock(0, 256, 0));
+	CHECK_EQUAL((DWORD)0, Buffer.Lock(256, 256, 0));
+	CHECK_EQUAL(2u, Buffer.DynamicLock.StallCount);
+
+	// Whole buffer locks are discarded
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Buffer.Lock(0, 0, 0));
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Buffer.Lock(0, 1024, 0));
+}
+
+TEST_CASE(ReadOnlyAndStaticBuffersAreNotPromoted)
+{
+	DYNAMICBUFFERLOCK DynamicLock;
+	DynamicLock.SetDesc(D3DUSAGE_DYNAMIC, 1024);
+	CHECK_EQUAL((DWORD)0, DynamicLock.PromoteFlags(0, 0, 0));
+
+	MOCKBUFFER Buffer(1024);
+	Buffer.Lock(0, 0, D3DLOCK_DISCARD);
+	CHECK_EQUAL((DWORD)D3DLOCK_READONLY, Buffer.Lock(512, 64, D3DLOCK_READONLY));
+}
+
+// Random ring buffer use with wraps, header rewrites, overwrites, whole buffer fills and application discards.
+// Draws only use data written in the current pass of the ring, like an application that appends and wraps.
+TEST_CASE(RandomLockSequencesKeepRenderingSemantics)
+{
+	std::mt19937 Random(1234);
+	MOCKBUFFER Buffer(4096);
+	UINT Cursor = 0;
+	BYTE Value = 1;
+
+	Buffer.LockWriteDraw(0, 0, D3DLOCK_DISCARD, Value++);
+	Cursor = 4096;
+
+	for (UINT x = 0; x < 20000; x++)
+	{
+		const UINT Size = 16 * (1 + Random() % 32);
+		const UINT Choice = Random() % 100;
+		if (Choice < 55)
+		{
+			// Append, or start a new pass once the ring is full
+			if (Cursor + Size > 4096)
+			{
+				Cursor = 0;
+			}
+			Buffer.LockWriteDraw(Cursor, Size, 0, Value++);
+			Cursor += Size;
+		}
+		else if (Choice < 65)
+		{
+			// Header rewrite while there is room left
+			if (Cursor + 64 <= 4096 && Cursor >= 64)
+			{
+				Buffer.LockWriteDraw(0, 64, 0, Value++);
+			}
+		}
+		else if (Choice < 70)
+		{
+			Buffer.LockWriteDraw(0, 0, 0, Value++);
+			Cursor = 4096;
+		}
+		else if (Choice < 75)
+		{
+			Buffer.LockWriteDraw(0, Size, D3DLOCK_DISCARD, Value++);
+			Cursor = Size;
+		}
+		else if (Choice < 85)
+		{
+			// Overwrite data of the current pass
+			if (Cursor >= Size)
+			{
+				const UINT Offset = 16 * (Random() % ((Cursor - Size) / 16 + 1));
+				Buffer.LockWriteDraw(Offset, Size, 0, Value++);
+			}
+		}
+		else
+		{
+			// Draw data of the current pass again without locking
+			if (Cursor >= Size)
+			{
+				Buffer.Draw(16 * (Random() % ((Cursor - Size) / 16 + 1)), Size);
+			}
+		}
+	}
+
+	CHECK_EQUAL(0u, Buffer.Hazards);
+	CHECK_EQUAL(0u, Buffer.BadReads);
+	CHECK(Buffer.DynamicLock.NoOverwriteCount > 0);
+	CHECK(Buffer.DynamicLock.DiscardCount > 0);
+	CHECK(Buffer.DynamicLock.StallCount > 0);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Discards the log output of the headers under test
+namespace Logging
+{
+	struct NULLLOG
+	{
+		template <typename T>
+		NULLLOG& operator<<(const T&) { return *this; }
+	};
+
+	inline NULLLOG Log() { return NULLLOG(); }
+	inline NULLLOG LogDebug() { return NULLLOG(); }
+}
+
+#define LOG_LIMIT(Num, Stream) do { Logging::NULLLOG() << Stream; } while (0)
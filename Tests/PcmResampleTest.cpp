@@ -0,0 +1,207 @@
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "dsound/PcmResample.h"
+
+using namespace PcmResample;
+
+// Plain scalar version of Resample in double precision, source frames wrap around the end of the buffer
+static std::vector<SHORT> ResampleReference(const std::vector<float>& Source, DWORD Channels, DWORD TargetFrames)
+{
+	const DWORD SourceFrames = (DWORD)(Source.size() / Channels);
+	const ULONGLONG Step = ((ULONGLONG)SourceFrames << 32) / TargetFrames;
+	const COEFFICIENTS& Coefficients = GetCoefficients();
+
+	std::vector<SHORT> Target(TargetFrames * Channels);
+	for (DWORD x = 0; x < TargetFrames; x++)
+	{
+		const ULONGLONG Position = (ULONGLONG)x * Step;
+		const DWORD Phase = (DWORD)(((Position & 0xFFFFFFFF) * Phases + 0x80000000) >> 32);
+		for (DWORD c = 0; c < Channels; c++)
+		{
+			double Sum = 0.0;
+			for (LONG j = 0; j < Taps; j++)
+			{
+				const LONG Frame = (LONG)(Position >> 32) - (HalfTaps - 1) + j;
+				const DWORD Wrapped = (DWORD)((Frame + (LONG)SourceFrames) % (LONG)SourceFrames);
+				Sum += (double)Source[Wrapped * Channels + c] * Coefficients.Table[Phase][j];
+			}
+			Target[x * Channels + c] = (SHORT)max(-32768.0, min(32767.0, std::round(Sum * 32768.0)));
+		}
+	}
+	return Target;
+}
+
+// Sine with a whole number of cycles in the buffer, so looping it is seamless
+static std::vector<float> MakeLoop(DWORD Frames, DWORD Channels, DWORD Cycles, double Amplitude)
+{
+	std::vector<float> Data(Frames * Channels);
+	for (DWORD x = 0; x < Frames; x++)
+	{
+		for (DWORD c = 0; c < Channels; c++)
+		{
+			Data[x * Channels + c] = (float)(Amplitude * sin(2.0 * 3.14159265358979323846 * Cycles * (x + c * 0.25) / Frames));
+		}
+	}
+	return Data;
+}
+
+static std::vector<BYTE> To8Bit(const std::vector<float>& Data)
+{
+	std::vector<BYTE> Result(Data.size());
+	for (size_t x = 0; x < Data.size(); x++)
+	{
+		Result[x] = (BYTE)(std::lround(Data[x] * 127.0f) + 128);
+	}
+	return Result;
+}
+
+static std::vector<BYTE> To16Bit(const std::vector<float>& Data)
+{
+	std::vector<BYTE> Result(Data.size() * sizeof(SHORT));
+	for (size_t x = 0; x < Data.size(); x++)
+	{
+		((SHORT*)Result.data())[x] = (SHORT)std::lround(Data[x] * 32767.0f);
+	}
+	return Result;
+}
+
+// What the application stored, decoded back to floats
+static std::vector<float> Decode(const std::vector<BYTE>& Data, bool Is8Bit)
+{
+	std::vector<float> Result(Is8Bit ? Data.size() : Data.size() / sizeof(SHORT));
+	for (size_t x = 0; x < Result.size(); x++)
+	{
+		Result[x] = (Is8Bit) ? ((LONG)Data[x] - 128) / 128.0f : ((const SHORT*)Data.data())[x] / 32768.0f;
+	}
+	return Result;
+}
+
+static LONG MaxDifference(const std::vector<SHORT>& a, const std::vector<SHORT>& b, size_t First = 0, size_t End = ~(size_t)0)
+{
+	LONG Max = 0;
+	for (size_t x = First; x < min(End, a.size()); x++)
+	{
+		Max = max(Max, (LONG)std::abs((LONG)a[x] - (LONG)b[x]));
+	}
+	return Max;
+}
+
+TEST_CASE(MatchesScalarReference)
+{
+	struct { DWORD SourceFrames, TargetFrames, Channels; bool Is8Bit; } Cases[] = {
+		{ 2205, 4410, 1, true },
+		{ 2205, 8820, 2, true },
+		{ 1000, 4000, 2, false },
+		{ 1323, 2646, 1, false },
+		{ 997, 1990, 2, false },	// Uneven ratio
+	};
+
+	for (const auto& Case : Cases)
+	{
+		const std::vector<float> Signal = MakeLoop(Case.SourceFrames, Case.Channels, 37, 0.8);
+		const std::vector<BYTE> Source = (Case.Is8Bit) ? To8Bit(Signal) : To16Bit(Signal);
+		const std::vector<SHORT> Reference = ResampleReference(Decode(Source, Case.Is8Bit), Case.Channels, Case.TargetFrames);
+
+		std::vector<SHORT> Target(Case.TargetFrames * Case.Channels);
+		Resample(Source.data(), Case.SourceFrames, Case.TargetFrames, Case.Channels, Case.Is8Bit, 0, Case.TargetFrames, Target.data());
+		CHECK(MaxDifference(Target, Reference) <= 1);
+
+		// Converting in pieces, as Unlock does for partial locks, gives the same result
+		std::vector<SHORT> Pieces(Target.size());
+		for (DWORD First = 0; First < Case.TargetFrames; First += 333)
+		{
+			const DWORD Count = min(333u, Case.TargetFrames - First);
+			Resample(Source.data(), Case.SourceFrames, Case.TargetFrames, Case.Channels, Case.Is8Bit, First, Count, &Pieces[First * Case.Channels]);
+		}
+		CHECK_EQUAL(0, MaxDifference(Target, Pieces));
+	}
+}
+
+TEST_CASE(LoopSeamIsAsCleanAsTheRestOfTheBuffer)
+{
+	const DWORD SourceFrames = 2205, TargetFrames = 8820;
+	const std::vector<BYTE> Source = To16Bit(MakeLoop(SourceFrames, 1, 20, 0.9));
+
+	std::vector<SHORT> Target(TargetFrames);
+	Resample(Source.data(), SourceFrames, TargetFrames, 1, false, 0, TargetFrames, Target.data());
+
+	// Ideal output is the same sine sampled at the target rate
+	const std::vector<float> Ideal = MakeLoop(TargetFrames, 1, 20, 0.9);
+	std::vector<SHORT> Expected(TargetFrames);
+	for (DWORD x = 0; x < TargetFrames; x++)
+	{
+		Expected[x] = (SHORT)std::lround(Ideal[x] * 32767.0f);
+	}
+
+	const size_t Margin = HalfTaps * TargetFrames / SourceFrames * 2;
+	const LONG Inside = MaxDifference(Target, Expected, Margin, TargetFrames - Margin);
+	const LONG Start = MaxDifference(Target, Expected, 0, Margin);
+	const LONG End = MaxDifference(Target, Expected, TargetFrames - Margin, TargetFrames);
+
+	CHECK(Inside < 64);
+	CHECK(Start <= Inside * 2 + 2);
+	CHECK(End <= Inside * 2 + 2);
+}
+
+TEST_CASE(Widen8To16MatchesScalar)
+{
+	std::vector<BYTE> Source(1000);
+	for (size_t x = 0; x < Source.size(); x++)
+	{
+		Source[x] = (BYTE)(x * 37 + 11);
+	}
+
+	// Counts that are not a multiple of the vector width use the scalar tail
+	for (DWORD Count : { 0u, 1u, 15u, 16u, 17u, 999u, 1000u })
+	{
+		std::vector<SHORT> Target(Count + 1, 0x1234);
+		Widen8To16(Source.data(), Target.data(), Count);
+
+		bool IsEqual = true;
+		for (DWORD x = 0; x < Count; x++)
+		{
+			IsEqual = IsEqual && Target[x] == (SHORT)(((LONG)Source[x] - 128) * 256);
+		}
+		CHECK(IsEqual);
+		CHECK_EQUAL(0x1234, Target[Count]);
+	}
+}
+
+BENCHMARK_CASE(ResampleOneSecond)
+{
+	struct { const char* Name; DWORD SourceRate, Channels; bool Is8Bit; } Cases[] = {
+		{ "22050 Hz 8-bit mono", 22050, 1, true },
+		{ "11025 Hz 8-bit stereo", 11025, 2, true },
+		{ "22050 Hz 16-bit stereo", 22050, 2, false },
+	};
+
+	for (const auto& Case : Cases)
+	{
+		const DWORD TargetFrames = 44100;
+		const std::vector<float> Signal = MakeLoop(Case.SourceRate, Case.Channels, 440, 0.8);
+		const std::vector<BYTE> Source = (Case.Is8Bit) ? To8Bit(Signal) : To16Bit(Signal);
+		const std::vector<float> Decoded = Decode(Source, Case.Is8Bit);
+		std::vector<SHORT> Target(TargetFrames * Case.Channels);
+
+		const double Simd = TestHarness::Measure(20, [&]() {
+			Resample(Source.data(), Case.SourceRate, TargetFrames, Case.Channels, Case.Is8Bit, 0, TargetFrames, Target.data());
+		});
+		const double Scalar = TestHarness::Measure(5, [&]() {
+			Target = ResampleReference(Decoded, Case.Channels, TargetFrames);
+		});
+
+		std::printf("    %-24s to 44100 Hz: %8.3f ms SSE, %8.3f ms scalar reference\n", Case.Name, Simd / 1e6, Scalar / 1e6);
+	}
+}
+
+BENCHMARK_CASE(WidenOneSecond)
+{
+	std::vector<BYTE> Source(44100 * 2, 0x40);
+	std::vector<SHORT> Target(Source.size());
+
+	const double Time = TestHarness::Measure(200, [&]() {
+		Widen8To16(Source.data(), Target.data(), (DWORD)Source.size());
+	});
+
+	std::printf("    44100 Hz 8-bit stereo to 16-bit: %8.3f us\n", Time / 1e3);
+}
@@ -0,0 +1,146 @@
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "d3d9/QueryBackOff.h"
+
+// Simulated performance counter where a spin costs a few microseconds and a yield returns at once unless another
+// thread is ready, in which case it runs for the rest of a scheduler quantum
+struct FAKECLOCK
+{
+	static constexpr LONGLONG TicksPerMS = 10000;
+	static constexpr LONGLONG PollTicks = 5;
+	static constexpr LONGLONG SpinTicks = 20;
+	static constexpr LONGLONG YieldTicks = 50;
+	static constexpr LONGLONG SleepTicks = 156250;		// Sleep(1) at the default timer resolution
+
+	LONGLONG Now = 1000000;
+};
+
+struct POLLRESULT
+{
+	LONGLONG Overshoot = 0;			// Time from the result being ready until the application sees it
+	DWORD SpinCount = 0;
+	DWORD YieldCount = 0;
+};
+
+// Runs an application loop that polls GetData until the query finishes after Latency ticks
+static POLLRESULT PollUntilReady(QUERYBACKOFF& Polling, FAKECLOCK& Clock, LONGLONG Latency)
+{
+	POLLRESULT Result;
+	Polling.OnIssue(Clock.Now);
+	const LONGLONG ReadyTicks = Clock.Now + Latency;
+
+	while (true)
+	{
+		Clock.Now += FAKECLOCK::PollTicks;
+		if (Clock.Now >= ReadyTicks)
+		{
+			Result.Overshoot = Clock.Now - ReadyTicks;
+			Polling.OnComplete(Clock.Now, true);
+			return Result;
+		}
+
+		const LONGLONG Start = Clock.Now;
+		switch (Polling.OnPending(Clock.Now, 16, FAKECLOCK::TicksPerMS))
+		{
+		case QUERYBACKOFF::SPIN:
+			Clock.Now += FAKECLOCK::SpinTicks;
+			Result.SpinCount++;
+			break;
+		case QUERYBACKOFF::YIELD:
+			Clock.Now += FAKECLOCK::YieldTicks;
+			Result.YieldCount++;
+			break;
+		default:
+			break;
+		}
+		if (Clock.Now != Start)
+		{
+			Polling.AddWait(Clock.Now - Start);
+		}
+	}
+}
+
+TEST_CASE(FirstPollsAreNotDelayed)
+{
+	QUERYBACKOFF Polling;
+	Polling.OnIssue(100);
+	for (DWORD x = 0; x < 16; x++)
+	{
+		CHECK_EQUAL(QUERYBACKOFF::NONE, Polling.OnPending(100 + x, 16, FAKECLOCK::TicksPerMS));
+	}
+	CHECK_EQUAL(QUERYBACKOFF::SPIN, Polling.OnPending(200, 16, FAKECLOCK::TicksPerMS));
+}
+
+TEST_CASE(QueryThatIsNotIssuedIsNotDelayed)
+{
+	QUERYBACKOFF Polling;
+	for (DWORD x = 0; x < 100; x++)
+	{
+		CHECK_EQUAL(QUERYBACKOFF::NONE, Polling.OnPending(x, 0, FAKECLOCK::TicksPerMS));
+	}
+}
+
+TEST_CASE(LatencyIsLearnedFromCompletedQueries)
+{
+	QUERYBACKOFF Polling;
+	FAKECLOCK Clock;
+
+	PollUntilReady(Polling, Clock, 8 * FAKECLOCK::TicksPerMS);
+	const LONGLONG First = Polling.LatencyTicks;
+	CHECK(First >= 8 * FAKECLOCK::TicksPerMS && First < 8 * FAKECLOCK::TicksPerMS + FAKECLOCK::YieldTicks + FAKECLOCK::PollTicks);
+
+	for (DWORD x = 0; x < 50; x++)
+	{
+		PollUntilReady(Polling, Clock, 2 * FAKECLOCK::TicksPerMS);
+	}
+	CHECK(Polling.LatencyTicks < 2 * FAKECLOCK::TicksPerMS + FAKECLOCK::TicksPerMS / 10);
+
+	// Failed polls do not change the estimate
+	const LONGLONG Latency = Polling.LatencyTicks;
+	Polling.OnIssue(Clock.Now);
+	Polling.OnComplete(Clock.Now + 100 * FAKECLOCK::TicksPerMS, false);
+	CHECK_EQUAL(Latency, Polling.LatencyTicks);
+	CHECK_EQUAL(0, Polling.IssueTicks);
+}
+
+TEST_CASE(SpinsNearTheExpectedLatencyAndYieldsBefore)
+{
+	QUERYBACKOFF Polling;
+	Polling.LatencyTicks = 10 * FAKECLOCK::TicksPerMS;
+	Polling.OnIssue(1000);
+	Polling.PollCount = 100;
+
+	CHECK_EQUAL(QUERYBACKOFF::YIELD, Polling.OnPending(1000 + 1 * FAKECLOCK::TicksPerMS, 16, FAKECLOCK::TicksPerMS));
+	CHECK_EQUAL(QUERYBACKOFF::SPIN, Polling.OnPending(1000 + 7 * FAKECLOCK::TicksPerMS, 16, FAKECLOCK::TicksPerMS));
+	CHECK_EQUAL(QUERYBACKOFF::SPIN, Polling.OnPending(1000 + 10 * FAKECLOCK::TicksPerMS - 1, 16, FAKECLOCK::TicksPerMS));
+}
+
+TEST_CASE(OverdueQueryYieldsInsteadOfSleeping)
+{
+	QUERYBACKOFF Polling;
+	FAKECLOCK Clock;
+
+	for (DWORD x = 0; x < 20; x++)
+	{
+		PollUntilReady(Polling, Clock, FAKECLOCK::TicksPerMS / 2);
+	}
+
+	// Query takes far longer than expected, the result must still be seen within one yield of being ready
+	const POLLRESULT Result = PollUntilReady(Polling, Clock, 40 * FAKECLOCK::TicksPerMS);
+	CHECK(Result.YieldCount > 0);
+	CHECK(Result.Overshoot <= FAKECLOCK::YieldTicks + FAKECLOCK::PollTicks);
+	CHECK(Result.Overshoot < FAKECLOCK::SleepTicks / 100);
+}
+
+TEST_CASE(UnknownLatencySpinsBrieflyThenYields)
+{
+	QUERYBACKOFF Polling;
+	FAKECLOCK Clock;
+
+	const POLLRESULT Result = PollUntilReady(Polling, Clock, 20 * FAKECLOCK::TicksPerMS);
+	CHECK(Result.SpinCount > 0);
+	CHECK(Result.SpinCount * FAKECLOCK::SpinTicks <= 3 * FAKECLOCK::TicksPerMS);
+	CHECK(Result.YieldCount > 0);
+	CHECK(Result.Overshoot <= FAKECLOCK::YieldTicks + FAKECLOCK::PollTicks);
+	CHECK_EQUAL(Result.SpinCount + Result.YieldCount, Polling.WaitCount);
+}
@@ -0,0 +1,247 @@
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "d3d9/ShadowState.h"
+
+static constexpr DWORD StateCount = 64;
+
+// Device that counts the calls the wrapper makes, a pure device fails every Get call
+struct MOCKDEVICE
+{
+	bool IsPure = false;
+	DWORD State[StateCount] = {};
+	DWORD GetCalls = 0;
+	DWORD SetCalls = 0;
+
+	HRESULT GetState(DWORD Index, DWORD* pValue)
+	{
+		GetCalls++;
+		if (IsPure)
+		{
+			return E_FAIL;
+		}
+		*pValue = State[Index];
+		return S_OK;
+	}
+
+	HRESULT SetState(DWORD Index, DWORD Value)
+	{
+		SetCalls++;
+		State[Index] = Value;
+		return S_OK;
+	}
+};
+
+// Follows m_IDirect3DDevice9Ex: Set calls update the shadow state and the overlay saves and restores through it
+struct MOCKWRAPPER
+{
+	MOCKDEVICE& Device;
+	SHADOWSTATE<DWORD> Cache[StateCount];
+	std::vector<DWORD> OverlayStates;
+	std::vector<DWORD> OverlayValues;
+	std::vector<SHADOWSTATE<DWORD>> Backup;
+
+	MOCKWRAPPER(MOCKDEVICE& Device, std::vector<DWORD> States, std::vector<DWORD> Values) :
+		Device(Device), OverlayStates(States), OverlayValues(Values), Backup(States.size()) {}
+
+	bool GetCachedState(DWORD Index, DWORD& Value)
+	{
+		return Cache[Index].Get(Value, [&](DWORD& Read) { return SUCCEEDED(Device.GetState(Index, &Read)); });
+	}
+
+	void SetCachedState(DWORD Index, DWORD Value)
+	{
+		if (SUCCEEDED(Device.SetState(Index, Value)))
+		{
+			Cache[Index] = { true, Value };
+		}
+	}
+
+	// Application Set call
+	void SetState(DWORD Index, DWORD Value)
+	{
+		SetCachedState(Index, Value);
+	}
+
+	// Device Reset and state block Apply
+	void InvalidateStateCache()
+	{
+		for (auto& Entry : Cache)
+		{
+			Entry = {};
+		}
+	}
+
+	void BackupDeviceState()
+	{
+		for (size_t x = 0; x < OverlayStates.size(); x++)
+		{
+			BackupShadowState(Backup[x], OverlayValues[x],
+				[&](DWORD& Value) { return GetCachedState(OverlayStates[x], Value); },
+				[&](DWORD Value) { SetCachedState(OverlayStates[x], Value); });
+		}
+	}
+
+	void RestoreDeviceState()
+	{
+		for (size_t x = 0; x < OverlayStates.size(); x++)
+		{
+			RestoreShadowState(Backup[x],
+				[&](DWORD& Value) { return GetCachedState(OverlayStates[x], Value); },
+				[&](DWORD Value) { SetCachedState(OverlayStates[x], Value); });
+		}
+	}
+};
+
+struct STATECALL
+{
+	DWORD Index;
+	DWORD Value;
+};
+
+// Recorded frame of a game that changes a few states around its draws
+static std::vector<STATECALL> RecordFrame(std::mt19937& Random, DWORD CallCount)
+{
+	std::vector<STATECALL> Calls;
+	for (DWORD x = 0; x < CallCount; x++)
+	{
+		Calls.push_back({ (DWORD)(Random() % StateCount), (DWORD)(Random() % 4) });
+	}
+	return Calls;
+}
+
+static void Replay(MOCKWRAPPER& Wrapper, const std::vector<STATECALL>& Calls)
+{
+	for (const STATECALL& Call : Calls)
+	{
+		Wrapper.SetState(Call.Index, Call.Value);
+	}
+}
+
+TEST_CASE(RestoreLeavesGameStateUnchanged)
+{
+	std::mt19937 Random(31);
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device, { 1, 5, 9, 20, 33 }, { 0, 0, 1, 3, 2 });
+
+	for (DWORD Frame = 0; Frame < 200; Frame++)
+	{
+		Replay(Wrapper, RecordFrame(Random, 40));
+
+		DWORD Before[StateCount];
+		memcpy(Before, Device.State, sizeof(Before));
+
+		Wrapper.BackupDeviceState();
+		for (size_t x = 0; x < Wrapper.OverlayStates.size(); x++)
+		{
+			CHECK_EQUAL(Wrapper.OverlayValues[x], Device.State[Wrapper.OverlayStates[x]]);
+		}
+		Wrapper.RestoreDeviceState();
+
+		CHECK(memcmp(Before, Device.State, sizeof(Before)) == 0);
+	}
+}
+
+TEST_CASE(DriverIsOnlyReadOncePerState)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device, { 1, 5, 9 }, { 0, 0, 1 });
+
+	// First overlay reads the states the game never set
+	Wrapper.BackupDeviceState();
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(3u, Device.GetCalls);
+
+	std::mt19937 Random(7);
+	for (DWORD Frame = 0; Frame < 100; Frame++)
+	{
+		Replay(Wrapper, RecordFrame(Random, 20));
+		Wrapper.BackupDeviceState();
+		Wrapper.RestoreDeviceState();
+	}
+	CHECK_EQUAL(3u, Device.GetCalls);
+}
+
+TEST_CASE(OnlyDifferingStatesAreSet)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device, { 1, 5, 9 }, { 0, 0, 1 });
+
+	// Game state already matches the overlay for states 1 and 5
+	Wrapper.SetState(1, 0);
+	Wrapper.SetState(5, 0);
+	Wrapper.SetState(9, 2);
+	Device.SetCalls = 0;
+
+	Wrapper.BackupDeviceState();
+	CHECK_EQUAL(1u, Device.SetCalls);
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(2u, Device.SetCalls);
+	CHECK_EQUAL(2u, Device.State[9]);
+
+	// Overlay state that matches the game state needs no calls at all
+	Wrapper.SetState(9, 1);
+	Device.SetCalls = 0;
+	Wrapper.BackupDeviceState();
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(0u, Device.SetCalls);
+}
+
+TEST_CASE(PureDeviceOnlyTouchesKnownStates)
+{
+	MOCKDEVICE Device;
+	Device.IsPure = true;
+	Device.State[5] = 3;
+	MOCKWRAPPER Wrapper(Device, { 1, 5, 9 }, { 0, 0, 1 });
+
+	// State 1 was set by the game, 5 and 9 cannot be read and are left alone
+	Wrapper.SetState(1, 2);
+	Device.SetCalls = 0;
+
+	Wrapper.BackupDeviceState();
+	CHECK_EQUAL(0u, Device.State[1]);
+	CHECK_EQUAL(3u, Device.State[5]);
+	CHECK_EQUAL(0u, Device.State[9]);
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(2u, Device.State[1]);
+	CHECK_EQUAL(3u, Device.State[5]);
+	CHECK_EQUAL(2u, Device.SetCalls);
+}
+
+TEST_CASE(InvalidatedCacheIsReadAgain)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device, { 1, 5 }, { 0, 0 });
+
+	Wrapper.SetState(1, 2);
+	Wrapper.SetState(5, 2);
+	Wrapper.BackupDeviceState();
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(0u, Device.GetCalls);
+
+	// A state block changed the device behind the cache
+	Device.State[1] = 3;
+	Wrapper.InvalidateStateCache();
+
+	Wrapper.BackupDeviceState();
+	Wrapper.RestoreDeviceState();
+	CHECK_EQUAL(2u, Device.GetCalls);
+	CHECK_EQUAL(3u, Device.State[1]);
+	CHECK_EQUAL(2u, Device.State[5]);
+}
+
+BENCHMARK_CASE(BackupAndRestoreCost)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device, { 1, 5, 9, 20, 33, 40, 41, 42, 43 }, { 0, 0, 1, 3, 2, 0, 0, 0, 0 });
+	std::mt19937 Random(1);
+	const std::vector<STATECALL> Frame = RecordFrame(Random, 40);
+
+	const double Time = TestHarness::Measure(100000, [&]()
+	{
+		Replay(Wrapper, Frame);
+		Wrapper.BackupDeviceState();
+		Wrapper.RestoreDeviceState();
+	});
+	std::printf("    frame with overlay: %.1f ns, driver reads: %u\n", Time, Device.GetCalls);
+}
@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "dsound/SoundBufferCache.h"
+
+// Sound buffer whose audio data is shared with its duplicates, settings and play state belong to each buffer
+struct MOCKBUFFER
+{
+	ULONG RefCount = 1;
+	DWORD& LiveCount;
+	std::shared_ptr<std::vector<BYTE>> Data;
+	LONG Volume = 0;
+	LONG Pan = 0;
+	DWORD Frequency = 22050;
+	DWORD Position = 0;
+	DWORD Status = 0;
+
+	MOCKBUFFER(DWORD& LiveCount, std::shared_ptr<std::vector<BYTE>> Data) : LiveCount(LiveCount), Data(Data)
+	{
+		LiveCount++;
+	}
+
+	ULONG AddRef()
+	{
+		return ++RefCount;
+	}
+
+	ULONG Release()
+	{
+		const ULONG Count = --RefCount;
+		if (!Count)
+		{
+			LiveCount--;
+			delete this;
+		}
+		return Count;
+	}
+};
+
+struct MOCKDEVICE
+{
+	DWORD LiveCount = 0;
+	DWORD CreateCount = 0;
+
+	MOCKBUFFER* CreateSoundBuffer(DWORD BufferBytes)
+	{
+		CreateCount++;
+		return new MOCKBUFFER(LiveCount, std::make_shared<std::vector<BYTE>>(BufferBytes));
+	}
+
+	MOCKBUFFER* DuplicateSoundBuffer(MOCKBUFFER* pBuffer)
+	{
+		return new MOCKBUFFER(LiveCount, pBuffer->Data);
+	}
+
+	// Same steps as SoundBufferCache::CreateCopy
+	MOCKBUFFER* CreateCopy(MOCKBUFFER* pBuffer)
+	{
+		MOCKBUFFER* pCopy = CreateSoundBuffer((DWORD)pBuffer->Data->size());
+		*pCopy->Data = *pBuffer->Data;
+		return pCopy;
+	}
+};
+
+// Same steps as SoundBufferCache::GetDuplicate and SoundBufferCache::RemoveEntry
+struct MOCKCACHE
+{
+	MOCKDEVICE& Device;
+	size_t MaxSize;
+	SoundBufferCache::CACHELIST<MOCKDEVICE*, MOCKBUFFER*> Masters;
+
+	MOCKCACHE(MOCKDEVICE& Device, size_t MaxSize) : Device(Device), MaxSize(MaxSize) {}
+
+	~MOCKCACHE()
+	{
+		for (auto& Entry : Masters.Entries)
+		{
+			Entry.pMaster->Release();
+		}
+	}
+
+	HRESULT GetDuplicate(ULONGLONG Key, MOCKBUFFER* pBuffer, MOCKBUFFER** ppDuplicate)
+	{
+		*ppDuplicate = nullptr;
+
+		MOCKBUFFER* pMaster = Masters.Find(&Device, Key);
+		if (pMaster)
+		{
+			if (*pMaster->Data != *pBuffer->Data)
+			{
+				return S_FALSE;
+			}
+			*ppDuplicate = Device.DuplicateSoundBuffer(pMaster);
+			return DS_OK;
+		}
+
+		Masters.Add(&Device, Key, Device.CreateCopy(pBuffer), MaxSize);
+		return S_FALSE;
+	}
+
+	void RemoveEntry(ULONGLONG Key)
+	{
+		Masters.Remove(&Device, Key);
+	}
+};
+
+// Same steps as the buffer sharing in m_IDirectSoundBuffer8, with locks that do not wrap
+struct MOCKWRAPPER
+{
+	MOCKCACHE& Cache;
+	MOCKBUFFER* ProxyInterface;
+	struct {
+		MOCKDEVICE* pDevice = nullptr;
+		ULONGLONG FormatKey = 0;
+		DWORD BufferBytes = 0;
+		bool IsLocked = false;
+		MOCKDEVICE* pSharedDevice = nullptr;
+		ULONGLONG SharedKey = 0;
+	} BufferSharing;
+
+	MOCKWRAPPER(MOCKCACHE& Cache, DWORD BufferBytes, DWORD Format = 1) : Cache(Cache)
+	{
+		ProxyInterface = Cache.Device.CreateSoundBuffer(BufferBytes);
+
+		BufferSharing.pDevice = &Cache.Device;
+		BufferSharing.FormatKey = SoundBufferCache::Hash(0, &Format, sizeof(DWORD));
+		BufferSharing.FormatKey = SoundBufferCache::Hash(BufferSharing.FormatKey, &BufferBytes, sizeof(DWORD));
+		BufferSharing.BufferBytes = BufferBytes;
+	}
+
+	~MOCKWRAPPER()
+	{
+		ProxyInterface->Release();
+	}
+
+	BYTE* Lock(DWORD dwOffset, DWORD dwBytes, DWORD& dwAudioBytes, DWORD dwFlags)
+	{
+		if (BufferSharing.pSharedDevice)
+		{
+			StopSharingBufferContent();
+		}
+
+		if (dwFlags & DSBLOCK_FROMWRITECURSOR)
+		{
+			dwOffset = ProxyInterface->Position;
+		}
+		if (dwFlags & DSBLOCK_ENTIREBUFFER)
+		{
+			dwBytes = (DWORD)ProxyInterface->Data->size();
+		}
+		dwAudioBytes = min(dwBytes, (DWORD)ProxyInterface->Data->size() - dwOffset);
+
+		if (BufferSharing.pDevice)
+		{
+			BufferSharing.IsLocked = SoundBufferCache::IsWholeBufferLock(dwOffset, dwBytes, dwFlags, BufferSharing.BufferBytes);
+			if (!BufferSharing.IsLocked)
+			{
+				BufferSharing.pDevice = nullptr;
+			}
+		}
+
+		return ProxyInterface->Data->data() + dwOffset;
+	}
+
+	void Unlock(BYTE* pvAudioPtr, DWORD dwAudioBytes)
+	{
+		MOCKDEVICE* pDevice = nullptr;
+		ULONGLONG Key = 0;
+		if (BufferSharing.pDevice && BufferSharing.IsLocked && dwAudioBytes == BufferSharing.BufferBytes)
+		{
+			pDevice = BufferSharing.pDevice;
+			Key = SoundBufferCache::Hash(BufferSharing.FormatKey, pvAudioPtr, dwAudioBytes);
+		}
+		BufferSharing.pDevice = nullptr;
+
+		if (pDevice)
+		{
+			ShareBufferContent(pDevice, Key);
+		}
+	}
+
+	void Fill(BYTE Value, DWORD dwFlags = DSBLOCK_ENTIREBUFFER)
+	{
+		DWORD dwAudioBytes = 0;
+		BYTE* pData = Lock(0, BufferSharing.BufferBytes, dwAudioBytes, dwFlags);
+		std::fill(pData, pData + dwAudioBytes, Value);
+		Unlock(pData, dwAudioBytes);
+	}
+
+	void ShareBufferContent(MOCKDEVICE* pDevice, ULONGLONG Key)
+	{
+		if (ProxyInterface->RefCount != 1 || (ProxyInterface->Status & DSBSTATUS_PLAYING))
+		{
+			return;
+		}
+
+		MOCKBUFFER* pDuplicate = nullptr;
+		if (Cache.GetDuplicate(Key, ProxyInterface, &pDuplicate) != DS_OK || !pDuplicate)
+		{
+			return;
+		}
+
+		ReplaceProxyInterface(pDuplicate);
+
+		BufferSharing.pSharedDevice = pDevice;
+		BufferSharing.SharedKey = Key;
+	}
+
+	void StopSharingBufferContent()
+	{
+		BufferSharing.pSharedDevice = nullptr;
+
+		const DWORD dwStatus = ProxyInterface->Status;
+		const DWORD dwPosition = ProxyInterface->Position;
+
+		if (ProxyInterface->RefCount != 1)
+		{
+			Cache.RemoveEntry(BufferSharing.SharedKey);
+			return;
+		}
+
+		ReplaceProxyInterface(Cache.Device.CreateCopy(ProxyInterface));
+
+		if (dwStatus & DSBSTATUS_PLAYING)
+		{
+			ProxyInterface->Position = dwPosition;
+			ProxyInterface->Status = dwStatus;
+		}
+	}
+
+	void ReplaceProxyInterface(MOCKBUFFER* pNewProxy)
+	{
+		pNewProxy->Volume = ProxyInterface->Volume;
+		pNewProxy->Pan = ProxyInterface->Pan;
+		pNewProxy->Frequency = ProxyInterface->Frequency;
+		pNewProxy->Position = ProxyInterface->Position;
+		ProxyInterface->Release();
+		ProxyInterface = pNewProxy;
+	}
+};
+
+TEST_CASE(HashDependsOnSeedAndEveryByte)
+{
+	std::vector<BYTE> Data(37, 0x5A);
+	const ULONGLONG Value = SoundBufferCache::Hash(0, Data.data(), (DWORD)Data.size());
+
+	CHECK_EQUAL(0xCBF29CE484222325ULL, SoundBufferCache::Hash(0, nullptr, 0));
+	CHECK_EQUAL(Value, SoundBufferCache::Hash(0xCBF29CE484222325ULL, Data.data(), (DWORD)Data.size()));
+	CHECK(Value != SoundBufferCache::Hash(1, Data.data(), (DWORD)Data.size()));
+	CHECK(Value != SoundBufferCache::Hash(0, Data.data(), (DWORD)Data.size() - 1));
+
+	// Bytes in the qword part and in the tail
+	for (DWORD x : { 0u, 7u, 8u, 35u, 36u })
+	{
+		Data[x] ^= 1;
+		CHECK(Value != SoundBufferCache::Hash(0, Data.data(), (DWORD)Data.size()));
+		Data[x] ^= 1;
+	}
+}
+
+TEST_CASE(OnlyWholeBufferLocksAreShared)
+{
+	CHECK(SoundBufferCache::IsWholeBufferLock(0, 1000, 0, 1000));
+	CHECK(SoundBufferCache::IsWholeBufferLock(0, 0, DSBLOCK_ENTIREBUFFER, 1000));
+	CHECK(SoundBufferCache::IsWholeBufferLock(500, 0, DSBLOCK_ENTIREBUFFER, 1000));
+	CHECK(!SoundBufferCache::IsWholeBufferLock(0, 999, 0, 1000));
+	CHECK(!SoundBufferCache::IsWholeBufferLock(4, 1000, 0, 1000));
+	CHECK(!SoundBufferCache::IsWholeBufferLock(0, 1000, DSBLOCK_FROMWRITECURSOR, 1000));
+	CHECK(!SoundBufferCache::IsWholeBufferLock(0, 0, DSBLOCK_FROMWRITECURSOR | DSBLOCK_ENTIREBUFFER, 1000));
+}
+
+TEST_CASE(LeastRecentlyUsedMasterIsReleased)
+{
+	MOCKDEVICE Device;
+	{
+		MOCKCACHE Cache(Device, 2);
+		MOCKBUFFER* pMaster1 = Device.CreateSoundBuffer(16);
+		MOCKBUFFER* pMaster2 = Device.CreateSoundBuffer(16);
+		Cache.Masters.Add(&Device, 1, pMaster1, Cache.MaxSize);
+		Cache.Masters.Add(&Device, 2, pMaster2, Cache.MaxSize);
+
+		// Using the older entry makes the newer one the least recently used
+		CHECK(Cache.Masters.Find(&Device, 1) == pMaster1);
+		CHECK(Cache.Masters.Find(&Device, 3) == nullptr);
+		CHECK(Cache.Masters.Find((MOCKDEVICE*)nullptr, 1) == nullptr);
+
+		Cache.Masters.Add(&Device, 3, Device.CreateSoundBuffer(16), Cache.MaxSize);
+		CHECK_EQUAL(2u, Cache.Masters.Entries.size());
+		CHECK_EQUAL(2u, Device.LiveCount);
+		CHECK(Cache.Masters.Find(&Device, 2) == nullptr);
+		CHECK(Cache.Masters.Find(&Device, 1) == pMaster1);
+
+		Cache.Masters.Remove(&Device, 1);
+		CHECK_EQUAL(1u, Device.LiveCount);
+		CHECK_EQUAL(3u, Cache.Masters.Entries.front().Key);
+	}
+	CHECK_EQUAL(0u, Device.LiveCount);
+}
+
+TEST_CASE(RemovedDeviceDropsMastersWithoutRelease)
+{
+	MOCKDEVICE Device, OtherDevice;
+	SoundBufferCache::CACHELIST<MOCKDEVICE*, MOCKBUFFER*> Masters;
+	MOCKBUFFER* pMaster = Device.CreateSoundBuffer(16);
+	MOCKBUFFER* pOtherMaster = OtherDevice.CreateSoundBuffer(16);
+	Masters.Add(&Device, 1, pMaster, 8);
+	Masters.Add(&OtherDevice, 1, pOtherMaster, 8);
+
+	// The device frees its buffers itself when it is released
+	Masters.RemoveDevice(&Device);
+	CHECK_EQUAL(1u, Masters.Entries.size());
+	CHECK_EQUAL(1u, Device.LiveCount);
+	CHECK(Masters.Find(&OtherDevice, 1) == pOtherMaster);
+
+	pMaster->Release();
+	pOtherMaster->Release();
+}
+
+TEST_CASE(SameContentSharesPrivateMaster)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKWRAPPER Buffer1(Cache, 4096), Buffer2(Cache, 4096), Buffer3(Cache, 4096), Other(Cache, 4096, 2);
+
+	// First fill makes a private master, the buffer keeps its own data
+	Buffer1.Fill(0x40);
+	CHECK(Buffer1.BufferSharing.pSharedDevice == nullptr);
+	CHECK_EQUAL(1u, Cache.Masters.Entries.size());
+	CHECK(Cache.Masters.Entries.front().pMaster->Data != Buffer1.ProxyInterface->Data);
+
+	// Later fills with the same content and format use duplicates of the master
+	Buffer2.Fill(0x40);
+	Buffer3.Fill(0x40);
+	Other.Fill(0x40);
+	CHECK(Buffer2.BufferSharing.pSharedDevice == &Device);
+	CHECK(Buffer2.ProxyInterface->Data == Buffer3.ProxyInterface->Data);
+	CHECK(Buffer2.ProxyInterface->Data == Cache.Masters.Find(&Device, Buffer2.BufferSharing.SharedKey)->Data);
+	CHECK(Other.BufferSharing.pSharedDevice == nullptr);
+	CHECK_EQUAL(2u, Cache.Masters.Entries.size());
+
+	// Only the first whole buffer fill is checked
+	Buffer1.Fill(0x40);
+	CHECK(Buffer1.BufferSharing.pSharedDevice == nullptr);
+}
+
+TEST_CASE(DuplicatesKeepTheirOwnSettings)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKWRAPPER Buffer1(Cache, 1024), Buffer2(Cache, 1024), Buffer3(Cache, 1024);
+	Buffer1.Fill(0x11);
+
+	Buffer2.ProxyInterface->Volume = -600;
+	Buffer2.ProxyInterface->Pan = 300;
+	Buffer2.ProxyInterface->Frequency = 11025;
+	Buffer2.Fill(0x11);
+	Buffer3.Fill(0x11);
+
+	// Settings from before sharing are carried over to the duplicate
+	CHECK(Buffer2.BufferSharing.pSharedDevice != nullptr);
+	CHECK_EQUAL(-600, Buffer2.ProxyInterface->Volume);
+	CHECK_EQUAL(300, Buffer2.ProxyInterface->Pan);
+	CHECK_EQUAL(11025u, Buffer2.ProxyInterface->Frequency);
+
+	Buffer3.ProxyInterface->Position = 512;
+	CHECK_EQUAL(0u, Buffer2.ProxyInterface->Position);
+	CHECK_EQUAL(0, Buffer3.ProxyInterface->Volume);
+}
+
+TEST_CASE(WriteToSharedBufferCopiesFirst)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKWRAPPER Buffer1(Cache, 1024), Buffer2(Cache, 1024), Buffer3(Cache, 1024), Buffer4(Cache, 1024);
+	Buffer1.Fill(0x22);
+	Buffer2.Fill(0x22);
+	Buffer3.Fill(0x22);
+	const ULONGLONG Key = Buffer2.BufferSharing.SharedKey;
+
+	// Playing buffer gets a private copy before the write, play state and settings stay the same
+	Buffer2.ProxyInterface->Status = DSBSTATUS_PLAYING | DSBSTATUS_LOOPING;
+	Buffer2.ProxyInterface->Position = 96;
+	Buffer2.ProxyInterface->Volume = -100;
+	DWORD dwAudioBytes = 0;
+	BYTE* pData = Buffer2.Lock(0, 16, dwAudioBytes, 0);
+	std::fill(pData, pData + dwAudioBytes, 0x33);
+	Buffer2.Unlock(pData, dwAudioBytes);
+
+	CHECK(Buffer2.BufferSharing.pSharedDevice == nullptr);
+	CHECK_EQUAL((DWORD)(DSBSTATUS_PLAYING | DSBSTATUS_LOOPING), Buffer2.ProxyInterface->Status);
+	CHECK_EQUAL(96u, Buffer2.ProxyInterface->Position);
+	CHECK_EQUAL(-100, Buffer2.ProxyInterface->Volume);
+	CHECK_EQUAL(0x33, (*Buffer2.ProxyInterface->Data)[0]);
+	CHECK_EQUAL(0x22, (*Buffer2.ProxyInterface->Data)[16]);
+
+	// Master and other duplicates still hold the original content
+	CHECK_EQUAL(0x22, (*Buffer3.ProxyInterface->Data)[0]);
+	CHECK_EQUAL(0x22, (*Cache.Masters.Find(&Device, Key)->Data)[0]);
+	Buffer4.Fill(0x22);
+	CHECK(Buffer4.BufferSharing.pSharedDevice == &Device);
+	CHECK_EQUAL(0x22, (*Buffer4.ProxyInterface->Data)[0]);
+}
+
+TEST_CASE(HeldProxyDropsCacheEntryInsteadOfCopying)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKWRAPPER Buffer1(Cache, 1024), Buffer2(Cache, 1024), Buffer3(Cache, 1024);
+	Buffer1.Fill(0x44);
+	Buffer2.Fill(0x44);
+
+	// Another interface holds the proxy, so it cannot be swapped for a copy
+	Buffer2.ProxyInterface->AddRef();
+	DWORD dwAudioBytes = 0;
+	Buffer2.Unlock(Buffer2.Lock(0, 16, dwAudioBytes, 0), dwAudioBytes);
+	CHECK(Cache.Masters.Entries.empty());
+	Buffer2.ProxyInterface->Release();
+
+	// New buffers no longer pick up the content
+	Buffer3.Fill(0x44);
+	CHECK(Buffer3.BufferSharing.pSharedDevice == nullptr);
+}
+
+TEST_CASE(PartialOrWriteCursorLocksAreNotShared)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKWRAPPER Buffer1(Cache, 1024), Buffer2(Cache, 1024), Buffer3(Cache, 1024), Buffer4(Cache, 1024);
+	Buffer1.Fill(0x55);
+
+	DWORD dwAudioBytes = 0;
+	Buffer2.Unlock(Buffer2.Lock(0, 512, dwAudioBytes, 0), dwAudioBytes);
+	Buffer2.Fill(0x55);
+	CHECK(Buffer2.BufferSharing.pSharedDevice == nullptr);
+
+	Buffer3.Fill(0x55, DSBLOCK_FROMWRITECURSOR);
+	CHECK(Buffer3.BufferSharing.pSharedDevice == nullptr);
+
+	// Buffers that were not filled in one lock never become shared afterwards
+	Buffer4.Fill(0x55);
+	CHECK(Buffer4.BufferSharing.pSharedDevice == &Device);
+	CHECK_EQUAL(1u, Cache.Masters.Entries.size());
+}
+
+TEST_CASE(HashCollisionIsNotShared)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 8);
+	MOCKBUFFER* pBuffer1 = Device.CreateSoundBuffer(64);
+	MOCKBUFFER* pBuffer2 = Device.CreateSoundBuffer(64);
+	(*pBuffer2->Data)[10] = 1;
+
+	MOCKBUFFER* pDuplicate = nullptr;
+	CHECK_EQUAL(S_FALSE, Cache.GetDuplicate(7, pBuffer1, &pDuplicate));
+	CHECK_EQUAL(S_FALSE, Cache.GetDuplicate(7, pBuffer2, &pDuplicate));
+	CHECK(pDuplicate == nullptr);
+	CHECK_EQUAL(DS_OK, Cache.GetDuplicate(7, pBuffer1, &pDuplicate));
+	CHECK(pDuplicate != nullptr && pDuplicate->Data != pBuffer1->Data);
+
+	pDuplicate->Release();
+	pBuffer1->Release();
+	pBuffer2->Release();
+}
+
+// A game loading the same one second sound effect for every unit on screen
+BENCHMARK_CASE(RepeatedEffectLoads)
+{
+	MOCKDEVICE Device;
+	MOCKCACHE Cache(Device, 64);
+	const DWORD BufferBytes = 44100 * 4;
+	DWORD Shared = 0;
+
+	const double Time = TestHarness::Measure(200, [&]()
+	{
+		MOCKWRAPPER Buffer(Cache, BufferBytes);
+		Buffer.Fill(0x66);
+		Shared += (Buffer.BufferSharing.pSharedDevice != nullptr);
+	});
+
+	std::vector<BYTE> Data(BufferBytes, 0x66);
+	const double HashOnly = TestHarness::Measure(200, [&]()
+	{
+		Data[0] = (BYTE)SoundBufferCache::Hash(0, Data.data(), BufferBytes);
+	});
+
+	std::printf("    load: %.1f us (%.1f us hash), %u of 200 shared, %u buffers alive\n", Time / 1000, HashOnly / 1000, Shared, Device.LiveCount);
+}
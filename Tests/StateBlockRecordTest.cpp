@@ -0,0 +1,306 @@
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "d3d9/ShadowState.h"
+
+static constexpr DWORD StateCount = 32;
+
+struct MOCKDEVICE
+{
+	bool IsPure = false;
+	bool IsRecording = false;
+	DWORD State[StateCount] = {};
+	DWORD GetCalls = 0;
+	DWORD SetCalls = 0;
+	std::vector<STATEVALUE> Recorded;		// Runtime state block, every recorded state is set on Apply
+
+	HRESULT GetState(DWORD Index, DWORD* pValue)
+	{
+		GetCalls++;
+		if (IsPure)
+		{
+			return E_FAIL;
+		}
+		*pValue = State[Index];
+		return S_OK;
+	}
+
+	HRESULT SetState(DWORD Index, DWORD Value)
+	{
+		SetCalls++;
+		if (IsRecording)
+		{
+			SetStateValue(Recorded, Index, Value);
+		}
+		else
+		{
+			State[Index] = Value;
+		}
+		return S_OK;
+	}
+
+	void RuntimeApply(const std::vector<STATEVALUE>& Block)
+	{
+		for (const STATEVALUE& Entry : Block)
+		{
+			SetState(Entry.Index, Entry.Value);
+		}
+	}
+};
+
+// Follows m_IDirect3DDevice9Ex: sets are added to the record while recording and to the shadow state otherwise
+struct MOCKWRAPPER
+{
+	MOCKDEVICE& Device;
+	SHADOWSTATE<DWORD> Cache[StateCount];
+	std::vector<STATEVALUE>* pRecord = nullptr;
+
+	MOCKWRAPPER(MOCKDEVICE& Device) : Device(Device) {}
+
+	bool GetCachedState(DWORD Index, DWORD& Value)
+	{
+		return Cache[Index].Get(Value, [&](DWORD& Read) { return SUCCEEDED(Device.GetState(Index, &Read)); });
+	}
+
+	void SetCachedState(DWORD Index, DWORD Value)
+	{
+		if (pRecord)
+		{
+			SetStateValue(*pRecord, Index, Value);
+		}
+		else
+		{
+			Cache[Index] = { true, Value };
+		}
+	}
+
+	void SetState(DWORD Index, DWORD Value)
+	{
+		if (SUCCEEDED(Device.SetState(Index, Value)))
+		{
+			SetCachedState(Index, Value);
+		}
+	}
+
+	void BeginStateBlock(std::vector<STATEVALUE>& Record)
+	{
+		Device.IsRecording = true;
+		Device.Recorded.clear();
+		pRecord = &Record;
+	}
+
+	void EndStateBlock()
+	{
+		Device.IsRecording = false;
+		pRecord = nullptr;
+	}
+
+	// Same steps as m_IDirect3DDevice9Ex::ApplyStateBlockRecord
+	void Apply(const std::vector<STATEVALUE>& Record)
+	{
+		for (const STATEVALUE& Entry : Record)
+		{
+			ApplyShadowState(Entry.Value,
+				[&](DWORD& Value) { return GetCachedState(Entry.Index, Value); },
+				[&](DWORD Value) { SetState(Entry.Index, Value); });
+		}
+	}
+
+	// Same steps as m_IDirect3DDevice9Ex::CaptureStateBlockRecord
+	bool Capture(std::vector<STATEVALUE>& Record)
+	{
+		for (STATEVALUE& Entry : Record)
+		{
+			if (!GetCachedState(Entry.Index, Entry.Value))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// Records a block of random states on both devices, the record must match what the runtime recorded
+static std::vector<STATEVALUE> RecordBlock(std::mt19937& Random, MOCKWRAPPER& Wrapper, MOCKDEVICE& Reference, std::vector<STATEVALUE>& RuntimeBlock)
+{
+	std::vector<STATEVALUE> Record;
+	Wrapper.BeginStateBlock(Record);
+	Reference.IsRecording = true;
+	Reference.Recorded.clear();
+
+	const DWORD Count = 1 + Random() % 12;
+	for (DWORD x = 0; x < Count; x++)
+	{
+		const DWORD Index = Random() % StateCount;
+		const DWORD Value = Random() % 3;
+		Wrapper.SetState(Index, Value);
+		Reference.SetState(Index, Value);
+	}
+
+	Wrapper.EndStateBlock();
+	Reference.IsRecording = false;
+	RuntimeBlock = Reference.Recorded;
+	return Record;
+}
+
+TEST_CASE(RecordKeepsLastValueOfEachState)
+{
+	std::vector<STATEVALUE> Record;
+	SetStateValue(Record, 7, 1);
+	SetStateValue(Record, 3, 2);
+	SetStateValue(Record, 7, 5);
+
+	CHECK_EQUAL(2u, Record.size());
+	CHECK_EQUAL(7u, Record[0].Index);
+	CHECK_EQUAL(5u, Record[0].Value);
+	CHECK_EQUAL(3u, Record[1].Index);
+	CHECK_EQUAL(2u, Record[1].Value);
+}
+
+TEST_CASE(RecordingDoesNotChangeShadowState)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device);
+	Wrapper.SetState(4, 1);
+
+	std::vector<STATEVALUE> Record;
+	Wrapper.BeginStateBlock(Record);
+	Wrapper.SetState(4, 2);
+	Wrapper.EndStateBlock();
+
+	DWORD Value = 0;
+	CHECK(Wrapper.GetCachedState(4, Value));
+	CHECK_EQUAL(1u, Value);
+	CHECK_EQUAL(1u, Device.State[4]);
+	CHECK_EQUAL(1u, Record.size());
+}
+
+TEST_CASE(ApplyMatchesRuntimeApply)
+{
+	std::mt19937 Random(40);
+	MOCKDEVICE Device, Reference;
+	MOCKWRAPPER Wrapper(Device);
+
+	std::vector<std::vector<STATEVALUE>> Records, RuntimeBlocks;
+	for (DWORD x = 0; x < 8; x++)
+	{
+		RuntimeBlocks.emplace_back();
+		Records.push_back(RecordBlock(Random, Wrapper, Reference, RuntimeBlocks.back()));
+	}
+
+	for (DWORD Step = 0; Step < 5000; Step++)
+	{
+		if (Random() % 3)
+		{
+			const DWORD Block = Random() % Records.size();
+			Wrapper.Apply(Records[Block]);
+			Reference.RuntimeApply(RuntimeBlocks[Block]);
+		}
+		else
+		{
+			const DWORD Index = Random() % StateCount;
+			const DWORD Value = Random() % 3;
+			Wrapper.SetState(Index, Value);
+			Reference.SetState(Index, Value);
+		}
+		CHECK(memcmp(Device.State, Reference.State, sizeof(Device.State)) == 0);
+	}
+
+	// Redundant sets are skipped, the runtime sets every recorded state on each apply
+	CHECK(Device.SetCalls < Reference.SetCalls);
+}
+
+TEST_CASE(BackToBackAppliesOnlySetOnce)
+{
+	std::mt19937 Random(4);
+	MOCKDEVICE Device, Reference;
+	MOCKWRAPPER Wrapper(Device);
+	std::vector<STATEVALUE> RuntimeBlock;
+	const std::vector<STATEVALUE> Record = RecordBlock(Random, Wrapper, Reference, RuntimeBlock);
+
+	Wrapper.Apply(Record);
+	const DWORD SetCalls = Device.SetCalls;
+	for (DWORD x = 0; x < 10; x++)
+	{
+		Wrapper.Apply(Record);
+	}
+	CHECK_EQUAL(SetCalls, Device.SetCalls);
+}
+
+TEST_CASE(UnreadableStatesAreAlwaysSet)
+{
+	MOCKDEVICE Device;
+	Device.IsPure = true;
+	Device.State[2] = 1;
+	MOCKWRAPPER Wrapper(Device);
+
+	std::vector<STATEVALUE> Record;
+	SetStateValue(Record, 2, 1);
+	SetStateValue(Record, 3, 0);
+
+	// The values match the device, but a pure device cannot confirm it
+	Wrapper.Apply(Record);
+	CHECK_EQUAL(2u, Device.SetCalls);
+
+	// Known from the first apply
+	Wrapper.Apply(Record);
+	CHECK_EQUAL(2u, Device.SetCalls);
+}
+
+TEST_CASE(CaptureThenApplyRestoresState)
+{
+	MOCKDEVICE Device;
+	MOCKWRAPPER Wrapper(Device);
+
+	std::vector<STATEVALUE> Record;
+	Wrapper.BeginStateBlock(Record);
+	Wrapper.SetState(1, 0);
+	Wrapper.SetState(9, 0);
+	Wrapper.EndStateBlock();
+
+	Wrapper.SetState(1, 2);
+	Wrapper.SetState(9, 1);
+	CHECK(Wrapper.Capture(Record));
+	CHECK_EQUAL(2u, Record[0].Value);
+	CHECK_EQUAL(1u, Record[1].Value);
+
+	Wrapper.SetState(1, 0);
+	Wrapper.SetState(9, 0);
+	Wrapper.Apply(Record);
+	CHECK_EQUAL(2u, Device.State[1]);
+	CHECK_EQUAL(1u, Device.State[9]);
+
+	// A pure device cannot capture states the game never set
+	MOCKDEVICE PureDevice;
+	PureDevice.IsPure = true;
+	MOCKWRAPPER PureWrapper(PureDevice);
+	std::vector<STATEVALUE> PureRecord;
+	SetStateValue(PureRecord, 5, 0);
+	CHECK(!PureWrapper.Capture(PureRecord));
+}
+
+BENCHMARK_CASE(ApplySetCallsPerFrame)
+{
+	std::mt19937 Random(1);
+	MOCKDEVICE Device, Reference;
+	MOCKWRAPPER Wrapper(Device);
+
+	std::vector<std::vector<STATEVALUE>> Records, RuntimeBlocks;
+	for (DWORD x = 0; x < 4; x++)
+	{
+		RuntimeBlocks.emplace_back();
+		Records.push_back(RecordBlock(Random, Wrapper, Reference, RuntimeBlocks.back()));
+	}
+	Device.SetCalls = 0;
+	Reference.SetCalls = 0;
+
+	// Material switches between a few recorded blocks
+	DWORD Frame = 0;
+	const double Time = TestHarness::Measure(100000, [&]()
+	{
+		const DWORD Block = (Frame++ / 3) % Records.size();
+		Wrapper.Apply(Records[Block]);
+		Reference.RuntimeApply(RuntimeBlocks[Block]);
+	});
+	std::printf("    apply: %.1f ns, set calls %u vs %u for the runtime\n", Time, Device.SetCalls, Reference.SetCalls);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+// Minimal test and benchmark registry for the Linux test harness
+namespace TestHarness
+{
+	struct TESTCASE
+	{
+		const char* Name;
+		void(*Function)();
+	};
+
+	inline std::vector<TESTCASE>& GetTests()
+	{
+		static std::vector<TESTCASE> Tests;
+		return Tests;
+	}
+
+	inline std::vector<TESTCASE>& GetBenchmarks()
+	{
+		static std::vector<TESTCASE> Benchmarks;
+		return Benchmarks;
+	}
+
+	inline int& GetFailures()
+	{
+		static int Failures = 0;
+		return Failures;
+	}
+
+	struct REGISTER
+	{
+		REGISTER(std::vector<TESTCASE>& List, const char* Name, void(*Function)())
+		{
+			List.push_back({ Name, Function });
+		}
+	};
+
+	// Runs Function Iterations times and returns nanoseconds per iteration
+	template <typename F>
+	double Measure(unsigned Iterations, F Function)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		for (unsigned x = 0; x < Iterations; x++)
+		{
+			Function();
+		}
+		const auto Stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(Stop - Start).count() / Iterations;
+	}
+}
+
+#define TEST_CASE(Name) \
+	static void Name(); \
+	static TestHarness::REGISTER Register ## Name(TestHarness::GetTests(), #Name, Name); \
+	static void Name()
+
+#define BENCHMARK_CASE(Name) \
+	static void Name(); \
+	static TestHarness::REGISTER Register ## Name(TestHarness::GetBenchmarks(), #Name, Name); \
+	static void Name()
+
+#define CHECK(Expr) \
+	do \
+	{ \
+		if (!(Expr)) \
+		{ \
+			std::printf("    %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #Expr); \
+			TestHarness::GetFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(Expected, Actual) \
+	do \
+	{ \
+		const auto ExpectedValue = (Expected); \
+		const auto ActualValue = (Actual); \
+		if (!(ExpectedValue == ActualValue)) \
+		{ \
+			std::printf("    %s:%d: CHECK_EQUAL(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #Expected, #Actual, \
+				(long long)ExpectedValue, (long long)ActualValue); \
+			TestHarness::GetFailures()++; \
+		} \
+	} while (0)
@@ -0,0 +1,25 @@
+#include <cstring>
+#include "TestHarness.h"
+
+// Runs all registered tests, or the benchmarks when started with --bench
+int main(int argc, char** argv)
+{
+	const bool RunBenchmarks = (argc > 1 && strcmp(argv[1], "--bench") == 0);
+
+	int Failed = 0;
+	for (const auto& entry : RunBenchmarks ? TestHarness::GetBenchmarks() : TestHarness::GetTests())
+	{
+		const int Failures = TestHarness::GetFailures();
+		std::printf("%s %s\n", RunBenchmarks ? "[ BENCH ]" : "[ RUN   ]", entry.Name);
+		entry.Function();
+		if (TestHarness::GetFailures() != Failures)
+		{
+			std::printf("[ FAIL  ] %s\n", entry.Name);
+			Failed++;
+		}
+	}
+
+	std::printf("%d failed\n", Failed);
+
+	return Failed ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+#include <random>
+#include "WinTypes.h"
+#include "TestHarness.h"
+#include "d3d9/UPDrawBuffer.h"
+
+// Dynamic buffer that checks NOOVERWRITE locks never touch data the GPU may still read since the last discard
+struct MOCKBUFFER
+{
+	UPRINGBUFFER Ring;
+	std::vector<BYTE> Storage;
+	UINT UsedEnd = 0;				// End of the data written since the last discard
+	DWORD DiscardCount = 0;
+	DWORD Hazards = 0;
+
+	MOCKBUFFER(UINT Size, ULONGLONG MaxCount = ~0ULL) : Storage(Size)
+	{
+		Ring.Reset(Size, MaxCount);
+	}
+
+	// Same steps as m_IDirect3DDevice9Ex::CopyToUPVertexBuffer, returns the start element for the draw
+	bool Copy(const void* pData, UINT Size, UINT Stride, UINT& Start)
+	{
+		UINT Offset = 0;
+		DWORD Flags = 0;
+		if (!Ring.Append(Size, Stride, Offset, Flags))
+		{
+			return false;
+		}
+
+		if (Flags & D3DLOCK_DISCARD)
+		{
+			DiscardCount++;
+			UsedEnd = 0;
+		}
+		else if (Offset < UsedEnd)
+		{
+			Hazards++;
+		}
+		memcpy(Storage.data() + Offset, pData, Size);
+		UsedEnd = Offset + Size;
+
+		Start = Offset / Stride;
+		return true;
+	}
+};
+
+TEST_CASE(VertexCountPerPrimitiveType)
+{
+	CHECK_EQUAL(5u, GetUPVertexCount(D3DPT_POINTLIST, 5));
+	CHECK_EQUAL(10u, GetUPVertexCount(D3DPT_LINELIST, 5));
+	CHECK_EQUAL(6u, GetUPVertexCount(D3DPT_LINESTRIP, 5));
+	CHECK_EQUAL(15u, GetUPVertexCount(D3DPT_TRIANGLELIST, 5));
+	CHECK_EQUAL(7u, GetUPVertexCount(D3DPT_TRIANGLESTRIP, 5));
+	CHECK_EQUAL(7u, GetUPVertexCount(D3DPT_TRIANGLEFAN, 5));
+	CHECK_EQUAL(0u, GetUPVertexCount(D3DPT_TRIANGLESTRIP, 0));
+	CHECK_EQUAL(0u, GetUPVertexCount((D3DPRIMITIVETYPE)0, 5));
+}
+
+TEST_CASE(FirstAppendDiscardsThenAppends)
+{
+	UPRINGBUFFER Ring;
+	Ring.Reset(1024);
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	CHECK(Ring.Append(100, 20, Offset, Flags));
+	CHECK_EQUAL(0u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Flags);
+
+	CHECK(Ring.Append(100, 20, Offset, Flags));
+	CHECK_EQUAL(100u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_NOOVERWRITE, Flags);
+}
+
+TEST_CASE(StartIsAlignedToStride)
+{
+	UPRINGBUFFER Ring;
+	Ring.Reset(1024);
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	CHECK(Ring.Append(30, 30, Offset, Flags));
+	CHECK(Ring.Append(96, 32, Offset, Flags));
+	CHECK_EQUAL(32u, Offset);
+	CHECK(Ring.Append(28, 28, Offset, Flags));
+	CHECK_EQUAL(140u, Offset);
+	CHECK_EQUAL(0u, Offset % 28);
+}
+
+TEST_CASE(WrapsWhenFull)
+{
+	UPRINGBUFFER Ring;
+	Ring.Reset(256);
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	CHECK(Ring.Append(200, 4, Offset, Flags));
+	CHECK(Ring.Append(56, 4, Offset, Flags));
+	CHECK_EQUAL(200u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_NOOVERWRITE, Flags);
+
+	CHECK(Ring.Append(4, 4, Offset, Flags));
+	CHECK_EQUAL(0u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Flags);
+}
+
+TEST_CASE(OversizedDrawsFallBack)
+{
+	UPRINGBUFFER Ring;
+	Ring.Reset(256, 16);
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	CHECK(!Ring.Append(260, 4, Offset, Flags));
+	CHECK(!Ring.Append(0, 4, Offset, Flags));
+	CHECK(!Ring.Append(16, 0, Offset, Flags));
+
+	// 17 vertices cannot be addressed by a device with a MaxVertexIndex of 15
+	CHECK(!Ring.Append(17 * 8, 8, Offset, Flags));
+	CHECK(Ring.Append(16 * 8, 8, Offset, Flags));
+
+	// Appending after the first 16 vertices would go past MaxVertexIndex, so the buffer is discarded instead
+	CHECK(Ring.Append(8, 8, Offset, Flags));
+	CHECK_EQUAL(0u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Flags);
+}
+
+TEST_CASE(FailedLockDiscardsNext)
+{
+	UPRINGBUFFER Ring;
+	Ring.Reset(1024);
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	CHECK(Ring.Append(64, 4, Offset, Flags));
+	CHECK(Ring.Append(64, 4, Offset, Flags));
+	Ring.Invalidate();
+
+	CHECK(Ring.Append(64, 4, Offset, Flags));
+	CHECK_EQUAL(0u, Offset);
+	CHECK_EQUAL((DWORD)D3DLOCK_DISCARD, Flags);
+}
+
+TEST_CASE(RandomDrawsNeverOverwriteInFlightData)
+{
+	std::mt19937 Random(39);
+	MOCKBUFFER Buffer(64 * 1024, 0x10000);
+	const UINT Strides[] = { 12, 20, 24, 28, 32, 36, 44 };
+	std::vector<BYTE> Data(8 * 1024);
+
+	for (DWORD Draw = 0; Draw < 20000; Draw++)
+	{
+		const UINT Stride = Strides[Random() % 7];
+		const UINT Size = (1 + Random() % (Data.size() / Stride)) * Stride;
+		for (UINT x = 0; x < Size; x += 64)
+		{
+			Data[x] = (BYTE)Random();
+		}
+
+		UINT Start = 0;
+		CHECK(Buffer.Copy(Data.data(), Size, Stride, Start));
+		CHECK(memcmp(Buffer.Storage.data() + (size_t)Start * Stride, Data.data(), Size) == 0);
+	}
+
+	CHECK_EQUAL(0u, Buffer.Hazards);
+	CHECK(Buffer.DiscardCount > 1);
+}
+
+// Sprite quads drawn as 4 vertex strips with a 28 byte stride, a typical UI or 2D game frame
+BENCHMARK_CASE(SpriteQuadCopyCost)
+{
+	MOCKBUFFER Buffer(2 * 1024 * 1024, 0x10000);
+	std::vector<BYTE> Quad(4 * 28, 0x11);
+	std::vector<BYTE> RuntimeCopy(Quad.size());
+	UINT Start = 0;
+
+	const double Ring = TestHarness::Measure(1000000, [&]()
+	{
+		Buffer.Copy(Quad.data(), (UINT)Quad.size(), 28, Start);
+	});
+
+	// The runtime copies UP data as well, this is the part of the cost that is not added by the ring
+	const double CopyOnly = TestHarness::Measure(1000000, [&]()
+	{
+		memcpy(RuntimeCopy.data(), Quad.data(), Quad.size());
+	});
+
+	std::printf("    quad: %.1f ns per draw (%.1f ns copy), %u discards\n", Ring, CopyOnly, Buffer.DiscardCount);
+}
+
+BENCHMARK_CASE(ParticleListCopyCost)
+{
+	MOCKBUFFER Buffer(2 * 1024 * 1024, 0x10000);
+	std::vector<BYTE> Particles(600 * 24, 0x22);
+	UINT Start = 0;
+
+	const double Ring = TestHarness::Measure(100000, [&]()
+	{
+		Buffer.Copy(Particles.data(), (UINT)Particles.size(), 24, Start);
+	});
+
+	std::printf("    600 vertex list: %.1f ns per draw, %u discards\n", Ring, Buffer.DiscardCount);
+}
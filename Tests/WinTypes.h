@@ -0,0 +1,95 @@
+#pragma once
+
+// Stand-ins for the Windows SDK types and constants used by the headers under test, so they build on Linux
+#include <cstdint>
+#include <cstring>
+#include <strings.h>
+#include <type_traits>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef int16_t SHORT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t UINT;
+typedef int32_t INT;
+typedef int BOOL;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int32_t HRESULT;
+typedef void* LPVOID;
+typedef DWORD* LPDWORD;
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005)
+
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+
+// Windows headers define these as macros, functions keep the standard headers usable
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return (a < b) ? a : b; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return (a < b) ? b : a; }
+
+// dsound.h
+#define DS_OK S_OK
+#define DS3D_IMMEDIATE 0x00000000
+#define DS3D_DEFERRED 0x00000001
+#define DSBLOCK_FROMWRITECURSOR 0x00000001
+#define DSBLOCK_ENTIREBUFFER 0x00000002
+#define DSBSTATUS_PLAYING 0x00000001
+#define DSBSTATUS_LOOPING 0x00000004
+#define DSBPLAY_LOOPING 0x00000001
+
+// d3d9types.h
+#define D3DUSAGE_WRITEONLY 0x00000008L
+#define D3DUSAGE_DYNAMIC 0x00000200L
+#define D3DLOCK_READONLY 0x00000010L
+#define D3DLOCK_DISCARD 0x00002000L
+#define D3DLOCK_NOOVERWRITE 0x00001000L
+#define D3DLOCK_NOSYSLOCK 0x00000800L
+
+typedef enum _D3DPRIMITIVETYPE {
+	D3DPT_POINTLIST = 1,
+	D3DPT_LINELIST = 2,
+	D3DPT_LINESTRIP = 3,
+	D3DPT_TRIANGLELIST = 4,
+	D3DPT_TRIANGLESTRIP = 5,
+	D3DPT_TRIANGLEFAN = 6,
+} D3DPRIMITIVETYPE;
+
+// windef.h
+typedef struct tagRECT
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} RECT, *LPRECT;
+
+// ddraw.h
+typedef struct IDirectDrawSurface* LPDIRECTDRAWSURFACE;
+typedef struct _DDBLTFX* LPDDBLTFX;
+
+typedef struct _DDBLTBATCH
+{
+	LPRECT lprDest;
+	LPDIRECTDRAWSURFACE lpDDSSrc;
+	LPRECT lprSrc;
+	DWORD dwFlags;
+	LPDDBLTFX lpDDBltFx;
+} DDBLTBATCH, *LPDDBLTBATCH;
+
+#define DDBLT_ASYNC 0x00000200L
+#define DDBLT_COLORFILL 0x00000400L
+#define DDBLT_DDFX 0x00000800L
+#define DDBLT_KEYDEST 0x00002000L
+#define DDBLT_KEYSRC 0x00008000L
+#define DDBLT_ROP 0x00020000L
+#define DDBLT_WAIT 0x01000000L
+#define DDBLT_DONOTWAIT 0x08000000L
@@ -0,0 +1,210 @@
+/**
+* Copyright (C) 2025 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <algorithm>
+#include "Utils.h"
+#include "Logging\Logging.h"
+
+namespace Utils
+{
+	struct PATTERNDATA
+	{
+		std::vector<BYTE> Bytes;
+		std::vector<BYTE> Mask;			// 0xFF for bytes that must match, 0x00 for wildcards
+		size_t AnchorOffset = 0;		// Offset of the fixed bytes used to index the lookup table
+		bool SingleAnchor = false;		// Pattern has no two fixed bytes next to each other
+	};
+
+	// Function declarations
+	bool ParsePattern(const char* str, PATTERNDATA& Data);
+	bool MatchPattern(const BYTE* address, const PATTERNDATA& Data);
+}
+
+namespace
+{
+	inline int HexValue(char ch)
+	{
+		return (ch >= '0' && ch <= '9') ? ch - '0' :
+			(ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 :
+			(ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : -1;
+	}
+}
+
+// Parses a pattern string such as "8B 0D ? ? ? ? 85 C9" with the same rules as hook::pattern, each '?' is one wildcard
+// byte and whitespace is ignored. Anything else is rejected instead of being skipped, so a typo cannot silently shift
+// the remaining bytes.
+bool Utils::ParsePattern(const char* str, PATTERNDATA& Data)
+{
+	Data = {};
+
+	if (!str)
+	{
+		return false;
+	}
+
+	for (const char* pos = str; *pos; pos++)
+	{
+		if (*pos == ' ' || *pos == '\t')
+		{
+			continue;
+		}
+		else if (*pos == '?')
+		{
+			Data.Bytes.push_back(0x00);
+			Data.Mask.push_back(0x00);
+		}
+		else if (HexValue(pos[0]) >= 0 && HexValue(pos[1]) >= 0)
+		{
+			Data.Bytes.push_back((BYTE)((HexValue(pos[0]) << 4) | HexValue(pos[1])));
+			Data.Mask.push_back(0xFF);
+			pos++;
+		}
+		else
+		{
+			Logging::Log() << __FUNCTION__ << " Error: unsupported token '" << *pos << "' at offset " << (pos - str) <<
+				((HexValue(*pos) >= 0) ? " (bytes need two hex digits)" : "") << " in pattern: " << str;
+			return false;
+		}
+	}
+
+	// Prefer two fixed bytes as the anchor since they filter out far more positions than one
+	for (size_t x = 0; x + 1 < Data.Mask.size(); x++)
+	{
+		if (Data.Mask[x] && Data.Mask[x + 1])
+		{
+			Data.AnchorOffset = x;
+			return true;
+		}
+	}
+	for (size_t x = 0; x < Data.Mask.size(); x++)
+	{
+		if (Data.Mask[x])
+		{
+			Data.AnchorOffset = x;
+			Data.SingleAnchor = true;
+			return true;
+		}
+	}
+
+	Logging::Log() << __FUNCTION__ << " Error: pattern has no fixed bytes: " << str;
+	return false;
+}
+
+bool Utils::MatchPattern(const BYTE* address, const PATTERNDATA& Data)
+{
+	for (size_t x = 0; x < Data.Bytes.size(); x++)
+	{
+		if ((address[x] & Data.Mask[x]) != Data.Bytes[x])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Checks if the memory at address still matches the pattern
+bool Utils::CheckPattern(const void* address, const std::string& Pattern)
+{
+	PATTERNDATA Data;
+	if (!address || !ParsePattern(Pattern.c_str(), Data))
+	{
+		return false;
+	}
+
+	return MatchPattern((const BYTE*)address, Data);
+}
+
+// Finds the first match of each pattern with a single pass over the memory range
+void Utils::FindPatterns(const void* base, size_t size, const std::vector<std::string>& Patterns, std::vector<void*>& Results)
+{
+	Results.assign(Patterns.size(), nullptr);
+
+	if (!base || !size || Patterns.empty())
+	{
+		return;
+	}
+
+	// Build lookup table of anchor byte pairs, a bitmap filters out positions that cannot start any pattern
+	std::vector<PATTERNDATA> Data(Patterns.size());
+	std::vector<std::pair<WORD, size_t>> Anchors;
+	std::vector<DWORD> Bitmap(65536 / 32, 0);
+	size_t Remaining = 0;
+
+	for (size_t x = 0; x < Patterns.size(); x++)
+	{
+		if (!ParsePattern(Patterns[x].c_str(), Data[x]))
+		{
+			continue;
+		}
+
+		Remaining++;
+
+		const BYTE Anchor = Data[x].Bytes[Data[x].AnchorOffset];
+		for (DWORD y = 0; y < ((Data[x].SingleAnchor) ? 256UL : 1UL); y++)
+		{
+			WORD Key = (Data[x].SingleAnchor) ? (WORD)(Anchor | (y << 8)) : (WORD)(Anchor | (Data[x].Bytes[Data[x].AnchorOffset + 1] << 8));
+			Anchors.push_back({ Key, x });
+			Bitmap[Key >> 5] |= (1UL << (Key & 31));
+		}
+	}
+	std::sort(Anchors.begin(), Anchors.end());
+
+	const BYTE* start = (const BYTE*)base;
+	const BYTE* end = start + size;
+
+	// Positions are visited in increasing order so the first match found for each pattern is the lowest address. The
+	// last byte has no pair, it is checked as a pair with 0 which every single byte anchor is listed under.
+	for (const BYTE* p = start; p < end && Remaining; p++)
+	{
+		const WORD Key = (WORD)(p[0] | ((p + 1 < end) ? p[1] << 8 : 0));
+		if (!(Bitmap[Key >> 5] & (1UL << (Key & 31))))
+		{
+			continue;
+		}
+
+		for (auto it = std::lower_bound(Anchors.begin(), Anchors.end(), std::make_pair(Key, (size_t)0)); it != Anchors.end() && it->first == Key; it++)
+		{
+			const PATTERNDATA& Pattern = Data[it->second];
+			if (Results[it->second] || (size_t)(p - start) < Pattern.AnchorOffset)
+			{
+				continue;
+			}
+
+			const BYTE* match = p - Pattern.AnchorOffset;
+			if ((size_t)(end - match) >= Pattern.Bytes.size() && MatchPattern(match, Pattern))
+			{
+				Results[it->second] = (void*)match;
+				Remaining--;
+			}
+		}
+	}
+}
+
+// Finds the first match of each pattern in the loaded image of a module
+void Utils::FindPatterns(HMODULE hModule, const std::vector<std::string>& Patterns, std::vector<void*>& Results)
+{
+	PIMAGE_DOS_HEADER pDosHeader = (PIMAGE_DOS_HEADER)hModule;
+	if (!pDosHeader || pDosHeader->e_magic != IMAGE_DOS_SIGNATURE)
+	{
+		Results.assign(Patterns.size(), nullptr);
+		return;
+	}
+	PIMAGE_NT_HEADERS pNtHeader = (PIMAGE_NT_HEADERS)((char*)pDosHeader + pDosHeader->e_lfanew);
+
+	FindPatterns(hModule, pNtHeader->OptionalHeader.SizeOfImage, Patterns, Results);
+}
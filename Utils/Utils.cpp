@@ -736,9 +736,15 @@ void *Utils::memmem(const void *l, size_t l_len, const void *s, size_t s_len)
 	/* the last position where it's possible to find "s" in "l" */
 	last = (char *)cl + l_len - s_len;
 
+	/* use memchr to skip to each candidate position */
 	for (cur = (char *)cl; cur <= last; cur++)
 	{
-		if (cur[0] == cs[0] && !memcmp(cur, cs, s_len))
+		cur = (char *)memchr(cur, (int)*cs, last - cur + 1);
+		if (!cur)
+		{
+			break;
+		}
+		if (!memcmp(cur, cs, s_len))
 		{
 			return cur;
 		}
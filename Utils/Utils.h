@@ -3,6 +3,8 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <intrin.h>
+#include <vector>
+#include <string>
 #include "Wrappers\wrapper.h"
 #include "External\MemoryModule\MemoryModule.h"
 #include "Logging\Logging.h"
@@ -70,6 +72,11 @@ namespace Utils
 	void GetDesktopRect(HWND hWnd, RECT& screenRect);
 	HRESULT GetVideoRam(UINT AdapterNo, DWORD& TotalMemory);	// Adapters start numbering from '1', based on "Win32_VideoController" WMI class and "DeviceID" property.
 
+	// Pattern scanning
+	bool CheckPattern(const void* address, const std::string& Pattern);
+	void FindPatterns(const void* base, size_t size, const std::vector<std::string>& Patterns, std::vector<void*>& Results);
+	void FindPatterns(HMODULE hModule, const std::vector<std::string>& Patterns, std::vector<void*>& Results);
+
 	// CPU Affinity
 	void SetProcessAffinity();
 	void SetThreadAffinity(DWORD threadId);
@@ -0,0 +1,40 @@
+#pragma once
+
+// Finds the rows of a locked texture level that differ from its shadow copy. Changed rows are copied into the shadow
+// and reported as ranges [Start, End), ranges closer than MergeGap rows are merged to keep the number of dirty rects low.
+template <typename F>
+void DiffDirtyRows(BYTE* pShadow, const BYTE* pBits, size_t Pitch, UINT Rows, UINT MergeGap, F AddRows)
+{
+	UINT DirtyStart = 0, DirtyEnd = 0;
+	bool IsDirty = false;
+
+	for (UINT y = 0; y < Rows; y++)
+	{
+		if (memcmp(pShadow + y * Pitch, pBits + y * Pitch, Pitch) == 0)
+		{
+			continue;
+		}
+
+		memcpy(pShadow + y * Pitch, pBits + y * Pitch, Pitch);
+
+		if (IsDirty && y <= DirtyEnd + MergeGap)
+		{
+			DirtyEnd = y + 1;
+		}
+		else
+		{
+			if (IsDirty)
+			{
+				AddRows(DirtyStart, DirtyEnd);
+			}
+			IsDirty = true;
+			DirtyStart = y;
+			DirtyEnd = y + 1;
+		}
+	}
+
+	if (IsDirty)
+	{
+		AddRows(DirtyStart, DirtyEnd);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// Rewrites plain locks on dynamic write-only buffers to D3DLOCK_NOOVERWRITE or D3DLOCK_DISCARD
+// Data past the append cursor has not been written since the last discard, so the GPU cannot be using it
+struct DYNAMICBUFFERLOCK
+{
+	bool IsChecked = false;
+	bool IsDynamic = false;
+	bool IsCursorValid = false;
+	bool IsAppending = false;		// NOOVERWRITE locks were made since the last discard
+	UINT BufferSize = 0;
+	UINT Cursor = 0;
+	DWORD NoOverwriteCount = 0;
+	DWORD DiscardCount = 0;
+	DWORD StallCount = 0;
+
+	void SetDesc(DWORD Usage, UINT Size)
+	{
+		IsChecked = true;
+		IsDynamic = (Usage & (D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY)) == (D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY) && Size;
+		BufferSize = Size;
+	}
+
+	DWORD PromoteFlags(UINT Offset, UINT Size, DWORD Flags)
+	{
+		if (!IsDynamic || Offset >= BufferSize)
+		{
+			return Flags;
+		}
+
+		const UINT End = (Size && Size <= BufferSize - Offset) ? Offset + Size : BufferSize;
+
+		if (Flags & D3DLOCK_READONLY)
+		{
+			return Flags;
+		}
+		if (Flags & D3DLOCK_DISCARD)
+		{
+			IsCursorValid = true;
+			IsAppending = false;
+			Cursor = End;
+			return Flags;
+		}
+		if (Flags & D3DLOCK_NOOVERWRITE)
+		{
+			IsAppending = IsCursorValid;
+			Cursor = max(Cursor, End);
+			return Flags;
+		}
+
+		if (IsCursorValid && Offset >= Cursor)
+		{
+			NoOverwriteCount++;
+			IsAppending = true;
+			Cursor = End;
+			return Flags | D3DLOCK_NOOVERWRITE;
+		}
+
+		// Whole buffer is rewritten, or an append run has no room left and wraps back to the start to begin a new pass.
+		// A partial lock at the start while there is still room, such as a header rewrite, keeps the data after it.
+		if (Offset == 0 && (End == BufferSize || (IsAppending && End > BufferSize - Cursor)))
+		{
+			DiscardCount++;
+			IsCursorValid = true;
+			IsAppending = false;
+			Cursor = End;
+			return Flags | D3DLOCK_DISCARD;
+		}
+
+		// Lock over data that may still be in use, this waits for the GPU and keeps the old contents
+		StallCount++;
+		Cursor = max(Cursor, End);
+		return Flags;
+	}
+
+	void LogStats(void* Buffer) const
+	{
+		if (NoOverwriteCount || DiscardCount || StallCount)
+		{
+			Logging::LogDebug() << __FUNCTION__ << " (" << Buffer << ") promoted locks: nooverwrite = " << NoOverwriteCount <<
+				" discard = " << DiscardCount << " stalls = " << StallCount;
+		}
+	}
+};
@@ -275,6 +275,7 @@ HRESULT m_IDirect3DDevice9Ex::CallEndScene()
 	if (Config.EnableImgui && DOverlay.Getd3d9Device() == ProxyInterface)
 	{
 		DOverlay.EndScene();
+		SHARED.SurfaceGeneration++;
 	}
 #endif
 
@@ -285,6 +286,8 @@ HRESULT m_IDirect3DDevice9Ex::EndScene()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	if (Config.ForceSingleBeginEndScene)
 	{
 		if (SHARED.IsInScene)
@@ -586,7 +589,17 @@ HRESULT m_IDirect3DDevice9Ex::BeginStateBlock()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->BeginStateBlock();
+	HRESULT hr = ProxyInterface->BeginStateBlock();
+
+	if (SUCCEEDED(hr))
+	{
+		SHARED.StateCache.IsRecording = true;
+
+		delete SHARED.StateBlockRecord;
+		SHARED.StateBlockRecord = (Config.OptimizeStateBlocks) ? new STATEBLOCKRECORD : nullptr;
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::CreateStateBlock(THIS_ D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB)
@@ -632,10 +645,18 @@ HRESULT m_IDirect3DDevice9Ex::EndStateBlock(THIS_ IDirect3DStateBlock9** ppSB)
 
 	HRESULT hr = ProxyInterface->EndStateBlock(ppSB);
 
+	SHARED.StateCache.IsRecording = false;
+
+	STATEBLOCKRECORD* pRecord = SHARED.StateBlockRecord;
+	SHARED.StateBlockRecord = nullptr;
+
 	if (SUCCEEDED(hr))
 	{
 		m_IDirect3DStateBlock9* StateBlockX = SHARED.ProxyAddressLookupTable9.FindAddress<m_IDirect3DStateBlock9, m_IDirect3DDevice9Ex, LPVOID>(*ppSB, this, IID_IDirect3DStateBlock9, nullptr);
 
+		StateBlockX->SetRecord(pRecord);
+		pRecord = nullptr;
+
 		if (Config.LimitStateBlocks)
 		{
 			SHARED.StateBlockTable.AddStateBlock(StateBlockX);
@@ -646,6 +667,8 @@ HRESULT m_IDirect3DDevice9Ex::EndStateBlock(THIS_ IDirect3DStateBlock9** ppSB)
 		*ppSB = StateBlockX;
 	}
 
+	delete pRecord;
+
 	return hr;
 }
 
@@ -702,6 +725,8 @@ HRESULT m_IDirect3DDevice9Ex::SetRenderState(D3DRENDERSTATETYPE State, DWORD Val
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	// Set for Multisample
 	if (SHARED.DeviceMultiSampleFlag && State == D3DRS_MULTISAMPLEANTIALIAS)
 	{
@@ -710,6 +735,11 @@ HRESULT m_IDirect3DDevice9Ex::SetRenderState(D3DRENDERSTATETYPE State, DWORD Val
 
 	HRESULT hr = ProxyInterface->SetRenderState(State, Value);
 
+	if (SUCCEEDED(hr))
+	{
+		SetCachedRenderState(State, Value);
+	}
+
 	// CacheClipPlane
 	if (SUCCEEDED(hr) && State == D3DRS_CLIPPLANEENABLE)
 	{
@@ -728,13 +758,23 @@ HRESULT m_IDirect3DDevice9Ex::SetRenderTarget(THIS_ DWORD RenderTargetIndex, IDi
 		pRenderTarget = static_cast<m_IDirect3DSurface9 *>(pRenderTarget)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetRenderTarget(RenderTargetIndex, pRenderTarget);
+	HRESULT hr = ProxyInterface->SetRenderTarget(RenderTargetIndex, pRenderTarget);
+
+	// Setting the first render target resets the viewport
+	if (SUCCEEDED(hr) && RenderTargetIndex == 0 && !SHARED.StateCache.IsRecording)
+	{
+		SHARED.StateCache.Viewport.IsSet = false;
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ") State: " << State;
 
+	SetStateBlockIncomplete();
+
 	HRESULT hr = ProxyInterface->SetTransform(State, pMatrix);
 
 	if (SUCCEEDED(hr))
@@ -749,6 +789,18 @@ HRESULT m_IDirect3DDevice9Ex::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3
 	return hr;
 }
 
+// FNV-1a hash of the ramp, used to quickly reject a changed ramp before comparing it
+static DWORD GetGammaRampHash(const D3DGAMMARAMP& Ramp)
+{
+	DWORD Hash = 2166136261UL;
+	const BYTE* Data = reinterpret_cast<const BYTE*>(&Ramp);
+	for (size_t x = 0; x < sizeof(D3DGAMMARAMP); x++)
+	{
+		Hash = (Hash ^ Data[x]) * 16777619UL;
+	}
+	return Hash;
+}
+
 inline HRESULT m_IDirect3DDevice9Ex::SetBrightnessLevel(D3DGAMMARAMP& Ramp)
 {
 	Logging::LogDebug() << __FUNCTION__;
@@ -768,7 +820,7 @@ inline HRESULT m_IDirect3DDevice9Ex::SetBrightnessLevel(D3DGAMMARAMP& Ramp)
 	}
 
 	D3DLOCKED_RECT lockedRect;
-	if (SUCCEEDED(SHARED.GammaLUTTexture->LockRect(0, &lockedRect, nullptr, D3DLOCK_DISCARD)))
+	if (SHARED.GammaLUTTexture && SUCCEEDED(SHARED.GammaLUTTexture->LockRect(0, &lockedRect, nullptr, D3DLOCK_DISCARD)))
 	{
 		if (SHARED.UsingShader32f)
 		{
@@ -794,6 +846,7 @@ inline HRESULT m_IDirect3DDevice9Ex::SetBrightnessLevel(D3DGAMMARAMP& Ramp)
 			}
 		}
 		SHARED.GammaLUTTexture->UnlockRect(0);
+		SHARED.GammaLUTHash = GetGammaRampHash(Ramp);
 	}
 
 	return D3D_OK;
@@ -856,9 +909,12 @@ inline void m_IDirect3DDevice9Ex::ApplyBrightnessLevel()
 	// Set texture
 	ProxyInterface->SetTexture(0, SHARED.ScreenCopyTexture);
 	ProxyInterface->SetTexture(1, SHARED.GammaLUTTexture);
+	SetCachedTexture(0, SHARED.ScreenCopyTexture);
+	SetCachedTexture(1, SHARED.GammaLUTTexture);
 
 	// Set shader
 	ProxyInterface->SetPixelShader(pShader);
+	SetCachedPixelShader(pShader);
 
 	const DWORD TLVERTEXFVF = (D3DFVF_XYZRHW | D3DFVF_TEX1);
 	struct TLVERTEX
@@ -877,10 +933,12 @@ inline void m_IDirect3DDevice9Ex::ApplyBrightnessLevel()
 
 	// Set FVF and render
 	ProxyInterface->SetFVF(TLVERTEXFVF);
+	SetCachedVertexFormat({ TLVERTEXFVF, nullptr });
 	if (FAILED(ProxyInterface->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, FullScreenQuadVertices, sizeof(TLVERTEX))))
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: Failed to draw primitive!");
 	}
+	SetCachedStreamSource(0, {});	// Stream zero is cleared by DrawPrimitiveUP
 
 	// Cleanup
 	pBackBuffer->Release();
@@ -924,6 +982,7 @@ inline void m_IDirect3DDevice9Ex::ReleaseResources(bool isReset)
 		{
 			SHARED.isBlankTextureUsed = false;
 			ProxyInterface->SetTexture(0, nullptr);
+			SetCachedTexture(0, nullptr);
 		}
 		ULONG ref = SHARED.BlankTexture->Release();
 		if (ref)
@@ -933,6 +992,11 @@ inline void m_IDirect3DDevice9Ex::ReleaseResources(bool isReset)
 		SHARED.BlankTexture = nullptr;
 	}
 
+	ReleaseUPBuffers();
+
+	delete SHARED.StateBlockRecord;
+	SHARED.StateBlockRecord = nullptr;
+
 	if (SHARED.pFont)
 	{
 		ULONG ref = SHARED.pFont->Release();
@@ -1007,6 +1071,13 @@ void m_IDirect3DDevice9Ex::SetGammaRamp(THIS_ UINT iSwapChain, DWORD Flags, CONS
 			LOG_LIMIT(3, __FUNCTION__ << " Warning: Gamma support for swapchains not implemented: " << iSwapChain);
 		}
 
+		// Skip the upload if the LUT already holds this ramp, a matching hash is confirmed against the stored ramp
+		if (SHARED.GammaLUTTexture && SHARED.GammaLUTHash == GetGammaRampHash(*pRamp) &&
+			memcmp(&SHARED.RampData, pRamp, sizeof(D3DGAMMARAMP)) == S_OK)
+		{
+			return;
+		}
+
 		SHARED.IsGammaSet = false;
 		memcpy(&SHARED.RampData, pRamp, sizeof(D3DGAMMARAMP));
 
@@ -1033,6 +1104,8 @@ HRESULT m_IDirect3DDevice9Ex::DrawRectPatch(UINT Handle, CONST float *pNumSegs,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	return ProxyInterface->DrawRectPatch(Handle, pNumSegs, pRectPatchInfo);
 }
 
@@ -1040,6 +1113,8 @@ HRESULT m_IDirect3DDevice9Ex::DrawTriPatch(UINT Handle, CONST float *pNumSegs, C
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	return ProxyInterface->DrawTriPatch(Handle, pNumSegs, pTriPatchInfo);
 }
 
@@ -1061,6 +1136,8 @@ HRESULT m_IDirect3DDevice9Ex::SetIndices(THIS_ IDirect3DIndexBuffer9* pIndexData
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	if (pIndexData)
 	{
 		pIndexData = static_cast<m_IDirect3DIndexBuffer9 *>(pIndexData)->GetProxyInterface();
@@ -1134,6 +1211,8 @@ HRESULT m_IDirect3DDevice9Ex::LightEnable(DWORD LightIndex, BOOL bEnable)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->LightEnable(LightIndex, bEnable);
 }
 
@@ -1142,6 +1221,8 @@ HRESULT m_IDirect3DDevice9Ex::SetLight(DWORD Index, CONST D3DLIGHT9 *pLight)
 
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetLight(Index, pLight);
 }
 
@@ -1149,6 +1230,8 @@ HRESULT m_IDirect3DDevice9Ex::SetMaterial(CONST D3DMATERIAL9 *pMaterial)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetMaterial(pMaterial);
 }
 
@@ -1201,6 +1284,8 @@ HRESULT m_IDirect3DDevice9Ex::SetCurrentTexturePalette(UINT PaletteNumber)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetCurrentTexturePalette(PaletteNumber);
 }
 
@@ -1250,155 +1335,804 @@ HRESULT m_IDirect3DDevice9Ex::SetPixelShader(THIS_ IDirect3DPixelShader9* pShade
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	if (pShader)
+	if (pShader)
+	{
+		pShader = static_cast<m_IDirect3DPixelShader9 *>(pShader)->GetProxyInterface();
+	}
+
+	HRESULT hr = ProxyInterface->SetPixelShader(pShader);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedPixelShader(pShader);
+	}
+
+	return hr;
+}
+
+// Sampler index in the state cache, vertex samplers are stored after the pixel samplers
+static inline DWORD GetSamplerCacheIndex(DWORD Sampler)
+{
+	return (Sampler >= D3DVERTEXTEXTURESAMPLER0) ? 16 + (Sampler - D3DVERTEXTEXTURESAMPLER0) : Sampler;
+}
+
+void m_IDirect3DDevice9Ex::InvalidateStateCache() const
+{
+	const bool IsRecording = SHARED.StateCache.IsRecording;
+	SHARED.StateCache = {};
+	SHARED.StateCache.IsRecording = IsRecording;
+}
+
+// States set outside of the shadow state cannot be applied from a record
+void m_IDirect3DDevice9Ex::SetStateBlockIncomplete() const
+{
+	if (SHARED.StateBlockRecord)
+	{
+		SHARED.StateBlockRecord->IsComplete = false;
+	}
+}
+
+// Applies a recorded state block, states that already match the shadow state are skipped
+void m_IDirect3DDevice9Ex::ApplyStateBlockRecord(const STATEBLOCKRECORD& Record)
+{
+	for (const auto& Entry : Record.RenderState)
+	{
+		const D3DRENDERSTATETYPE State = (D3DRENDERSTATETYPE)Entry.Index;
+		ApplyShadowState(Entry.Value,
+			[&](DWORD& Value) { return GetCachedRenderState(State, Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetRenderState(State, Value)))
+				{
+					SetCachedRenderState(State, Value);
+				}
+			});
+	}
+	for (const auto& Entry : Record.TextureStageState)
+	{
+		const DWORD Stage = HIWORD(Entry.Index);
+		const D3DTEXTURESTAGESTATETYPE Type = (D3DTEXTURESTAGESTATETYPE)LOWORD(Entry.Index);
+		ApplyShadowState(Entry.Value,
+			[&](DWORD& Value) { return GetCachedTextureStageState(Stage, Type, Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetTextureStageState(Stage, Type, Value)))
+				{
+					SetCachedTextureStageState(Stage, Type, Value);
+				}
+			});
+	}
+	for (const auto& Entry : Record.SamplerState)
+	{
+		const DWORD Sampler = HIWORD(Entry.Index);
+		const D3DSAMPLERSTATETYPE Type = (D3DSAMPLERSTATETYPE)LOWORD(Entry.Index);
+		ApplyShadowState(Entry.Value,
+			[&](DWORD& Value) { return GetCachedSamplerState(Sampler, Type, Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetSamplerState(Sampler, Type, Value)))
+				{
+					SetCachedSamplerState(Sampler, Type, Value);
+				}
+			});
+	}
+	for (const auto& Entry : Record.Texture)
+	{
+		ApplyShadowState(Entry.second,
+			[&](IDirect3DBaseTexture9*& pTexture) { return GetCachedTexture(Entry.first, pTexture); },
+			[&](IDirect3DBaseTexture9* pTexture) {
+				if (SUCCEEDED(ProxyInterface->SetTexture(Entry.first, pTexture)))
+				{
+					SetCachedTexture(Entry.first, pTexture);
+				}
+			});
+	}
+	for (const auto& Entry : Record.StreamSource)
+	{
+		ApplyShadowState(Entry.second,
+			[&](STREAMSOURCE& Stream) { return GetCachedStreamSource(Entry.first, Stream); },
+			[&](const STREAMSOURCE& Stream) {
+				if (SUCCEEDED(ProxyInterface->SetStreamSource(Entry.first, Stream.pStreamData, Stream.OffsetInBytes, Stream.Stride)))
+				{
+					SetCachedStreamSource(Entry.first, Stream);
+				}
+			});
+	}
+	if (Record.PixelShader.IsSet)
+	{
+		ApplyShadowState(Record.PixelShader.Value,
+			[&](IDirect3DPixelShader9*& pShader) { return GetCachedPixelShader(pShader); },
+			[&](IDirect3DPixelShader9* pShader) {
+				if (SUCCEEDED(ProxyInterface->SetPixelShader(pShader)))
+				{
+					SetCachedPixelShader(pShader);
+				}
+			});
+	}
+	if (Record.VertexShader.IsSet)
+	{
+		ApplyShadowState(Record.VertexShader.Value,
+			[&](IDirect3DVertexShader9*& pShader) { return GetCachedVertexShader(pShader); },
+			[&](IDirect3DVertexShader9* pShader) {
+				if (SUCCEEDED(ProxyInterface->SetVertexShader(pShader)))
+				{
+					SetCachedVertexShader(pShader);
+				}
+			});
+	}
+	if (Record.VertexFormat.IsSet)
+	{
+		ApplyShadowState(Record.VertexFormat.Value,
+			[&](VERTEXFORMAT& Format) { return GetCachedVertexFormat(Format); },
+			[&](const VERTEXFORMAT& Format) {
+				if (SUCCEEDED((Format.FVF) ? ProxyInterface->SetFVF(Format.FVF) : ProxyInterface->SetVertexDeclaration(Format.pDecl)))
+				{
+					SetCachedVertexFormat(Format);
+				}
+			});
+	}
+	if (Record.Viewport.IsSet)
+	{
+		D3DVIEWPORT9 Viewport;
+		if ((!GetCachedViewport(Viewport) || memcmp(&Viewport, &Record.Viewport.Value, sizeof(D3DVIEWPORT9)) != 0) &&
+			SUCCEEDED(ProxyInterface->SetViewport(&Record.Viewport.Value)))
+		{
+			SetCachedViewport(Record.Viewport.Value);
+		}
+	}
+}
+
+// Updates a recorded state block with the current values of its states
+bool m_IDirect3DDevice9Ex::CaptureStateBlockRecord(STATEBLOCKRECORD& Record)
+{
+	for (auto& Entry : Record.RenderState)
+	{
+		if (!GetCachedRenderState((D3DRENDERSTATETYPE)Entry.Index, Entry.Value))
+		{
+			return false;
+		}
+	}
+	for (auto& Entry : Record.TextureStageState)
+	{
+		if (!GetCachedTextureStageState(HIWORD(Entry.Index), (D3DTEXTURESTAGESTATETYPE)LOWORD(Entry.Index), Entry.Value))
+		{
+			return false;
+		}
+	}
+	for (auto& Entry : Record.SamplerState)
+	{
+		if (!GetCachedSamplerState(HIWORD(Entry.Index), (D3DSAMPLERSTATETYPE)LOWORD(Entry.Index), Entry.Value))
+		{
+			return false;
+		}
+	}
+	for (auto& Entry : Record.Texture)
+	{
+		IDirect3DBaseTexture9* pTexture;
+		if (!GetCachedTexture(Entry.first, pTexture))
+		{
+			return false;
+		}
+		Record.SetTexture(Entry.first, pTexture);
+	}
+	for (auto& Entry : Record.StreamSource)
+	{
+		STREAMSOURCE Stream;
+		if (!GetCachedStreamSource(Entry.first, Stream))
+		{
+			return false;
+		}
+		Record.SetStreamSource(Entry.first, Stream);
+	}
+	if (Record.PixelShader.IsSet)
+	{
+		IDirect3DPixelShader9* pShader;
+		if (!GetCachedPixelShader(pShader))
+		{
+			return false;
+		}
+		Record.SetPixelShader(pShader);
+	}
+	if (Record.VertexShader.IsSet)
+	{
+		IDirect3DVertexShader9* pShader;
+		if (!GetCachedVertexShader(pShader))
+		{
+			return false;
+		}
+		Record.SetVertexShader(pShader);
+	}
+	if (Record.VertexFormat.IsSet)
+	{
+		VERTEXFORMAT Format;
+		if (!GetCachedVertexFormat(Format))
+		{
+			return false;
+		}
+		Record.SetVertexFormat(Format);
+	}
+	if (Record.Viewport.IsSet && !GetCachedViewport(Record.Viewport.Value))
+	{
+		return false;
+	}
+	return true;
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedRenderState(D3DRENDERSTATETYPE State, DWORD& Value)
+{
+	if ((DWORD)State >= MAX_RENDER_STATES)
+	{
+		return SUCCEEDED(ProxyInterface->GetRenderState(State, &Value));
+	}
+	// Only reads from the driver the first time, this fails on pure devices
+	return SHARED.StateCache.RenderState[State].Get(Value, [&](DWORD& Read) { return SUCCEEDED(ProxyInterface->GetRenderState(State, &Read)); });
+}
+
+void m_IDirect3DDevice9Ex::SetCachedRenderState(D3DRENDERSTATETYPE State, DWORD Value) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SetStateValue(SHARED.StateBlockRecord->RenderState, State, Value);
+		}
+	}
+	else if ((DWORD)State < MAX_RENDER_STATES)
+	{
+		SHARED.StateCache.RenderState[State] = { true, Value };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD& Value)
+{
+	if (Stage >= MAX_TEXTURE_STAGES || (DWORD)Type >= MAX_TEXTURE_STAGE_STATES)
+	{
+		return SUCCEEDED(ProxyInterface->GetTextureStageState(Stage, Type, &Value));
+	}
+	return SHARED.StateCache.TextureStageState[Stage][Type].Get(Value, [&](DWORD& Read) { return SUCCEEDED(ProxyInterface->GetTextureStageState(Stage, Type, &Read)); });
+}
+
+void m_IDirect3DDevice9Ex::SetCachedTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SetStateValue(SHARED.StateBlockRecord->TextureStageState, MAKELONG(Type, Stage), Value);
+		}
+	}
+	else if (Stage < MAX_TEXTURE_STAGES && (DWORD)Type < MAX_TEXTURE_STAGE_STATES)
+	{
+		SHARED.StateCache.TextureStageState[Stage][Type] = { true, Value };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD& Value)
+{
+	const DWORD Index = GetSamplerCacheIndex(Sampler);
+	if (Index >= MAX_SAMPLERS || (DWORD)Type >= MAX_SAMPLER_STATES)
+	{
+		return SUCCEEDED(ProxyInterface->GetSamplerState(Sampler, Type, &Value));
+	}
+	return SHARED.StateCache.SamplerState[Index][Type].Get(Value, [&](DWORD& Read) { return SUCCEEDED(ProxyInterface->GetSamplerState(Sampler, Type, &Read)); });
+}
+
+void m_IDirect3DDevice9Ex::SetCachedSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) const
+{
+	const DWORD Index = GetSamplerCacheIndex(Sampler);
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SetStateValue(SHARED.StateBlockRecord->SamplerState, MAKELONG(Type, Sampler), Value);
+		}
+	}
+	else if (Index < MAX_SAMPLERS && (DWORD)Type < MAX_SAMPLER_STATES)
+	{
+		SHARED.StateCache.SamplerState[Index][Type] = { true, Value };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedTexture(DWORD Stage, IDirect3DBaseTexture9*& pTexture)
+{
+	const DWORD Index = GetSamplerCacheIndex(Stage);
+	if (Index >= MAX_SAMPLERS)
+	{
+		return false;
+	}
+	SHADOWSTATE<IDirect3DBaseTexture9*>& Entry = SHARED.StateCache.Texture[Index];
+	if (!Entry.IsSet)
+	{
+		if (FAILED(ProxyInterface->GetTexture(Stage, &Entry.Value)))
+		{
+			return false;
+		}
+		// The device holds a reference while the texture is bound
+		if (Entry.Value)
+		{
+			Entry.Value->Release();
+		}
+		Entry.IsSet = true;
+	}
+	pTexture = Entry.Value;
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::SetCachedTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) const
+{
+	const DWORD Index = GetSamplerCacheIndex(Stage);
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->SetTexture(Stage, pTexture);
+		}
+	}
+	else if (Index < MAX_SAMPLERS)
+	{
+		SHARED.StateCache.Texture[Index] = { true, pTexture };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedPixelShader(IDirect3DPixelShader9*& pShader)
+{
+	SHADOWSTATE<IDirect3DPixelShader9*>& Entry = SHARED.StateCache.PixelShader;
+	if (!Entry.IsSet)
+	{
+		if (FAILED(ProxyInterface->GetPixelShader(&Entry.Value)))
+		{
+			return false;
+		}
+		if (Entry.Value)
+		{
+			Entry.Value->Release();
+		}
+		Entry.IsSet = true;
+	}
+	pShader = Entry.Value;
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::SetCachedPixelShader(IDirect3DPixelShader9* pShader) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->SetPixelShader(pShader);
+		}
+	}
+	else
+	{
+		SHARED.StateCache.PixelShader = { true, pShader };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedVertexShader(IDirect3DVertexShader9*& pShader)
+{
+	SHADOWSTATE<IDirect3DVertexShader9*>& Entry = SHARED.StateCache.VertexShader;
+	if (!Entry.IsSet)
+	{
+		if (FAILED(ProxyInterface->GetVertexShader(&Entry.Value)))
+		{
+			return false;
+		}
+		if (Entry.Value)
+		{
+			Entry.Value->Release();
+		}
+		Entry.IsSet = true;
+	}
+	pShader = Entry.Value;
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::SetCachedVertexShader(IDirect3DVertexShader9* pShader) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->SetVertexShader(pShader);
+		}
+	}
+	else
+	{
+		SHARED.StateCache.VertexShader = { true, pShader };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedViewport(D3DVIEWPORT9& Viewport)
+{
+	return SHARED.StateCache.Viewport.Get(Viewport, [&](D3DVIEWPORT9& Read) { return SUCCEEDED(ProxyInterface->GetViewport(&Read)); });
+}
+
+void m_IDirect3DDevice9Ex::SetCachedViewport(const D3DVIEWPORT9& Viewport) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->Viewport = { true, Viewport };
+		}
+	}
+	else
+	{
+		SHARED.StateCache.Viewport = { true, Viewport };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedStreamSource(UINT StreamNumber, STREAMSOURCE& Stream)
+{
+	if (StreamNumber >= MAX_STREAMS)
+	{
+		return false;
+	}
+	SHADOWSTATE<STREAMSOURCE>& Entry = SHARED.StateCache.StreamSource[StreamNumber];
+	if (!Entry.IsSet)
+	{
+		if (FAILED(ProxyInterface->GetStreamSource(StreamNumber, &Entry.Value.pStreamData, &Entry.Value.OffsetInBytes, &Entry.Value.Stride)))
+		{
+			return false;
+		}
+		if (Entry.Value.pStreamData)
+		{
+			Entry.Value.pStreamData->Release();
+		}
+		Entry.IsSet = true;
+	}
+	Stream = Entry.Value;
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::SetCachedStreamSource(UINT StreamNumber, const STREAMSOURCE& Stream) const
+{
+	if (SHARED.StateCache.IsRecording)
+	{
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->SetStreamSource(StreamNumber, Stream);
+		}
+	}
+	else if (StreamNumber < MAX_STREAMS)
+	{
+		SHARED.StateCache.StreamSource[StreamNumber] = { true, Stream };
+	}
+}
+
+bool m_IDirect3DDevice9Ex::GetCachedVertexFormat(VERTEXFORMAT& Format)
+{
+	SHADOWSTATE<VERTEXFORMAT>& Entry = SHARED.StateCache.VertexFormat;
+	if (!Entry.IsSet)
+	{
+		Entry.Value = {};
+		if (FAILED(ProxyInterface->GetFVF(&Entry.Value.FVF)))
+		{
+			return false;
+		}
+		if (!Entry.Value.FVF)
+		{
+			if (FAILED(ProxyInterface->GetVertexDeclaration(&Entry.Value.pDecl)))
+			{
+				return false;
+			}
+			if (Entry.Value.pDecl)
+			{
+				Entry.Value.pDecl->Release();
+			}
+		}
+		Entry.IsSet = true;
+	}
+	Format = Entry.Value;
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::SetCachedVertexFormat(const VERTEXFORMAT& Format) const
+{
+	if (SHARED.StateCache.IsRecording)
 	{
-		pShader = static_cast<m_IDirect3DPixelShader9 *>(pShader)->GetProxyInterface();
+		if (SHARED.StateBlockRecord)
+		{
+			SHARED.StateBlockRecord->SetVertexFormat(Format);
+		}
+	}
+	else
+	{
+		SHARED.StateCache.VertexFormat = { true, Format };
 	}
-
-	return ProxyInterface->SetPixelShader(pShader);
 }
 
 void m_IDirect3DDevice9Ex::BackupDeviceState()
 {
+	// Game state is read from the state cache and only states that differ from the overlay state are set
 	// Set render states
-	ProxyInterface->GetRenderState(D3DRS_LIGHTING, &ds.rsLighting);
-	ProxyInterface->GetRenderState(D3DRS_ALPHATESTENABLE, &ds.rsAlphaTestEnable);
-	ProxyInterface->GetRenderState(D3DRS_ALPHABLENDENABLE, &ds.rsAlphaBlendEnable);
-	ProxyInterface->GetRenderState(D3DRS_FOGENABLE, &ds.rsFogEnable);
-	ProxyInterface->GetRenderState(D3DRS_ZENABLE, &ds.rsZEnable);
-	ProxyInterface->GetRenderState(D3DRS_ZWRITEENABLE, &ds.rsZWriteEnable);
-	ProxyInterface->GetRenderState(D3DRS_STENCILENABLE, &ds.rsStencilEnable);
-	ProxyInterface->GetRenderState(D3DRS_CULLMODE, &ds.rsCullMode);
-	ProxyInterface->GetRenderState(D3DRS_CLIPPING, &ds.rsClipping);
-	ProxyInterface->SetRenderState(D3DRS_LIGHTING, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_ALPHABLENDENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_FOGENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_ZENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_STENCILENABLE, FALSE);
-	ProxyInterface->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
-	ProxyInterface->SetRenderState(D3DRS_CLIPPING, FALSE);
+	const D3DRENDERSTATETYPE RenderStates[] = { D3DRS_LIGHTING, D3DRS_ALPHATESTENABLE, D3DRS_ALPHABLENDENABLE, D3DRS_FOGENABLE, D3DRS_ZENABLE, D3DRS_ZWRITEENABLE, D3DRS_STENCILENABLE, D3DRS_CULLMODE, D3DRS_CLIPPING };
+	const DWORD RenderStateValues[] = { FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, D3DCULL_NONE, FALSE };
+	static_assert(_countof(RenderStates) == _countof(ds.RenderState) && _countof(RenderStateValues) == _countof(ds.RenderState), "Render state backup size mismatch!");
+	for (UINT x = 0; x < _countof(RenderStates); x++)
+	{
+		BackupShadowState(ds.RenderState[x], RenderStateValues[x],
+			[&](DWORD& Value) { return GetCachedRenderState(RenderStates[x], Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetRenderState(RenderStates[x], Value)))
+				{
+					SetCachedRenderState(RenderStates[x], Value);
+				}
+			});
+	}
 
 	// Set texture states
-	ProxyInterface->GetTextureStageState(0, D3DTSS_COLOROP, &ds.tsColorOP);
-	ProxyInterface->GetTextureStageState(0, D3DTSS_COLORARG1, &ds.tsColorArg1);
-	ProxyInterface->GetTextureStageState(0, D3DTSS_COLORARG2, &ds.tsColorArg2);
-	ProxyInterface->GetTextureStageState(0, D3DTSS_ALPHAOP, &ds.tsAlphaOP);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_CURRENT);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+	const D3DTEXTURESTAGESTATETYPE TextureStates[] = { D3DTSS_COLOROP, D3DTSS_COLORARG1, D3DTSS_COLORARG2, D3DTSS_ALPHAOP };
+	const DWORD TextureStateValues[] = { D3DTOP_MODULATE, D3DTA_TEXTURE, D3DTA_CURRENT, D3DTOP_DISABLE };
+	static_assert(_countof(TextureStates) == _countof(ds.TextureStageState) && _countof(TextureStateValues) == _countof(ds.TextureStageState), "Texture state backup size mismatch!");
+	for (UINT x = 0; x < _countof(TextureStates); x++)
+	{
+		BackupShadowState(ds.TextureStageState[x], TextureStateValues[x],
+			[&](DWORD& Value) { return GetCachedTextureStageState(0, TextureStates[x], Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetTextureStageState(0, TextureStates[x], Value)))
+				{
+					SetCachedTextureStageState(0, TextureStates[x], Value);
+				}
+			});
+	}
 
 	// Set sampler states
-	for (UINT x = 0; x < 2; x++)
+	const D3DSAMPLERSTATETYPE SamplerStates[] = { D3DSAMP_ADDRESSU, D3DSAMP_ADDRESSV, D3DSAMP_ADDRESSW };
+	const DWORD SamplerStateValues[] = { D3DTADDRESS_CLAMP, D3DTADDRESS_CLAMP, D3DTADDRESS_WRAP };
+	for (UINT x = 0; x < _countof(ds.SamplerState); x++)
 	{
-		ProxyInterface->GetSamplerState(x, D3DSAMP_ADDRESSU, &ds.ssaddressU[x]);
-		ProxyInterface->GetSamplerState(x, D3DSAMP_ADDRESSV, &ds.ssaddressV[x]);
-		ProxyInterface->GetSamplerState(x, D3DSAMP_ADDRESSW, &ds.ssaddressW[x]);
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSW, D3DTADDRESS_WRAP);
+		for (UINT y = 0; y < _countof(SamplerStates); y++)
+		{
+			BackupShadowState(ds.SamplerState[x][y], SamplerStateValues[y],
+				[&](DWORD& Value) { return GetCachedSamplerState(x, SamplerStates[y], Value); },
+				[&](DWORD Value) {
+					if (SUCCEEDED(ProxyInterface->SetSamplerState(x, SamplerStates[y], Value)))
+					{
+						SetCachedSamplerState(x, SamplerStates[y], Value);
+					}
+				});
+		}
 	}
 
-	// Set viewport
-	ProxyInterface->GetViewport(&ds.oldViewport);
-
-	ds.newViewport.X = 0;
-	ds.newViewport.Y = 0;
-	ds.newViewport.Width = SHARED.BufferWidth;
-	ds.newViewport.Height = SHARED.BufferHeight;
-	ds.newViewport.MinZ = 0.0f;
-	ds.newViewport.MaxZ = 1.0f;
-
-	ProxyInterface->SetViewport(&ds.newViewport);
+	// Set texture, references are held until restored since the game may have released them
+	for (UINT x = 0; x < MAX_TEXTURE_STAGES; x++)
+	{
+		ds.Texture[x].IsSet = GetCachedTexture(x, ds.Texture[x].Value);
+		if (ds.Texture[x].IsSet && ds.Texture[x].Value)
+		{
+			ds.Texture[x].Value->AddRef();
+			if (SUCCEEDED(ProxyInterface->SetTexture(x, nullptr)))
+			{
+				SetCachedTexture(x, nullptr);
+			}
+		}
+	}
 
-	// Set texture
-	for (int x = 0; x < 8; x++)
+	// Set shader
+	ds.PixelShader.IsSet = GetCachedPixelShader(ds.PixelShader.Value);
+	if (ds.PixelShader.IsSet && ds.PixelShader.Value)
 	{
-		ProxyInterface->GetTexture(x, &ds.pTexture[x]);
+		ds.PixelShader.Value->AddRef();
+		if (SUCCEEDED(ProxyInterface->SetPixelShader(nullptr)))
+		{
+			SetCachedPixelShader(nullptr);
+		}
 	}
-	for (int x = 0; x < 8; x++)
+	ds.VertexShader.IsSet = GetCachedVertexShader(ds.VertexShader.Value);
+	if (ds.VertexShader.IsSet && ds.VertexShader.Value)
 	{
-		ProxyInterface->SetTexture(x, nullptr);
+		ds.VertexShader.Value->AddRef();
+		if (SUCCEEDED(ProxyInterface->SetVertexShader(nullptr)))
+		{
+			SetCachedVertexShader(nullptr);
+		}
 	}
 
-	// Set shader
-	ProxyInterface->GetPixelShader(&ds.pPixelShader);
-	ProxyInterface->GetVertexShader(&ds.pVertexShader);
-	ProxyInterface->SetPixelShader(nullptr);
-	ProxyInterface->SetVertexShader(nullptr);
+	// Save stream and vertex format, these are changed by the gamma pass
+	ds.StreamSource.IsSet = GetCachedStreamSource(0, ds.StreamSource.Value);
+	if (ds.StreamSource.IsSet && ds.StreamSource.Value.pStreamData)
+	{
+		ds.StreamSource.Value.pStreamData->AddRef();
+	}
+	ds.VertexFormat.IsSet = GetCachedVertexFormat(ds.VertexFormat.Value);
+	if (ds.VertexFormat.IsSet && !ds.VertexFormat.Value.FVF && ds.VertexFormat.Value.pDecl)
+	{
+		ds.VertexFormat.Value.pDecl->AddRef();
+	}
 
 	// Get current render target
 	ProxyInterface->GetRenderTarget(0, &ds.pRenderTarget);
 
+	// Save viewport before the render target is changed since that resets the viewport
+	ds.Viewport.IsSet = GetCachedViewport(ds.Viewport.Value);
+
 	// Set backbuffer as render target
+	bool IsTargetSet = false;
 	IDirect3DSurface9* pBackBuffer = nullptr;
 	if (SUCCEEDED(ProxyInterface->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &pBackBuffer)))
 	{
-		ProxyInterface->SetRenderTarget(0, pBackBuffer);
+		if (pBackBuffer != ds.pRenderTarget)
+		{
+			IsTargetSet = SUCCEEDED(ProxyInterface->SetRenderTarget(0, pBackBuffer));
+		}
+		else if (ds.pRenderTarget)
+		{
+			// Render target does not need to be restored
+			ds.pRenderTarget->Release();
+			ds.pRenderTarget = nullptr;
+		}
 		pBackBuffer->Release();
 	}
+
+	// Set viewport
+	D3DVIEWPORT9 newViewport = {};
+	newViewport.X = 0;
+	newViewport.Y = 0;
+	newViewport.Width = SHARED.BufferWidth;
+	newViewport.Height = SHARED.BufferHeight;
+	newViewport.MinZ = 0.0f;
+	newViewport.MaxZ = 1.0f;
+
+	if ((IsTargetSet || !ds.Viewport.IsSet || memcmp(&ds.Viewport.Value, &newViewport, sizeof(D3DVIEWPORT9)) != 0) &&
+		SUCCEEDED(ProxyInterface->SetViewport(&newViewport)))
+	{
+		SetCachedViewport(newViewport);
+	}
 }
 
 void m_IDirect3DDevice9Ex::RestoreDeviceState()
 {
+	// Only states that are different from the saved game state are set
 	// Ensure we are rendering to the backbuffer
+	bool IsTargetSet = false;
 	if (ds.pRenderTarget)
 	{
-		ProxyInterface->SetRenderTarget(0, ds.pRenderTarget);
+		IsTargetSet = SUCCEEDED(ProxyInterface->SetRenderTarget(0, ds.pRenderTarget));
 		ds.pRenderTarget->Release();
 		ds.pRenderTarget = nullptr;
 	}
 
+	// Restore game viewport, setting the render target resets the viewport
+	if (IsTargetSet && !SHARED.StateCache.IsRecording)
+	{
+		SHARED.StateCache.Viewport.IsSet = false;
+	}
+	D3DVIEWPORT9 Viewport = {};
+	if (ds.Viewport.IsSet && (IsTargetSet || !GetCachedViewport(Viewport) || memcmp(&Viewport, &ds.Viewport.Value, sizeof(D3DVIEWPORT9)) != 0) &&
+		SUCCEEDED(ProxyInterface->SetViewport(&ds.Viewport.Value)))
+	{
+		SetCachedViewport(ds.Viewport.Value);
+	}
+	ds.Viewport = {};
+
+	// Restore stream and vertex format
+	STREAMSOURCE Stream = {};
+	if (ds.StreamSource.IsSet)
+	{
+		if (GetCachedStreamSource(0, Stream) && Stream != ds.StreamSource.Value &&
+			SUCCEEDED(ProxyInterface->SetStreamSource(0, ds.StreamSource.Value.pStreamData, ds.StreamSource.Value.OffsetInBytes, ds.StreamSource.Value.Stride)))
+		{
+			SetCachedStreamSource(0, ds.StreamSource.Value);
+		}
+		if (ds.StreamSource.Value.pStreamData)
+		{
+			ds.StreamSource.Value.pStreamData->Release();
+		}
+		ds.StreamSource = {};
+	}
+	VERTEXFORMAT Format = {};
+	if (ds.VertexFormat.IsSet)
+	{
+		if (GetCachedVertexFormat(Format) && Format != ds.VertexFormat.Value &&
+			SUCCEEDED((ds.VertexFormat.Value.FVF) ? ProxyInterface->SetFVF(ds.VertexFormat.Value.FVF) : ProxyInterface->SetVertexDeclaration(ds.VertexFormat.Value.pDecl)))
+		{
+			SetCachedVertexFormat(ds.VertexFormat.Value);
+		}
+		if (!ds.VertexFormat.Value.FVF && ds.VertexFormat.Value.pDecl)
+		{
+			ds.VertexFormat.Value.pDecl->Release();
+		}
+		ds.VertexFormat = {};
+	}
+
 	// Reset textures
-	for (int x = 0; x < 8; x++)
+	for (UINT x = 0; x < MAX_TEXTURE_STAGES; x++)
 	{
-		ProxyInterface->SetTexture(x, ds.pTexture[x]);
-		if (ds.pTexture[x])
+		IDirect3DBaseTexture9* pTexture = nullptr;
+		if (ds.Texture[x].IsSet)
 		{
-			ds.pTexture[x]->Release();
-			ds.pTexture[x] = nullptr;
+			if (GetCachedTexture(x, pTexture) && pTexture != ds.Texture[x].Value &&
+				SUCCEEDED(ProxyInterface->SetTexture(x, ds.Texture[x].Value)))
+			{
+				SetCachedTexture(x, ds.Texture[x].Value);
+			}
+			if (ds.Texture[x].Value)
+			{
+				ds.Texture[x].Value->Release();
+			}
+			ds.Texture[x] = {};
 		}
 	}
 
 	// Reset shaders
-	ProxyInterface->SetPixelShader(ds.pPixelShader);
-	ds.pPixelShader = nullptr;
-	ProxyInterface->SetVertexShader(ds.pVertexShader);
-	ds.pVertexShader = nullptr;
-
-	// Restore game viewport
-	ProxyInterface->SetViewport(&ds.oldViewport);
+	IDirect3DPixelShader9* pPixelShader = nullptr;
+	if (ds.PixelShader.IsSet)
+	{
+		if (GetCachedPixelShader(pPixelShader) && pPixelShader != ds.PixelShader.Value &&
+			SUCCEEDED(ProxyInterface->SetPixelShader(ds.PixelShader.Value)))
+		{
+			SetCachedPixelShader(ds.PixelShader.Value);
+		}
+		if (ds.PixelShader.Value)
+		{
+			ds.PixelShader.Value->Release();
+		}
+		ds.PixelShader = {};
+	}
+	IDirect3DVertexShader9* pVertexShader = nullptr;
+	if (ds.VertexShader.IsSet)
+	{
+		if (GetCachedVertexShader(pVertexShader) && pVertexShader != ds.VertexShader.Value &&
+			SUCCEEDED(ProxyInterface->SetVertexShader(ds.VertexShader.Value)))
+		{
+			SetCachedVertexShader(ds.VertexShader.Value);
+		}
+		if (ds.VertexShader.Value)
+		{
+			ds.VertexShader.Value->Release();
+		}
+		ds.VertexShader = {};
+	}
 
 	// Restore sampler states
-	for (UINT x = 0; x < 2; x++)
+	const D3DSAMPLERSTATETYPE SamplerStates[] = { D3DSAMP_ADDRESSU, D3DSAMP_ADDRESSV, D3DSAMP_ADDRESSW };
+	for (UINT x = 0; x < _countof(ds.SamplerState); x++)
 	{
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSU, ds.ssaddressU[x]);
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSV, ds.ssaddressV[x]);
-		ProxyInterface->SetSamplerState(x, D3DSAMP_ADDRESSW, ds.ssaddressW[x]);
+		for (UINT y = 0; y < _countof(SamplerStates); y++)
+		{
+			RestoreShadowState(ds.SamplerState[x][y],
+				[&](DWORD& Value) { return GetCachedSamplerState(x, SamplerStates[y], Value); },
+				[&](DWORD Value) {
+					if (SUCCEEDED(ProxyInterface->SetSamplerState(x, SamplerStates[y], Value)))
+					{
+						SetCachedSamplerState(x, SamplerStates[y], Value);
+					}
+				});
+		}
 	}
 
 	// Restore texture states
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLOROP, ds.tsColorOP);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLORARG1, ds.tsColorArg1);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_COLORARG2, ds.tsColorArg2);
-	ProxyInterface->SetTextureStageState(0, D3DTSS_ALPHAOP, ds.tsAlphaOP);
+	const D3DTEXTURESTAGESTATETYPE TextureStates[] = { D3DTSS_COLOROP, D3DTSS_COLORARG1, D3DTSS_COLORARG2, D3DTSS_ALPHAOP };
+	for (UINT x = 0; x < _countof(TextureStates); x++)
+	{
+		RestoreShadowState(ds.TextureStageState[x],
+			[&](DWORD& Value) { return GetCachedTextureStageState(0, TextureStates[x], Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetTextureStageState(0, TextureStates[x], Value)))
+				{
+					SetCachedTextureStageState(0, TextureStates[x], Value);
+				}
+			});
+	}
 
 	// Restore render states
-	ProxyInterface->SetRenderState(D3DRS_LIGHTING, ds.rsLighting);
-	ProxyInterface->SetRenderState(D3DRS_ALPHATESTENABLE, ds.rsAlphaTestEnable);
-	ProxyInterface->SetRenderState(D3DRS_ALPHABLENDENABLE, ds.rsAlphaBlendEnable);
-	ProxyInterface->SetRenderState(D3DRS_FOGENABLE, ds.rsFogEnable);
-	ProxyInterface->SetRenderState(D3DRS_ZENABLE, ds.rsZEnable);
-	ProxyInterface->SetRenderState(D3DRS_ZWRITEENABLE, ds.rsZWriteEnable);
-	ProxyInterface->SetRenderState(D3DRS_STENCILENABLE, ds.rsStencilEnable);
-	ProxyInterface->SetRenderState(D3DRS_CULLMODE, ds.rsCullMode);
-	ProxyInterface->SetRenderState(D3DRS_CLIPPING, ds.rsClipping);
+	const D3DRENDERSTATETYPE RenderStates[] = { D3DRS_LIGHTING, D3DRS_ALPHATESTENABLE, D3DRS_ALPHABLENDENABLE, D3DRS_FOGENABLE, D3DRS_ZENABLE, D3DRS_ZWRITEENABLE, D3DRS_STENCILENABLE, D3DRS_CULLMODE, D3DRS_CLIPPING };
+	for (UINT x = 0; x < _countof(RenderStates); x++)
+	{
+		RestoreShadowState(ds.RenderState[x],
+			[&](DWORD& Value) { return GetCachedRenderState(RenderStates[x], Value); },
+			[&](DWORD Value) {
+				if (SUCCEEDED(ProxyInterface->SetRenderState(RenderStates[x], Value)))
+				{
+					SetCachedRenderState(RenderStates[x], Value);
+				}
+			});
+	}
 }
 
 inline void m_IDirect3DDevice9Ex::ApplyPresentFixes()
 {
+	// Back buffer contents change on present
+	SHARED.SurfaceGeneration++;
+
 	bool CalledBeginScene = false;
 	if (!Config.ForceSingleBeginEndScene || !SHARED.BeginSceneCalled)
 	{
@@ -1446,6 +2180,8 @@ HRESULT m_IDirect3DDevice9Ex::Present(CONST RECT *pSourceRect, CONST RECT *pDest
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	ApplyPresentFixes();
 
 	HRESULT hr = ProxyInterface->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
@@ -1461,8 +2197,125 @@ HRESULT m_IDirect3DDevice9Ex::Present(CONST RECT *pSourceRect, CONST RECT *pDest
 	return hr;
 }
 
+// Appends vertex data to the UP vertex buffer, the start is aligned to the stride so it can be used as StartVertex
+bool m_IDirect3DDevice9Ex::CopyToUPVertexBuffer(const void* pData, UINT Size, UINT Stride, UINT& StartVertex)
+{
+	if (SHARED.UPBuffer.IsFailed || Size > UP_VERTEX_BUFFER_SIZE)
+	{
+		return false;
+	}
+
+	if (!SHARED.UPBuffer.VertexBuffer)
+	{
+		D3DDEVICE_CREATION_PARAMETERS Params = {};
+		ProxyInterface->GetCreationParameters(&Params);
+		const DWORD Usage = D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY |
+			((Params.BehaviorFlags & (D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_MIXED_VERTEXPROCESSING)) ? D3DUSAGE_SOFTWAREPROCESSING : 0);
+
+		if (FAILED(ProxyInterface->CreateVertexBuffer(UP_VERTEX_BUFFER_SIZE, Usage, 0, D3DPOOL_DEFAULT, &SHARED.UPBuffer.VertexBuffer, nullptr)))
+		{
+			LOG_LIMIT(3, __FUNCTION__ << " Error: failed to create UP vertex buffer!");
+			SHARED.UPBuffer.IsFailed = true;
+			return false;
+		}
+
+		// Older devices can only address the first 64k vertices of a buffer
+		D3DCAPS9 Caps = {};
+		const DWORD MaxVertexIndex = SUCCEEDED(ProxyInterface->GetDeviceCaps(&Caps)) && Caps.MaxVertexIndex ? Caps.MaxVertexIndex : 0xFFFF;
+		SHARED.UPBuffer.VertexRing.Reset(UP_VERTEX_BUFFER_SIZE, MaxVertexIndex + 1ULL);
+	}
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	if (!SHARED.UPBuffer.VertexRing.Append(Size, Stride, Offset, Flags))
+	{
+		return false;
+	}
+
+	void* pDest = nullptr;
+	if (FAILED(SHARED.UPBuffer.VertexBuffer->Lock(Offset, Size, &pDest, Flags)) || !pDest)
+	{
+		SHARED.UPBuffer.VertexRing.Invalidate();
+		return false;
+	}
+	memcpy(pDest, pData, Size);
+	SHARED.UPBuffer.VertexBuffer->Unlock();
+
+	StartVertex = Offset / Stride;
+
+	return true;
+}
+
+// Appends index data to the UP index buffer of the matching format
+bool m_IDirect3DDevice9Ex::CopyToUPIndexBuffer(const void* pData, UINT Size, D3DFORMAT Format, UINT& StartIndex)
+{
+	if (SHARED.UPBuffer.IsFailed || Size > UP_INDEX_BUFFER_SIZE)
+	{
+		return false;
+	}
+
+	const UINT x = (Format == D3DFMT_INDEX16) ? 0 : 1;
+	const UINT IndexSize = (Format == D3DFMT_INDEX16) ? sizeof(WORD) : sizeof(DWORD);
+
+	if (!SHARED.UPBuffer.IndexBuffer[x])
+	{
+		D3DDEVICE_CREATION_PARAMETERS Params = {};
+		ProxyInterface->GetCreationParameters(&Params);
+		const DWORD Usage = D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY |
+			((Params.BehaviorFlags & (D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_MIXED_VERTEXPROCESSING)) ? D3DUSAGE_SOFTWAREPROCESSING : 0);
+
+		if (FAILED(ProxyInterface->CreateIndexBuffer(UP_INDEX_BUFFER_SIZE, Usage, Format, D3DPOOL_DEFAULT, &SHARED.UPBuffer.IndexBuffer[x], nullptr)))
+		{
+			LOG_LIMIT(3, __FUNCTION__ << " Error: failed to create UP index buffer!");
+			return false;
+		}
+		SHARED.UPBuffer.IndexRing[x].Reset(UP_INDEX_BUFFER_SIZE);
+	}
+
+	UINT Offset = 0;
+	DWORD Flags = 0;
+	if (!SHARED.UPBuffer.IndexRing[x].Append(Size, IndexSize, Offset, Flags))
+	{
+		return false;
+	}
+
+	void* pDest = nullptr;
+	if (FAILED(SHARED.UPBuffer.IndexBuffer[x]->Lock(Offset, Size, &pDest, Flags)) || !pDest)
+	{
+		SHARED.UPBuffer.IndexRing[x].Invalidate();
+		return false;
+	}
+	memcpy(pDest, pData, Size);
+	SHARED.UPBuffer.IndexBuffer[x]->Unlock();
+
+	StartIndex = Offset / IndexSize;
+
+	return true;
+}
+
+void m_IDirect3DDevice9Ex::ReleaseUPBuffers() const
+{
+	if (SHARED.UPBuffer.VertexBuffer)
+	{
+		SHARED.UPBuffer.VertexBuffer->Release();
+		SHARED.UPBuffer.VertexBuffer = nullptr;
+	}
+	for (auto& pIndexBuffer : SHARED.UPBuffer.IndexBuffer)
+	{
+		if (pIndexBuffer)
+		{
+			pIndexBuffer->Release();
+			pIndexBuffer = nullptr;
+		}
+	}
+	SHARED.UPBuffer.IsFailed = false;
+}
+
 inline void m_IDirect3DDevice9Ex::ApplyDrawFixes()
 {
+	// Render targets may be written
+	SHARED.SurfaceGeneration++;
+
 	// CacheClipPlane
 	if (Config.CacheClipPlane && SHARED.isClipPlaneSet)
 	{
@@ -1484,7 +2337,9 @@ inline void m_IDirect3DDevice9Ex::ApplyDrawFixes()
 
 HRESULT m_IDirect3DDevice9Ex::DrawIndexedPrimitive(THIS_ D3DPRIMITIVETYPE Type, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
+	LOG_TRACE(this, Type, BaseVertexIndex, MinVertexIndex, NumVertices, startIndex, primCount);
+
+	PROFILE_SCOPE();
 
 	ApplyDrawFixes();
 
@@ -1495,14 +2350,48 @@ HRESULT m_IDirect3DDevice9Ex::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveT
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	ApplyDrawFixes();
 
-	return ProxyInterface->DrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+	if (Config.EnableUPDrawBuffering && !SHARED.StateCache.IsRecording && pIndexData && pVertexStreamZeroData && VertexStreamZeroStride &&
+		(IndexDataFormat == D3DFMT_INDEX16 || IndexDataFormat == D3DFMT_INDEX32))
+	{
+		const UINT IndexSize = GetUPVertexCount(PrimitiveType, PrimitiveCount) * ((IndexDataFormat == D3DFMT_INDEX16) ? sizeof(WORD) : sizeof(DWORD));
+		const UINT VertexSize = (MinIndex + NumVertices) * VertexStreamZeroStride;
+		UINT StartVertex = 0, StartIndex = 0;
+
+		if (IndexSize && VertexSize &&
+			CopyToUPVertexBuffer(pVertexStreamZeroData, VertexSize, VertexStreamZeroStride, StartVertex) &&
+			CopyToUPIndexBuffer(pIndexData, IndexSize, IndexDataFormat, StartIndex))
+		{
+			ProxyInterface->SetStreamSource(0, SHARED.UPBuffer.VertexBuffer, 0, VertexStreamZeroStride);
+			ProxyInterface->SetIndices(SHARED.UPBuffer.IndexBuffer[(IndexDataFormat == D3DFMT_INDEX16) ? 0 : 1]);
+
+			HRESULT hr = ProxyInterface->DrawIndexedPrimitive(PrimitiveType, StartVertex, MinIndex, NumVertices, StartIndex, PrimitiveCount);
+
+			// Match UP draw behavior, stream zero and the indices are cleared after drawing
+			ProxyInterface->SetStreamSource(0, nullptr, 0, 0);
+			ProxyInterface->SetIndices(nullptr);
+			SetCachedStreamSource(0, {});
+
+			return hr;
+		}
+	}
+
+	HRESULT hr = ProxyInterface->DrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+
+	// Stream zero is cleared after drawing
+	SetCachedStreamSource(0, {});
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
+	LOG_TRACE(this, PrimitiveType, StartVertex, PrimitiveCount);
+
+	PROFILE_SCOPE();
 
 	ApplyDrawFixes();
 
@@ -1513,15 +2402,43 @@ HRESULT m_IDirect3DDevice9Ex::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UI
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	ApplyDrawFixes();
 
-	return ProxyInterface->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+	if (Config.EnableUPDrawBuffering && !SHARED.StateCache.IsRecording && pVertexStreamZeroData && VertexStreamZeroStride)
+	{
+		const UINT VertexSize = GetUPVertexCount(PrimitiveType, PrimitiveCount) * VertexStreamZeroStride;
+		UINT StartVertex = 0;
+
+		if (VertexSize && CopyToUPVertexBuffer(pVertexStreamZeroData, VertexSize, VertexStreamZeroStride, StartVertex))
+		{
+			ProxyInterface->SetStreamSource(0, SHARED.UPBuffer.VertexBuffer, 0, VertexStreamZeroStride);
+
+			HRESULT hr = ProxyInterface->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
+
+			// Match UP draw behavior, stream zero is cleared after drawing
+			ProxyInterface->SetStreamSource(0, nullptr, 0, 0);
+			SetCachedStreamSource(0, {});
+
+			return hr;
+		}
+	}
+
+	HRESULT hr = ProxyInterface->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+
+	// Stream zero is cleared after drawing
+	SetCachedStreamSource(0, {});
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::BeginScene()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 #ifdef ENABLE_DEBUGOVERLAY
 	// Setup overlay before BeginScene if not already setup on this device
 	if (Config.EnableImgui && IsWindow(SHARED.DeviceWindow) && (!DOverlay.IsSetup() || DOverlay.Getd3d9Device() != ProxyInterface))
@@ -1582,9 +2499,11 @@ HRESULT m_IDirect3DDevice9Ex::BeginScene()
 	if (SHARED.DeviceMultiSampleFlag)
 	{
 		ProxyInterface->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS, TRUE);
+		SetCachedRenderState(D3DRS_MULTISAMPLEANTIALIAS, TRUE);
 		if (SHARED.SetSSAA)
 		{
 			ProxyInterface->SetRenderState(D3DRS_ADAPTIVETESS_Y, MAKEFOURCC('S', 'S', 'A', 'A'));
+			SetCachedRenderState(D3DRS_ADAPTIVETESS_Y, MAKEFOURCC('S', 'S', 'A', 'A'));
 		}
 	}
 
@@ -1609,12 +2528,21 @@ HRESULT m_IDirect3DDevice9Ex::SetStreamSource(THIS_ UINT StreamNumber, IDirect3D
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	if (pStreamData)
 	{
 		pStreamData = static_cast<m_IDirect3DVertexBuffer9 *>(pStreamData)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
+	HRESULT hr = ProxyInterface->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedStreamSource(StreamNumber, { pStreamData, OffsetInBytes, Stride });
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::GetBackBuffer(THIS_ UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer)
@@ -1789,6 +2717,7 @@ inline void m_IDirect3DDevice9Ex::SetEnvironmentMapCubeTexture()
 
 		SHARED.isBlankTextureUsed = true;
 		ProxyInterface->SetTexture(0, SHARED.BlankTexture);
+		SetCachedTexture(0, SHARED.BlankTexture);
 	}
 }
 
@@ -1796,6 +2725,8 @@ HRESULT m_IDirect3DDevice9Ex::SetTexture(DWORD Stage, IDirect3DBaseTexture9 *pTe
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	bool isTexCube = false;
 	if (pTexture)
 	{
@@ -1832,6 +2763,7 @@ HRESULT m_IDirect3DDevice9Ex::SetTexture(DWORD Stage, IDirect3DBaseTexture9 *pTe
 
 	if (SUCCEEDED(hr))
 	{
+		SetCachedTexture(Stage, pTexture);
 		if (Stage < MAX_TEXTURE_STAGES)
 		{
 			SHARED.isTextureMapCube[Stage] = isTexCube;
@@ -1850,10 +2782,13 @@ HRESULT m_IDirect3DDevice9Ex::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGES
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ") Stage: " << Stage << " Type: " << Type << " Value: " << Value;
 
+	PROFILE_SCOPE();
+
 	HRESULT hr = ProxyInterface->SetTextureStageState(Stage, Type, Value);
 
 	if (SUCCEEDED(hr))
 	{
+		SetCachedTextureStageState(Stage, Type, Value);
 		if (Stage < MAX_TEXTURE_STAGES)
 		{
 			if (Type == D3DTSS_TEXCOORDINDEX)
@@ -1874,6 +2809,8 @@ HRESULT m_IDirect3DDevice9Ex::UpdateTexture(IDirect3DBaseTexture9 *pSourceTextur
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (pSourceTexture)
 	{
 		switch (pSourceTexture->GetType())
@@ -1943,6 +2880,8 @@ HRESULT m_IDirect3DDevice9Ex::SetClipPlane(DWORD Index, CONST float *pPlane)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	// CacheClipPlane
 	if (Config.CacheClipPlane)
 	{
@@ -1981,6 +2920,10 @@ HRESULT m_IDirect3DDevice9Ex::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Fl
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	SHARED.SurfaceGeneration++;
+
 	return ProxyInterface->Clear(Count, pRects, Flags, Color, Z, Stencil);
 }
 
@@ -1995,7 +2938,14 @@ HRESULT m_IDirect3DDevice9Ex::SetViewport(CONST D3DVIEWPORT9 *pViewport)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetViewport(pViewport);
+	HRESULT hr = ProxyInterface->SetViewport(pViewport);
+
+	if (SUCCEEDED(hr) && pViewport)
+	{
+		SetCachedViewport(*pViewport);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::CreateVertexShader(THIS_ CONST DWORD* pFunction, IDirect3DVertexShader9** ppShader)
@@ -2042,7 +2992,14 @@ HRESULT m_IDirect3DDevice9Ex::SetVertexShader(THIS_ IDirect3DVertexShader9* pSha
 		pShader = static_cast<m_IDirect3DVertexShader9 *>(pShader)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetVertexShader(pShader);
+	HRESULT hr = ProxyInterface->SetVertexShader(pShader);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedVertexShader(pShader);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::CreateQuery(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery)
@@ -2070,6 +3027,8 @@ HRESULT m_IDirect3DDevice9Ex::SetPixelShaderConstantB(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetPixelShaderConstantB(StartRegister, pConstantData, BoolCount);
 }
 
@@ -2084,6 +3043,8 @@ HRESULT m_IDirect3DDevice9Ex::SetPixelShaderConstantI(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetPixelShaderConstantI(StartRegister, pConstantData, Vector4iCount);
 }
 
@@ -2098,6 +3059,8 @@ HRESULT m_IDirect3DDevice9Ex::SetPixelShaderConstantF(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetPixelShaderConstantF(StartRegister, pConstantData, Vector4fCount);
 }
 
@@ -2112,6 +3075,8 @@ HRESULT m_IDirect3DDevice9Ex::SetStreamSourceFreq(THIS_ UINT StreamNumber, UINT
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetStreamSourceFreq(StreamNumber, Divider);
 }
 
@@ -2126,6 +3091,8 @@ HRESULT m_IDirect3DDevice9Ex::SetVertexShaderConstantB(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetVertexShaderConstantB(StartRegister, pConstantData, BoolCount);
 }
 
@@ -2140,6 +3107,10 @@ HRESULT m_IDirect3DDevice9Ex::SetVertexShaderConstantF(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
+	PROFILE_SCOPE();
+
 	return ProxyInterface->SetVertexShaderConstantF(StartRegister, pConstantData, Vector4fCount);
 }
 
@@ -2154,6 +3125,8 @@ HRESULT m_IDirect3DDevice9Ex::SetVertexShaderConstantI(THIS_ UINT StartRegister,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetVertexShaderConstantI(StartRegister, pConstantData, Vector4iCount);
 }
 
@@ -2168,7 +3141,14 @@ HRESULT m_IDirect3DDevice9Ex::SetFVF(THIS_ DWORD FVF)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetFVF(FVF);
+	HRESULT hr = ProxyInterface->SetFVF(FVF);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedVertexFormat({ FVF, nullptr });
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::GetFVF(THIS_ DWORD* pFVF)
@@ -2208,7 +3188,14 @@ HRESULT m_IDirect3DDevice9Ex::SetVertexDeclaration(THIS_ IDirect3DVertexDeclarat
 		pDecl = static_cast<m_IDirect3DVertexDeclaration9 *>(pDecl)->GetProxyInterface();
 	}
 
-	return ProxyInterface->SetVertexDeclaration(pDecl);
+	HRESULT hr = ProxyInterface->SetVertexDeclaration(pDecl);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedVertexFormat({ 0, pDecl });
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DDevice9Ex::GetVertexDeclaration(THIS_ IDirect3DVertexDeclaration9** ppDecl)
@@ -2229,6 +3216,8 @@ HRESULT m_IDirect3DDevice9Ex::SetNPatchMode(THIS_ float nSegments)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetNPatchMode(nSegments);
 }
 
@@ -2264,6 +3253,8 @@ HRESULT m_IDirect3DDevice9Ex::SetSoftwareVertexProcessing(THIS_ BOOL bSoftware)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetSoftwareVertexProcessing(bSoftware);
 }
 
@@ -2271,6 +3262,8 @@ HRESULT m_IDirect3DDevice9Ex::SetScissorRect(THIS_ CONST RECT* pRect)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SetStateBlockIncomplete();
+
 	return ProxyInterface->SetScissorRect(pRect);
 }
 
@@ -2292,18 +3285,17 @@ HRESULT m_IDirect3DDevice9Ex::SetSamplerState(THIS_ DWORD Sampler, D3DSAMPLERSTA
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	// Disable AntiAliasing when using point filtering
 	if (Config.AntiAliasing)
 	{
 		if (Type == D3DSAMP_MINFILTER || Type == D3DSAMP_MAGFILTER)
 		{
-			if (Value == D3DTEXF_NONE || Value == D3DTEXF_POINT)
-			{
-				ProxyInterface->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS, FALSE);
-			}
-			else
+			const DWORD MultiSampleValue = (Value == D3DTEXF_NONE || Value == D3DTEXF_POINT) ? FALSE : TRUE;
+			if (SUCCEEDED(ProxyInterface->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS, MultiSampleValue)))
 			{
-				ProxyInterface->SetRenderState(D3DRS_MULTISAMPLEANTIALIAS, TRUE);
+				SetCachedRenderState(D3DRS_MULTISAMPLEANTIALIAS, MultiSampleValue);
 			}
 		}
 	}
@@ -2315,6 +3307,7 @@ HRESULT m_IDirect3DDevice9Ex::SetSamplerState(THIS_ DWORD Sampler, D3DSAMPLERSTA
 		{
 			if (SUCCEEDED(ProxyInterface->SetSamplerState(Sampler, D3DSAMP_MAXANISOTROPY, SHARED.MaxAnisotropy)))
 			{
+				SetCachedSamplerState(Sampler, D3DSAMP_MAXANISOTROPY, SHARED.MaxAnisotropy);
 				return D3D_OK;
 			}
 		}
@@ -2323,6 +3316,8 @@ HRESULT m_IDirect3DDevice9Ex::SetSamplerState(THIS_ DWORD Sampler, D3DSAMPLERSTA
 			if (SUCCEEDED(ProxyInterface->SetSamplerState(Sampler, D3DSAMP_MAXANISOTROPY, SHARED.MaxAnisotropy)) &&
 				SUCCEEDED(ProxyInterface->SetSamplerState(Sampler, Type, D3DTEXF_ANISOTROPIC)))
 			{
+				SetCachedSamplerState(Sampler, D3DSAMP_MAXANISOTROPY, SHARED.MaxAnisotropy);
+				SetCachedSamplerState(Sampler, Type, D3DTEXF_ANISOTROPIC);
 				if (!SHARED.isAnisotropySet)
 				{
 					SHARED.isAnisotropySet = true;
@@ -2333,7 +3328,14 @@ HRESULT m_IDirect3DDevice9Ex::SetSamplerState(THIS_ DWORD Sampler, D3DSAMPLERSTA
 		}
 	}
 
-	return ProxyInterface->SetSamplerState(Sampler, Type, Value);
+	HRESULT hr = ProxyInterface->SetSamplerState(Sampler, Type, Value);
+
+	if (SUCCEEDED(hr))
+	{
+		SetCachedSamplerState(Sampler, Type, Value);
+	}
+
+	return hr;
 }
 
 inline void m_IDirect3DDevice9Ex::DisableAnisotropicSamplerState(bool AnisotropyMin, bool AnisotropyMag)
@@ -2343,17 +3345,19 @@ inline void m_IDirect3DDevice9Ex::DisableAnisotropicSamplerState(bool Anisotropy
 	{
 		if (!AnisotropyMin)	// Anisotropic Min Filter is not supported for multi-stage textures
 		{
-			if (SUCCEEDED(ProxyInterface->GetSamplerState(x, D3DSAMP_MINFILTER, &Value)) && Value == D3DTEXF_ANISOTROPIC &&
+			if (GetCachedSamplerState(x, D3DSAMP_MINFILTER, Value) && Value == D3DTEXF_ANISOTROPIC &&
 				SUCCEEDED(ProxyInterface->SetSamplerState(x, D3DSAMP_MINFILTER, D3DTEXF_LINEAR)))
 			{
+				SetCachedSamplerState(x, D3DSAMP_MINFILTER, D3DTEXF_LINEAR);
 				SHARED.AnisotropyDisabledFlag = true;
 			}
 		}
 		if (!AnisotropyMag)	// Anisotropic Mag Filter is not supported for multi-stage textures
 		{
-			if (SUCCEEDED(ProxyInterface->GetSamplerState(x, D3DSAMP_MAGFILTER, &Value)) && Value == D3DTEXF_ANISOTROPIC &&
+			if (GetCachedSamplerState(x, D3DSAMP_MAGFILTER, Value) && Value == D3DTEXF_ANISOTROPIC &&
 				SUCCEEDED(ProxyInterface->SetSamplerState(x, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR)))
 			{
+				SetCachedSamplerState(x, D3DSAMP_MAGFILTER, D3DTEXF_LINEAR);
 				SHARED.AnisotropyDisabledFlag = true;
 			}
 		}
@@ -2368,16 +3372,24 @@ inline void m_IDirect3DDevice9Ex::ReeableAnisotropicSamplerState()
 		DWORD Value = 0;
 		for (int x = 0; x < 4; x++)
 		{
-			if (!(SUCCEEDED(ProxyInterface->GetSamplerState(x, D3DSAMP_MINFILTER, &Value)) && Value == D3DTEXF_LINEAR &&
+			if (!(GetCachedSamplerState(x, D3DSAMP_MINFILTER, Value) && Value == D3DTEXF_LINEAR &&
 				SUCCEEDED(ProxyInterface->SetSamplerState(x, D3DSAMP_MINFILTER, D3DTEXF_ANISOTROPIC))))
 			{
 				Flag = true;	// Unable to re-eanble Anisotropic filtering
 			}
-			if (!(SUCCEEDED(ProxyInterface->GetSamplerState(x, D3DSAMP_MAGFILTER, &Value)) && Value == D3DTEXF_LINEAR &&
+			else
+			{
+				SetCachedSamplerState(x, D3DSAMP_MINFILTER, D3DTEXF_ANISOTROPIC);
+			}
+			if (!(GetCachedSamplerState(x, D3DSAMP_MAGFILTER, Value) && Value == D3DTEXF_LINEAR &&
 				SUCCEEDED(ProxyInterface->SetSamplerState(x, D3DSAMP_MAGFILTER, D3DTEXF_ANISOTROPIC))))
 			{
 				Flag = true;	// Unable to re-eanble Anisotropic filtering
 			}
+			else
+			{
+				SetCachedSamplerState(x, D3DSAMP_MAGFILTER, D3DTEXF_ANISOTROPIC);
+			}
 		}
 		SHARED.AnisotropyDisabledFlag = Flag;
 	}
@@ -2420,6 +3432,8 @@ HRESULT m_IDirect3DDevice9Ex::ColorFill(THIS_ IDirect3DSurface9* pSurface, CONST
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (pSurface)
 	{
 		pSurface = static_cast<m_IDirect3DSurface9 *>(pSurface)->GetProxyInterface();
@@ -2433,6 +3447,8 @@ HRESULT m_IDirect3DDevice9Ex::CopyRects(THIS_ IDirect3DSurface9 *pSourceSurface,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (!pSourceSurface || !pDestinationSurface || pSourceSurface == pDestinationSurface)
 	{
 		return D3DERR_INVALIDCALL;
@@ -2504,6 +3520,8 @@ HRESULT m_IDirect3DDevice9Ex::StretchRect(THIS_ IDirect3DSurface9* pSourceSurfac
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (pSourceSurface)
 	{
 		pSourceSurface = static_cast<m_IDirect3DSurface9 *>(pSourceSurface)->GetProxyInterface();
@@ -2613,6 +3631,8 @@ HRESULT m_IDirect3DDevice9Ex::GetRenderTargetData(THIS_ IDirect3DSurface9* pRend
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (pRenderTarget)
 	{
 		pRenderTarget = static_cast<m_IDirect3DSurface9 *>(pRenderTarget)->GetNonMultiSampledSurface(nullptr, 0);
@@ -2630,6 +3650,8 @@ HRESULT m_IDirect3DDevice9Ex::UpdateSurface(THIS_ IDirect3DSurface9* pSourceSurf
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (pSourceSurface)
 	{
 		pSourceSurface = static_cast<m_IDirect3DSurface9 *>(pSourceSurface)->GetProxyInterface();
@@ -2725,6 +3747,8 @@ HRESULT m_IDirect3DDevice9Ex::ComposeRects(THIS_ IDirect3DSurface9* pSrc, IDirec
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	SHARED.SurfaceGeneration++;
+
 	if (!ProxyInterfaceEx)
 	{
 		Logging::Log() << __FUNCTION__ << " Error: Calling extension function from a non-extension device!";
@@ -2758,6 +3782,8 @@ HRESULT m_IDirect3DDevice9Ex::PresentEx(THIS_ CONST RECT* pSourceRect, CONST REC
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	ApplyPresentFixes();
 
 	HRESULT hr = ProxyInterfaceEx->PresentEx(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion, dwFlags);
@@ -3043,6 +4069,10 @@ inline void m_IDirect3DDevice9Ex::ReInitInterface() const
 {
 	Utils::GetScreenSize(SHARED.DeviceWindow, SHARED.screenWidth, SHARED.screenHeight);
 
+	// Device state is unknown until it is set or read back
+	SHARED.StateCache = {};
+	SHARED.SurfaceGeneration++;
+
 	SHARED.IsGammaSet = false;
 	for (int i = 0; i < 256; ++i)
 	{
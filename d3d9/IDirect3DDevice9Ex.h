@@ -3,8 +3,51 @@
 static constexpr size_t MAX_CLIP_PLANES = 6;
 static constexpr size_t MAX_TEXTURE_STAGES = 8;
 static constexpr size_t MAX_STATE_BLOCKS = 1024;
+static constexpr size_t MAX_RENDER_STATES = 256;
+static constexpr size_t MAX_TEXTURE_STAGE_STATES = D3DTSS_CONSTANT + 1;
+static constexpr size_t MAX_SAMPLERS = 16 + 4;		// Pixel samplers followed by the vertex samplers
+static constexpr size_t MAX_SAMPLER_STATES = D3DSAMP_DMAPOFFSET + 1;
+static constexpr size_t MAX_STREAMS = 16;
+static constexpr UINT UP_VERTEX_BUFFER_SIZE = 2 * 1024 * 1024;
+static constexpr UINT UP_INDEX_BUFFER_SIZE = 512 * 1024;
 const std::chrono::seconds FPS_CALCULATION_WINDOW(1);	// Define a constant for the desired duration of FPS calculation
 
+struct STREAMSOURCE
+{
+	IDirect3DVertexBuffer9* pStreamData;
+	UINT OffsetInBytes;
+	UINT Stride;
+
+	bool operator==(const STREAMSOURCE& other) const { return pStreamData == other.pStreamData && OffsetInBytes == other.OffsetInBytes && Stride == other.Stride; }
+	bool operator!=(const STREAMSOURCE& other) const { return !(*this == other); }
+};
+
+struct VERTEXFORMAT
+{
+	DWORD FVF;
+	IDirect3DVertexDeclaration9* pDecl;		// Only used when FVF is 0
+
+	bool operator==(const VERTEXFORMAT& other) const { return FVF == other.FVF && (FVF || pDecl == other.pDecl); }
+	bool operator!=(const VERTEXFORMAT& other) const { return !(*this == other); }
+};
+
+// Shadow of the device state, values are tracked as they are set so they don't need to be read back from the driver
+struct DEVICESTATECACHE
+{
+	bool IsRecording = false;	// Set calls between BeginStateBlock and EndStateBlock are recorded rather than applied
+	SHADOWSTATE<DWORD> RenderState[MAX_RENDER_STATES];
+	SHADOWSTATE<DWORD> TextureStageState[MAX_TEXTURE_STAGES][MAX_TEXTURE_STAGE_STATES];
+	SHADOWSTATE<DWORD> SamplerState[MAX_SAMPLERS][MAX_SAMPLER_STATES];
+	SHADOWSTATE<IDirect3DBaseTexture9*> Texture[MAX_SAMPLERS];
+	SHADOWSTATE<IDirect3DPixelShader9*> PixelShader;
+	SHADOWSTATE<IDirect3DVertexShader9*> VertexShader;
+	SHADOWSTATE<D3DVIEWPORT9> Viewport;
+	SHADOWSTATE<STREAMSOURCE> StreamSource[MAX_STREAMS];
+	SHADOWSTATE<VERTEXFORMAT> VertexFormat;
+};
+
+struct STATEBLOCKRECORD;
+
 struct DEVICEDETAILS
 {
 	// Window handle and size
@@ -66,12 +109,29 @@ struct DEVICEDETAILS
 	DWORD m_clipPlaneRenderState = 0;
 	float m_storedClipPlanes[MAX_CLIP_PLANES][4] = {};
 
+	// Shadow device state
+	DEVICESTATECACHE StateCache;
+	STATEBLOCKRECORD* StateBlockRecord = nullptr;	// States set since BeginStateBlock, used with OptimizeStateBlocks
+
+	// Incremented on every call that may write to a surface, used to reuse multisample resolves
+	DWORD SurfaceGeneration = 0;
+
+	// Dynamic buffers used for UP draws, filled with NOOVERWRITE locks and discarded when full
+	struct {
+		bool IsFailed = false;
+		LPDIRECT3DVERTEXBUFFER9 VertexBuffer = nullptr;
+		UPRINGBUFFER VertexRing;
+		LPDIRECT3DINDEXBUFFER9 IndexBuffer[2] = {};		// 16-bit and 32-bit indices
+		UPRINGBUFFER IndexRing[2];
+	} UPBuffer;
+
 	// For gamma
 	bool IsGammaSet = false;
 	bool UsingShader32f = true;
 	D3DGAMMARAMP RampData = {};
 	D3DGAMMARAMP DefaultRampData = {};
 	LPDIRECT3DTEXTURE9 GammaLUTTexture = nullptr;
+	DWORD GammaLUTHash = 0;		// Hash of the last ramp uploaded to GammaLUTTexture
 	LPDIRECT3DTEXTURE9 ScreenCopyTexture = nullptr;
 	LPDIRECT3DPIXELSHADER9 gammaPixelShader = nullptr;
 };
@@ -82,14 +142,17 @@ extern std::unordered_map<UINT, DEVICEDETAILS> DeviceDetailsMap;
 
 #define SHARED DeviceDetailsMap[DDKey]
 
+// Game state saved while the overlay is drawn, entries are only set if the value was known
 struct DEVICESTATEBACKUP {
-	DWORD rsLighting, rsAlphaTestEnable, rsAlphaBlendEnable, rsFogEnable, rsZEnable, rsZWriteEnable, rsStencilEnable, rsCullMode, rsClipping;
-	DWORD tsColorOP, tsColorArg1, tsColorArg2, tsAlphaOP;
-	DWORD ssaddressU[2], ssaddressV[2], ssaddressW[2];
-	D3DVIEWPORT9 oldViewport, newViewport;
-	IDirect3DBaseTexture9* pTexture[8];
-	IDirect3DPixelShader9* pPixelShader;
-	IDirect3DVertexShader9* pVertexShader;
+	SHADOWSTATE<DWORD> RenderState[9];
+	SHADOWSTATE<DWORD> TextureStageState[4];
+	SHADOWSTATE<DWORD> SamplerState[2][3];
+	SHADOWSTATE<D3DVIEWPORT9> Viewport;
+	SHADOWSTATE<IDirect3DBaseTexture9*> Texture[MAX_TEXTURE_STAGES];
+	SHADOWSTATE<IDirect3DPixelShader9*> PixelShader;
+	SHADOWSTATE<IDirect3DVertexShader9*> VertexShader;
+	SHADOWSTATE<STREAMSOURCE> StreamSource;
+	SHADOWSTATE<VERTEXFORMAT> VertexFormat;
 	IDirect3DSurface9* pRenderTarget;
 };
 
@@ -108,9 +171,34 @@ private:
 	void ApplyDrawFixes();
 	void ApplyPresentFixes();
 
+	// UP draw buffering
+	bool CopyToUPVertexBuffer(const void* pData, UINT Size, UINT Stride, UINT& StartVertex);
+	bool CopyToUPIndexBuffer(const void* pData, UINT Size, D3DFORMAT Format, UINT& StartIndex);
+	void ReleaseUPBuffers() const;
+
 	void BackupDeviceState();
 	void RestoreDeviceState();
 
+	// Shadow device state
+	bool GetCachedRenderState(D3DRENDERSTATETYPE State, DWORD& Value);
+	void SetCachedRenderState(D3DRENDERSTATETYPE State, DWORD Value) const;
+	bool GetCachedTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD& Value);
+	void SetCachedTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) const;
+	bool GetCachedSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD& Value);
+	void SetCachedSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) const;
+	bool GetCachedTexture(DWORD Stage, IDirect3DBaseTexture9*& pTexture);
+	void SetCachedTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) const;
+	bool GetCachedPixelShader(IDirect3DPixelShader9*& pShader);
+	void SetCachedPixelShader(IDirect3DPixelShader9* pShader) const;
+	bool GetCachedVertexShader(IDirect3DVertexShader9*& pShader);
+	void SetCachedVertexShader(IDirect3DVertexShader9* pShader) const;
+	bool GetCachedViewport(D3DVIEWPORT9& Viewport);
+	void SetCachedViewport(const D3DVIEWPORT9& Viewport) const;
+	bool GetCachedStreamSource(UINT StreamNumber, STREAMSOURCE& Stream);
+	void SetCachedStreamSource(UINT StreamNumber, const STREAMSOURCE& Stream) const;
+	bool GetCachedVertexFormat(VERTEXFORMAT& Format);
+	void SetCachedVertexFormat(const VERTEXFORMAT& Format) const;
+
 	HRESULT CallEndScene();
 
 	// Limit frame rate
@@ -322,5 +410,12 @@ public:
 	inline LPDIRECT3DDEVICE9 GetProxyInterface() const { return ProxyInterface; }
 	inline AddressLookupTableD3d9* GetLookupTable() const { return &SHARED.ProxyAddressLookupTable9; }
 	REFIID GetIID() { return WrapperID; }
+	void InvalidateStateCache() const;
+	void ApplyStateBlockRecord(const STATEBLOCKRECORD& Record);
+	bool CaptureStateBlockRecord(STATEBLOCKRECORD& Record);
+	void SetStateBlockIncomplete() const;
+	bool IsRecordingStateBlock() const { return SHARED.StateCache.IsRecording; }
+	DWORD GetSurfaceGeneration() const { return SHARED.SurfaceGeneration; }
+	void IncrementSurfaceGeneration() const { SHARED.SurfaceGeneration++; }
 };
 #undef SHARED
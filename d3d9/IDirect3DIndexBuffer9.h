@@ -5,6 +5,7 @@ class m_IDirect3DIndexBuffer9 : public IDirect3DIndexBuffer9, public AddressLook
 private:
 	LPDIRECT3DINDEXBUFFER9 ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx;
+	DYNAMICBUFFERLOCK DynamicLock;
 	REFIID WrapperID = IID_IDirect3DIndexBuffer9;
 
 public:
@@ -17,6 +18,8 @@ public:
 	~m_IDirect3DIndexBuffer9()
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
+
+		DynamicLock.LogStats(this);
 	}
 
 	/*** IUnknown methods ***/
@@ -86,6 +86,13 @@ HRESULT m_IDirect3DQuery9::Issue(THIS_ DWORD dwIssueFlags)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	if (Config.QueryPollBackoff && (dwIssueFlags & D3DISSUE_END))
+	{
+		LARGE_INTEGER Counter;
+		QueryPerformanceCounter(&Counter);
+		Polling.OnIssue(Counter.QuadPart);
+	}
+
 	return ProxyInterface->Issue(dwIssueFlags);
 }
 
@@ -93,5 +100,58 @@ HRESULT m_IDirect3DQuery9::GetData(THIS_ void* pData, DWORD dwSize, DWORD dwGetD
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->GetData(pData, dwSize, dwGetDataFlags);
+	HRESULT hr = ProxyInterface->GetData(pData, dwSize, dwGetDataFlags);
+
+	if (Config.QueryPollBackoff && Polling.IssueTicks)
+	{
+		LARGE_INTEGER Counter;
+		QueryPerformanceCounter(&Counter);
+
+		if (hr == S_FALSE)
+		{
+			BackOff(Polling.OnPending(Counter.QuadPart, Config.QueryPollBackoff, GetTicksPerMS()));
+		}
+		else
+		{
+			Polling.OnComplete(Counter.QuadPart, hr == S_OK);
+		}
+	}
+
+	return hr;
+}
+
+LONGLONG m_IDirect3DQuery9::GetTicksPerMS()
+{
+	static LONGLONG TicksPerMS = []() {
+		LARGE_INTEGER Frequency = {};
+		QueryPerformanceFrequency(&Frequency);
+		return max(Frequency.QuadPart / 1000, 1LL);
+		}();
+
+	return TicksPerMS;
+}
+
+// Never sleeps, Sleep(1) runs at the default timer resolution and can return long after the result is ready
+void m_IDirect3DQuery9::BackOff(QUERYBACKOFF::ACTION Action)
+{
+	if (Action == QUERYBACKOFF::NONE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER Start;
+	QueryPerformanceCounter(&Start);
+
+	if (Action == QUERYBACKOFF::SPIN)
+	{
+		Utils::BusyWaitYield(0);
+	}
+	else
+	{
+		Sleep(0);
+	}
+
+	LARGE_INTEGER End;
+	QueryPerformanceCounter(&End);
+	Polling.AddWait(End.QuadPart - Start.QuadPart);
 }
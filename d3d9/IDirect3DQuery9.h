@@ -7,6 +7,12 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx;
 	REFIID WrapperID = IID_IDirect3DQuery9;
 
+	// Polling state used to back off tight GetData loops
+	QUERYBACKOFF Polling;
+
+	static LONGLONG GetTicksPerMS();
+	void BackOff(QUERYBACKOFF::ACTION Action);
+
 public:
 	m_IDirect3DQuery9(LPDIRECT3DQUERY9 pQuery9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pQuery9), m_pDeviceEx(pDevice)
 	{
@@ -17,6 +23,14 @@ public:
 	~m_IDirect3DQuery9()
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
+
+		if (Polling.WaitCount)
+		{
+			LARGE_INTEGER Frequency = {};
+			QueryPerformanceFrequency(&Frequency);
+			Logging::LogDebug() << __FUNCTION__ << " (" << this << ") GetData backoff yielded " << Polling.WaitCount << " times for " <<
+				(double)Polling.WaitTicks * 1000.0 / Frequency.QuadPart << "ms";
+		}
 	}
 
 	/*** IUnknown methods ***/
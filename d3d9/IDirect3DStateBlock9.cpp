@@ -57,6 +57,9 @@ ULONG m_IDirect3DStateBlock9::Release(THIS)
 
 	if (ref == 0)
 	{
+		// Release objects held by the record since the wrapper may outlive the state block
+		SetRecord(nullptr);
+
 		if (Config.LimitStateBlocks)
 		{
 			delete this;
@@ -82,12 +85,127 @@ HRESULT m_IDirect3DStateBlock9::Capture(THIS)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->Capture();
+	HRESULT hr = ProxyInterface->Capture();
+
+	// Keep the record in sync, fall back to the runtime state block if a state cannot be read
+	if (SUCCEEDED(hr) && pRecord && pRecord->IsComplete && !m_pDeviceEx->CaptureStateBlockRecord(*pRecord))
+	{
+		pRecord->IsComplete = false;
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirect3DStateBlock9::Apply(THIS)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->Apply();
+	PROFILE_SCOPE();
+
+	// Only set states that differ from the current device state
+	if (pRecord && pRecord->IsComplete && !m_pDeviceEx->IsRecordingStateBlock())
+	{
+		m_pDeviceEx->ApplyStateBlockRecord(*pRecord);
+
+		return D3D_OK;
+	}
+
+	HRESULT hr = ProxyInterface->Apply();
+
+	// Applied states are not known by the device state cache
+	if (SUCCEEDED(hr))
+	{
+		m_pDeviceEx->InvalidateStateCache();
+	}
+
+	return hr;
+}
+
+/************************/
+/*** Helper functions ***/
+/************************/
+
+// References the new object before releasing the old one in case they are the same
+template <typename T>
+static void ReplaceReference(T*& pDest, T* pSrc)
+{
+	if (pSrc)
+	{
+		pSrc->AddRef();
+	}
+	if (pDest)
+	{
+		pDest->Release();
+	}
+	pDest = pSrc;
+}
+
+STATEBLOCKRECORD::~STATEBLOCKRECORD()
+{
+	for (auto& Entry : Texture)
+	{
+		if (Entry.second)
+		{
+			Entry.second->Release();
+		}
+	}
+	for (auto& Entry : StreamSource)
+	{
+		if (Entry.second.pStreamData)
+		{
+			Entry.second.pStreamData->Release();
+		}
+	}
+	ReplaceReference(PixelShader.Value, (IDirect3DPixelShader9*)nullptr);
+	ReplaceReference(VertexShader.Value, (IDirect3DVertexShader9*)nullptr);
+	ReplaceReference(VertexFormat.Value.pDecl, (IDirect3DVertexDeclaration9*)nullptr);
+}
+
+void STATEBLOCKRECORD::SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture)
+{
+	for (auto& Entry : Texture)
+	{
+		if (Entry.first == Stage)
+		{
+			ReplaceReference(Entry.second, pTexture);
+			return;
+		}
+	}
+	Texture.push_back({ Stage, nullptr });
+	ReplaceReference(Texture.back().second, pTexture);
+}
+
+void STATEBLOCKRECORD::SetStreamSource(UINT StreamNumber, const STREAMSOURCE& Stream)
+{
+	for (auto& Entry : StreamSource)
+	{
+		if (Entry.first == StreamNumber)
+		{
+			ReplaceReference(Entry.second.pStreamData, Stream.pStreamData);
+			Entry.second.OffsetInBytes = Stream.OffsetInBytes;
+			Entry.second.Stride = Stream.Stride;
+			return;
+		}
+	}
+	StreamSource.push_back({ StreamNumber, { nullptr, Stream.OffsetInBytes, Stream.Stride } });
+	ReplaceReference(StreamSource.back().second.pStreamData, Stream.pStreamData);
+}
+
+void STATEBLOCKRECORD::SetPixelShader(IDirect3DPixelShader9* pShader)
+{
+	ReplaceReference(PixelShader.Value, pShader);
+	PixelShader.IsSet = true;
+}
+
+void STATEBLOCKRECORD::SetVertexShader(IDirect3DVertexShader9* pShader)
+{
+	ReplaceReference(VertexShader.Value, pShader);
+	VertexShader.IsSet = true;
+}
+
+void STATEBLOCKRECORD::SetVertexFormat(const VERTEXFORMAT& Format)
+{
+	ReplaceReference(VertexFormat.Value.pDecl, (Format.FVF) ? nullptr : Format.pDecl);
+	VertexFormat.Value.FVF = Format.FVF;
+	VertexFormat.IsSet = true;
 }
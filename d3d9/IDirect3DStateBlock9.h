@@ -1,5 +1,31 @@
 #pragma once
 
+// Sparse copy of the states set while a state block was recorded, bound objects are referenced by the record
+struct STATEBLOCKRECORD
+{
+	bool IsComplete = true;		// Cleared when a state that is not tracked here was recorded
+	std::vector<STATEVALUE> RenderState;
+	std::vector<STATEVALUE> TextureStageState;	// Index is the stage in the high word and the type in the low word
+	std::vector<STATEVALUE> SamplerState;		// Index is the sampler in the high word and the type in the low word
+	std::vector<std::pair<DWORD, IDirect3DBaseTexture9*>> Texture;
+	std::vector<std::pair<UINT, STREAMSOURCE>> StreamSource;
+	SHADOWSTATE<IDirect3DPixelShader9*> PixelShader;
+	SHADOWSTATE<IDirect3DVertexShader9*> VertexShader;
+	SHADOWSTATE<D3DVIEWPORT9> Viewport;
+	SHADOWSTATE<VERTEXFORMAT> VertexFormat;
+
+	STATEBLOCKRECORD() = default;
+	STATEBLOCKRECORD(const STATEBLOCKRECORD&) = delete;
+	STATEBLOCKRECORD& operator=(const STATEBLOCKRECORD&) = delete;
+	~STATEBLOCKRECORD();
+
+	void SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture);
+	void SetStreamSource(UINT StreamNumber, const STREAMSOURCE& Stream);
+	void SetPixelShader(IDirect3DPixelShader9* pShader);
+	void SetVertexShader(IDirect3DVertexShader9* pShader);
+	void SetVertexFormat(const VERTEXFORMAT& Format);
+};
+
 class m_IDirect3DStateBlock9 : public IDirect3DStateBlock9, public AddressLookupTableD3d9Object
 {
 private:
@@ -7,6 +33,7 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx;
 	REFIID WrapperID = IID_IDirect3DStateBlock9;
 	UINT DDKey = NO_MAP_VALUE;
+	STATEBLOCKRECORD* pRecord = nullptr;
 
 public:
 	m_IDirect3DStateBlock9(LPDIRECT3DSTATEBLOCK9 pBlock9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pBlock9), m_pDeviceEx(pDevice)
@@ -23,6 +50,8 @@ public:
 		{
 			DeviceDetailsMap[DDKey].StateBlockTable.RemoveStateBlock(this);
 		}
+
+		delete pRecord;
 	}
 
 	/*** IUnknown methods ***/
@@ -39,4 +68,5 @@ public:
 	LPDIRECT3DSTATEBLOCK9 GetProxyInterface() { return ProxyInterface; }
 	void ClearDirect3DDevice() { DDKey = NO_MAP_VALUE; }
 	void SetDDKey(UINT NewDDKey) { DDKey = NewDDKey; }
+	void SetRecord(STATEBLOCKRECORD* pNewRecord) { delete pRecord; pRecord = pNewRecord; }
 };
@@ -180,9 +180,23 @@ m_IDirect3DSurface9* m_IDirect3DSurface9::m_GetNonMultiSampledSurface(const RECT
 		Emu.Rect = (pRect) ? *pRect : Emu.Rect;
 		Emu.pRect = (pRect) ? &Emu.Rect : nullptr;
 
-		if (FAILED(m_pDeviceEx->CopyRects(this, pRect, 1, Emu.pSurface, (LPPOINT)pRect)))
+		// Reuse the last resolve if it covers this rect and nothing has written to the surface since
+		const RECT LockRect = (pRect) ? *pRect : RECT{ 0, 0, (LONG)Desc.Width, (LONG)Desc.Height };
+		if (!Emu.IsResolved || Emu.Generation != m_pDeviceEx->GetSurfaceGeneration() ||
+			LockRect.left < Emu.ResolvedRect.left || LockRect.top < Emu.ResolvedRect.top ||
+			LockRect.right > Emu.ResolvedRect.right || LockRect.bottom > Emu.ResolvedRect.bottom)
 		{
-			LOG_LIMIT(100, __FUNCTION__ << " Error: copying surface!");
+			if (FAILED(m_pDeviceEx->CopyRects(this, pRect, 1, Emu.pSurface, (LPPOINT)pRect)))
+			{
+				LOG_LIMIT(100, __FUNCTION__ << " Error: copying surface!");
+				Emu.IsResolved = false;
+			}
+			else
+			{
+				Emu.IsResolved = true;
+				Emu.ResolvedRect = LockRect;
+				Emu.Generation = m_pDeviceEx->GetSurfaceGeneration();
+			}
 		}
 	}
 	else
@@ -197,11 +211,18 @@ HRESULT m_IDirect3DSurface9::RestoreMultiSampleData()
 {
 	if (Emu.pSurface && !Emu.ReadOnly)
 	{
+		const bool IsCurrent = (Emu.IsResolved && Emu.Generation == m_pDeviceEx->GetSurfaceGeneration());
 		if (FAILED(m_pDeviceEx->CopyRects(Emu.pSurface, Emu.pRect, 1, this, (LPPOINT)Emu.pRect)))
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: copying emulated surface!");
+			Emu.IsResolved = false;
 			return D3DERR_INVALIDCALL;
 		}
+		// Both surfaces still match after the copy back
+		if (IsCurrent)
+		{
+			Emu.Generation = m_pDeviceEx->GetSurfaceGeneration();
+		}
 	}
 	return D3D_OK;
 }
@@ -210,6 +231,8 @@ HRESULT m_IDirect3DSurface9::LockRect(THIS_ D3DLOCKED_RECT* pLockedRect, CONST R
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	if (!pLockedRect)
 	{
 		return D3DERR_INVALIDCALL;
@@ -222,6 +245,8 @@ HRESULT m_IDirect3DSurface9::UnlockRect(THIS)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	HRESULT hr = D3DERR_INVALIDCALL;
 
 	// Copy data back from emulated surface
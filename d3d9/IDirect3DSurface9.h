@@ -14,6 +14,9 @@ private:
 		RECT* pRect = nullptr;
 		RECT Rect = {};
 		m_IDirect3DSurface9* pSurface = nullptr;
+		bool IsResolved = false;		// Emulated surface holds the multisample data for ResolvedRect
+		RECT ResolvedRect = {};
+		DWORD Generation = 0;			// Device surface generation when the data was resolved
 	} Emu;
 
 	m_IDirect3DSurface9* m_GetNonMultiSampledSurface(const RECT* pSurfaceRect, DWORD Flags);
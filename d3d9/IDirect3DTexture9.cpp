@@ -174,6 +174,14 @@ HRESULT m_IDirect3DTexture9::GetSurfaceLevel(THIS_ UINT Level, IDirect3DSurface9
 
 	if (SUCCEEDED(hr) && ppSurfaceLevel)
 	{
+		// Writes through the surface cannot be seen here, so stop tracking this texture
+		if (Level == 0)
+		{
+			DirtyTracking.IsChecked = true;
+			DirtyTracking.IsEnabled = false;
+			DirtyTracking.Shadow.clear();
+		}
+
 		*ppSurfaceLevel = m_pDeviceEx->GetLookupTable()->FindAddress<m_IDirect3DSurface9, m_IDirect3DDevice9Ex, LPVOID>(*ppSurfaceLevel, m_pDeviceEx, IID_IDirect3DSurface9, nullptr);
 	}
 
@@ -184,6 +192,46 @@ HRESULT m_IDirect3DTexture9::LockRect(THIS_ UINT Level, D3DLOCKED_RECT* pLockedR
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	if (Config.EnableTextureDirtyTracking && Level == 0 && !DirtyTracking.IsLocked && CheckDirtyTracking())
+	{
+		// Partial locks are uploaded by the runtime, the shadow no longer matches after them
+		if (pRect || (Flags & (D3DLOCK_READONLY | D3DLOCK_NO_DIRTY_UPDATE)))
+		{
+			if (!(Flags & D3DLOCK_READONLY))
+			{
+				DirtyTracking.Shadow.clear();
+			}
+			return ProxyInterface->LockRect(Level, pLockedRect, pRect, Flags);
+		}
+
+		HRESULT hr = ProxyInterface->LockRect(Level, pLockedRect, nullptr, Flags | D3DLOCK_NO_DIRTY_UPDATE);
+
+		if (SUCCEEDED(hr) && pLockedRect && pLockedRect->pBits && pLockedRect->Pitch > 0)
+		{
+			const size_t Size = (size_t)pLockedRect->Pitch * ((DirtyTracking.Height + DirtyTracking.BlockHeight - 1) / DirtyTracking.BlockHeight);
+
+			// First lock or the shadow was invalidated, the runtime copy is current at this point
+			if (DirtyTracking.Shadow.size() != Size || DirtyTracking.Pitch != pLockedRect->Pitch)
+			{
+				DirtyTracking.Shadow.assign((BYTE*)pLockedRect->pBits, (BYTE*)pLockedRect->pBits + Size);
+				DirtyTracking.Pitch = pLockedRect->Pitch;
+			}
+
+			DirtyTracking.pBits = (BYTE*)pLockedRect->pBits;
+			DirtyTracking.IsLocked = true;
+		}
+		else if (SUCCEEDED(hr))
+		{
+			// Cannot diff this lock, mark the whole level dirty
+			ProxyInterface->AddDirtyRect(nullptr);
+			DirtyTracking.Shadow.clear();
+		}
+
+		return hr;
+	}
+
 	return ProxyInterface->LockRect(Level, pLockedRect, pRect, Flags);
 }
 
@@ -191,6 +239,16 @@ HRESULT m_IDirect3DTexture9::UnlockRect(THIS_ UINT Level)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	if (Level == 0 && DirtyTracking.IsLocked)
+	{
+		AddChangedRows();
+
+		DirtyTracking.IsLocked = false;
+		DirtyTracking.pBits = nullptr;
+	}
+
 	return ProxyInterface->UnlockRect(Level);
 }
 
@@ -200,3 +258,45 @@ HRESULT m_IDirect3DTexture9::AddDirtyRect(THIS_ CONST RECT* pDirtyRect)
 
 	return ProxyInterface->AddDirtyRect(pDirtyRect);
 }
+
+// Dirty tracking is only useful for managed textures, other pools have no runtime copy to upload from
+bool m_IDirect3DTexture9::CheckDirtyTracking()
+{
+	if (!DirtyTracking.IsChecked)
+	{
+		DirtyTracking.IsChecked = true;
+
+		D3DSURFACE_DESC Desc = {};
+		if (SUCCEEDED(ProxyInterface->GetLevelDesc(0, &Desc)) && Desc.Pool == D3DPOOL_MANAGED && Desc.Width && Desc.Height)
+		{
+			const bool IsDXT = (Desc.Format == D3DFMT_DXT1 || Desc.Format == D3DFMT_DXT2 || Desc.Format == D3DFMT_DXT3 ||
+				Desc.Format == D3DFMT_DXT4 || Desc.Format == D3DFMT_DXT5);
+
+			// Skip other FourCC formats since their row layout is unknown
+			if (IsDXT || !((DWORD)Desc.Format & 0xFF000000))
+			{
+				DirtyTracking.IsEnabled = true;
+				DirtyTracking.Width = Desc.Width;
+				DirtyTracking.Height = Desc.Height;
+				DirtyTracking.BlockHeight = IsDXT ? 4 : 1;
+			}
+		}
+	}
+
+	return DirtyTracking.IsEnabled;
+}
+
+// Compares the locked data with the shadow copy and marks the changed row ranges dirty
+void m_IDirect3DTexture9::AddChangedRows()
+{
+	// Nearby ranges are merged to keep the number of dirty rects low
+	constexpr UINT MergeGap = 8;
+
+	const UINT Rows = (DirtyTracking.Height + DirtyTracking.BlockHeight - 1) / DirtyTracking.BlockHeight;
+
+	DiffDirtyRows(DirtyTracking.Shadow.data(), DirtyTracking.pBits, DirtyTracking.Pitch, Rows, MergeGap, [&](UINT Start, UINT End)
+	{
+		RECT Rect = { 0, (LONG)(Start * DirtyTracking.BlockHeight), (LONG)DirtyTracking.Width, (LONG)min(End * DirtyTracking.BlockHeight, DirtyTracking.Height) };
+		ProxyInterface->AddDirtyRect(&Rect);
+	});
+}
@@ -7,6 +7,22 @@ private:
 	m_IDirect3DDevice9Ex* m_pDeviceEx;
 	REFIID WrapperID = IID_IDirect3DTexture9;
 
+	// Shadow copy of level 0 used to find the rows changed by whole-texture locks
+	struct {
+		bool IsChecked = false;
+		bool IsEnabled = false;
+		bool IsLocked = false;
+		UINT Width = 0;
+		UINT Height = 0;
+		UINT BlockHeight = 1;
+		INT Pitch = 0;
+		BYTE* pBits = nullptr;
+		std::vector<BYTE> Shadow;
+	} DirtyTracking;
+
+	bool CheckDirtyTracking();
+	void AddChangedRows();
+
 public:
 	m_IDirect3DTexture9(LPDIRECT3DTEXTURE9 pTexture9, m_IDirect3DDevice9Ex* pDevice) : ProxyInterface(pTexture9), m_pDeviceEx(pDevice)
 	{
@@ -121,6 +121,21 @@ HRESULT m_IDirect3DVertexBuffer9::Lock(THIS_ UINT OffsetToLock, UINT SizeToLock,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	if (Config.ForceDynamicBufferLockFlags)
+	{
+		if (!DynamicLock.IsChecked)
+		{
+			D3DVERTEXBUFFER_DESC Desc = {};
+			if (SUCCEEDED(ProxyInterface->GetDesc(&Desc)))
+			{
+				DynamicLock.SetDesc(Desc.Usage, Desc.Size);
+			}
+		}
+		Flags = DynamicLock.PromoteFlags(OffsetToLock, SizeToLock, Flags);
+	}
+
 	return ProxyInterface->Lock(OffsetToLock, SizeToLock, ppbData, Flags);
 }
 
@@ -128,6 +143,8 @@ HRESULT m_IDirect3DVertexBuffer9::Unlock(THIS)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	return ProxyInterface->Unlock();
 }
 
@@ -5,6 +5,7 @@ class m_IDirect3DVertexBuffer9 : public IDirect3DVertexBuffer9, public AddressLo
 private:
 	LPDIRECT3DVERTEXBUFFER9 ProxyInterface;
 	m_IDirect3DDevice9Ex* m_pDeviceEx;
+	DYNAMICBUFFERLOCK DynamicLock;
 	REFIID WrapperID = IID_IDirect3DVertexBuffer9;
 
 public:
@@ -17,6 +18,8 @@ public:
 	~m_IDirect3DVertexBuffer9()
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
+
+		DynamicLock.LogStats(this);
 	}
 
 	/*** IUnknown methods ***/
@@ -0,0 +1,53 @@
+#pragma once
+
+// Backs off tight GetData polling loops. Spins while the result is expected soon and yields the rest of the time slice
+// otherwise, including when the query is overdue. It never sleeps, Sleep(1) at the default timer resolution can block
+// for a whole frame after the result is already available.
+struct QUERYBACKOFF
+{
+	enum ACTION { NONE, SPIN, YIELD };
+
+	LONGLONG IssueTicks = 0;
+	LONGLONG LatencyTicks = 0;		// Running average of Issue to S_OK time
+	DWORD PollCount = 0;
+	LONGLONG WaitTicks = 0;			// Total time spent yielding instead of spinning
+	DWORD WaitCount = 0;
+
+	void OnIssue(LONGLONG Now)
+	{
+		IssueTicks = Now;
+		PollCount = 0;
+	}
+
+	// Updates the expected latency of this query once the result is available
+	void OnComplete(LONGLONG Now, bool IsDataReady)
+	{
+		if (IsDataReady && IssueTicks)
+		{
+			const LONGLONG Latency = Now - IssueTicks;
+			LatencyTicks = (LatencyTicks) ? (LatencyTicks * 7 + Latency) / 8 : Latency;
+		}
+		IssueTicks = 0;
+	}
+
+	// Picks how to wait after a poll that found the result not ready yet
+	ACTION OnPending(LONGLONG Now, DWORD PollThreshold, LONGLONG TicksPerMS)
+	{
+		if (!IssueTicks || ++PollCount <= PollThreshold)
+		{
+			return NONE;
+		}
+
+		// Without a latency estimate only yield once the wait is already long
+		const LONGLONG Elapsed = Now - IssueTicks;
+		const LONGLONG Expected = (LatencyTicks) ? LatencyTicks : TicksPerMS * 2;
+
+		return (Elapsed < Expected && Expected - Elapsed < TicksPerMS * 4) ? SPIN : YIELD;
+	}
+
+	void AddWait(LONGLONG Ticks)
+	{
+		WaitTicks += Ticks;
+		WaitCount++;
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+// Shadow copy of a device state, the value is only valid once it was set or read from the device
+template <typename T>
+struct SHADOWSTATE
+{
+	bool IsSet = false;
+	T Value = {};
+
+	// Gets the tracked value, Read is only called the first time to fetch the value from the device
+	template <typename F>
+	bool Get(T& Out, F Read)
+	{
+		if (!IsSet)
+		{
+			if (!Read(Value))
+			{
+				return false;
+			}
+			IsSet = true;
+		}
+		Out = Value;
+		return true;
+	}
+};
+
+// Saves the game value of a state and sets the overlay value. The Set call is skipped when the state already has the
+// overlay value, and a state that cannot be read is left as it is so it is never restored with a made up value.
+template <typename T, typename GET, typename SET>
+void BackupShadowState(SHADOWSTATE<T>& Backup, const T& NewValue, GET Get, SET Set)
+{
+	Backup.IsSet = Get(Backup.Value);
+	if (Backup.IsSet && !(Backup.Value == NewValue))
+	{
+		Set(NewValue);
+	}
+}
+
+// Sets the saved game value of a state again if the current value differs
+template <typename T, typename GET, typename SET>
+void RestoreShadowState(const SHADOWSTATE<T>& Backup, GET Get, SET Set)
+{
+	T Value = {};
+	if (Backup.IsSet && Get(Value) && !(Value == Backup.Value))
+	{
+		Set(Backup.Value);
+	}
+}
+
+// Sets a state unless the shadow state shows it already has the value, a state that cannot be read is always set
+template <typename T, typename GET, typename SET>
+void ApplyShadowState(const T& NewValue, GET Get, SET Set)
+{
+	T Value = {};
+	if (!Get(Value) || !(Value == NewValue))
+	{
+		Set(NewValue);
+	}
+}
+
+// Recorded value of an indexed state
+struct STATEVALUE
+{
+	DWORD Index;
+	DWORD Value;
+};
+
+// Sets a state in a sparse list, a state that is set again keeps its place in the list
+inline void SetStateValue(std::vector<STATEVALUE>& List, DWORD Index, DWORD Value)
+{
+	for (auto& Entry : List)
+	{
+		if (Entry.Index == Index)
+		{
+			Entry.Value = Value;
+			return;
+		}
+	}
+	List.push_back({ Index, Value });
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Number of vertices, or indices for indexed draws, used by a primitive list
+inline UINT GetUPVertexCount(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount)
+{
+	if (!PrimitiveCount)
+	{
+		return 0;
+	}
+
+	switch (PrimitiveType)
+	{
+	case D3DPT_POINTLIST:
+		return PrimitiveCount;
+	case D3DPT_LINELIST:
+		return PrimitiveCount * 2;
+	case D3DPT_LINESTRIP:
+		return PrimitiveCount + 1;
+	case D3DPT_TRIANGLELIST:
+		return PrimitiveCount * 3;
+	case D3DPT_TRIANGLESTRIP:
+	case D3DPT_TRIANGLEFAN:
+		return PrimitiveCount + 2;
+	default:
+		return 0;
+	}
+}
+
+// Append position in a dynamic buffer used for UP draws. Data is appended with NOOVERWRITE locks, the buffer is
+// discarded and filled from the start once the next draw no longer fits.
+struct UPRINGBUFFER
+{
+	UINT BufferSize = 0;
+	UINT Offset = 0;
+	ULONGLONG MaxCount = ~0ULL;		// Number of elements the device can address from the start of the buffer
+
+	// Starts with a full buffer so the first lock discards
+	void Reset(UINT Size, ULONGLONG Count = ~0ULL)
+	{
+		BufferSize = Size;
+		Offset = Size;
+		MaxCount = Count;
+	}
+
+	// Gets the lock offset and flags for Size bytes, the offset is aligned to Stride so it can be used as the start element
+	bool Append(UINT Size, UINT Stride, UINT& LockOffset, DWORD& Flags)
+	{
+		if (!Size || !Stride || Size > BufferSize || Size / Stride > MaxCount)
+		{
+			return false;
+		}
+
+		LockOffset = (Offset + Stride - 1) / Stride * Stride;
+		Flags = D3DLOCK_NOOVERWRITE;
+		if (LockOffset > BufferSize - Size || (LockOffset + Size) / Stride > MaxCount)
+		{
+			LockOffset = 0;
+			Flags = D3DLOCK_DISCARD;
+		}
+		Offset = LockOffset + Size;
+
+		return true;
+	}
+
+	// The lock failed, the next append discards since the GPU may still use any part of the buffer
+	void Invalidate()
+	{
+		Offset = BufferSize;
+	}
+};
@@ -85,6 +85,12 @@ struct D3DDISPLAYMODEEX_CONVERT : public D3DDISPLAYMODEEX {
 	}
 };
 
+#include "DynamicBufferLock.h"
+#include "QueryBackOff.h"
+#include "ShadowState.h"
+#include "DirtyRows.h"
+#include "UPDrawBuffer.h"
+
 typedef int(WINAPI* D3DPERF_BeginEventProc)(D3DCOLOR, LPCWSTR);
 typedef int(WINAPI* D3DPERF_EndEventProc)();
 typedef DWORD(WINAPI* D3DPERF_GetStatusProc)();
@@ -0,0 +1,32 @@
+#pragma once
+
+// Groups BltBatch entries that can be copied without going through Blt for each entry. Only adjacent entries are
+// grouped, reordering by source would change the result where sprites overlap.
+namespace BltBatchRun
+{
+	// Plain copies, optionally color keyed
+	constexpr DWORD CopyFlags = DDBLT_WAIT | DDBLT_ASYNC | DDBLT_KEYSRC | DDBLT_KEYDEST;
+
+	// Number of entries at the start of the batch that are plain copies from the same source surface with the same flags
+	inline DWORD GetCopyRunLength(const DDBLTBATCH* lpDDBltBatch, DWORD dwCount)
+	{
+		if (!dwCount)
+		{
+			return 0;
+		}
+
+		const LPDIRECTDRAWSURFACE lpDDSrcSurface = lpDDBltBatch[0].lpDDSSrc;
+		const DWORD dwFlags = lpDDBltBatch[0].dwFlags;
+		if (!lpDDSrcSurface || (dwFlags & ~CopyFlags))
+		{
+			return 0;
+		}
+
+		DWORD Count = 1;
+		while (Count < dwCount && lpDDBltBatch[Count].lpDDSSrc == lpDDSrcSurface && lpDDBltBatch[Count].dwFlags == dwFlags)
+		{
+			Count++;
+		}
+		return Count;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Decides when the resources of a MipMap chain get created. With deferring the texture starts with only the top level
+// and is replaced by one with the whole chain the first time a lower level is used. Emulated DC memory of a level is
+// created on the first GetDC of that level.
+namespace DeferredMipMap
+{
+	// Direct3D9 generated levels and textures in the default pool are always created with the whole chain
+	inline bool ShouldDefer(bool IsEnabled, bool IsAutoGen, DWORD LevelCount, bool IsDefaultPool)
+	{
+		return (IsEnabled && !IsAutoGen && LevelCount > 1 && !IsDefaultPool);
+	}
+
+	// Number of levels to create the texture with
+	inline DWORD GetCreateLevelCount(bool IsDeferred, DWORD LevelCount)
+	{
+		return (IsDeferred) ? 1 : LevelCount;
+	}
+
+	// Any level below the top one needs the whole chain
+	inline bool IsChainRequired(bool IsDeferred, DWORD MipMapLevel)
+	{
+		return (IsDeferred && MipMapLevel);
+	}
+
+	// The texture cannot be replaced while the top level is locked or in a DC
+	inline bool CanCreateChain(bool IsLocked, bool IsInDC)
+	{
+		return (!IsLocked && !IsInDC);
+	}
+
+	// Size of a level, which is never smaller than one pixel
+	inline DWORD GetLevelSize(DWORD Size, DWORD MipMapLevel)
+	{
+		return (MipMapLevel < 32) ? max(1UL, (DWORD)(Size >> MipMapLevel)) : 1;
+	}
+
+	// Levels without their own Direct3D9 surface, or on an emulated surface, get their DC from emulated memory
+	inline bool IsDCEmulated(bool IsUsingEmulation, bool DCRequiresEmulation, bool IsDummyLevel)
+	{
+		return (IsUsingEmulation || DCRequiresEmulation || IsDummyLevel);
+	}
+}
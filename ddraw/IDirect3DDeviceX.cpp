@@ -475,6 +475,8 @@ HRESULT m_IDirect3DDeviceX::Execute(LPDIRECT3DEXECUTEBUFFER lpDirect3DExecuteBuf
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (ProxyDirectXVersion != 1)
 	{
 		if (!lpDirect3DExecuteBuffer || !lpDirect3DViewport)
@@ -715,6 +717,7 @@ HRESULT m_IDirect3DDeviceX::Execute(LPDIRECT3DEXECUTEBUFFER lpDirect3DExecuteBuf
 
 				for (DWORD i = 0; i < instruction->wCount; i++)
 				{
+					AddStateStats();
 					SetRenderState(state[i].drstRenderStateType, state[i].dwArg[0]);
 				}
 
@@ -1048,6 +1051,10 @@ HRESULT m_IDirect3DDeviceX::SetTransform(D3DTRANSFORMSTATETYPE dtstTransformStat
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpD3DMatrix)
@@ -1594,6 +1601,10 @@ HRESULT m_IDirect3DDeviceX::SetTexture(DWORD dwStage, LPDIRECT3DTEXTURE2 lpTextu
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (ProxyDirectXVersion > 3)
 	{
 		if (dwStage >= MaxTextureStages)
@@ -1636,6 +1647,10 @@ HRESULT m_IDirect3DDeviceX::SetTexture(DWORD dwStage, LPDIRECTDRAWSURFACE7 lpSur
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (dwStage >= MaxTextureStages)
@@ -1683,6 +1698,10 @@ HRESULT m_IDirect3DDeviceX::SetTexture(DWORD dwStage, LPDIRECTDRAWSURFACE7 lpSur
 
 		if (SUCCEEDED(hr))
 		{
+			if (AttachedTexture[dwStage] != lpSurface)
+			{
+				FrameStats.TextureChanges++;
+			}
 			AttachedTexture[dwStage] = lpSurface;
 			CurrentTextureSurfaceX[dwStage] = lpDDSrcSurfaceX;
 		}
@@ -1702,6 +1721,8 @@ HRESULT m_IDirect3DDeviceX::SetRenderTarget(LPDIRECTDRAWSURFACE7 lpNewRenderTarg
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpNewRenderTarget)
@@ -1929,6 +1950,10 @@ HRESULT m_IDirect3DDeviceX::SetTextureStageState(DWORD dwStage, D3DTEXTURESTAGES
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (dwStage >= MaxTextureStages)
@@ -2105,6 +2130,19 @@ HRESULT m_IDirect3DDeviceX::GetStats(LPD3DSTATS lpD3DStats, DWORD DirectXVersion
 		return GetProxyInterfaceV3()->GetStats(lpD3DStats);
 	default:
 
+		if (Config.Dd7to9 && DirectXVersion < 3)
+		{
+			if (!lpD3DStats || lpD3DStats->dwSize != sizeof(D3DSTATS))
+			{
+				return DDERR_INVALIDPARAMS;
+			}
+
+			*lpD3DStats = TotalStats;
+			lpD3DStats->dwSize = sizeof(D3DSTATS);
+
+			return D3D_OK;
+		}
+
 		if (DirectXVersion == 3)
 		{
 			// The method returns E_NOTIMPL / DDERR_UNSUPPORTED.
@@ -2304,6 +2342,8 @@ HRESULT m_IDirect3DDeviceX::SetCurrentViewport(LPDIRECT3DVIEWPORT3 lpd3dViewport
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9 || ProxyDirectXVersion == 7)
 	{
 		// Before calling this method, applications must have already called the AddViewport method to add the viewport to the device.
@@ -2420,6 +2460,8 @@ HRESULT m_IDirect3DDeviceX::SetViewport(LPD3DVIEWPORT7 lpViewport)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpViewport)
@@ -2473,14 +2515,13 @@ HRESULT m_IDirect3DDeviceX::GetViewport(LPD3DVIEWPORT7 lpViewport)
 	return GetProxyInterfaceV7()->GetViewport(lpViewport);
 }
 
-HRESULT m_IDirect3DDeviceX::Begin(D3DPRIMITIVETYPE d3dpt, DWORD d3dvt, DWORD dwFlags)
+HRESULT m_IDirect3DDeviceX::Begin(D3DPRIMITIVETYPE d3dpt, DWORD d3dvt, DWORD dwFlags, DWORD DirectXVersion)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
 	if (ProxyDirectXVersion > 3)
 	{
-		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
-		return DDERR_UNSUPPORTED;
+		return BeginImmediateBatch(d3dpt, d3dvt, nullptr, 0, dwFlags, DirectXVersion);
 	}
 
 	switch (ProxyDirectXVersion)
@@ -2495,14 +2536,18 @@ HRESULT m_IDirect3DDeviceX::Begin(D3DPRIMITIVETYPE d3dpt, DWORD d3dvt, DWORD dwF
 	}
 }
 
-HRESULT m_IDirect3DDeviceX::BeginIndexed(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dvtVertexType, LPVOID lpvVertices, DWORD dwNumVertices, DWORD dwFlags)
+HRESULT m_IDirect3DDeviceX::BeginIndexed(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dvtVertexType, LPVOID lpvVertices, DWORD dwNumVertices, DWORD dwFlags, DWORD DirectXVersion)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
 	if (ProxyDirectXVersion > 3)
 	{
-		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
-		return DDERR_UNSUPPORTED;
+		if (!lpvVertices || !dwNumVertices)
+		{
+			return DDERR_INVALIDPARAMS;
+		}
+
+		return BeginImmediateBatch(dptPrimitiveType, dvtVertexType, lpvVertices, dwNumVertices, dwFlags, DirectXVersion);
 	}
 
 	switch (ProxyDirectXVersion)
@@ -2523,8 +2568,34 @@ HRESULT m_IDirect3DDeviceX::Vertex(LPVOID lpVertexType)
 
 	if (ProxyDirectXVersion > 3)
 	{
-		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
-		return DDERR_UNSUPPORTED;
+		if (!lpVertexType)
+		{
+			return DDERR_INVALIDPARAMS;
+		}
+
+		if (!ImmediateBatch.IsInBegin || ImmediateBatch.IsIndexed)
+		{
+			return D3DERR_NOTINBEGIN;
+		}
+
+		// Draw what was collected so far once the batch is full, lists split between primitives and
+		// strips split after an even vertex count so the winding order stays the same
+		const DWORD VertexCount = (DWORD)(ImmediateBatch.Vertices.size() / ImmediateBatch.Stride);
+		if (VertexCount + 3 > MaxImmediateBatchVertices &&
+			VertexCount % ((ImmediateBatch.PrimitiveType == D3DPT_TRIANGLELIST) ? 3 :
+				(ImmediateBatch.PrimitiveType == D3DPT_LINELIST || ImmediateBatch.PrimitiveType == D3DPT_TRIANGLESTRIP) ? 2 : 1) == 0)
+		{
+			HRESULT hr = SplitImmediateBatch();
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+		}
+
+		const BYTE* pVertex = (const BYTE*)lpVertexType;
+		ImmediateBatch.Vertices.insert(ImmediateBatch.Vertices.end(), pVertex, pVertex + ImmediateBatch.Stride);
+
+		return D3D_OK;
 	}
 
 	switch (ProxyDirectXVersion)
@@ -2545,8 +2616,19 @@ HRESULT m_IDirect3DDeviceX::Index(WORD wVertexIndex)
 
 	if (ProxyDirectXVersion > 3)
 	{
-		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
-		return DDERR_UNSUPPORTED;
+		if (!ImmediateBatch.IsInBegin || !ImmediateBatch.IsIndexed)
+		{
+			return D3DERR_NOTINBEGIN;
+		}
+
+		if (wVertexIndex >= ImmediateBatch.SegmentVertexCount)
+		{
+			return DDERR_INVALIDPARAMS;
+		}
+
+		ImmediateBatch.Indices.push_back((WORD)(ImmediateBatch.SegmentBaseVertex + wVertexIndex));
+
+		return D3D_OK;
 	}
 
 	switch (ProxyDirectXVersion)
@@ -2567,8 +2649,36 @@ HRESULT m_IDirect3DDeviceX::End(DWORD dwFlags)
 
 	if (ProxyDirectXVersion > 3)
 	{
-		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
-		return DDERR_UNSUPPORTED;
+		if (!ImmediateBatch.IsInBegin)
+		{
+			return D3DERR_NOTINBEGIN;
+		}
+
+		// dwFlags is reserved for End, the draw flags given to Begin are kept with the batch
+		ImmediateBatch.IsInBegin = false;
+
+		// Drop any trailing partial primitive so the next segment can be appended to a list
+		const DWORD PrimitiveSize =
+			(ImmediateBatch.PrimitiveType == D3DPT_TRIANGLELIST) ? 3 :
+			(ImmediateBatch.PrimitiveType == D3DPT_LINELIST) ? 2 : 1;
+		if (ImmediateBatch.IsIndexed)
+		{
+			const size_t SegmentCount = ImmediateBatch.Indices.size() - ImmediateBatch.SegmentStart;
+			ImmediateBatch.Indices.resize(ImmediateBatch.Indices.size() - SegmentCount % PrimitiveSize);
+		}
+		else
+		{
+			const size_t SegmentCount = (ImmediateBatch.Vertices.size() - ImmediateBatch.SegmentStart) / ImmediateBatch.Stride;
+			ImmediateBatch.Vertices.resize(ImmediateBatch.Vertices.size() - (SegmentCount % PrimitiveSize) * ImmediateBatch.Stride);
+		}
+
+		// Strips and fans cannot be joined so they are drawn right away
+		if (ImmediateBatch.PrimitiveType != D3DPT_POINTLIST && ImmediateBatch.PrimitiveType != D3DPT_LINELIST && ImmediateBatch.PrimitiveType != D3DPT_TRIANGLELIST)
+		{
+			return FlushImmediateBatch();
+		}
+
+		return D3D_OK;
 	}
 
 	switch (ProxyDirectXVersion)
@@ -2583,10 +2693,150 @@ HRESULT m_IDirect3DDeviceX::End(DWORD dwFlags)
 	}
 }
 
+// Starts a new Begin/End segment, appending it to the pending batch when the draw can be joined
+HRESULT m_IDirect3DDeviceX::BeginImmediateBatch(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwVertexTypeDesc, LPVOID lpVertices, DWORD dwVertexCount, DWORD dwFlags, DWORD DirectXVersion)
+{
+	if (ImmediateBatch.IsInBegin)
+	{
+		return D3DERR_INBEGIN;
+	}
+
+	DWORD FVF = dwVertexTypeDesc;
+	if (DirectXVersion == 2)
+	{
+		if (dwVertexTypeDesc != D3DVT_VERTEX && dwVertexTypeDesc != D3DVT_LVERTEX && dwVertexTypeDesc != D3DVT_TLVERTEX)
+		{
+			LOG_LIMIT(100, __FUNCTION__ << " Error: invalid Vertex type: " << dwVertexTypeDesc);
+			return D3DERR_INVALIDVERTEXTYPE;
+		}
+		FVF = ConvertVertexTypeToFVF((D3DVERTEXTYPE)dwVertexTypeDesc);
+	}
+	const UINT Stride = GetVertexStride(FVF);
+	if (!Stride)
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: invalid FVF type: " << Logging::hex(FVF));
+		return D3DERR_INVALIDVERTEXTYPE;
+	}
+
+	const bool IsIndexed = (lpVertices != nullptr);
+	const DWORD PendingVertexCount = (ImmediateBatch.Stride) ? (DWORD)(ImmediateBatch.Vertices.size() / ImmediateBatch.Stride) : 0;
+
+	if (ImmediateBatch.PrimitiveType != dptPrimitiveType ||
+		ImmediateBatch.VertexTypeDesc != dwVertexTypeDesc ||
+		ImmediateBatch.Flags != dwFlags ||
+		ImmediateBatch.DirectXVersion != DirectXVersion ||
+		ImmediateBatch.IsIndexed != IsIndexed ||
+		PendingVertexCount + dwVertexCount > MaxImmediateBatchVertices)
+	{
+		HRESULT hr = FlushImmediateBatch();
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+
+	ImmediateBatch.IsInBegin = true;
+	ImmediateBatch.IsIndexed = IsIndexed;
+	ImmediateBatch.PrimitiveType = dptPrimitiveType;
+	ImmediateBatch.VertexTypeDesc = dwVertexTypeDesc;
+	ImmediateBatch.Flags = dwFlags;
+	ImmediateBatch.DirectXVersion = DirectXVersion;
+	ImmediateBatch.Stride = Stride;
+
+	if (IsIndexed)
+	{
+		ImmediateBatch.SegmentStart = ImmediateBatch.Indices.size();
+		ImmediateBatch.SegmentBaseVertex = (DWORD)(ImmediateBatch.Vertices.size() / Stride);
+		ImmediateBatch.SegmentVertexCount = dwVertexCount;
+		ImmediateBatch.Vertices.insert(ImmediateBatch.Vertices.end(), (BYTE*)lpVertices, (BYTE*)lpVertices + dwVertexCount * Stride);
+	}
+	else
+	{
+		ImmediateBatch.SegmentStart = ImmediateBatch.Vertices.size();
+	}
+
+	return D3D_OK;
+}
+
+// Draws the vertices collected by Begin/Vertex/End as one primitive call
+HRESULT m_IDirect3DDeviceX::FlushImmediateBatch()
+{
+	if (ImmediateBatch.Vertices.empty() || ImmediateBatch.IsInBegin)
+	{
+		return D3D_OK;
+	}
+
+	// Clear the batch before drawing, the draw calls below flush the batch again
+	std::vector<BYTE> Vertices;
+	std::vector<WORD> Indices;
+	Vertices.swap(ImmediateBatch.Vertices);
+	Indices.swap(ImmediateBatch.Indices);
+
+	const DWORD VertexCount = (DWORD)(Vertices.size() / ImmediateBatch.Stride);
+
+	HRESULT hr = D3D_OK;
+	if (ImmediateBatch.IsIndexed)
+	{
+		if (!Indices.empty())
+		{
+			hr = DrawIndexedPrimitive(ImmediateBatch.PrimitiveType, ImmediateBatch.VertexTypeDesc, Vertices.data(), VertexCount,
+				Indices.data(), (DWORD)Indices.size(), ImmediateBatch.Flags, ImmediateBatch.DirectXVersion);
+		}
+	}
+	else if (VertexCount)
+	{
+		hr = DrawPrimitive(ImmediateBatch.PrimitiveType, ImmediateBatch.VertexTypeDesc, Vertices.data(), VertexCount,
+			ImmediateBatch.Flags, ImmediateBatch.DirectXVersion);
+	}
+
+	// Keep the allocations for the next batch
+	Vertices.clear();
+	Indices.clear();
+	ImmediateBatch.Vertices.swap(Vertices);
+	ImmediateBatch.Indices.swap(Indices);
+
+	return hr;
+}
+
+// Draws the vertices of an open Begin/End segment and carries over the vertices the rest of a strip or fan connects to
+HRESULT m_IDirect3DDeviceX::SplitImmediateBatch()
+{
+	const UINT Stride = ImmediateBatch.Stride;
+	const std::vector<BYTE>& Vertices = ImmediateBatch.Vertices;
+
+	std::vector<BYTE> Carry;
+	switch (ImmediateBatch.PrimitiveType)
+	{
+	case D3DPT_LINESTRIP:
+		Carry.assign(Vertices.end() - Stride, Vertices.end());
+		break;
+	case D3DPT_TRIANGLESTRIP:
+		Carry.assign(Vertices.end() - Stride * 2, Vertices.end());
+		break;
+	case D3DPT_TRIANGLEFAN:
+		Carry.assign(Vertices.begin(), Vertices.begin() + Stride);
+		Carry.insert(Carry.end(), Vertices.end() - Stride, Vertices.end());
+		break;
+	default:
+		break;
+	}
+
+	ImmediateBatch.IsInBegin = false;
+	HRESULT hr = FlushImmediateBatch();
+	ImmediateBatch.IsInBegin = true;
+
+	ImmediateBatch.SegmentStart = 0;
+	ImmediateBatch.Vertices.insert(ImmediateBatch.Vertices.end(), Carry.begin(), Carry.end());
+
+	return hr;
+}
+
 HRESULT m_IDirect3DDeviceX::BeginScene()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -2634,6 +2884,10 @@ HRESULT m_IDirect3DDeviceX::EndScene()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -2651,6 +2905,8 @@ HRESULT m_IDirect3DDeviceX::EndScene()
 		{
 			IsInScene = false;
 
+			EndFrameStats();
+
 #ifdef ENABLE_PROFILING
 			Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(sceneTime);
 #endif
@@ -2684,6 +2940,8 @@ HRESULT m_IDirect3DDeviceX::Clear(DWORD dwCount, LPD3DRECT lpRects, DWORD dwFlag
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -2838,6 +3096,8 @@ HRESULT m_IDirect3DDeviceX::SetLightState(D3DLIGHTSTATETYPE dwLightStateType, DW
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (ProxyDirectXVersion > 3)
 	{
 		DWORD RenderState = 0;
@@ -2963,6 +3223,8 @@ HRESULT m_IDirect3DDeviceX::SetLight(m_IDirect3DLight* lpLightInterface, LPD3DLI
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (!lpLightInterface || !lpLight || (lpLight->dwSize != sizeof(D3DLIGHT) && lpLight->dwSize != sizeof(D3DLIGHT2)))
 	{
 		return DDERR_INVALIDPARAMS;
@@ -3039,6 +3301,8 @@ HRESULT m_IDirect3DDeviceX::SetLight(DWORD dwLightIndex, LPD3DLIGHT7 lpLight)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpLight)
@@ -3116,6 +3380,8 @@ HRESULT m_IDirect3DDeviceX::LightEnable(DWORD dwLightIndex, BOOL bEnable)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -3196,6 +3462,8 @@ HRESULT m_IDirect3DDeviceX::MultiplyTransform(D3DTRANSFORMSTATETYPE dtstTransfor
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -3274,6 +3542,8 @@ HRESULT m_IDirect3DDeviceX::SetMaterial(LPD3DMATERIAL lpMaterial)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (!lpMaterial)
 	{
 		return DDERR_INVALIDPARAMS;
@@ -3308,6 +3578,8 @@ HRESULT m_IDirect3DDeviceX::SetMaterial(LPD3DMATERIAL7 lpMaterial)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpMaterial)
@@ -3354,6 +3626,10 @@ HRESULT m_IDirect3DDeviceX::SetRenderState(D3DRENDERSTATETYPE dwRenderStateType,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ") " << dwRenderStateType << " " << dwRenderState;
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -3993,13 +4269,11 @@ HRESULT m_IDirect3DDeviceX::EndStateBlock(LPDWORD lpdwBlockHandle)
 
 HRESULT m_IDirect3DDeviceX::DrawPrimitive(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwVertexTypeDesc, LPVOID lpVertices, DWORD dwVertexCount, DWORD dwFlags, DWORD DirectXVersion)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
-		" VertexType = " << Logging::hex(dptPrimitiveType) <<
-		" VertexDesc = " << Logging::hex(dwVertexTypeDesc) <<
-		" Vertices = " << lpVertices <<
-		" VertexCount = " << dwVertexCount <<
-		" Flags = " << Logging::hex(dwFlags) <<
-		" Version = " << DirectXVersion;
+	LOG_TRACE(this, dptPrimitiveType, dwVertexTypeDesc, lpVertices, dwVertexCount, dwFlags, DirectXVersion);
+
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
 
 	if (DirectXVersion == 2 && ProxyDirectXVersion > 2)
 	{
@@ -4053,6 +4327,10 @@ HRESULT m_IDirect3DDeviceX::DrawPrimitive(D3DPRIMITIVETYPE dptPrimitiveType, DWO
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: 'DrawPrimitiveUP' call failed: " << (D3DERR)hr);
 		}
+		else
+		{
+			AddDrawStats(dptPrimitiveType, GetNumberOfPrimitives(dptPrimitiveType, dwVertexCount), dwVertexCount);
+		}
 
 #ifdef ENABLE_PROFILING
 		Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(startTime);
@@ -4100,6 +4378,8 @@ HRESULT m_IDirect3DDeviceX::DrawPrimitiveStrided(D3DPRIMITIVETYPE dptPrimitiveTy
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
@@ -4145,6 +4425,10 @@ HRESULT m_IDirect3DDeviceX::DrawPrimitiveVB(D3DPRIMITIVETYPE dptPrimitiveType, L
 		" Flags = " << Logging::hex(dwFlags) <<
 		" Version = " << DirectXVersion;
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpd3dVertexBuffer)
@@ -4204,6 +4488,10 @@ HRESULT m_IDirect3DDeviceX::DrawPrimitiveVB(D3DPRIMITIVETYPE dptPrimitiveType, L
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: 'DrawPrimitive' call failed: " << (D3DERR)hr);
 		}
+		else
+		{
+			AddDrawStats(dptPrimitiveType, GetNumberOfPrimitives(dptPrimitiveType, dwNumVertices), dwNumVertices);
+		}
 
 #ifdef ENABLE_PROFILING
 		Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(startTime);
@@ -4254,15 +4542,11 @@ HRESULT m_IDirect3DDeviceX::DrawPrimitiveVB(D3DPRIMITIVETYPE dptPrimitiveType, L
 
 HRESULT m_IDirect3DDeviceX::DrawIndexedPrimitive(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwVertexTypeDesc, LPVOID lpVertices, DWORD dwVertexCount, LPWORD lpIndices, DWORD dwIndexCount, DWORD dwFlags, DWORD DirectXVersion)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
-		" VertexType = " << Logging::hex(dptPrimitiveType) <<
-		" VertexDesc = " << Logging::hex(dwVertexTypeDesc) <<
-		" Vertices = " << lpVertices <<
-		" VertexCount = " << dwVertexCount <<
-		" Indices = " << lpIndices <<
-		" IndexCount = " << dwIndexCount <<
-		" Flags = " << Logging::hex(dwFlags) <<
-		" Version = " << DirectXVersion;
+	LOG_TRACE(this, dptPrimitiveType, dwVertexTypeDesc, lpVertices, dwVertexCount, lpIndices, dwIndexCount, dwFlags, DirectXVersion);
+
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
 
 	if (DirectXVersion == 2 && ProxyDirectXVersion > 2)
 	{
@@ -4316,6 +4600,10 @@ HRESULT m_IDirect3DDeviceX::DrawIndexedPrimitive(D3DPRIMITIVETYPE dptPrimitiveTy
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: 'DrawIndexedPrimitiveUP' call failed: " << (D3DERR)hr);
 		}
+		else
+		{
+			AddDrawStats(dptPrimitiveType, GetNumberOfPrimitives(dptPrimitiveType, dwIndexCount), dwVertexCount);
+		}
 
 #ifdef ENABLE_PROFILING
 		Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(startTime);
@@ -4363,6 +4651,8 @@ HRESULT m_IDirect3DDeviceX::DrawIndexedPrimitiveStrided(D3DPRIMITIVETYPE dptPrim
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: Not Implemented");
@@ -4410,6 +4700,10 @@ HRESULT m_IDirect3DDeviceX::DrawIndexedPrimitiveVB(D3DPRIMITIVETYPE dptPrimitive
 		" Flags = " << Logging::hex(dwFlags) <<
 		" Version = " << DirectXVersion;
 
+	FlushImmediateBatch();
+
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (!lpd3dVertexBuffer || !lpwIndices)
@@ -4485,6 +4779,10 @@ HRESULT m_IDirect3DDeviceX::DrawIndexedPrimitiveVB(D3DPRIMITIVETYPE dptPrimitive
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: 'DrawIndexedPrimitive' call failed: " << (D3DERR)hr);
 		}
+		else
+		{
+			AddDrawStats(dptPrimitiveType, GetNumberOfPrimitives(dptPrimitiveType, dwIndexCount), dwNumVertices);
+		}
 
 #ifdef ENABLE_PROFILING
 		Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(startTime);
@@ -4630,6 +4928,8 @@ HRESULT m_IDirect3DDeviceX::ApplyStateBlock(DWORD dwBlockHandle)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		if (!dwBlockHandle || StateBlockTokens.find(dwBlockHandle) == StateBlockTokens.end())
@@ -4904,6 +5204,8 @@ HRESULT m_IDirect3DDeviceX::SetClipPlane(DWORD dwIndex, D3DVALUE* pPlaneEquation
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	FlushImmediateBatch();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -5033,6 +5335,38 @@ void m_IDirect3DDeviceX::ClearSurface(m_IDirectDrawSurfaceX* lpSurfaceX)
 	}
 }
 
+// Binds the surface again on the stages that use it, after the surface replaced its d3d9 texture
+void m_IDirect3DDeviceX::ResetTextureSurface(m_IDirectDrawSurfaceX* lpSurfaceX)
+{
+	for (UINT x = 0; x < MaxTextureStages; x++)
+	{
+		if (CurrentTextureSurfaceX[x] == lpSurfaceX && AttachedTexture[x])
+		{
+			SetTexture(x, AttachedTexture[x]);
+		}
+	}
+}
+
+// Draws the pending Begin/End batch if it reads from or renders to a surface that is about to change
+void m_IDirect3DDeviceX::FlushImmediateBatch(m_IDirectDrawSurfaceX* lpSurfaceX)
+{
+	if (ImmediateBatch.Vertices.empty() || !lpSurfaceX)
+	{
+		return;
+	}
+
+	bool IsSurfaceInUse = (lpCurrentRenderTargetX == lpSurfaceX || (ddrawParent && ddrawParent->GetDepthStencilSurface() == lpSurfaceX));
+	for (UINT x = 0; x < MaxTextureStages && !IsSurfaceInUse; x++)
+	{
+		IsSurfaceInUse = (CurrentTextureSurfaceX[x] == lpSurfaceX);
+	}
+
+	if (IsSurfaceInUse)
+	{
+		FlushImmediateBatch();
+	}
+}
+
 void m_IDirect3DDeviceX::SetDdrawParent(m_IDirectDrawX* ddraw)
 {
 	ddrawParent = ddraw;
@@ -5174,6 +5508,71 @@ void m_IDirect3DDeviceX::ClearD3D(m_IDirect3DX* lpD3D)
 	D3DInterface = nullptr;
 }
 
+void m_IDirect3DDeviceX::AddDrawStats(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwPrimitiveCount, DWORD dwVertexCount)
+{
+	FrameStats.DrawCalls++;
+	FrameStats.VerticesProcessed += dwVertexCount;
+
+	switch (dptPrimitiveType)
+	{
+	case D3DPT_POINTLIST:
+		FrameStats.PointsDrawn += dwPrimitiveCount;
+		break;
+	case D3DPT_LINELIST:
+	case D3DPT_LINESTRIP:
+		FrameStats.LinesDrawn += dwPrimitiveCount;
+		break;
+	default:
+		FrameStats.TrianglesDrawn += dwPrimitiveCount;
+		break;
+	}
+}
+
+// Moves the current frame counters into the totals and logs the rolling average when enabled
+void m_IDirect3DDeviceX::EndFrameStats()
+{
+	TotalStats.dwTrianglesDrawn += FrameStats.TrianglesDrawn;
+	TotalStats.dwLinesDrawn += FrameStats.LinesDrawn;
+	TotalStats.dwPointsDrawn += FrameStats.PointsDrawn;
+	TotalStats.dwVerticesProcessed += FrameStats.VerticesProcessed;
+
+	const D3DFRAMESTATS LastFrameStats = FrameStats;
+	FrameStats = {};
+
+	if (!Config.DdrawLogFrameStats)
+	{
+		return;
+	}
+
+	D3DFRAMESTATS& Sum = FrameStatsLog.Sum;
+	Sum.DrawCalls += LastFrameStats.DrawCalls;
+	Sum.TrianglesDrawn += LastFrameStats.TrianglesDrawn;
+	Sum.LinesDrawn += LastFrameStats.LinesDrawn;
+	Sum.PointsDrawn += LastFrameStats.PointsDrawn;
+	Sum.VerticesProcessed += LastFrameStats.VerticesProcessed;
+	Sum.StateChanges += LastFrameStats.StateChanges;
+	Sum.TextureChanges += LastFrameStats.TextureChanges;
+	Sum.Locks += LastFrameStats.Locks;
+	Sum.Blits += LastFrameStats.Blits;
+
+	if (++FrameStatsLog.FrameCount >= Config.DdrawLogFrameStats)
+	{
+		const DWORD Frames = FrameStatsLog.FrameCount;
+		Logging::Log() << __FUNCTION__ << " (" << this << ") Average per frame over " << Frames << " frames:" <<
+			" Draws = " << Sum.DrawCalls / Frames <<
+			" Triangles = " << Sum.TrianglesDrawn / Frames <<
+			" Lines = " << Sum.LinesDrawn / Frames <<
+			" Points = " << Sum.PointsDrawn / Frames <<
+			" Vertices = " << Sum.VerticesProcessed / Frames <<
+			" StateChanges = " << Sum.StateChanges / Frames <<
+			" TextureChanges = " << Sum.TextureChanges / Frames <<
+			" Locks = " << Sum.Locks / Frames <<
+			" Blits = " << Sum.Blits / Frames;
+
+		FrameStatsLog = {};
+	}
+}
+
 HRESULT m_IDirect3DDeviceX::SetD9RenderState(D3DRENDERSTATETYPE dwRenderStateType, DWORD dwRenderState)
 {
 	HRESULT hr = (*d3d9Device)->SetRenderState(dwRenderStateType, dwRenderState);
@@ -5370,6 +5769,11 @@ void m_IDirect3DDeviceX::BeforeResetDevice()
 			DeleteStateBlock(dwBlockHandle);
 		}
 	}
+
+	// Pending immediate mode vertices cannot be drawn on a lost device
+	ImmediateBatch.IsInBegin = false;
+	ImmediateBatch.Vertices.clear();
+	ImmediateBatch.Indices.clear();
 }
 
 void m_IDirect3DDeviceX::AfterResetDevice()
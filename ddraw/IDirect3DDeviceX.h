@@ -4,6 +4,20 @@
 #include <unordered_set>
 #include "External\DirectXMath\Inc\DirectXMath.h"
 
+// Draw statistics collected for each frame
+struct D3DFRAMESTATS
+{
+	DWORD DrawCalls = 0;
+	DWORD TrianglesDrawn = 0;
+	DWORD LinesDrawn = 0;
+	DWORD PointsDrawn = 0;
+	DWORD VerticesProcessed = 0;
+	DWORD StateChanges = 0;
+	DWORD TextureChanges = 0;
+	DWORD Locks = 0;
+	DWORD Blits = 0;
+};
+
 class m_IDirect3DDeviceX : public IUnknown, public AddressLookupTableDdrawObject
 {
 private:
@@ -88,6 +102,16 @@ private:
 
 	bool IsInScene = false;
 
+	// Draw statistics
+	D3DFRAMESTATS FrameStats;			// Current frame
+	D3DSTATS TotalStats = {};			// Totals since the device was created, returned by GetStats
+	struct {
+		D3DFRAMESTATS Sum;
+		DWORD FrameCount = 0;
+	} FrameStatsLog;
+	void AddDrawStats(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwPrimitiveCount, DWORD dwVertexCount);
+	void EndFrameStats();
+
 	// Last clip status
 	D3DCLIPSTATUS D3DClipStatus;
 
@@ -111,6 +135,26 @@ private:
 	DWORD rsColorKeyEnabled;
 	DWORD ssMipFilter[MaxTextureStages] = {};
 
+	// Immediate mode Begin/Vertex/End batching
+	static constexpr DWORD MaxImmediateBatchVertices = 0xFFFF;
+	struct {
+		bool IsInBegin = false;
+		bool IsIndexed = false;
+		D3DPRIMITIVETYPE PrimitiveType = (D3DPRIMITIVETYPE)0;
+		DWORD VertexTypeDesc = 0;
+		DWORD Flags = 0;
+		DWORD DirectXVersion = 0;
+		UINT Stride = 0;
+		size_t SegmentStart = 0;			// Start of the current Begin/End segment in Vertices or Indices
+		DWORD SegmentBaseVertex = 0;		// Added to indices of the current BeginIndexed segment
+		DWORD SegmentVertexCount = 0;
+		std::vector<BYTE> Vertices;
+		std::vector<WORD> Indices;
+	} ImmediateBatch;
+	HRESULT BeginImmediateBatch(D3DPRIMITIVETYPE dptPrimitiveType, DWORD dwVertexTypeDesc, LPVOID lpVertices, DWORD dwVertexCount, DWORD dwFlags, DWORD DirectXVersion);
+	HRESULT FlushImmediateBatch();
+	HRESULT SplitImmediateBatch();
+
 	// Handle state blocks
 	bool IsRecordingState = false;
 	std::unordered_set<DWORD> StateBlockTokens;
@@ -306,8 +350,8 @@ public:
 	STDMETHOD(GetCurrentViewport)(THIS_ LPDIRECT3DVIEWPORT3 *, DWORD);
 	STDMETHOD(SetViewport)(THIS_ LPD3DVIEWPORT7);
 	STDMETHOD(GetViewport)(THIS_ LPD3DVIEWPORT7);
-	STDMETHOD(Begin)(THIS_ D3DPRIMITIVETYPE, DWORD, DWORD);
-	STDMETHOD(BeginIndexed)(THIS_ D3DPRIMITIVETYPE, DWORD, LPVOID, DWORD, DWORD);
+	STDMETHOD(Begin)(THIS_ D3DPRIMITIVETYPE, DWORD, DWORD, DWORD);
+	STDMETHOD(BeginIndexed)(THIS_ D3DPRIMITIVETYPE, DWORD, LPVOID, DWORD, DWORD, DWORD);
 	STDMETHOD(Vertex)(THIS_ LPVOID);
 	STDMETHOD(Index)(THIS_ WORD);
 	STDMETHOD(End)(THIS_ DWORD);
@@ -354,6 +398,9 @@ public:
 	ULONG AddRef(DWORD DirectXVersion);
 	ULONG Release(DWORD DirectXVersion);
 	bool IsDeviceInScene() const { return IsInScene; }
+	inline void AddStateStats() { FrameStats.StateChanges++; }
+	inline void AddLockStats() { FrameStats.Locks++; }
+	inline void AddBltStats() { FrameStats.Blits++; }
 	inline void SetParent3DSurface(m_IDirectDrawSurfaceX* lpSurfaceX, DWORD DxVersion) { parent3DSurface = { lpSurfaceX, DxVersion }; }
 
 	// ExecuteBuffer
@@ -397,6 +444,8 @@ public:
 
 	// Functions handling the ddraw parent interface
 	void ClearSurface(m_IDirectDrawSurfaceX* lpSurfaceX);
+	void ResetTextureSurface(m_IDirectDrawSurfaceX* lpSurfaceX);
+	void FlushImmediateBatch(m_IDirectDrawSurfaceX* lpSurfaceX);
 	void SetDdrawParent(m_IDirectDrawX* ddraw);
 	void ClearDdraw();
 	void BeforeResetDevice();
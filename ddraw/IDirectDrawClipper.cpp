@@ -17,6 +17,7 @@
 */
 
 #include "ddraw.h"
+#include "GDI\WndProc.h"
 
 // Cached wrapper interface
 namespace {
@@ -141,88 +142,22 @@ HRESULT m_IDirectDrawClipper::GetClipList(LPRECT lpRect, LPRGNDATA lpClipList, L
 
 		if (IsClipListSet)
 		{
-			// ToDo: add support for lpRect
-			// A pointer to a RECT structure that GetClipList uses to clip the clip list. Set this parameter to NULL to retrieve the entire clip list.
+			const RGNDATA* pRgnData = (const RGNDATA*)ClipList.data();
 
-			// ToDo: fix sizeof(RGNDATA) to be the atual size of the data
-			if (!lpClipList)
-			{
-				*lpdwSize = ClipList.size();
-				return DD_OK;
-			}
-			else if (*lpdwSize == ClipList.size())
-			{
-				IsClipListChangedFlag = false;				// Just set this to false for now
-				memcpy(lpClipList, &ClipList, *lpdwSize);
-				return DD_OK;
-			}
-			else if (lpdwSize && *lpdwSize >= sizeof(RGNDATA))
-			{
-				return DDERR_REGIONTOOSMALL;
-			}
+			return CopyClipList((const RECT*)pRgnData->Buffer, pRgnData->rdh.nCount, lpRect, lpClipList, lpdwSize);
 		}
 		// Get default clip area
 		else
 		{
-			// ToDo: add support for lpRect
-			// A pointer to a RECT structure that GetClipList uses to clip the clip list. Set this parameter to NULL to retrieve the entire clip list.
-
-			HRESULT hr = DD_OK;
-
-			// Get the HWND of the window
-			HWND hWnd = (cliphWnd) ? cliphWnd : (ddrawParent) ? ddrawParent->GetHwnd() : nullptr;
-
-			if (!hWnd)
-			{
-				LOG_LIMIT(100, __FUNCTION__ << " Error: Could not get window handle!");
-				return DDERR_GENERIC;
-			}
-
-			// Get the client area rectangle
-			RECT clientRect = {};
-			GetClientRect(hWnd, &clientRect);
-
-			// Map the client area coordinates to screen coordinates
-			MapWindowPoints(hWnd, HWND_DESKTOP, (LPPOINT)&clientRect, 2);
-
-			// Create a region from the client rectangle
-			HRGN hRgn = CreateRectRgn(clientRect.left, clientRect.top, clientRect.right, clientRect.bottom);
-
-			if (!hRgn)
-			{
-				return DDERR_GENERIC;
-			}
-
-			// Get region data
-			*lpdwSize = GetRegionData(hRgn, *lpdwSize, lpClipList);
+			HRESULT hr = UpdateWindowClipRect();
 
-			// Check region data
-			if (!*lpdwSize)
+			if (FAILED(hr))
 			{
-				if (lpClipList)
-				{
-					*lpdwSize = GetRegionData(hRgn, 0, nullptr);
-					hr = DDERR_REGIONTOOSMALL;
-				}
-				else
-				{
-					hr = DDERR_GENERIC;
-				}
+				return hr;
 			}
 
-			// Get region data size
-			if (*lpdwSize && *lpdwSize != ClipList.size())
-			{
-				ClipList.resize(*lpdwSize);
-			}
-
-			// Release the region
-			DeleteObject(hRgn);
-
-			return hr;
+			return CopyClipList(&WindowClip.Rect, 1, lpRect, lpClipList, lpdwSize);
 		}
-
-		return DDERR_GENERIC;
 	}
 
 	return ProxyInterface->GetClipList(lpRect, lpClipList, lpdwSize);
@@ -281,7 +216,12 @@ HRESULT m_IDirectDrawClipper::IsClipListChanged(BOOL FAR * lpbChanged)
 			return DDERR_INVALIDPARAMS;
 		}
 
-		// ToDo: Fix this to get real status of ClipList
+		// Check if the window has moved or resized since the clip list was last retrieved
+		if (!IsClipListSet)
+		{
+			UpdateWindowClipRect();
+		}
+
 		// lpbChanged is TRUE if the clip list has changed, and FALSE otherwise.
 		if (IsClipListChangedFlag)
 		{
@@ -320,12 +260,9 @@ HRESULT m_IDirectDrawClipper::SetClipList(LPRGNDATA lpClipList, DWORD dwFlags)
 			// Set clip list to lpClipList
 			IsClipListSet = true;
 			IsClipListChangedFlag = true;
-			if (ClipList.empty())
-			{
-				ClipList.resize(sizeof(RGNDATA));
-			}
-			// ToDo: Fix this to get correct size of ClipList
+			ClipList.resize(sizeof(RGNDATAHEADER) + lpClipList->rdh.nCount * sizeof(RECT));
 			memcpy(ClipList.data(), lpClipList, ClipList.size());
+			((RGNDATA*)ClipList.data())->rdh.dwSize = sizeof(RGNDATAHEADER);
 		}
 
 		return DD_OK;
@@ -342,7 +279,9 @@ HRESULT m_IDirectDrawClipper::SetHWnd(DWORD dwFlags, HWND hWnd)
 	{
 		cliphWnd = hWnd;
 
-		// Load clip list from window
+		// Load clip list from window on next use
+		WindowClip.IsValid = false;
+		IsClipListChangedFlag = true;
 
 		return DD_OK;
 	}
@@ -354,6 +293,108 @@ HRESULT m_IDirectDrawClipper::SetHWnd(DWORD dwFlags, HWND hWnd)
 /*** Helper functions ***/
 /************************/
 
+// Updates the cached client area of the clipper window, only queries the window if it has changed
+HRESULT m_IDirectDrawClipper::UpdateWindowClipRect()
+{
+	// Get the HWND of the window
+	HWND hWnd = (cliphWnd) ? cliphWnd : (ddrawParent) ? ddrawParent->GetHwnd() : nullptr;
+
+	if (!hWnd)
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: Could not get window handle!");
+		return DDERR_GENERIC;
+	}
+
+	// Hooked windows report moves and resizes, other windows are queried every time
+	WndProc::DATASTRUCT* WndDataStruct = WndProc::GetWndProctStruct(hWnd);
+	DWORD ChangeCount = (WndDataStruct) ? (DWORD)WndDataStruct->WindowChangeCount : 0;
+
+	// A child window gets no message when its parent moves, so the screen position is checked on every call
+	RECT windowRect = {};
+	GetWindowRect(hWnd, &windowRect);
+
+	if (WindowClip.IsValid && WindowClip.hWnd == hWnd && WndDataStruct && WindowClip.ChangeCount == ChangeCount &&
+		EqualRect(&WindowClip.WindowRect, &windowRect))
+	{
+		return DD_OK;
+	}
+
+	// Get the client area rectangle
+	RECT clientRect = {};
+	GetClientRect(hWnd, &clientRect);
+
+	// Map the client area coordinates to screen coordinates
+	MapWindowPoints(hWnd, HWND_DESKTOP, (LPPOINT)&clientRect, 2);
+
+	if (!WindowClip.IsValid || WindowClip.hWnd != hWnd || !EqualRect(&WindowClip.Rect, &clientRect))
+	{
+		IsClipListChangedFlag = true;
+	}
+
+	WindowClip.hWnd = hWnd;
+	WindowClip.ChangeCount = ChangeCount;
+	WindowClip.WindowRect = windowRect;
+	WindowClip.Rect = clientRect;
+	WindowClip.IsValid = true;
+
+	return DD_OK;
+}
+
+// Copies a list of rects to a region, clipped to lpRect if one is given
+HRESULT m_IDirectDrawClipper::CopyClipList(const RECT* pRects, DWORD Count, LPRECT lpRect, LPRGNDATA lpClipList, LPDWORD lpdwSize)
+{
+	auto ClipRect = [&](DWORD x, RECT& Rect) -> bool {
+		Rect = pRects[x];
+		return (lpRect) ? IntersectRect(&Rect, &pRects[x], lpRect) != FALSE : IsRectEmpty(&Rect) == FALSE;
+	};
+
+	// Count rects left after clipping
+	DWORD ClippedCount = 0;
+	for (DWORD x = 0; x < Count; x++)
+	{
+		RECT Rect;
+		if (ClipRect(x, Rect))
+		{
+			ClippedCount++;
+		}
+	}
+
+	const DWORD Size = sizeof(RGNDATAHEADER) + ClippedCount * sizeof(RECT);
+
+	if (!lpClipList)
+	{
+		*lpdwSize = Size;
+		return DD_OK;
+	}
+	else if (*lpdwSize < Size)
+	{
+		*lpdwSize = Size;
+		return DDERR_REGIONTOOSMALL;
+	}
+
+	lpClipList->rdh.dwSize = sizeof(RGNDATAHEADER);
+	lpClipList->rdh.iType = RDH_RECTANGLES;
+	lpClipList->rdh.nCount = ClippedCount;
+	lpClipList->rdh.nRgnSize = ClippedCount * sizeof(RECT);
+	SetRectEmpty(&lpClipList->rdh.rcBound);
+
+	RECT* pDest = (RECT*)lpClipList->Buffer;
+	for (DWORD x = 0; x < Count; x++)
+	{
+		RECT Rect;
+		if (ClipRect(x, Rect))
+		{
+			*pDest++ = Rect;
+			UnionRect(&lpClipList->rdh.rcBound, &lpClipList->rdh.rcBound, &Rect);
+		}
+	}
+
+	*lpdwSize = Size;
+	IsClipListChangedFlag = false;
+
+	return DD_OK;
+}
+
 void m_IDirectDrawClipper::InitInterface(DWORD dwFlags)
 {
 	if (ddrawParent)
@@ -366,6 +407,7 @@ void m_IDirectDrawClipper::InitInterface(DWORD dwFlags)
 	ClipList.clear();
 	IsClipListSet = false;
 	IsClipListChangedFlag = false;
+	WindowClip = {};
 }
 
 void m_IDirectDrawClipper::ReleaseInterface()
@@ -14,9 +14,22 @@ private:
 	bool IsClipListSet = false;
 	bool IsClipListChangedFlag = false;
 
+	// Cached client area of the clipper window
+	struct {
+		HWND hWnd = nullptr;
+		DWORD ChangeCount = 0;
+		bool IsValid = false;
+		RECT WindowRect = {};		// Screen rect of the whole window when the cache was filled
+		RECT Rect = {};
+	} WindowClip;
+
 	// Convert to Direct3D9
 	m_IDirectDrawX* ddrawParent = nullptr;
 
+	// Helper functions
+	HRESULT UpdateWindowClipRect();
+	HRESULT CopyClipList(const RECT* pRects, DWORD Count, LPRECT lpRect, LPRGNDATA lpClipList, LPDWORD lpdwSize);
+
 	// Interface initialization functions
 	void InitInterface(DWORD dwFlags);
 	void ReleaseInterface();
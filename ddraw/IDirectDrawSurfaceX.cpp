@@ -571,14 +571,9 @@ HRESULT m_IDirectDrawSurfaceX::Load(LPDIRECTDRAWSURFACE7 lpDestTex, LPPOINT lpDe
 
 HRESULT m_IDirectDrawSurfaceX::Blt(LPRECT lpDestRect, LPDIRECTDRAWSURFACE7 lpDDSrcSurface, LPRECT lpSrcRect, DWORD dwFlags, LPDDBLTFX lpDDBltFx, DWORD MipMapLevel, bool PresentBlt)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
-		" DestRect = " << lpDestRect <<
-		" SrcSurface = " << lpDDSrcSurface <<
-		" SrcRect = " << lpSrcRect <<
-		" Flags = " << Logging::hex(dwFlags) <<
-		" BltFX = " << lpDDBltFx <<
-		" MipMapLevel = " << MipMapLevel <<
-		" PresentBlt = " << PresentBlt;
+	LOG_TRACE(this, lpDestRect, lpDDSrcSurface, lpSrcRect, dwFlags, lpDDBltFx, MipMapLevel, PresentBlt);
+
+	PROFILE_SCOPE();
 
 	// Check if source Surface exists
 	if (lpDDSrcSurface && !ProxyAddressLookupTable.CheckSurfaceExists(lpDDSrcSurface))
@@ -681,6 +676,15 @@ HRESULT m_IDirectDrawSurfaceX::Blt(LPRECT lpDestRect, LPDIRECTDRAWSURFACE7 lpDDS
 			return (c_hr == DDERR_SURFACELOST || s_hr == DDERR_SURFACELOST) ? DDERR_SURFACELOST : FAILED(c_hr) ? c_hr : s_hr;
 		}
 
+		if (m_IDirect3DDeviceX* D3DDeviceX = *ddrawParent->GetCurrentD3DDevice())
+		{
+			D3DDeviceX->AddBltStats();
+
+			// Draw batched primitives before either surface changes
+			D3DDeviceX->FlushImmediateBatch(this);
+			D3DDeviceX->FlushImmediateBatch(lpDDSrcSurfaceX);
+		}
+
 		// Clear the depth stencil surface
 		if (dwFlags & DDBLT_DEPTHFILL)
 		{
@@ -963,16 +967,28 @@ HRESULT m_IDirectDrawSurfaceX::BltBatch(LPDDBLTBATCH lpDDBltBatch, DWORD dwCount
 
 	IsInBltBatch = true;
 
-	for (DWORD x = 0; x < dwCount; x++)
+	for (DWORD x = 0; x < dwCount; )
 	{
-		IsSkipScene |= (lpDDBltBatch[x].lprDest) ? CheckRectforSkipScene(*lpDDBltBatch[x].lprDest) : false;
+		// Runs of plain copies from the same source are done without going through Blt for each entry
+		DWORD RunCount = (Config.Dd7to9) ? BltBatchRun::GetCopyRunLength(&lpDDBltBatch[x], dwCount - x) : 0;
+		if (RunCount > 1)
+		{
+			hr = BltBatchCopy(&lpDDBltBatch[x], RunCount, MipMapLevel, IsSkipScene);
+		}
+		else
+		{
+			RunCount = 1;
+
+			IsSkipScene |= (lpDDBltBatch[x].lprDest) ? CheckRectforSkipScene(*lpDDBltBatch[x].lprDest) : false;
 
-		hr = Blt(lpDDBltBatch[x].lprDest, (LPDIRECTDRAWSURFACE7)lpDDBltBatch[x].lpDDSSrc, lpDDBltBatch[x].lprSrc, lpDDBltBatch[x].dwFlags, lpDDBltBatch[x].lpDDBltFx, MipMapLevel, false);
+			hr = Blt(lpDDBltBatch[x].lprDest, (LPDIRECTDRAWSURFACE7)lpDDBltBatch[x].lpDDSSrc, lpDDBltBatch[x].lprSrc, lpDDBltBatch[x].dwFlags, lpDDBltBatch[x].lpDDBltFx, MipMapLevel, false);
+		}
 		if (FAILED(hr))
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Warning: BltBatch failed before the end! " << x << " of " << dwCount << " " << (DDERR)hr);
 			break;
 		}
+		x += RunCount;
 	}
 
 	IsInBltBatch = false;
@@ -996,10 +1012,132 @@ HRESULT m_IDirectDrawSurfaceX::BltBatch(LPDDBLTBATCH lpDDBltBatch, DWORD dwCount
 	return hr;
 }
 
+// Copies a run of entries from one source surface, the checks and surface setup done by Blt are only done once
+HRESULT m_IDirectDrawSurfaceX::BltBatchCopy(LPDDBLTBATCH lpDDBltBatch, DWORD dwCount, DWORD MipMapLevel, bool& IsSkipScene)
+{
+	LPDIRECTDRAWSURFACE7 lpDDSrcSurface = (LPDIRECTDRAWSURFACE7)lpDDBltBatch[0].lpDDSSrc;
+	const DWORD dwFlags = lpDDBltBatch[0].dwFlags;
+
+	// Check if source Surface exists
+	if (!ProxyAddressLookupTable.CheckSurfaceExists(lpDDSrcSurface))
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: could not find source surface! " << lpDDSrcSurface);
+		return DDERR_INVALIDPARAMS;
+	}
+
+	m_IDirectDrawSurfaceX* lpDDSrcSurfaceX = nullptr;
+	lpDDSrcSurface->QueryInterface(IID_GetInterfaceX, (LPVOID*)&lpDDSrcSurfaceX);
+	if (!lpDDSrcSurfaceX)
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: could not get surfaceX!");
+		return DDERR_INVALIDPARAMS;
+	}
+
+	DWORD SrcMipMapLevel = 0;
+	lpDDSrcSurface->QueryInterface(IID_GetMipMapLevel, (LPVOID*)&SrcMipMapLevel);
+
+	if (lpDDSrcSurfaceX != this)
+	{
+		HRESULT s_hr = lpDDSrcSurfaceX->CheckInterface(__FUNCTION__, true, true, true);
+		if (FAILED(s_hr))
+		{
+			return s_hr;
+		}
+	}
+
+	// Get color key
+	DDCOLORKEY ColorKey = {};
+	if ((dwFlags & DDBLT_KEYDEST) && (surfaceDesc2.dwFlags & DDSD_CKDESTBLT))
+	{
+		ColorKey = surfaceDesc2.ddckCKDestBlt;
+	}
+	else if ((dwFlags & DDBLT_KEYSRC) && (lpDDSrcSurfaceX->surfaceDesc2.dwFlags & DDSD_CKSRCBLT))
+	{
+		ColorKey = lpDDSrcSurfaceX->surfaceDesc2.ddckCKSrcBlt;
+	}
+	else if (dwFlags & (DDBLT_KEYDEST | DDBLT_KEYSRC))
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: color key not found!");
+		return DDERR_INVALIDPARAMS;
+	}
+	const DWORD Flags = (dwFlags & (DDBLT_KEYDEST | DDBLT_KEYSRC)) ? BLT_COLORKEY : 0;
+	const bool BltWait = ((dwFlags & DDBLT_WAIT) && (dwFlags & DDBLT_DONOTWAIT) == 0);
+
+	m_IDirect3DDeviceX* D3DDeviceX = *ddrawParent->GetCurrentD3DDevice();
+	if (D3DDeviceX)
+	{
+		// Draw batched primitives before either surface changes
+		D3DDeviceX->FlushImmediateBatch(this);
+		D3DDeviceX->FlushImmediateBatch(lpDDSrcSurfaceX);
+	}
+
+	lpDDSrcSurfaceX->SetLockCriticalSection();
+
+	HRESULT hr = DD_OK;
+
+	// Same as Blt, only wait for lock from other thread if the caller asked for it
+	if (!BltWait && (IsLockedFromOtherThread() || lpDDSrcSurfaceX->IsLockedFromOtherThread()))
+	{
+		hr = DDERR_WASSTILLDRAWING;
+	}
+	while (SUCCEEDED(hr) && (IsLockedFromOtherThread() || lpDDSrcSurfaceX->IsLockedFromOtherThread()))
+	{
+		Utils::BusyWaitYield((DWORD)-1);
+		if (!surface.Surface && !surface.Texture)
+		{
+			LOG_LIMIT(100, __FUNCTION__ << " Error: surface texture missing!");
+			hr = DDERR_SURFACELOST;
+			break;
+		}
+	}
+
+	if (SUCCEEDED(hr))
+	{
+		// Set blt flag
+		lpDDSrcSurfaceX->IsInBlt = true;
+		LockedWithID = GetCurrentThreadId();
+		lpDDSrcSurfaceX->LockedWithID = GetCurrentThreadId();
+
+		for (DWORD x = 0; x < dwCount; x++)
+		{
+			IsSkipScene |= (lpDDBltBatch[x].lprDest) ? CheckRectforSkipScene(*lpDDBltBatch[x].lprDest) : false;
+
+			if (D3DDeviceX)
+			{
+				D3DDeviceX->AddBltStats();
+			}
+
+			hr = CopySurface(lpDDSrcSurfaceX, lpDDBltBatch[x].lprSrc, lpDDBltBatch[x].lprDest, D3DTEXF_NONE, ColorKey.dwColorSpaceLowValue, Flags, SrcMipMapLevel, MipMapLevel);
+			if (FAILED(hr))
+			{
+				break;
+			}
+		}
+
+		// Reset Blt flag
+		lpDDSrcSurfaceX->IsInBlt = false;
+		if (!lpDDSrcSurfaceX->IsSurfaceBlitting() && !lpDDSrcSurfaceX->IsSurfaceLocked())
+		{
+			lpDDSrcSurfaceX->LockedWithID = 0;
+		}
+	}
+
+	if (FAILED(hr) && hr != DDERR_WASSTILLDRAWING && (IsLost() == DDERR_SURFACELOST || lpDDSrcSurfaceX->IsLost() == DDERR_SURFACELOST))
+	{
+		hr = DDERR_SURFACELOST;
+	}
+
+	lpDDSrcSurfaceX->ReleaseLockCriticalSection();
+
+	return hr;
+}
+
 HRESULT m_IDirectDrawSurfaceX::BltFast(DWORD dwX, DWORD dwY, LPDIRECTDRAWSURFACE7 lpDDSrcSurface, LPRECT lpSrcRect, DWORD dwFlags, DWORD MipMapLevel)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	// Check if source Surface exists
 	if (lpDDSrcSurface && !ProxyAddressLookupTable.CheckSurfaceExists(lpDDSrcSurface))
 	{
@@ -1512,6 +1650,8 @@ HRESULT m_IDirectDrawSurfaceX::Flip(LPDIRECTDRAWSURFACE7 lpDDSurfaceTargetOverri
 		" Flags = " << Logging::hex(dwFlags) <<
 		" Version = " << DirectXVersion;
 
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if ((dwFlags & (DDFLIP_EVEN | DDFLIP_ODD)) == (DDFLIP_EVEN | DDFLIP_ODD))
@@ -2145,6 +2285,8 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 		" lpDC = " << (void*)lphDC <<
 		" MipMapLevel = " << MipMapLevel;
 
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		if (!lphDC)
@@ -2153,18 +2295,11 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 		}
 		*lphDC = nullptr;
 
-		// MipMap level support
-		if (MipMapLevel)
-		{
-			LOG_LIMIT(100, __FUNCTION__ << " Error: GetDC from MipMap level Not Implemented: " << MipMapLevel);
-			return DDERR_UNSUPPORTED;
-		}
-
-		if (LastDC && IsSurfaceInDC())
+		if (LastDC && IsSurfaceInDC() && LastDCMipMapLevel == MipMapLevel)
 		{
 			*lphDC = LastDC;
 		}
-		else if (IsUsingEmulation())
+		else if (IsUsingEmulation() && !MipMapLevel)
 		{
 			// Prepare GameDC
 			SetEmulationGameDC();
@@ -2179,12 +2314,14 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 			return c_hr;
 		}
 
-		if (LastDC && IsSurfaceInDC())
+		if (LastDC && IsSurfaceInDC() && LastDCMipMapLevel == MipMapLevel)
 		{
 			*lphDC = LastDC;
 			return DD_OK;
 		}
 
+		FlushD3DDeviceBatch();
+
 		if (IsSurfaceInDC())
 		{
 			LOG_LIMIT(100, __FUNCTION__ << " Error: does not support getting device context twice!");
@@ -2217,7 +2354,15 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 
 		do {
 
-			if (IsUsingEmulation() || DCRequiresEmulation)
+			if (MipMapLevel && IsMipMapDCEmulated(MipMapLevel))
+			{
+				if (FAILED(GetEmulatedMipMapDC(lphDC, MipMapLevel)))
+				{
+					hr = DDERR_GENERIC;
+					break;
+				}
+			}
+			else if (IsUsingEmulation() || DCRequiresEmulation)
 			{
 				if (!IsUsingEmulation())
 				{
@@ -2227,7 +2372,11 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 						break;
 					}
 
-					CopyToEmulatedSurface(nullptr);
+					// Emulated memory starts out cleared so there is nothing to copy until the surface has data
+					if (surface.HasData || (surface.Usage & D3DUSAGE_RENDERTARGET))
+					{
+						CopyToEmulatedSurface(nullptr);
+					}
 				}
 
 				// Set new palette data
@@ -2242,12 +2391,15 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 				// Prepare GameDC
 				SetEmulationGameDC();
 
+				// Accumulate the area drawn by GDI so ReleaseDC only writes back that part
+				SetBoundsRect(surface.emu->GameDC, nullptr, DCB_RESET | DCB_ENABLE);
+
 				*lphDC = surface.emu->GameDC;
 			}
 			else
 			{
 				// Get surface
-				IDirect3DSurface9* pSurfaceD9 = Get3DMipMapSurface(0);
+				IDirect3DSurface9* pSurfaceD9 = Get3DMipMapSurface(MipMapLevel);
 				if (!pSurfaceD9)
 				{
 					LOG_LIMIT(100, __FUNCTION__ << " Error: could not find surface!");
@@ -2257,6 +2409,7 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 
 				// Get device context
 				hr = pSurfaceD9->GetDC(lphDC);
+				Release3DMipMapSurface(pSurfaceD9, MipMapLevel);
 				if (FAILED(hr))
 				{
 					LOG_LIMIT(100, __FUNCTION__ << " Error: could not get device context!");
@@ -2271,6 +2424,7 @@ HRESULT m_IDirectDrawSurfaceX::GetDC(HDC FAR* lphDC, DWORD MipMapLevel)
 
 			// Set LastDC
 			LastDC = *lphDC;
+			LastDCMipMapLevel = MipMapLevel;
 
 		} while (false);
 
@@ -2558,7 +2712,15 @@ HRESULT m_IDirectDrawSurfaceX::GetSurfaceDesc2(LPDDSURFACEDESC2 lpDDSurfaceDesc2
 				if ((!MipMaps[Level].dwWidth || !MipMaps[Level].dwHeight) && surface.Texture)
 				{
 					D3DSURFACE_DESC Desc = {};
-					surface.Texture->GetLevelDesc(GetD3d9MipMapLevel(MipMapLevel), &Desc);
+					if (IsMipMapChainDeferred)
+					{
+						Desc.Width = DeferredMipMap::GetLevelSize(surface.Width, GetD3d9MipMapLevel(MipMapLevel));
+						Desc.Height = DeferredMipMap::GetLevelSize(surface.Height, GetD3d9MipMapLevel(MipMapLevel));
+					}
+					else
+					{
+						surface.Texture->GetLevelDesc(GetD3d9MipMapLevel(MipMapLevel), &Desc);
+					}
 					MipMaps[Level].dwWidth = Desc.Width;
 					MipMaps[Level].dwHeight = Desc.Height;
 				}
@@ -2729,13 +2891,9 @@ HRESULT m_IDirectDrawSurfaceX::Lock(LPRECT lpDestRect, LPDDSURFACEDESC lpDDSurfa
 
 HRESULT m_IDirectDrawSurfaceX::Lock2(LPRECT lpDestRect, LPDDSURFACEDESC2 lpDDSurfaceDesc2, DWORD dwFlags, HANDLE hEvent, DWORD MipMapLevel, DWORD DirectXVersion)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
-		" Rect = " << lpDestRect <<
-		" Desc = " << lpDDSurfaceDesc2 <<
-		" Flags = " << Logging::hex(dwFlags) <<
-		" Event = " << hEvent <<
-		" MipMapLevel = " << MipMapLevel <<
-		" Version = " << DirectXVersion;
+	LOG_TRACE(this, lpDestRect, lpDDSurfaceDesc2, dwFlags, hEvent, MipMapLevel, DirectXVersion);
+
+	PROFILE_SCOPE();
 
 	if (Config.Dd7to9)
 	{
@@ -2763,6 +2921,13 @@ HRESULT m_IDirectDrawSurfaceX::Lock2(LPRECT lpDestRect, LPDDSURFACEDESC2 lpDDSur
 		// Check for device interface
 		HRESULT c_hr = CheckInterface(__FUNCTION__, true, true, false);
 
+		m_IDirect3DDeviceX* D3DDeviceX = (SUCCEEDED(c_hr)) ? *ddrawParent->GetCurrentD3DDevice() : nullptr;
+		if (D3DDeviceX)
+		{
+			D3DDeviceX->AddLockStats();
+			D3DDeviceX->FlushImmediateBatch(this);
+		}
+
 		// Prepare surfaceDesc
 		GetSurfaceDesc2(lpDDSurfaceDesc2, MipMapLevel, DirectXVersion);
 		if (!surface.UsingSurfaceMemory && !IsUsingEmulation())
@@ -3076,6 +3241,12 @@ inline HRESULT m_IDirectDrawSurfaceX::LockD3d9Surface(D3DLOCKED_RECT* pLockedRec
 	// Lock surface texture
 	else if (surface.Texture)
 	{
+		// MipMap levels cannot be locked until the chain exists
+		if (FAILED(CheckDeferredMipMapLevels(MipMapLevel)))
+		{
+			return DDERR_SURFACEBUSY;
+		}
+
 		HRESULT hr = surface.Texture->LockRect(GetD3d9MipMapLevel(MipMapLevel), pLockedRect, pRect, Flags);
 		if (FAILED(hr) && (Flags & D3DLOCK_NOSYSLOCK))
 		{
@@ -3092,6 +3263,8 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
 		" DC = " << hDC;
 
+	PROFILE_SCOPE();
+
 	if (Config.Dd7to9)
 	{
 		// Check for device interface
@@ -3107,6 +3280,8 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 			return DDERR_GENERIC;
 		}
 
+		FlushD3DDeviceBatch();
+
 		SetSurfaceCriticalSection();
 
 #ifdef ENABLE_PROFILING
@@ -3115,9 +3290,24 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 
 		HRESULT hr = DD_OK;
 
+		// Area written by GDI, nullptr writes back the whole surface
+		RECT DestRect = {};
+		LPRECT lpDestRect = nullptr;
+		bool IsDCModified = true;
+
+		const DWORD MipMapLevel = LastDCMipMapLevel;
+
 		do {
 
-			if (IsUsingEmulation() || DCRequiresEmulation)
+			if (MipMapLevel && IsMipMapDCEmulated(MipMapLevel))
+			{
+				// Copy emulated MipMap level back to the surface
+				if (FAILED(CopyEmulatedMipMapSurface(MipMapLevel, false)))
+				{
+					hr = DDERR_GENERIC;
+				}
+			}
+			else if (IsUsingEmulation() || DCRequiresEmulation)
 			{
 				if (!IsUsingEmulation())
 				{
@@ -3125,13 +3315,38 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 					break;
 				}
 
+				// Get area drawn by GDI
+				RECT BoundsRect = {};
+				UINT Bounds = GetBoundsRect(surface.emu->GameDC, &BoundsRect, DCB_RESET);
+				SetBoundsRect(surface.emu->GameDC, nullptr, DCB_DISABLE);
+				if ((Bounds & DCB_SET) == DCB_RESET)
+				{
+					IsDCModified = false;
+				}
+				else if ((Bounds & DCB_SET) == DCB_SET && LPtoDP(surface.emu->GameDC, (LPPOINT)&BoundsRect, 2))
+				{
+					// Mapping mode can flip the rect
+					DestRect.left = min(BoundsRect.left, BoundsRect.right);
+					DestRect.top = min(BoundsRect.top, BoundsRect.bottom);
+					DestRect.right = max(BoundsRect.left, BoundsRect.right);
+					DestRect.bottom = max(BoundsRect.top, BoundsRect.bottom);
+					if (CheckCoordinates(DestRect, &DestRect, nullptr))
+					{
+						lpDestRect = &DestRect;
+					}
+					else
+					{
+						IsDCModified = false;
+					}
+				}
+
 				// Restore DC
 				UnsetEmulationGameDC();
 			}
 			else
 			{
 				// Get surface
-				IDirect3DSurface9* pSurfaceD9 = Get3DMipMapSurface(0);
+				IDirect3DSurface9* pSurfaceD9 = Get3DMipMapSurface(MipMapLevel);
 				if (!pSurfaceD9)
 				{
 					LOG_LIMIT(100, __FUNCTION__ << " Error: could not find surface!");
@@ -3140,7 +3355,9 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 				}
 
 				// Release device context
-				if (FAILED(pSurfaceD9->ReleaseDC(hDC)))
+				HRESULT ret = pSurfaceD9->ReleaseDC(hDC);
+				Release3DMipMapSurface(pSurfaceD9, MipMapLevel);
+				if (FAILED(ret))
 				{
 					LOG_LIMIT(100, __FUNCTION__ << " Error: failed to release surface DC!");
 					hr = DDERR_GENERIC;
@@ -3153,6 +3370,7 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 
 			// Set LastDC
 			LastDC = nullptr;
+			LastDCMipMapLevel = 0;
 
 		} while (false);
 
@@ -3162,16 +3380,19 @@ HRESULT m_IDirectDrawSurfaceX::ReleaseDC(HDC hDC)
 		Logging::Log() << __FUNCTION__ << " (" << this << ") hr = " << (D3DERR)hr << " Timing = " << Logging::GetTimeLapseInMS(startTime);
 #endif
 
-		if (SUCCEEDED(hr))
+		if (SUCCEEDED(hr) && IsDCModified)
 		{
 			// Set dirty flag
-			SetDirtyFlag(0);
+			SetDirtyFlag(MipMapLevel);
 
-			// Keep surface insync
-			EndWriteSyncSurfaces(nullptr);
+			if (!MipMapLevel)
+			{
+				// Keep surface insync
+				EndWriteSyncSurfaces(lpDestRect);
 
-			// Present surface
-			EndWritePresent(nullptr, true, true, false);
+				// Present surface
+				EndWritePresent(lpDestRect, true, true, false);
+			}
 		}
 
 		if (FAILED(hr))
@@ -3440,9 +3661,9 @@ HRESULT m_IDirectDrawSurfaceX::SetPalette(LPDIRECTDRAWPALETTE lpDDPalette)
 
 HRESULT m_IDirectDrawSurfaceX::Unlock(LPRECT lpRect, DWORD MipMapLevel)
 {
-	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")" <<
-		" Rect = " << lpRect <<
-		" MipMapLevel = " << MipMapLevel;
+	LOG_TRACE(this, lpRect, MipMapLevel);
+
+	PROFILE_SCOPE();
 
 	if (Config.Dd7to9)
 	{
@@ -4473,6 +4694,11 @@ inline LPDIRECT3DSURFACE9 m_IDirectDrawSurfaceX::Get3DMipMapSurface(DWORD MipMap
 	}
 	else if (surface.Texture)
 	{
+		if (FAILED(CheckDeferredMipMapLevels(MipMapLevel)))
+		{
+			return nullptr;
+		}
+
 		LPDIRECT3DSURFACE9 pSurfaceD9 = nullptr;
 		surface.Texture->GetSurfaceLevel(GetD3d9MipMapLevel(MipMapLevel), &pSurfaceD9);
 		return pSurfaceD9;
@@ -4584,6 +4810,11 @@ void m_IDirectDrawSurfaceX::CheckMipMapLevelGen()
 
 HRESULT m_IDirectDrawSurfaceX::GenerateMipMapLevels()
 {
+	if (FAILED(CheckDeferredMipMapLevels(1)))
+	{
+		return DDERR_SURFACEBUSY;
+	}
+
 	IDirect3DSurface9* pSourceSurfaceD9 = Get3DMipMapSurface(0);
 	if (!pSourceSurfaceD9)
 	{
@@ -4617,6 +4848,68 @@ HRESULT m_IDirectDrawSurfaceX::GenerateMipMapLevels()
 	return DD_OK;
 }
 
+// Replace the top level only texture with one that has all the MipMap levels
+HRESULT m_IDirectDrawSurfaceX::CreateDeferredMipMapLevels()
+{
+	if (!IsMipMapChainDeferred)
+	{
+		return DD_OK;
+	}
+
+	// Texture cannot be replaced while the top level is in use
+	if (!DeferredMipMap::CanCreateChain(IsLocked, IsInDC))
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Warning: cannot add MipMap levels while surface is locked or in DC!");
+		return DDERR_SURFACEBUSY;
+	}
+
+	IsMipMapChainDeferred = false;
+
+	D3DSURFACE_DESC Desc = {};
+	LPDIRECT3DTEXTURE9 pNewTexture = nullptr;
+	if (!surface.Texture || FAILED(surface.Texture->GetLevelDesc(0, &Desc)) ||
+		FAILED((*d3d9Device)->CreateTexture(Desc.Width, Desc.Height, MaxMipMapLevel + 1, Desc.Usage, Desc.Format, Desc.Pool, &pNewTexture, nullptr)))
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: failed to create MipMap levels, using dummy levels. Size: " << surface.Width << "x" << surface.Height <<
+			" Format: " << surface.Format << " MipMapCount: " << (MaxMipMapLevel + 1));
+		MaxMipMapLevel = 0;
+		return DDERR_GENERIC;
+	}
+
+	// Copy top level to new texture
+	IDirect3DSurface9* pSourceSurfaceD9 = Get3DSurface();
+	IDirect3DSurface9* pDestSurfaceD9 = nullptr;
+	if (surface.HasData && pSourceSurfaceD9 && SUCCEEDED(pNewTexture->GetSurfaceLevel(0, &pDestSurfaceD9)))
+	{
+		if (FAILED(D3DXLoadSurfaceFromSurface(pDestSurfaceD9, nullptr, nullptr, pSourceSurfaceD9, nullptr, nullptr, D3DX_FILTER_NONE, 0x00000000)))
+		{
+			LOG_LIMIT(100, __FUNCTION__ << " Error: could not copy top level to MipMap texture!");
+		}
+		pDestSurfaceD9->Release();
+	}
+	if (Desc.Pool == D3DPOOL_MANAGED)
+	{
+		pNewTexture->SetLOD(surface.Texture->GetLOD());
+	}
+
+	// Replace texture
+	if (surface.Context)
+	{
+		surface.Context->Release();
+		surface.Context = nullptr;
+	}
+	surface.Texture->Release();
+	surface.Texture = pNewTexture;
+
+	// Update texture stages still using this surface, the old texture stays bound in Direct3D9 until then
+	if (m_IDirect3DDeviceX* D3DDeviceX = *ddrawParent->GetCurrentD3DDevice())
+	{
+		D3DDeviceX->ResetTextureSurface(this);
+	}
+
+	return DD_OK;
+}
+
 HRESULT m_IDirectDrawSurfaceX::CheckInterface(char *FunctionName, bool CheckD3DDevice, bool CheckD3DSurface, bool CheckLostSurface)
 {
 	// Check ddrawParent device
@@ -4915,10 +5208,12 @@ HRESULT m_IDirectDrawSurfaceX::CreateD9Surface()
 			surface.Type = D3DTYPE_TEXTURE;
 			DWORD MipMapCount = (surfaceDesc2.dwFlags & DDSD_MIPMAPCOUNT) ? surfaceDesc2.dwMipMapCount : 1;
 			DWORD MipMapLevel = (CreateSurfaceEmulated || !MipMapCount) ? 1 : MipMapCount;
+			// Create only the top level, the MipMap levels get added the first time one is used
+			IsMipMapChainDeferred = DeferredMipMap::ShouldDefer(Config.DdrawDeferMipMapLevels, Config.DdrawForceMipMapAutoGen, MipMapLevel, surface.Pool == D3DPOOL_DEFAULT);
 			HRESULT hr_t;
 			do {
 				surface.Usage = (Config.DdrawForceMipMapAutoGen && MipMapLevel > 1) ? D3DUSAGE_AUTOGENMIPMAP : 0;
-				DWORD Level = ((surface.Usage & D3DUSAGE_AUTOGENMIPMAP) && MipMapLevel == MipMapCount) ? 0 : MipMapLevel;
+				DWORD Level = ((surface.Usage & D3DUSAGE_AUTOGENMIPMAP) && MipMapLevel == MipMapCount) ? 0 : DeferredMipMap::GetCreateLevelCount(IsMipMapChainDeferred, MipMapLevel);
 				// Create texture
 				hr_t = (*d3d9Device)->CreateTexture(surface.Width, surface.Height, Level, surface.Usage, Format, surface.Pool, &surface.Texture, nullptr);
 				if (FAILED(hr_t))
@@ -4933,6 +5228,7 @@ HRESULT m_IDirectDrawSurfaceX::CreateD9Surface()
 				break;
 			}
 			MaxMipMapLevel = (MipMapLevel > 1 && !IsMipMapAutogen()) ? MipMapLevel - 1 : 0;
+			IsMipMapChainDeferred = (IsMipMapChainDeferred && MaxMipMapLevel);
 			while (MipMaps.size() < MaxMipMapLevel)
 			{
 				MIPMAP MipMap;
@@ -5258,16 +5554,50 @@ inline void m_IDirectDrawSurfaceX::UnsetEmulationGameDC()
 	}
 }
 
-HRESULT m_IDirectDrawSurfaceX::CreateDCSurface()
+// Get device context for a MipMap level, the emulated memory for the level is created on first use
+HRESULT m_IDirectDrawSurfaceX::GetEmulatedMipMapDC(HDC* lphDC, DWORD MipMapLevel)
 {
-	// Check if color masks are needed
-	bool ColorMaskReq = ((surface.BitCount == 16 || surface.BitCount == 24 || surface.BitCount == 32) &&									// Only valid when used with 16 bit, 24 bit and 32 bit surfaces
-		(surfaceDesc2.ddpfPixelFormat.dwRBitMask || surfaceDesc2.ddpfPixelFormat.dwGBitMask || surfaceDesc2.ddpfPixelFormat.dwBBitMask));	// Check to make sure the masks actually exist
+	if (!MipMapLevel || MipMapLevel > MipMaps.size())
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: invalid MipMap level: " << MipMapLevel);
+		return DDERR_INVALIDPARAMS;
+	}
+
+	MIPMAP& MipMap = MipMaps[MipMapLevel - 1];
+
+	// Create emulated surface for MipMap level
+	if (!MipMap.emu)
+	{
+		DWORD Width = DeferredMipMap::GetLevelSize(surface.Width ? surface.Width : surfaceDesc2.dwWidth, MipMapLevel);
+		DWORD Height = DeferredMipMap::GetLevelSize(surface.Height ? surface.Height : surfaceDesc2.dwHeight, MipMapLevel);
+
+		Logging::LogDebug() << __FUNCTION__ " (" << this << ") creating emulated MipMap surface. Size: " << Width << "x" << Height << " Format: " << surface.Format << " MipMapLevel: " << MipMapLevel;
+
+		if (FAILED(CreateEmulatedMemory(&MipMap.emu, GetByteAlignedWidth(Width, surface.BitCount), Height)))
+		{
+			return DDERR_GENERIC;
+		}
+	}
+
+	// Set new palette data
+	UpdatePaletteData();
 
+	// Copy MipMap level to emulated surface
+	if (FAILED(CopyEmulatedMipMapSurface(MipMapLevel, true)))
+	{
+		return DDERR_GENERIC;
+	}
+
+	*lphDC = MipMap.emu->DC;
+
+	return DD_OK;
+}
+
+HRESULT m_IDirectDrawSurfaceX::CreateDCSurface()
+{
 	// Adjust Width to be byte-aligned
 	DWORD Width = GetByteAlignedWidth(surfaceDesc2.dwWidth, surface.BitCount);
 	DWORD Height = surfaceDesc2.dwHeight;
-	DWORD Pitch = ComputePitch(surface.Format, Width, surface.BitCount);
 
 	// Check if emulated surface already exists
 	if (surface.emu)
@@ -5332,71 +5662,84 @@ HRESULT m_IDirectDrawSurfaceX::CreateDCSurface()
 
 	Logging::LogDebug() << __FUNCTION__ " (" << this << ") creating emulated surface. Size: " << Width << "x" << Height << " Format: " << surface.Format << " dwCaps: " << surfaceDesc2.ddsCaps;
 
+	return CreateEmulatedMemory(&surface.emu, Width, Height);
+}
+
+// Create device context memory for an emulated surface
+HRESULT m_IDirectDrawSurfaceX::CreateEmulatedMemory(EMUSURFACE** ppEmuSurface, DWORD Width, DWORD Height)
+{
+	// Check if color masks are needed
+	bool ColorMaskReq = ((surface.BitCount == 16 || surface.BitCount == 24 || surface.BitCount == 32) &&									// Only valid when used with 16 bit, 24 bit and 32 bit surfaces
+		(surfaceDesc2.ddpfPixelFormat.dwRBitMask || surfaceDesc2.ddpfPixelFormat.dwGBitMask || surfaceDesc2.ddpfPixelFormat.dwBBitMask));	// Check to make sure the masks actually exist
+
+	DWORD Pitch = ComputePitch(surface.Format, Width, surface.BitCount);
+
 	// Create new emulated surface structure
-	surface.emu = new EMUSURFACE;
+	EMUSURFACE* pEmuSurface = new EMUSURFACE;
+	*ppEmuSurface = pEmuSurface;
 
 	// Create device context memory
-	ZeroMemory(surface.emu->bmiMemory, sizeof(surface.emu->bmiMemory));
-	surface.emu->bmi->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-	surface.emu->bmi->bmiHeader.biWidth = Width;
-	surface.emu->bmi->bmiHeader.biHeight = -((LONG)Height + (LONG)ExtraDataBufferSize);
-	surface.emu->bmi->bmiHeader.biPlanes = 1;
-	surface.emu->bmi->bmiHeader.biBitCount = (WORD)surface.BitCount;
-	surface.emu->bmi->bmiHeader.biCompression =
+	ZeroMemory(pEmuSurface->bmiMemory, sizeof(pEmuSurface->bmiMemory));
+	pEmuSurface->bmi->bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	pEmuSurface->bmi->bmiHeader.biWidth = Width;
+	pEmuSurface->bmi->bmiHeader.biHeight = -((LONG)Height + (LONG)ExtraDataBufferSize);
+	pEmuSurface->bmi->bmiHeader.biPlanes = 1;
+	pEmuSurface->bmi->bmiHeader.biBitCount = (WORD)surface.BitCount;
+	pEmuSurface->bmi->bmiHeader.biCompression =
 		(surface.BitCount == 8 || surface.BitCount == 24) ? BI_RGB :
 		(ColorMaskReq) ? BI_BITFIELDS : 0;	// BI_BITFIELDS is only valid for 16-bpp and 32-bpp bitmaps.
-	surface.emu->bmi->bmiHeader.biSizeImage = ((Width * surface.BitCount + 31) & ~31) / 8 * Height;
+	pEmuSurface->bmi->bmiHeader.biSizeImage = ((Width * surface.BitCount + 31) & ~31) / 8 * Height;
 
 	if (surface.BitCount == 8)
 	{
 		for (int i = 0; i < 256; i++)
 		{
-			surface.emu->bmi->bmiColors[i].rgbRed = (byte)i;
-			surface.emu->bmi->bmiColors[i].rgbGreen = (byte)i;
-			surface.emu->bmi->bmiColors[i].rgbBlue = (byte)i;
-			surface.emu->bmi->bmiColors[i].rgbReserved = 0;
+			pEmuSurface->bmi->bmiColors[i].rgbRed = (byte)i;
+			pEmuSurface->bmi->bmiColors[i].rgbGreen = (byte)i;
+			pEmuSurface->bmi->bmiColors[i].rgbBlue = (byte)i;
+			pEmuSurface->bmi->bmiColors[i].rgbReserved = 0;
 		}
 	}
 	else if (ColorMaskReq)
 	{
-		((DWORD*)surface.emu->bmi->bmiColors)[0] = surfaceDesc2.ddpfPixelFormat.dwRBitMask;
-		((DWORD*)surface.emu->bmi->bmiColors)[1] = surfaceDesc2.ddpfPixelFormat.dwGBitMask;
-		((DWORD*)surface.emu->bmi->bmiColors)[2] = surfaceDesc2.ddpfPixelFormat.dwBBitMask;
-		((DWORD*)surface.emu->bmi->bmiColors)[3] = surfaceDesc2.ddpfPixelFormat.dwRGBAlphaBitMask;
+		((DWORD*)pEmuSurface->bmi->bmiColors)[0] = surfaceDesc2.ddpfPixelFormat.dwRBitMask;
+		((DWORD*)pEmuSurface->bmi->bmiColors)[1] = surfaceDesc2.ddpfPixelFormat.dwGBitMask;
+		((DWORD*)pEmuSurface->bmi->bmiColors)[2] = surfaceDesc2.ddpfPixelFormat.dwBBitMask;
+		((DWORD*)pEmuSurface->bmi->bmiColors)[3] = surfaceDesc2.ddpfPixelFormat.dwRGBAlphaBitMask;
 	}
 	else
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: failed to set bmi colors! " << surface.Format << " " << surface.BitCount);
-		DeleteEmulatedMemory(&surface.emu);
+		DeleteEmulatedMemory(ppEmuSurface);
 		return DDERR_GENERIC;
 	}
 	HDC hDC = ddrawParent->GetDC();
-	surface.emu->DC = CreateCompatibleDC(hDC);
-	surface.emu->GameDC = CreateCompatibleDC(hDC);
-	if (!surface.emu->DC || !surface.emu->GameDC)
+	pEmuSurface->DC = CreateCompatibleDC(hDC);
+	pEmuSurface->GameDC = CreateCompatibleDC(hDC);
+	if (!pEmuSurface->DC || !pEmuSurface->GameDC)
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: failed to create compatible DC: " << hDC << " " << surface.Format);
-		DeleteEmulatedMemory(&surface.emu);
+		DeleteEmulatedMemory(ppEmuSurface);
 		return DDERR_GENERIC;
 	}
-	surface.emu->bitmap = CreateDIBSection(surface.emu->DC, surface.emu->bmi, (surface.BitCount == 8) ? DIB_PAL_COLORS : DIB_RGB_COLORS, (void**)&surface.emu->pBits, nullptr, 0);
-	if (!surface.emu->bitmap)
+	pEmuSurface->bitmap = CreateDIBSection(pEmuSurface->DC, pEmuSurface->bmi, (surface.BitCount == 8) ? DIB_PAL_COLORS : DIB_RGB_COLORS, (void**)&pEmuSurface->pBits, nullptr, 0);
+	if (!pEmuSurface->bitmap)
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: failed to create bitmap!");
-		DeleteEmulatedMemory(&surface.emu);
+		DeleteEmulatedMemory(ppEmuSurface);
 		return DDERR_GENERIC;
 	}
-	surface.emu->OldDCObject = SelectObject(surface.emu->DC, surface.emu->bitmap);
-	if (!surface.emu->OldDCObject || surface.emu->OldDCObject == HGDI_ERROR)
+	pEmuSurface->OldDCObject = SelectObject(pEmuSurface->DC, pEmuSurface->bitmap);
+	if (!pEmuSurface->OldDCObject || pEmuSurface->OldDCObject == HGDI_ERROR)
 	{
 		LOG_LIMIT(100, __FUNCTION__ << " Error: failed to replace object in DC!");
-		DeleteEmulatedMemory(&surface.emu);
+		DeleteEmulatedMemory(ppEmuSurface);
 		return DDERR_GENERIC;
 	}
-	surface.emu->bmi->bmiHeader.biHeight = -(LONG)Height;
-	surface.emu->Format = surface.Format;
-	surface.emu->Pitch = Pitch;
-	surface.emu->Size = Height * Pitch;
+	pEmuSurface->bmi->bmiHeader.biHeight = -(LONG)Height;
+	pEmuSurface->Format = surface.Format;
+	pEmuSurface->Pitch = Pitch;
+	pEmuSurface->Size = Height * Pitch;
 
 	return DD_OK;
 }
@@ -5711,7 +6054,7 @@ void m_IDirectDrawSurfaceX::ReleaseD9Surface(bool BackupData, bool ResetSurface)
 
 			if (!IsUsingEmulation() && LostDeviceBackup.empty())
 			{
-				for (UINT Level = 0; Level < ((IsMipMapAutogen() || !MaxMipMapLevel) ? 1 : MaxMipMapLevel); Level++)
+				for (UINT Level = 0; Level < ((IsMipMapAutogen() || !MaxMipMapLevel || IsMipMapChainDeferred) ? 1 : MaxMipMapLevel); Level++)
 				{
 					D3DLOCKED_RECT LockRect = {};
 					if (FAILED(LockD3d9Surface(&LockRect, nullptr, D3DLOCK_READONLY, Level)))
@@ -5779,6 +6122,13 @@ void m_IDirectDrawSurfaceX::ReleaseD9Surface(bool BackupData, bool ResetSurface)
 			Logging::Log() << __FUNCTION__ << " Error: there is still a reference to 'surfaceTexture' " << ref;
 		}
 		surface.Texture = nullptr;
+		IsMipMapChainDeferred = false;
+	}
+
+	// Release emulated MipMap levels, they get recreated from the texture on the next GetDC
+	for (MIPMAP& MipMap : MipMaps)
+	{
+		DeleteEmulatedMemory(&MipMap.emu);
 	}
 
 	// Clear locked rects
@@ -6267,6 +6617,16 @@ void m_IDirectDrawSurfaceX::SetDirtyFlag(DWORD MipMapLevel)
 	}
 }
 
+// Draw batched primitives that use this surface before its contents change
+void m_IDirectDrawSurfaceX::FlushD3DDeviceBatch()
+{
+	m_IDirect3DDeviceX* D3DDeviceX = (ddrawParent) ? *ddrawParent->GetCurrentD3DDevice() : nullptr;
+	if (D3DDeviceX)
+	{
+		D3DDeviceX->FlushImmediateBatch(this);
+	}
+}
+
 void m_IDirectDrawSurfaceX::ClearDirtyFlags()
 {
 	// Reset dirty flag
@@ -6860,6 +7220,12 @@ HRESULT m_IDirectDrawSurfaceX::CopySurface(m_IDirectDrawSurfaceX* pSourceSurface
 		return (c_hr == DDERR_SURFACELOST || s_hr == DDERR_SURFACELOST) ? DDERR_SURFACELOST : FAILED(c_hr) ? c_hr : s_hr;
 	}
 
+	// Add MipMap levels before either surface gets locked
+	if (FAILED(CheckDeferredMipMapLevels(MipMapLevel)) || FAILED(pSourceSurface->CheckDeferredMipMapLevels(SrcMipMapLevel)))
+	{
+		return DDERR_SURFACEBUSY;
+	}
+
 	// Get surface desc for mipmap
 	DDSURFACEDESC2 SrcDesc2 = {}, DestDesc2 = {};
 	SrcDesc2.dwSize = sizeof(DDSURFACEDESC2);
@@ -7716,6 +8082,62 @@ HRESULT m_IDirectDrawSurfaceX::CopyToEmulatedSurface(LPRECT lpDestRect)
 	return hr;
 }
 
+// Copy between a MipMap level and its emulated surface
+HRESULT m_IDirectDrawSurfaceX::CopyEmulatedMipMapSurface(DWORD MipMapLevel, bool CopyToEmulated)
+{
+	EMUSURFACE* pEmuSurface = (MipMapLevel && MipMapLevel <= MipMaps.size()) ? MipMaps[MipMapLevel - 1].emu : nullptr;
+	if (!pEmuSurface || !pEmuSurface->pBits)
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: MipMap level is not using emulation: " << MipMapLevel);
+		return DDERR_GENERIC;
+	}
+
+	// Dummy MipMap levels only exist in emulated memory
+	if (IsDummyMipMap(MipMapLevel))
+	{
+		return DD_OK;
+	}
+
+	D3DLOCKED_RECT LockRect = {};
+	if (FAILED(LockD3d9Surface(&LockRect, nullptr, CopyToEmulated ? D3DLOCK_READONLY : 0, MipMapLevel)))
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: could not lock MipMap level: " << MipMapLevel);
+		return (IsSurfaceLocked()) ? DDERR_SURFACEBUSY : DDERR_GENERIC;
+	}
+
+	// Only levels stored with the same bit count can be copied directly
+	D3DSURFACE_DESC Desc = {};
+	if (!surface.Texture || FAILED(surface.Texture->GetLevelDesc(GetD3d9MipMapLevel(MipMapLevel), &Desc)) || GetBitCount(Desc.Format) != surface.BitCount)
+	{
+		LOG_LIMIT(100, __FUNCTION__ << " Error: MipMap level format not supported: " << Desc.Format << " -> " << surface.Format);
+		UnLockD3d9Surface(MipMapLevel);
+		return DDERR_UNSUPPORTED;
+	}
+
+	BYTE* SurfaceBuffer = (BYTE*)LockRect.pBits;
+	BYTE* EmulatedBuffer = (BYTE*)pEmuSurface->pBits;
+	DWORD Height = min(Desc.Height, (DWORD)-pEmuSurface->bmi->bmiHeader.biHeight);
+	DWORD WidthPitch = min(Desc.Width * surface.BitCount / 8, pEmuSurface->Pitch);
+
+	for (DWORD y = 0; y < Height; y++)
+	{
+		if (CopyToEmulated)
+		{
+			memcpy(EmulatedBuffer, SurfaceBuffer, WidthPitch);
+		}
+		else
+		{
+			memcpy(SurfaceBuffer, EmulatedBuffer, WidthPitch);
+		}
+		SurfaceBuffer += LockRect.Pitch;
+		EmulatedBuffer += pEmuSurface->Pitch;
+	}
+
+	UnLockD3d9Surface(MipMapLevel);
+
+	return DD_OK;
+}
+
 inline HRESULT m_IDirectDrawSurfaceX::CopyEmulatedPaletteSurface(LPRECT lpDestRect)
 {
 	if (!IsPalette())
@@ -8129,6 +8551,16 @@ void m_IDirectDrawSurfaceX::UpdatePaletteData()
 		surface.emu->LastPaletteUSN = NewPaletteUSN;
 	}
 
+	// Set color palette for emulated MipMap levels
+	for (MIPMAP& MipMap : MipMaps)
+	{
+		if (MipMap.emu && NewRGBPalette && MipMap.emu->LastPaletteUSN != NewPaletteUSN)
+		{
+			SetDIBColorTable(MipMap.emu->DC, 0, MaxPaletteSize, NewRGBPalette);
+			MipMap.emu->LastPaletteUSN = NewPaletteUSN;
+		}
+	}
+
 	// Set new palette data
 	if (NewPaletteEntry && surface.LastPaletteUSN != NewPaletteUSN)
 	{
@@ -60,6 +60,7 @@ private:
 		LONG lPitch = 0;
 		DWORD UniquenessValue = 0;
 		bool IsDummy = false;
+		EMUSURFACE* emu = nullptr;
 	};
 
 	// For aligning bits after a lock for games that hard code the pitch
@@ -170,6 +171,7 @@ private:
 	SURFACEOVERLAY SurfaceOverlay;						// The overlays for this surface
 	std::vector<MIPMAP> MipMaps;						// MipMaps structure with addresses
 	DWORD MaxMipMapLevel = 0;							// Total number of manually created MipMap levels
+	bool IsMipMapChainDeferred = false;					// Texture only has the top level until a MipMap level is used
 	bool IsMipMapReadyToUse = false;					// Used for MipMap filtering
 	bool RecreateAuxiliarySurfaces = false;
 	LPDIRECT3DTEXTURE9 PrimaryDisplayTexture = nullptr;	// Used for the texture surface for the primary surface
@@ -194,6 +196,7 @@ private:
 	bool IsInDC = false;
 	bool IsPreparingDC = false;
 	HDC LastDC = nullptr;
+	DWORD LastDCMipMapLevel = 0;
 	bool IsInBlt = false;
 	bool IsInBltBatch = false;
 	bool IsLocked = false;
@@ -268,6 +271,7 @@ private:
 	void Release3DMipMapSurface(LPDIRECT3DSURFACE9 pSurfaceD9, DWORD MipMapLevel);
 	LPDIRECT3DTEXTURE9 Get3DTexture();
 	void CheckMipMapLevelGen();
+	HRESULT CreateDeferredMipMapLevels();
 	HRESULT CheckInterface(char* FunctionName, bool CheckD3DDevice, bool CheckD3DSurface, bool CheckLostSurface);
 	HRESULT CreateD9AuxiliarySurfaces();
 	HRESULT CreateD9Surface();
@@ -275,7 +279,9 @@ private:
 	void SetEmulationGameDC();
 	void UnsetEmulationGameDC();
 	HRESULT CreateDCSurface();
+	HRESULT CreateEmulatedMemory(EMUSURFACE** ppEmuSurface, DWORD Width, DWORD Height);
 	void ReleaseDCSurface();
+	HRESULT GetEmulatedMipMapDC(HDC* lphDC, DWORD MipMapLevel);
 	void UpdateAttachedDepthStencil(m_IDirectDrawSurfaceX* lpAttachedSurfaceX);
 	void UpdateSurfaceDesc();
 
@@ -307,12 +313,15 @@ private:
 	inline bool IsLockedFromOtherThread() const { return (IsSurfaceBlitting() || IsSurfaceLocked()) && LockedWithID && LockedWithID != GetCurrentThreadId(); }
 	inline bool IsDummyMipMap(DWORD MipMapLevel) { return (MipMapLevel > MaxMipMapLevel || ((MipMapLevel & ~DXW_IS_MIPMAP_DUMMY) - 1 < MipMaps.size() && MipMaps[(MipMapLevel & ~DXW_IS_MIPMAP_DUMMY) - 1].IsDummy)); }
 	inline DWORD GetD3d9MipMapLevel(DWORD MipMapLevel) const { return min(MipMapLevel, MaxMipMapLevel); }
+	inline bool IsMipMapDCEmulated(DWORD MipMapLevel) { return DeferredMipMap::IsDCEmulated(IsUsingEmulation(), DCRequiresEmulation, IsDummyMipMap(MipMapLevel)); }
+	inline HRESULT CheckDeferredMipMapLevels(DWORD MipMapLevel) { return (DeferredMipMap::IsChainRequired(IsMipMapChainDeferred, MipMapLevel) && FAILED(CreateDeferredMipMapLevels()) && IsMipMapChainDeferred) ? DDERR_SURFACEBUSY : DD_OK; }
 	inline DWORD GetWidth() const { return surfaceDesc2.dwWidth; }
 	inline DWORD GetHeight() const { return surfaceDesc2.dwHeight; }
 	inline DDSCAPS2 GetSurfaceCaps() const { return surfaceDesc2.ddsCaps; }
 	inline D3DFORMAT GetSurfaceFormat() const { return surface.Format; }
 
 	void SetDirtyFlag(DWORD MipMapLevel);
+	void FlushD3DDeviceBatch();
 
 	// Attached surfaces
 	void InitSurfaceDesc(DWORD DirectXVersion);
@@ -326,10 +335,12 @@ private:
 	HRESULT SaveDXTDataToDDS(const void* data, size_t dataSize, const char* filename, int dxtVersion) const;
 	HRESULT SaveSurfaceToFile(const char* filename, D3DXIMAGE_FILEFORMAT format);
 	HRESULT CopySurface(m_IDirectDrawSurfaceX* pSourceSurface, RECT* pSourceRect, RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter, D3DCOLOR ColorKey, DWORD dwFlags, DWORD SrcMipMapLevel, DWORD MipMapLevel);
+	HRESULT BltBatchCopy(LPDDBLTBATCH lpDDBltBatch, DWORD dwCount, DWORD MipMapLevel, bool& IsSkipScene);
 	HRESULT CopyToDrawTexture(LPRECT lpDestRect);
 	HRESULT LoadSurfaceFromMemory(LPDIRECT3DSURFACE9 pDestSurface, const RECT& Rect, LPCVOID pSrcMemory, D3DFORMAT SrcFormat, UINT SrcPitch);
 	HRESULT CopyFromEmulatedSurface(LPRECT lpDestRect);
 	HRESULT CopyToEmulatedSurface(LPRECT lpDestRect);
+	HRESULT CopyEmulatedMipMapSurface(DWORD MipMapLevel, bool CopyToEmulated);
 	HRESULT CopyEmulatedPaletteSurface(LPRECT lpDestRect);
 	HRESULT CopyEmulatedSurfaceFromGDI(LPRECT lpDestRect);
 	HRESULT CopyEmulatedSurfaceToGDI(LPRECT lpDestRect);
@@ -214,6 +214,7 @@ HRESULT m_IDirect3DDevice7::SetRenderState(D3DRENDERSTATETYPE a, DWORD b)
 	{
 		return DDERR_INVALIDOBJECT;
 	}
+	ProxyInterface->AddStateStats();
 	return ProxyInterface->SetRenderState(a, b);
 }
 
@@ -371,6 +372,7 @@ HRESULT m_IDirect3DDevice7::SetTextureStageState(DWORD a, D3DTEXTURESTAGESTATETY
 	{
 		return DDERR_INVALIDOBJECT;
 	}
+	ProxyInterface->AddStateStats();
 	return ProxyInterface->SetTextureStageState(a, b, c);
 }
 
@@ -168,6 +168,8 @@ using namespace DdrawWrapper;
 #include "IDirect3DTypes.h"
 // DirectDraw Helpers
 #include "IDirectDrawTypes.h"
+#include "DeferredMipMap.h"
+#include "BltBatchRun.h"
 // DirectDraw Interfaces
 #include "IDirectDrawClipper.h"
 #include "IDirectDrawColorControl.h"
@@ -18,6 +18,20 @@
 
 constexpr DWORD SignBit = 0x80000000;
 
+namespace DeviceStateSnapshot
+{
+	// Created with the other statics at DLL attach, so devices on different threads never race to initialize it
+	struct SNAPSHOTLOCK {
+		CRITICAL_SECTION dscs;
+		SNAPSHOTLOCK() { InitializeCriticalSection(&dscs); }
+	} Lock;
+	HANDLE hWorkerThread = nullptr;
+	bool m_StopThreadFlag = false;
+	std::vector<m_IDirectInputDevice8*> Devices;
+
+	DWORD WINAPI WorkerThreadFunction(LPVOID);
+}
+
 HRESULT m_IDirectInputDevice8::QueryInterface(REFIID riid, LPVOID* ppvObj)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
@@ -52,7 +66,7 @@ ULONG m_IDirectInputDevice8::Release()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	ULONG ref = ProxyInterface->Release();
+	ULONG ref = (Snapshot.IsRegistered) ? DeviceStateSnapshot::ReleaseDevice(this, ProxyInterface) : ProxyInterface->Release();
 
 	if (ref == 0)
 	{
@@ -120,13 +134,31 @@ HRESULT m_IDirectInputDevice8::Acquire()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->Acquire();
+	HRESULT hr = ProxyInterface->Acquire();
+
+	// Mice are left out since reading relative axes on the worker would consume the movement
+	if (SUCCEEDED(hr) && Config.DeviceStateSnapshotMS && !IsMouse && !Snapshot.IsRegistered)
+	{
+		DIDEVCAPS Caps = {};
+		Caps.dwSize = sizeof(DIDEVCAPS);
+		if (SUCCEEDED(ProxyInterface->GetCapabilities(&Caps)) && GET_DIDEVICE_TYPE(Caps.dwDevType) != DI8DEVTYPE_MOUSE)
+		{
+			Snapshot.IsPolled = (Caps.dwFlags & (DIDC_POLLEDDEVICE | DIDC_POLLEDDATAFORMAT)) != 0;
+			Snapshot.IsRegistered = true;
+
+			DeviceStateSnapshot::AddDevice(this);
+		}
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirectInputDevice8::Unacquire()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	ResetSnapshot();
+
 	return ProxyInterface->Unacquire();
 }
 
@@ -134,6 +166,26 @@ HRESULT m_IDirectInputDevice8::GetDeviceState(DWORD cbData, LPVOID lpvData)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	// Snapshots are not updated while another process is in the foreground
+	if (Snapshot.IsRegistered && lpvData && cbData && cbData <= MaxSnapshotSize &&
+		(!Config.FilterNonActiveInput || DeviceStateSnapshot::IsForegroundProcess(ProcessID)))
+	{
+		// Only a snapshot taken after the previous poll is used, otherwise the state is read now
+		const LONGLONG LastReadTicks = Snapshot.LastReadTicks;
+		Snapshot.LastReadTicks = DeviceStateSnapshot::GetTicks();
+
+		HRESULT hr;
+		if (Snapshot.Size == cbData && ReadSnapshot(cbData, lpvData, LastReadTicks, hr))
+		{
+			return hr;
+		}
+
+		// Worker picks up the size on its next pass
+		Snapshot.Size = cbData;
+	}
+
 	return ProxyInterface->GetDeviceState(cbData, lpvData);
 }
 
@@ -333,18 +385,10 @@ HRESULT m_IDirectInputDevice8::GetDeviceData(DWORD cbObjectData, LPDIDEVICEOBJEC
 
 	if (Config.FilterNonActiveInput && pdwInOut)
 	{
-		// Check foreground window's process and don't copy device data if process is not active
-		HWND hfgwnd = GetForegroundWindow();
-		if (hfgwnd)
+		// Foreground window belongs to another process, don't copy the device data
+		if (!DeviceStateSnapshot::IsForegroundProcess(ProcessID))
 		{
-			DWORD fgwndprocid = 0;
-			GetWindowThreadProcessId(hfgwnd, &fgwndprocid);
-
-			if (ProcessID != fgwndprocid)
-			{
-				// Foreground window belongs to another process, don't copy the device data
-				*pdwInOut = 0;
-			}
+			*pdwInOut = 0;
 		}
 	}
 
@@ -360,6 +404,8 @@ HRESULT m_IDirectInputDevice8::SetDataFormat(LPCDIDATAFORMAT lpdf)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	ResetSnapshot();
+
 	return ProxyInterface->SetDataFormat(lpdf);
 }
 
@@ -502,6 +548,12 @@ HRESULT m_IDirectInputDevice8::Poll()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	// Snapshots taken before this poll are older than what the application asked for
+	if (Snapshot.IsRegistered)
+	{
+		Snapshot.LastReadTicks = DeviceStateSnapshot::GetTicks();
+	}
+
 	return ProxyInterface->Poll();
 }
 
@@ -561,3 +613,200 @@ HRESULT m_IDirectInputDevice8::GetImageInfoT(V lpdiDevImageInfoHeader)
 
 	return GetProxyInterface<T>()->GetImageInfo(lpdiDevImageInfoHeader);
 }
+
+// Helper functions
+bool m_IDirectInputDevice8::ReadSnapshot(DWORD cbData, LPVOID lpvData, LONGLONG MinTicks, HRESULT& hr)
+{
+	// Retry if the worker published while copying, the slot being read is only reused after the next publish
+	for (UINT x = 0; x < 4; x++)
+	{
+		const LONG Sequence = Snapshot.Sequence;
+		MemoryBarrier();
+
+		const UINT Slot = Sequence & 1;
+		if (Snapshot.SlotSize[Slot] != cbData || Snapshot.SlotTicks[Slot] < MinTicks)
+		{
+			return false;
+		}
+		memcpy(lpvData, Snapshot.Data[Slot], cbData);
+		hr = Snapshot.Result[Slot];
+
+		MemoryBarrier();
+		if (Snapshot.Sequence == Sequence)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void m_IDirectInputDevice8::ResetSnapshot()
+{
+	if (!Snapshot.IsRegistered)
+	{
+		return;
+	}
+
+	DeviceStateSnapshot::RemoveDevice(this);
+
+	Snapshot.IsRegistered = false;
+	Snapshot.Size = 0;
+	Snapshot.SlotSize[0] = 0;
+	Snapshot.SlotSize[1] = 0;
+}
+
+// Called on the worker with the snapshot lock held
+void m_IDirectInputDevice8::UpdateSnapshot()
+{
+	const DWORD Size = Snapshot.Size;
+	if (!Size)
+	{
+		return;
+	}
+
+	const UINT Slot = (Snapshot.Sequence + 1) & 1;
+
+	Snapshot.SlotTicks[Slot] = DeviceStateSnapshot::GetTicks();
+	if (Snapshot.IsPolled)
+	{
+		ProxyInterface->Poll();
+	}
+	Snapshot.Result[Slot] = ProxyInterface->GetDeviceState(Size, Snapshot.Data[Slot]);
+	Snapshot.SlotSize[Slot] = Size;
+
+	InterlockedIncrement(&Snapshot.Sequence);
+}
+
+void DeviceStateSnapshot::AddDevice(m_IDirectInputDevice8* pDevice)
+{
+	EnterCriticalSection(&Lock.dscs);
+
+	if (std::find(Devices.begin(), Devices.end(), pDevice) == Devices.end())
+	{
+		Devices.push_back(pDevice);
+	}
+
+	if (!hWorkerThread && !m_StopThreadFlag)
+	{
+		hWorkerThread = CreateThread(nullptr, 0, WorkerThreadFunction, nullptr, 0, nullptr);
+		if (!hWorkerThread)
+		{
+			Logging::Log() << __FUNCTION__ << " Error: failed to create device state snapshot thread!";
+		}
+	}
+
+	LeaveCriticalSection(&Lock.dscs);
+}
+
+void DeviceStateSnapshot::RemoveDevice(m_IDirectInputDevice8* pDevice)
+{
+	EnterCriticalSection(&Lock.dscs);
+
+	Devices.erase(std::remove(Devices.begin(), Devices.end(), pDevice), Devices.end());
+
+	LeaveCriticalSection(&Lock.dscs);
+}
+
+// Releases the proxy while the worker is not using it, so a device is never polled after its last release
+ULONG DeviceStateSnapshot::ReleaseDevice(m_IDirectInputDevice8* pDevice, IDirectInputDevice8W* pProxy)
+{
+	EnterCriticalSection(&Lock.dscs);
+
+	ULONG ref = pProxy->Release();
+
+	if (ref == 0)
+	{
+		Devices.erase(std::remove(Devices.begin(), Devices.end(), pDevice), Devices.end());
+	}
+
+	LeaveCriticalSection(&Lock.dscs);
+
+	return ref;
+}
+
+// Stop thread
+void DeviceStateSnapshot::StopThread()
+{
+	EnterCriticalSection(&Lock.dscs);
+
+	// Set flag to stop thread
+	m_StopThreadFlag = true;
+
+	HANDLE hThread = hWorkerThread;
+	hWorkerThread = nullptr;
+
+	LeaveCriticalSection(&Lock.dscs);
+
+	// Wait for thread to exit
+	if (hThread)
+	{
+		Logging::Log() << __FUNCTION__ << " Stopping thread...";
+
+		WaitForSingleObject(hThread, INFINITE);
+		CloseHandle(hThread);
+
+		// Thread stopped
+		Logging::Log() << __FUNCTION__ << " thread stopped";
+	}
+}
+
+LONGLONG DeviceStateSnapshot::GetTicks()
+{
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	return Counter.QuadPart;
+}
+
+bool DeviceStateSnapshot::IsForegroundProcess(DWORD ProcessID)
+{
+	HWND hfgwnd = GetForegroundWindow();
+	if (hfgwnd)
+	{
+		DWORD fgwndprocid = 0;
+		GetWindowThreadProcessId(hfgwnd, &fgwndprocid);
+
+		return (ProcessID == fgwndprocid);
+	}
+
+	return true;
+}
+
+DWORD WINAPI DeviceStateSnapshot::WorkerThreadFunction(LPVOID)
+{
+	const DWORD ProcessID = GetCurrentProcessId();
+
+	while (true)
+	{
+		EnterCriticalSection(&Lock.dscs);
+
+		// StopThread owns the handle once it is stopping the thread
+		if (m_StopThreadFlag)
+		{
+			LeaveCriticalSection(&Lock.dscs);
+			return 0;
+		}
+
+		// Exit once all devices are gone, a new thread is started with the next device
+		if (Devices.empty())
+		{
+			CloseHandle(hWorkerThread);
+			hWorkerThread = nullptr;
+
+			LeaveCriticalSection(&Lock.dscs);
+			return 0;
+		}
+
+		if (!Config.FilterNonActiveInput || IsForegroundProcess(ProcessID))
+		{
+			for (m_IDirectInputDevice8* pDevice : Devices)
+			{
+				pDevice->UpdateSnapshot();
+			}
+		}
+
+		LeaveCriticalSection(&Lock.dscs);
+
+		Sleep(Config.DeviceStateSnapshotMS);
+	}
+}
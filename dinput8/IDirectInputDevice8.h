@@ -1,5 +1,15 @@
 #pragma once
 
+namespace DeviceStateSnapshot
+{
+	void AddDevice(m_IDirectInputDevice8* pDevice);
+	void RemoveDevice(m_IDirectInputDevice8* pDevice);
+	ULONG ReleaseDevice(m_IDirectInputDevice8* pDevice, IDirectInputDevice8W* pProxy);
+	bool IsForegroundProcess(DWORD ProcessID);
+	LONGLONG GetTicks();
+	void StopThread();
+}
+
 class m_IDirectInputDevice8 : public IDirectInputDevice8A, public IDirectInputDevice8W, public AddressLookupTableDinput8Object
 {
 private:
@@ -25,6 +35,22 @@ private:
 	std::vector<DIDEVICEOBJECTDATA_DX3> dod_dx3;
 	std::vector<DIDEVICEOBJECTDATA> dod_dx8;
 
+	// Device state polled by the snapshot worker, the worker fills one slot while GetDeviceState reads the other
+	static constexpr DWORD MaxSnapshotSize = 1024;
+	struct {
+		bool IsRegistered = false;
+		bool IsPolled = false;
+		volatile DWORD Size = 0;
+		volatile LONG Sequence = 0;
+		DWORD SlotSize[2] = {};
+		LONGLONG SlotTicks[2] = {};		// When the worker started reading each slot
+		LONGLONG LastReadTicks = 0;		// Previous application Poll or GetDeviceState call
+		HRESULT Result[2] = {};
+		BYTE Data[2][MaxSnapshotSize] = {};
+	} Snapshot;
+	bool ReadSnapshot(DWORD cbData, LPVOID lpvData, LONGLONG MinTicks, HRESULT& hr);
+	void ResetSnapshot();
+
 	template <class T>
 	inline LPDIDEVICEOBJECTDATA GetObjectDataBuffer(T& dod, DWORD dwBufferSize, DWORD& dwItems)
 	{
@@ -86,6 +112,11 @@ public:
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
 
+		if (Snapshot.IsRegistered)
+		{
+			DeviceStateSnapshot::RemoveDevice(this);
+		}
+
 		DeleteCriticalSection(&dics);
 
 		ProxyAddressLookupTableDinput8.DeleteAddress(this);
@@ -200,4 +231,5 @@ public:
 
 	// Helper functions
 	void SetAsMouse() { IsMouse = true; }
+	void UpdateSnapshot();
 };
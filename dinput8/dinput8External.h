@@ -13,6 +13,11 @@ HRESULT WINAPI di8_DllRegisterServer();
 HRESULT WINAPI di8_DllUnregisterServer();
 LPCDIDATAFORMAT WINAPI di8_GetdfDIJoystick();
 
+namespace DeviceStateSnapshot
+{
+	void StopThread();
+}
+
 #define DECLARE_IN_WRAPPED_PROC(procName, unused) \
 	const FARPROC procName ## _in = (FARPROC)*di8_ ## procName;
 
@@ -0,0 +1,63 @@
+#pragma once
+
+// Play and write cursors of a looping buffer extrapolated from the last driver query. Times are performance counter
+// ticks passed in by the caller, callers must hold the buffer's cursor estimate lock.
+struct CURSORESTIMATE
+{
+	bool IsValid = false;
+	bool IsFormatSet = false;
+	DWORD BufferBytes = 0;
+	DWORD BlockAlign = 0;
+	ULONGLONG BytesPerSecond = 0;
+	DWORD PlayCursor = 0;
+	DWORD WriteLead = 0;
+	LONGLONG SyncTime = 0;
+
+	void SetFormat(DWORD dwBufferBytes, DWORD nBlockAlign, DWORD dwFrequency)
+	{
+		BufferBytes = dwBufferBytes;
+		BlockAlign = nBlockAlign;
+		BytesPerSecond = (ULONGLONG)nBlockAlign * dwFrequency;
+		IsFormatSet = (dwBufferBytes && nBlockAlign && dwFrequency);
+	}
+
+	// Starts a new estimate from the cursors the driver returned at Now
+	void Sync(DWORD dwPlayCursor, DWORD dwWriteCursor, LONGLONG Now)
+	{
+		IsValid = false;
+		if (IsFormatSet && dwPlayCursor < BufferBytes && dwWriteCursor < BufferBytes)
+		{
+			PlayCursor = dwPlayCursor;
+			WriteLead = (dwWriteCursor + BufferBytes - dwPlayCursor) % BufferBytes;
+			SyncTime = Now;
+			IsValid = true;
+		}
+	}
+
+	// Gets the extrapolated cursors, returns false once ResyncMS have passed since the last sync
+	bool Get(LONGLONG Now, LONGLONG Frequency, DWORD ResyncMS, DWORD& dwPlayCursor, DWORD& dwWriteCursor) const
+	{
+		const LONGLONG Elapsed = Now - SyncTime;
+		if (!IsValid || Elapsed < 0 || Elapsed * 1000 >= (LONGLONG)ResyncMS * Frequency)
+		{
+			return false;
+		}
+
+		// Driver cursors trail the real playback position, so extrapolating from them at the nominal rate does not overtake it
+		DWORD Advance = (DWORD)(Elapsed * BytesPerSecond / Frequency);
+		Advance -= Advance % BlockAlign;
+
+		dwPlayCursor = (PlayCursor + Advance) % BufferBytes;
+		dwWriteCursor = (dwPlayCursor + WriteLead) % BufferBytes;
+		return true;
+	}
+
+	void Invalidate(bool FormatChanged)
+	{
+		IsValid = false;
+		if (FormatChanged)
+		{
+			IsFormatSet = false;
+		}
+	}
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Bookkeeping for 3D updates deferred by the wrapper. CommitDeferredSettings on a listener commits the deferred
+// updates of every buffer on its device, so the state is kept per device. Callers must hold the deferred lock.
+template <typename T>
+class DEFERRED3DSTATE
+{
+private:
+	struct DEVICESTATE
+	{
+		void* pDevice = nullptr;
+		std::vector<T*> Listeners;
+		bool IsPending = false;
+		bool IsAppPending = false;		// Application has its own deferred updates waiting for CommitDeferredSettings
+	};
+	std::vector<DEVICESTATE> Devices;
+
+	DEVICESTATE* FindDevice(void* pDevice)
+	{
+		for (auto& entry : Devices)
+		{
+			if (entry.pDevice == pDevice)
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	// Deferring is only done while the device has a single listener to commit through
+	static T* GetCommitListener(const DEVICESTATE& Device)
+	{
+		return (Device.Listeners.size() == 1) ? Device.Listeners[0] : nullptr;
+	}
+
+	static void CommitPending(DEVICESTATE& Device)
+	{
+		// Committing now would also apply the application's deferred updates early
+		if (Device.IsAppPending)
+		{
+			return;
+		}
+		T* pCommitListener = GetCommitListener(Device);
+		if (Device.IsPending && pCommitListener)
+		{
+			pCommitListener->CommitDeferredSettings();
+		}
+		Device.IsPending = false;
+	}
+
+public:
+	void AddListener(void* pDevice, T* pListener)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (!pState)
+		{
+			Devices.emplace_back();
+			pState = &Devices.back();
+			pState->pDevice = pDevice;
+		}
+
+		// Commit before a second listener stops deferring on this device
+		CommitPending(*pState);
+
+		pState->Listeners.push_back(pListener);
+	}
+
+	void RemoveListener(void* pDevice, T* pListener)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (!pState || std::find(pState->Listeners.begin(), pState->Listeners.end(), pListener) == pState->Listeners.end())
+		{
+			return;
+		}
+
+		CommitPending(*pState);
+
+		pState->Listeners.erase(std::find(pState->Listeners.begin(), pState->Listeners.end(), pListener));
+
+		if (pState->Listeners.empty())
+		{
+			Devices.erase(Devices.begin() + (pState - Devices.data()));
+		}
+	}
+
+	// Commits and unregisters the listener before its last reference is released, so it is never used after it is freed
+	ULONG ReleaseListener(void* pDevice, T* pListener)
+	{
+		pListener->AddRef();
+		if (pListener->Release() == 1)
+		{
+			RemoveListener(pDevice, pListener);
+		}
+		return pListener->Release();
+	}
+
+	// Rewrites immediate updates to deferred when they can be committed later
+	bool DeferUpdate(void* pDevice, DWORD& dwApply, bool CanCommit)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (dwApply != DS3D_IMMEDIATE || !CanCommit || !pState || pState->IsAppPending || !GetCommitListener(*pState))
+		{
+			return false;
+		}
+		dwApply = DS3D_DEFERRED;
+		return true;
+	}
+
+	void SetPending(void* pDevice)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (pState)
+		{
+			pState->IsPending = true;
+		}
+	}
+
+	// Stops deferring until the application commits its own deferred updates
+	void SetAppDeferred(void* pDevice)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (pState)
+		{
+			// Commit the wrapper's updates now so they are not held back by the application's batch
+			CommitPending(*pState);
+			pState->IsAppPending = true;
+		}
+	}
+
+	// Application committed, which also committed any of the wrapper's updates
+	void ClearAppDeferred(void* pDevice)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (pState)
+		{
+			pState->IsPending = false;
+			pState->IsAppPending = false;
+		}
+	}
+
+	bool IsAppDeferred(void* pDevice)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		return (pState && pState->IsAppPending);
+	}
+
+	void Commit(void* pDevice)
+	{
+		DEVICESTATE* pState = FindDevice(pDevice);
+		if (pState)
+		{
+			CommitPending(*pState);
+		}
+	}
+
+	void CommitAll()
+	{
+		for (auto& entry : Devices)
+		{
+			CommitPending(entry);
+		}
+	}
+
+	bool IsEmpty() const
+	{
+		return Devices.empty();
+	}
+};
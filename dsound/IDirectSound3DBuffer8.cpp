@@ -70,6 +70,8 @@ HRESULT m_IDirectSound3DBuffer8::GetAllParameters(_Out_ LPDS3DBUFFER pDs3dBuffer
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetAllParameters(pDs3dBuffer);
 }
 
@@ -77,6 +79,8 @@ HRESULT m_IDirectSound3DBuffer8::GetConeAngles(_Out_ LPDWORD pdwInsideConeAngle,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetConeAngles(pdwInsideConeAngle, pdwOutsideConeAngle);
 }
 
@@ -84,6 +88,8 @@ HRESULT m_IDirectSound3DBuffer8::GetConeOrientation(_Out_ D3DVECTOR* pvOrientati
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetConeOrientation(pvOrientation);
 }
 
@@ -91,6 +97,8 @@ HRESULT m_IDirectSound3DBuffer8::GetConeOutsideVolume(_Out_ LPLONG plConeOutside
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetConeOutsideVolume(plConeOutsideVolume);
 }
 
@@ -98,6 +106,8 @@ HRESULT m_IDirectSound3DBuffer8::GetMaxDistance(_Out_ D3DVALUE* pflMaxDistance)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetMaxDistance(pflMaxDistance);
 }
 
@@ -105,6 +115,8 @@ HRESULT m_IDirectSound3DBuffer8::GetMinDistance(_Out_ D3DVALUE* pflMinDistance)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetMinDistance(pflMinDistance);
 }
 
@@ -112,6 +124,8 @@ HRESULT m_IDirectSound3DBuffer8::GetMode(_Out_ LPDWORD pdwMode)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetMode(pdwMode);
 }
 
@@ -119,6 +133,8 @@ HRESULT m_IDirectSound3DBuffer8::GetPosition(_Out_ D3DVECTOR* pvPosition)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetPosition(pvPosition);
 }
 
@@ -126,6 +142,8 @@ HRESULT m_IDirectSound3DBuffer8::GetVelocity(_Out_ D3DVECTOR* pvVelocity)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetVelocity(pvVelocity);
 }
 
@@ -133,61 +151,79 @@ HRESULT m_IDirectSound3DBuffer8::SetAllParameters(_In_ LPCDS3DBUFFER pcDs3dBuffe
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetAllParameters(pcDs3dBuffer, dwApply);
+	if (!pcDs3dBuffer || pcDs3dBuffer->dwSize != sizeof(DS3DBUFFER))
+	{
+		return ProxyInterface->SetAllParameters(pcDs3dBuffer, dwApply);
+	}
+
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow, *pcDs3dBuffer, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetAllParameters(pcDs3dBuffer, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetConeAngles(DWORD dwInsideConeAngle, DWORD dwOutsideConeAngle, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetConeAngles(dwInsideConeAngle, dwOutsideConeAngle, dwApply);
+	// Inside and outside angles are next to each other in DS3DBUFFER
+	struct { DWORD dwInsideConeAngle, dwOutsideConeAngle; } ConeAngles = { dwInsideConeAngle, dwOutsideConeAngle };
+	auto& ShadowConeAngles = *(decltype(ConeAngles)*)&Shadow.dwInsideConeAngle;
+
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, ShadowConeAngles, ConeAngles, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetConeAngles(dwInsideConeAngle, dwOutsideConeAngle, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetConeOrientation(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetConeOrientation(x, y, z, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.vConeOrientation, D3DVECTOR{ x, y, z }, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetConeOrientation(x, y, z, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetConeOutsideVolume(LONG lConeOutsideVolume, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetConeOutsideVolume(lConeOutsideVolume, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.lConeOutsideVolume, lConeOutsideVolume, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetConeOutsideVolume(lConeOutsideVolume, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetMaxDistance(D3DVALUE flMaxDistance, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetMaxDistance(flMaxDistance, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.flMaxDistance, flMaxDistance, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetMaxDistance(flMaxDistance, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetMinDistance(D3DVALUE flMinDistance, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetMinDistance(flMinDistance, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.flMinDistance, flMinDistance, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetMinDistance(flMinDistance, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetMode(DWORD dwMode, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetMode(dwMode, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.dwMode, dwMode, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetMode(dwMode, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetPosition(x, y, z, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.vPosition, D3DVECTOR{ x, y, z }, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetPosition(x, y, z, Apply); });
 }
 
 HRESULT m_IDirectSound3DBuffer8::SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetVelocity(x, y, z, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.vVelocity, D3DVECTOR{ x, y, z }, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetVelocity(x, y, z, Apply); });
 }
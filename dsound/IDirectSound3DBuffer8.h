@@ -5,11 +5,22 @@ class m_IDirectSound3DBuffer8 : public IDirectSound3DBuffer8, public AddressLook
 private:
 	LPDIRECTSOUND3DBUFFER8 ProxyInterface;
 
+	// Shadow of the buffer parameters for deferred 3D updates
+	LPDIRECTSOUND8 pParentDevice = nullptr;
+	bool IsShadowSet = false;
+	DS3DBUFFER Shadow = {};
+
 public:
 	m_IDirectSound3DBuffer8(LPDIRECTSOUND3DBUFFER8 pSound8) : ProxyInterface(pSound8)
 	{
 		LOG_LIMIT(3, "Creating interface " << __FUNCTION__ << " (" << this << ")");
 
+		if (Config.AudioDefer3DUpdatesMS)
+		{
+			Shadow.dwSize = sizeof(DS3DBUFFER);
+			IsShadowSet = SUCCEEDED(ProxyInterface->GetAllParameters(&Shadow));
+		}
+
 		ProxyAddressLookupTableDsound.SaveAddress(this, ProxyInterface);
 	}
 	~m_IDirectSound3DBuffer8()
@@ -46,4 +57,5 @@ public:
 
 	// Helper functions
 	LPDIRECTSOUND3DBUFFER8 GetProxyInterface() { return ProxyInterface; }
+	void SetParentDevice(LPDIRECTSOUND8 pDevice) { pParentDevice = pDevice; }
 };
@@ -16,6 +16,21 @@
 
 #include "dsound.h"
 
+namespace Deferred3DUpdates
+{
+	// Created with the module's static objects when the dll is attached, before any interface can exist
+	struct DEFERREDLOCK
+	{
+		CRITICAL_SECTION dcs;
+		DEFERREDLOCK() { InitializeCriticalSection(&dcs); }
+	} Lock;
+
+	DEFERRED3DSTATE<IDirectSound3DListener8> State;
+	HANDLE hCommitTimer = nullptr;
+
+	void CALLBACK CommitTimerCallback(PVOID, BOOLEAN);
+}
+
 HRESULT m_IDirectSound3DListener8::QueryInterface(REFIID riid, LPVOID * ppvObj)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
@@ -55,7 +70,7 @@ ULONG m_IDirectSound3DListener8::Release()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	ULONG x = ProxyInterface->Release();
+	ULONG x = (pParentDevice) ? Deferred3DUpdates::ReleaseListener(pParentDevice, ProxyInterface) : ProxyInterface->Release();
 
 	if (x == 0)
 	{
@@ -70,6 +85,8 @@ HRESULT m_IDirectSound3DListener8::GetAllParameters(_Out_ LPDS3DLISTENER pListen
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetAllParameters(pListener);
 }
 
@@ -77,6 +94,8 @@ HRESULT m_IDirectSound3DListener8::GetDistanceFactor(_Out_ D3DVALUE* pflDistance
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetDistanceFactor(pflDistanceFactor);
 }
 
@@ -84,6 +103,8 @@ HRESULT m_IDirectSound3DListener8::GetDopplerFactor(_Out_ D3DVALUE* pflDopplerFa
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetDopplerFactor(pflDopplerFactor);
 }
 
@@ -91,6 +112,8 @@ HRESULT m_IDirectSound3DListener8::GetOrientation(_Out_ D3DVECTOR* pvOrientFront
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetOrientation(pvOrientFront, pvOrientTop);
 }
 
@@ -98,6 +121,8 @@ HRESULT m_IDirectSound3DListener8::GetPosition(_Out_ D3DVECTOR* pvPosition)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetPosition(pvPosition);
 }
 
@@ -105,6 +130,8 @@ HRESULT m_IDirectSound3DListener8::GetRolloffFactor(_Out_ D3DVALUE* pflRolloffFa
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetRolloffFactor(pflRolloffFactor);
 }
 
@@ -112,6 +139,8 @@ HRESULT m_IDirectSound3DListener8::GetVelocity(_Out_ D3DVECTOR* pvVelocity)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	Deferred3DUpdates::Commit(pParentDevice);
+
 	return ProxyInterface->GetVelocity(pvVelocity);
 }
 
@@ -119,54 +148,222 @@ HRESULT m_IDirectSound3DListener8::SetAllParameters(_In_ LPCDS3DLISTENER pcListe
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetAllParameters(pcListener, dwApply);
+	if (!pcListener || pcListener->dwSize != sizeof(DS3DLISTENER))
+	{
+		return ProxyInterface->SetAllParameters(pcListener, dwApply);
+	}
+
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow, *pcListener, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetAllParameters(pcListener, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetDistanceFactor(D3DVALUE flDistanceFactor, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetDistanceFactor(flDistanceFactor, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.flDistanceFactor, flDistanceFactor, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetDistanceFactor(flDistanceFactor, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetDopplerFactor(D3DVALUE flDopplerFactor, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetDopplerFactor(flDopplerFactor, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.flDopplerFactor, flDopplerFactor, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetDopplerFactor(flDopplerFactor, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetOrientation(D3DVALUE xFront, D3DVALUE yFront, D3DVALUE zFront, D3DVALUE xTop, D3DVALUE yTop, D3DVALUE zTop, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetOrientation(xFront, yFront, zFront, xTop, yTop, zTop, dwApply);
+	// Front and top vectors are next to each other in DS3DLISTENER
+	struct { D3DVECTOR vOrientFront, vOrientTop; } Orientation = { { xFront, yFront, zFront }, { xTop, yTop, zTop } };
+	auto& ShadowOrientation = *(decltype(Orientation)*)&Shadow.vOrientFront;
+
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, ShadowOrientation, Orientation, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetOrientation(xFront, yFront, zFront, xTop, yTop, zTop, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetPosition(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetPosition(x, y, z, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.vPosition, D3DVECTOR{ x, y, z }, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetPosition(x, y, z, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetRolloffFactor(D3DVALUE flRolloffFactor, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetRolloffFactor(flRolloffFactor, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.flRolloffFactor, flRolloffFactor, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetRolloffFactor(flRolloffFactor, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::SetVelocity(D3DVALUE x, D3DVALUE y, D3DVALUE z, DWORD dwApply)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->SetVelocity(x, y, z, dwApply);
+	return Deferred3DUpdates::SetParameter(pParentDevice, IsShadowSet, Shadow.vVelocity, D3DVECTOR{ x, y, z }, dwApply,
+		[&](DWORD Apply) { return ProxyInterface->SetVelocity(x, y, z, Apply); });
 }
 
 HRESULT m_IDirectSound3DListener8::CommitDeferredSettings()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->CommitDeferredSettings();
+	HRESULT hr = ProxyInterface->CommitDeferredSettings();
+
+	if (SUCCEEDED(hr))
+	{
+		Deferred3DUpdates::ClearAppDeferred(pParentDevice);
+	}
+
+	return hr;
+}
+
+void m_IDirectSound3DListener8::SetParentDevice(LPDIRECTSOUND8 pDevice)
+{
+	if (!pParentDevice && pDevice && Config.AudioDefer3DUpdatesMS)
+	{
+		pParentDevice = pDevice;
+
+		Deferred3DUpdates::AddListener(pParentDevice, ProxyInterface);
+	}
+}
+
+void Deferred3DUpdates::AddListener(LPDIRECTSOUND8 pDevice, LPDIRECTSOUND3DLISTENER8 pListener)
+{
+	EnterCriticalSection(&Lock.dcs);
+
+	State.AddListener(pDevice, pListener);
+
+	if (!hCommitTimer && !CreateTimerQueueTimer(&hCommitTimer, nullptr, CommitTimerCallback, nullptr,
+		Config.AudioDefer3DUpdatesMS, Config.AudioDefer3DUpdatesMS, WT_EXECUTEDEFAULT))
+	{
+		Logging::Log() << __FUNCTION__ << " Error: failed to create 3D commit timer!";
+		hCommitTimer = nullptr;
+	}
+
+	LeaveCriticalSection(&Lock.dcs);
+}
+
+// Releases the listener under the lock, so neither a commit nor the timer can use it after its last release
+ULONG Deferred3DUpdates::ReleaseListener(LPDIRECTSOUND8 pDevice, LPDIRECTSOUND3DLISTENER8 pListener)
+{
+	EnterCriticalSection(&Lock.dcs);
+
+	ULONG ref = State.ReleaseListener(pDevice, pListener);
+
+	HANDLE hTimer = nullptr;
+	if (State.IsEmpty())
+	{
+		hTimer = hCommitTimer;
+		hCommitTimer = nullptr;
+	}
+
+	LeaveCriticalSection(&Lock.dcs);
+
+	// Wait for a running callback outside of the lock since the callback takes it
+	if (hTimer)
+	{
+		DeleteTimerQueueTimer(nullptr, hTimer, INVALID_HANDLE_VALUE);
+	}
+
+	return ref;
+}
+
+// Rewrites immediate updates to deferred when they can be committed later
+bool Deferred3DUpdates::DeferUpdate(LPDIRECTSOUND8 pDevice, DWORD& dwApply)
+{
+	if (dwApply != DS3D_IMMEDIATE || !pDevice)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&Lock.dcs);
+
+	const bool IsDeferred = State.DeferUpdate(pDevice, dwApply, hCommitTimer != nullptr);
+
+	LeaveCriticalSection(&Lock.dcs);
+
+	return IsDeferred;
+}
+
+void Deferred3DUpdates::SetPending(LPDIRECTSOUND8 pDevice)
+{
+	EnterCriticalSection(&Lock.dcs);
+
+	State.SetPending(pDevice);
+
+	LeaveCriticalSection(&Lock.dcs);
+}
+
+void Deferred3DUpdates::SetAppDeferred(LPDIRECTSOUND8 pDevice)
+{
+	if (!pDevice)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&Lock.dcs);
+
+	State.SetAppDeferred(pDevice);
+
+	LeaveCriticalSection(&Lock.dcs);
+}
+
+void Deferred3DUpdates::ClearAppDeferred(LPDIRECTSOUND8 pDevice)
+{
+	if (!pDevice)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&Lock.dcs);
+
+	State.ClearAppDeferred(pDevice);
+
+	LeaveCriticalSection(&Lock.dcs);
+}
+
+bool Deferred3DUpdates::IsAppDeferred(LPDIRECTSOUND8 pDevice)
+{
+	if (!pDevice)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&Lock.dcs);
+
+	const bool IsDeferred = State.IsAppDeferred(pDevice);
+
+	LeaveCriticalSection(&Lock.dcs);
+
+	return IsDeferred;
+}
+
+// Commits pending updates so queries and the mixer see the latest values
+void Deferred3DUpdates::Commit(LPDIRECTSOUND8 pDevice)
+{
+	if (!pDevice)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&Lock.dcs);
+
+	State.Commit(pDevice);
+
+	LeaveCriticalSection(&Lock.dcs);
+}
+
+void CALLBACK Deferred3DUpdates::CommitTimerCallback(PVOID, BOOLEAN)
+{
+	EnterCriticalSection(&Lock.dcs);
+
+	State.CommitAll();
+
+	LeaveCriticalSection(&Lock.dcs);
 }
@@ -1,15 +1,73 @@
 #pragma once
 
+namespace Deferred3DUpdates
+{
+	void AddListener(LPDIRECTSOUND8 pDevice, LPDIRECTSOUND3DLISTENER8 pListener);
+	ULONG ReleaseListener(LPDIRECTSOUND8 pDevice, LPDIRECTSOUND3DLISTENER8 pListener);
+	bool DeferUpdate(LPDIRECTSOUND8 pDevice, DWORD& dwApply);
+	void SetPending(LPDIRECTSOUND8 pDevice);
+	void SetAppDeferred(LPDIRECTSOUND8 pDevice);
+	void ClearAppDeferred(LPDIRECTSOUND8 pDevice);
+	bool IsAppDeferred(LPDIRECTSOUND8 pDevice);
+	void Commit(LPDIRECTSOUND8 pDevice);
+
+	// Forwards a 3D parameter, values matching the shadow are dropped and immediate updates are deferred to the next commit
+	template <typename T, typename F>
+	HRESULT SetParameter(LPDIRECTSOUND8 pDevice, bool IsShadowSet, T& ShadowValue, const T& Value, DWORD dwApply, F SetProxyParameter)
+	{
+		if (!Config.AudioDefer3DUpdatesMS)
+		{
+			return SetProxyParameter(dwApply);
+		}
+
+		// Updates the application defers itself are only committed by the application
+		if (dwApply == DS3D_DEFERRED)
+		{
+			SetAppDeferred(pDevice);
+		}
+		else if (IsShadowSet && !IsAppDeferred(pDevice) && memcmp(&ShadowValue, &Value, sizeof(T)) == 0)
+		{
+			return DS_OK;
+		}
+
+		const bool IsDeferred = DeferUpdate(pDevice, dwApply);
+
+		HRESULT hr = SetProxyParameter(dwApply);
+
+		if (SUCCEEDED(hr))
+		{
+			ShadowValue = Value;
+			if (IsDeferred)
+			{
+				SetPending(pDevice);
+			}
+		}
+
+		return hr;
+	}
+}
+
 class m_IDirectSound3DListener8 : public IDirectSound3DListener8, public AddressLookupTableDsoundObject
 {
 private:
 	LPDIRECTSOUND3DLISTENER8 ProxyInterface;
 
+	// Shadow of the listener parameters for deferred 3D updates
+	LPDIRECTSOUND8 pParentDevice = nullptr;
+	bool IsShadowSet = false;
+	DS3DLISTENER Shadow = {};
+
 public:
 	m_IDirectSound3DListener8(LPDIRECTSOUND3DLISTENER8 pSound8) : ProxyInterface(pSound8)
 	{
 		LOG_LIMIT(3, "Creating interface " << __FUNCTION__ << " (" << this << ")");
 
+		if (Config.AudioDefer3DUpdatesMS)
+		{
+			Shadow.dwSize = sizeof(DS3DLISTENER);
+			IsShadowSet = SUCCEEDED(ProxyInterface->GetAllParameters(&Shadow));
+		}
+
 		ProxyAddressLookupTableDsound.SaveAddress(this, ProxyInterface);
 	}
 	~m_IDirectSound3DListener8()
@@ -44,4 +102,5 @@ public:
 
 	// Helper functions
 	LPDIRECTSOUND3DLISTENER8 GetProxyInterface() { return ProxyInterface; }
+	void SetParentDevice(LPDIRECTSOUND8 pDevice);
 };
@@ -16,6 +16,16 @@
 
 #include "dsound.h"
 
+namespace SoundBufferCache
+{
+	CRITICAL_SECTION bccs = {};
+	bool IsInitialized = false;
+	std::vector<LPDIRECTSOUND8> Devices;
+	CACHELIST<LPDIRECTSOUND8, LPDIRECTSOUNDBUFFER> Masters;
+
+	bool IsContentEqual(LPDIRECTSOUNDBUFFER pBuffer1, LPDIRECTSOUNDBUFFER pBuffer2);
+}
+
 HRESULT m_IDirectSound8::QueryInterface(REFIID riid, LPVOID * ppvObj)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
@@ -70,6 +80,14 @@ HRESULT m_IDirectSound8::CreateSoundBuffer(_In_ LPCDSBUFFERDESC pcDSBufferDesc,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	// Static buffers in a low quality format are converted once when filled instead of on every mix
+	std::shared_ptr<PCMCONVERTER> pConverter;
+	if (Config.AudioConvertStaticBuffers && Config.PrimaryBufferSamples && pcDSBufferDesc && pcDSBufferDesc->dwSize &&
+		(pcDSBufferDesc->dwFlags & DSBCAPS_STATIC) && (pcDSBufferDesc->dwFlags & (DSBCAPS_PRIMARYBUFFER | DSBCAPS_CTRLPOSITIONNOTIFY)) == 0)
+	{
+		pConverter = PcmConvert::Create(pcDSBufferDesc->lpwfxFormat, pcDSBufferDesc->dwBufferBytes, Config.PrimaryBufferSamples);
+	}
+
 	if (pcDSBufferDesc && pcDSBufferDesc->dwSize)
 	{
 		DSBUFFERDESC *dsdesc = (DSBUFFERDESC*)pcDSBufferDesc;
@@ -109,12 +127,39 @@ HRESULT m_IDirectSound8::CreateSoundBuffer(_In_ LPCDSBUFFERDESC pcDSBufferDesc,
 		}
 	}
 
-	HRESULT hr = ProxyInterface->CreateSoundBuffer(pcDSBufferDesc, ppDSBuffer, pUnkOuter);
+	HRESULT hr = DSERR_GENERIC;
+
+	if (pConverter)
+	{
+		DSBUFFERDESC ConvertDesc = {};
+		memcpy(&ConvertDesc, pcDSBufferDesc, min(pcDSBufferDesc->dwSize, sizeof(DSBUFFERDESC)));
+		ConvertDesc.lpwfxFormat = &pConverter->TargetFormat;
+		ConvertDesc.dwBufferBytes = pConverter->TargetFrames * pConverter->TargetFormat.nBlockAlign;
+
+		hr = ProxyInterface->CreateSoundBuffer(&ConvertDesc, ppDSBuffer, pUnkOuter);
+
+		if (FAILED(hr))
+		{
+			pConverter = nullptr;
+		}
+	}
+
+	if (FAILED(hr))
+	{
+		hr = ProxyInterface->CreateSoundBuffer(pcDSBufferDesc, ppDSBuffer, pUnkOuter);
+	}
 
 	if (SUCCEEDED(hr) && ppDSBuffer)
 	{
 		*ppDSBuffer = new m_IDirectSoundBuffer8((IDirectSoundBuffer8*)*ppDSBuffer);
 
+		((m_IDirectSoundBuffer8*)*ppDSBuffer)->SetParentDevice(ProxyInterface);
+
+		if (pConverter)
+		{
+			((m_IDirectSoundBuffer8*)*ppDSBuffer)->SetConverter(pConverter);
+		}
+
 		if (pcDSBufferDesc && (pcDSBufferDesc->dwFlags & DSBCAPS_PRIMARYBUFFER) != 0)
 		{
 			((m_IDirectSoundBuffer8*)*ppDSBuffer)->SetPrimaryBuffer(true);
@@ -124,6 +169,11 @@ HRESULT m_IDirectSound8::CreateSoundBuffer(_In_ LPCDSBUFFERDESC pcDSBufferDesc,
 				(*ppDSBuffer)->SetFormat(nullptr);
 			}
 		}
+		// Buffers with effects cannot be duplicated
+		else if (Config.AudioBufferCacheSize && pcDSBufferDesc && (pcDSBufferDesc->dwFlags & DSBCAPS_CTRLFX) == 0)
+		{
+			((m_IDirectSoundBuffer8*)*ppDSBuffer)->EnableBufferSharing(ProxyInterface, pcDSBufferDesc);
+		}
 	}
 
 	return hr;
@@ -182,8 +232,15 @@ HRESULT m_IDirectSound8::DuplicateSoundBuffer(_In_ LPDIRECTSOUNDBUFFER pDSBuffer
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	// Duplicates share the audio data, so they also share the converted view of it
+	std::shared_ptr<PCMCONVERTER> pConverter;
+
 	if (pDSBufferOriginal)
 	{
+		pConverter = static_cast<m_IDirectSoundBuffer8 *>(pDSBufferOriginal)->GetConverter();
+
+		static_cast<m_IDirectSoundBuffer8 *>(pDSBufferOriginal)->DisableBufferSharing();
+
 		pDSBufferOriginal = static_cast<m_IDirectSoundBuffer8 *>(pDSBufferOriginal)->GetProxyInterface();
 	}
 
@@ -192,6 +249,13 @@ HRESULT m_IDirectSound8::DuplicateSoundBuffer(_In_ LPDIRECTSOUNDBUFFER pDSBuffer
 	if (SUCCEEDED(hr) && ppDSBufferDuplicate)
 	{
 		*ppDSBufferDuplicate = new m_IDirectSoundBuffer8((IDirectSoundBuffer8*)*ppDSBufferDuplicate);
+
+		((m_IDirectSoundBuffer8*)*ppDSBufferDuplicate)->SetParentDevice(ProxyInterface);
+
+		if (pConverter)
+		{
+			((m_IDirectSoundBuffer8*)*ppDSBufferDuplicate)->SetConverter(pConverter);
+		}
 	}
 
 	return hr;
@@ -261,3 +325,168 @@ HRESULT  m_IDirectSound8::VerifyCertification(_Out_ LPDWORD pdwCertified)
 
 	return hr;
 }
+
+// Helper functions
+void SoundBufferCache::AddDevice(LPDIRECTSOUND8 pDevice)
+{
+	if (!IsInitialized)
+	{
+		InitializeCriticalSection(&bccs);
+		IsInitialized = true;
+	}
+
+	EnterCriticalSection(&bccs);
+
+	Devices.push_back(pDevice);
+
+	LeaveCriticalSection(&bccs);
+}
+
+void SoundBufferCache::RemoveDevice(LPDIRECTSOUND8 pDevice)
+{
+	if (!IsInitialized)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&bccs);
+
+	Devices.erase(std::remove(Devices.begin(), Devices.end(), pDevice), Devices.end());
+	Masters.RemoveDevice(pDevice);
+
+	LeaveCriticalSection(&bccs);
+}
+
+// Creates a new buffer with the same format and audio data, the copy does not share memory with the buffer
+HRESULT SoundBufferCache::CreateCopy(LPDIRECTSOUND8 pDevice, LPDIRECTSOUNDBUFFER pBuffer, REFGUID guid3DAlgorithm, LPDIRECTSOUNDBUFFER* ppCopy)
+{
+	*ppCopy = nullptr;
+
+	DSBCAPS Caps = {};
+	Caps.dwSize = sizeof(DSBCAPS);
+	DWORD FormatSize = 0;
+	if (FAILED(pBuffer->GetCaps(&Caps)) || FAILED(pBuffer->GetFormat(nullptr, 0, &FormatSize)) || FormatSize < sizeof(WAVEFORMATEX))
+	{
+		return DSERR_GENERIC;
+	}
+	std::vector<BYTE> Format(FormatSize);
+	if (FAILED(pBuffer->GetFormat((LPWAVEFORMATEX)Format.data(), FormatSize, nullptr)))
+	{
+		return DSERR_GENERIC;
+	}
+
+	DSBUFFERDESC Desc = {};
+	Desc.dwSize = sizeof(DSBUFFERDESC);
+	Desc.dwFlags = Caps.dwFlags;
+	Desc.dwBufferBytes = Caps.dwBufferBytes;
+	Desc.lpwfxFormat = (LPWAVEFORMATEX)Format.data();
+	Desc.guid3DAlgorithm = guid3DAlgorithm;
+
+	LPDIRECTSOUNDBUFFER pCopy = nullptr;
+	HRESULT hr = pDevice->CreateSoundBuffer(&Desc, &pCopy, nullptr);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	LPVOID pSrc = nullptr, pDest = nullptr;
+	DWORD SrcBytes = 0, DestBytes = 0;
+	hr = pBuffer->Lock(0, 0, &pSrc, &SrcBytes, nullptr, nullptr, DSBLOCK_ENTIREBUFFER);
+	if (SUCCEEDED(hr))
+	{
+		hr = pCopy->Lock(0, 0, &pDest, &DestBytes, nullptr, nullptr, DSBLOCK_ENTIREBUFFER);
+		if (SUCCEEDED(hr))
+		{
+			memcpy(pDest, pSrc, min(SrcBytes, DestBytes));
+			pCopy->Unlock(pDest, DestBytes, nullptr, 0);
+		}
+		pBuffer->Unlock(pSrc, SrcBytes, nullptr, 0);
+	}
+
+	if (FAILED(hr))
+	{
+		pCopy->Release();
+		return hr;
+	}
+
+	*ppCopy = pCopy;
+	return DS_OK;
+}
+
+// Compares the audio data since a matching hash does not guarantee matching content
+bool SoundBufferCache::IsContentEqual(LPDIRECTSOUNDBUFFER pBuffer1, LPDIRECTSOUNDBUFFER pBuffer2)
+{
+	bool Result = false;
+
+	LPVOID pData1 = nullptr, pData2 = nullptr;
+	DWORD Bytes1 = 0, Bytes2 = 0;
+	if (SUCCEEDED(pBuffer1->Lock(0, 0, &pData1, &Bytes1, nullptr, nullptr, DSBLOCK_ENTIREBUFFER)))
+	{
+		if (SUCCEEDED(pBuffer2->Lock(0, 0, &pData2, &Bytes2, nullptr, nullptr, DSBLOCK_ENTIREBUFFER)))
+		{
+			Result = (pData1 && pData2 && Bytes1 == Bytes2 && memcmp(pData1, pData2, Bytes1) == 0);
+			pBuffer2->Unlock(pData2, Bytes2, nullptr, 0);
+		}
+		pBuffer1->Unlock(pData1, Bytes1, nullptr, 0);
+	}
+
+	return Result;
+}
+
+// Returns DS_OK with a duplicate of the cached master, or S_FALSE after caching a private copy of the buffer as the master for its content
+HRESULT SoundBufferCache::GetDuplicate(LPDIRECTSOUND8 pDevice, ULONGLONG Key, LPDIRECTSOUNDBUFFER pBuffer, REFGUID guid3DAlgorithm, LPDIRECTSOUNDBUFFER* ppDuplicate)
+{
+	if (!IsInitialized || !pDevice || !pBuffer || !ppDuplicate)
+	{
+		return DSERR_INVALIDPARAM;
+	}
+
+	*ppDuplicate = nullptr;
+
+	EnterCriticalSection(&bccs);
+
+	if (std::find(Devices.begin(), Devices.end(), pDevice) == Devices.end())
+	{
+		LeaveCriticalSection(&bccs);
+		return DSERR_UNINITIALIZED;
+	}
+
+	HRESULT hr;
+	LPDIRECTSOUNDBUFFER pMaster = Masters.Find(pDevice, Key);
+	if (pMaster)
+	{
+		hr = (IsContentEqual(pMaster, pBuffer)) ?
+			pDevice->DuplicateSoundBuffer(pMaster, ppDuplicate) :
+			S_FALSE;
+	}
+	else
+	{
+		// The master is never handed to the application, so its content cannot change
+		hr = CreateCopy(pDevice, pBuffer, guid3DAlgorithm, &pMaster);
+		if (SUCCEEDED(hr))
+		{
+			Masters.Add(pDevice, Key, pMaster, Config.AudioBufferCacheSize);
+
+			hr = S_FALSE;
+		}
+	}
+
+	LeaveCriticalSection(&bccs);
+
+	return hr;
+}
+
+// Removes the master for content that is about to be overwritten by one of its duplicates
+void SoundBufferCache::RemoveEntry(LPDIRECTSOUND8 pDevice, ULONGLONG Key)
+{
+	if (!IsInitialized)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&bccs);
+
+	Masters.Remove(pDevice, Key);
+
+	LeaveCriticalSection(&bccs);
+}
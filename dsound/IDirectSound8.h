@@ -1,5 +1,14 @@
 #pragma once
 
+namespace SoundBufferCache
+{
+	void AddDevice(LPDIRECTSOUND8 pDevice);
+	void RemoveDevice(LPDIRECTSOUND8 pDevice);
+	HRESULT CreateCopy(LPDIRECTSOUND8 pDevice, LPDIRECTSOUNDBUFFER pBuffer, REFGUID guid3DAlgorithm, LPDIRECTSOUNDBUFFER* ppCopy);
+	HRESULT GetDuplicate(LPDIRECTSOUND8 pDevice, ULONGLONG Key, LPDIRECTSOUNDBUFFER pBuffer, REFGUID guid3DAlgorithm, LPDIRECTSOUNDBUFFER* ppDuplicate);
+	void RemoveEntry(LPDIRECTSOUND8 pDevice, ULONGLONG Key);
+}
+
 class m_IDirectSound8 : public IDirectSound8, public AddressLookupTableDsoundObject
 {
 private:
@@ -10,12 +19,22 @@ public:
 	{
 		LOG_LIMIT(3, "Creating interface " << __FUNCTION__ << " (" << this << ")");
 
+		if (Config.AudioBufferCacheSize)
+		{
+			SoundBufferCache::AddDevice(ProxyInterface);
+		}
+
 		ProxyAddressLookupTableDsound.SaveAddress(this, ProxyInterface);
 	}
 	~m_IDirectSound8()
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
 
+		if (Config.AudioBufferCacheSize)
+		{
+			SoundBufferCache::RemoveDevice(ProxyInterface);
+		}
+
 		ProxyAddressLookupTableDsound.DeleteAddress(this);
 	}
 
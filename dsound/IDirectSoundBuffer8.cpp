@@ -17,7 +17,26 @@
 #include "dsound.h"
 #include "Utils\Utils.h"
 
-DWORD WINAPI ResetPending(LPVOID pvParam);
+namespace AudioClipTimer
+{
+	// Hashed timer wheel, one slot per millisecond tick
+	constexpr DWORD WheelSlots = 256;
+
+	CRITICAL_SECTION wtcs = {};
+	bool IsInitialized = false;
+	HANDLE hWorkerThread = nullptr;
+	HANDLE hWorkerEvent = nullptr;
+	bool EnableThreadFlag = false;
+	DWORD RefCount = 0;
+	DWORD PendingCount = 0;
+	ULONGLONG LastTick = 0;
+	std::vector<AUDIOCLIP*> Wheel[WheelSlots];
+
+	void Initialize();
+	void FireClip(AUDIOCLIP* pAudioClip);
+	void RemoveFromSlot(AUDIOCLIP* pAudioClip);
+	DWORD WINAPI WorkerThreadFunction(LPVOID);
+}
 
 HRESULT m_IDirectSoundBuffer8::QueryInterface(REFIID riid, LPVOID * ppvObj)
 {
@@ -37,11 +56,27 @@ HRESULT m_IDirectSoundBuffer8::QueryInterface(REFIID riid, LPVOID * ppvObj)
 		return DS_OK;
 	}
 
+	// Other interfaces hold on to the proxy, so it can no longer be replaced
+	DisableBufferSharing();
+
 	HRESULT hr = ProxyInterface->QueryInterface(riid, ppvObj);
 
 	if (SUCCEEDED(hr))
 	{
 		genericQueryInterface(riid, ppvObj);
+
+		// Deferred 3D updates are committed per device
+		if (Config.AudioDefer3DUpdatesMS && m_pParentDevice && *ppvObj)
+		{
+			if (riid == IID_IDirectSound3DBuffer8)
+			{
+				((m_IDirectSound3DBuffer8*)*ppvObj)->SetParentDevice(m_pParentDevice);
+			}
+			else if (riid == IID_IDirectSound3DListener8)
+			{
+				((m_IDirectSound3DListener8*)*ppvObj)->SetParentDevice(m_pParentDevice);
+			}
+		}
 	}
 
 	return hr;
@@ -58,9 +93,9 @@ ULONG m_IDirectSoundBuffer8::Release()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	if (CheckThreadRunning())
+	if (IsStopPending())
 	{
-		StopThread();
+		ResetPendingStop();
 	}
 
 	ULONG x = ProxyInterface->Release();
@@ -77,47 +112,145 @@ HRESULT m_IDirectSoundBuffer8::GetCaps(_Out_ LPDSBCAPS pDSBufferCaps)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->GetCaps(pDSBufferCaps);
+	HRESULT hr = ProxyInterface->GetCaps(pDSBufferCaps);
+
+	if (SUCCEEDED(hr) && Converter && pDSBufferCaps)
+	{
+		pDSBufferCaps->dwBufferBytes = (DWORD)Converter->SourceData.size();
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirectSoundBuffer8::GetCurrentPosition(_Out_opt_ LPDWORD pdwCurrentPlayCursor, _Out_opt_ LPDWORD pdwCurrentWriteCursor)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	HRESULT hr = ProxyInterface->GetCurrentPosition(pdwCurrentPlayCursor, pdwCurrentWriteCursor);
+	PROFILE_SCOPE();
 
-	if (Config.StoppedDriverWorkaround && pdwCurrentWriteCursor)
+	if (!Converter)
 	{
-		DWORD dwStatus;
+		return GetProxyPosition(pdwCurrentPlayCursor, pdwCurrentWriteCursor);
+	}
 
-		ProxyInterface->GetStatus(&dwStatus);
+	DWORD PlayCursor = 0, WriteCursor = 0;
+	HRESULT hr = GetProxyPosition(&PlayCursor, &WriteCursor);
+
+	if (SUCCEEDED(hr))
+	{
+		if (pdwCurrentPlayCursor)
+		{
+			*pdwCurrentPlayCursor = PcmConvert::TargetToSourceBytes(*Converter, PlayCursor);
+		}
+		if (pdwCurrentWriteCursor)
+		{
+			*pdwCurrentWriteCursor = PcmConvert::TargetToSourceBytes(*Converter, WriteCursor);
+		}
+	}
+
+	return hr;
+}
 
-		if (dwStatus & DSBSTATUS_PLAYING)
+HRESULT m_IDirectSoundBuffer8::GetProxyPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+	if (Config.AudioCursorResyncMS && !m_bIsPrimary)
+	{
+		if (GetEstimatedPosition(pdwCurrentPlayCursor, pdwCurrentWriteCursor))
 		{
-			if (m_dwOldWriteCursorPos == *pdwCurrentWriteCursor)
+			return DS_OK;
+		}
+
+		DWORD PlayCursor = 0, WriteCursor = 0;
+		HRESULT hr = ProxyInterface->GetCurrentPosition(&PlayCursor, &WriteCursor);
+
+		if (SUCCEEDED(hr))
+		{
+			DWORD dwStatus = 0;
+			ProxyInterface->GetStatus(&dwStatus);
+
+			if (Config.StoppedDriverWorkaround)
 			{
-				if (++m_nWriteCursorIdent > 1)
-				{
-					ProxyInterface->Stop();
-					ProxyInterface->Play(0, 0, dwStatus & DSBPLAY_LOOPING);
-				}
+				CheckStoppedDriver(WriteCursor, dwStatus);
 			}
-			else
+
+			SyncCursorEstimate(PlayCursor, WriteCursor, dwStatus);
+
+			if (pdwCurrentPlayCursor)
 			{
-				m_nWriteCursorIdent = 0;
+				*pdwCurrentPlayCursor = PlayCursor;
+			}
+			if (pdwCurrentWriteCursor)
+			{
+				*pdwCurrentWriteCursor = WriteCursor;
 			}
-
-			m_dwOldWriteCursorPos = *pdwCurrentWriteCursor;
 		}
+
+		return hr;
+	}
+
+	HRESULT hr = ProxyInterface->GetCurrentPosition(pdwCurrentPlayCursor, pdwCurrentWriteCursor);
+
+	if (Config.StoppedDriverWorkaround && pdwCurrentWriteCursor)
+	{
+		DWORD dwStatus;
+
+		ProxyInterface->GetStatus(&dwStatus);
+
+		CheckStoppedDriver(*pdwCurrentWriteCursor, dwStatus);
 	}
 
 	return hr;
 }
 
+// Restarts the buffer if the driver stopped moving the write cursor while playing
+void m_IDirectSoundBuffer8::CheckStoppedDriver(DWORD WriteCursor, DWORD dwStatus)
+{
+	if (dwStatus & DSBSTATUS_PLAYING)
+	{
+		if (m_dwOldWriteCursorPos == WriteCursor)
+		{
+			if (++m_nWriteCursorIdent > 1)
+			{
+				InvalidateCursorEstimate(false);
+
+				ProxyInterface->Stop();
+				ProxyInterface->Play(0, 0, dwStatus & DSBPLAY_LOOPING);
+			}
+		}
+		else
+		{
+			m_nWriteCursorIdent = 0;
+		}
+
+		m_dwOldWriteCursorPos = WriteCursor;
+	}
+}
+
 HRESULT m_IDirectSoundBuffer8::GetFormat(_Out_writes_bytes_opt_(dwSizeAllocated) LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, _Out_opt_ LPDWORD pdwSizeWritten)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	if (Converter)
+	{
+		if (!pwfxFormat && !pdwSizeWritten)
+		{
+			return DSERR_INVALIDPARAM;
+		}
+		if (pwfxFormat)
+		{
+			if (dwSizeAllocated < sizeof(WAVEFORMATEX))
+			{
+				return DSERR_INVALIDPARAM;
+			}
+			*pwfxFormat = Converter->SourceFormat;
+		}
+		if (pdwSizeWritten)
+		{
+			*pdwSizeWritten = sizeof(WAVEFORMATEX);
+		}
+		return DS_OK;
+	}
+
 	return ProxyInterface->GetFormat(pwfxFormat, dwSizeAllocated, pdwSizeWritten);
 }
 
@@ -160,7 +293,14 @@ HRESULT m_IDirectSoundBuffer8::GetFrequency(_Out_ LPDWORD pdwFrequency)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->GetFrequency(pdwFrequency);
+	HRESULT hr = ProxyInterface->GetFrequency(pdwFrequency);
+
+	if (SUCCEEDED(hr) && Converter && pdwFrequency)
+	{
+		*pdwFrequency = PcmConvert::TargetToSourceFrequency(*Converter, *pdwFrequency);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirectSoundBuffer8::GetStatus(_Out_ LPDWORD pdwStatus)
@@ -188,23 +328,42 @@ HRESULT m_IDirectSoundBuffer8::Lock(DWORD dwOffset, DWORD dwBytes,
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->Lock(dwOffset, dwBytes, ppvAudioPtr1, pdwAudioBytes1, ppvAudioPtr2, pdwAudioBytes2, dwFlags);
+	PROFILE_SCOPE();
+
+	// Writes must not reach the audio data shared with the cached master
+	if (BufferSharing.pSharedDevice)
+	{
+		StopSharingBufferContent();
+	}
+
+	HRESULT hr = (Converter) ?
+		LockConverted(dwOffset, dwBytes, ppvAudioPtr1, pdwAudioBytes1, ppvAudioPtr2, pdwAudioBytes2, dwFlags) :
+		ProxyInterface->Lock(dwOffset, dwBytes, ppvAudioPtr1, pdwAudioBytes1, ppvAudioPtr2, pdwAudioBytes2, dwFlags);
+
+	if (BufferSharing.pDevice)
+	{
+		BufferSharing.IsLocked = SUCCEEDED(hr) && SoundBufferCache::IsWholeBufferLock(dwOffset, dwBytes, dwFlags, BufferSharing.BufferBytes);
+		if (!BufferSharing.IsLocked)
+		{
+			BufferSharing.pDevice = nullptr;
+		}
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirectSoundBuffer8::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	if (CheckThreadRunning())
-	{
-		// Stop thread
-		StopThread();
+	PROFILE_SCOPE();
 
-		// Stop audio
-		ProxyInterface->Stop();
+	InvalidateCursorEstimate(false);
 
-		// Reset volume
-		ProxyInterface->SetVolume(AudioClip.CurrentVolume);
+	if (IsStopPending())
+	{
+		// Cancel timer, stop audio and reset volume
+		ResetPendingStop();
 	}
 
 	return ProxyInterface->Play(dwReserved1, dwPriority, dwFlags);
@@ -214,6 +373,15 @@ HRESULT m_IDirectSoundBuffer8::SetCurrentPosition(DWORD dwNewPosition)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	InvalidateCursorEstimate(false);
+
+	if (Converter)
+	{
+		dwNewPosition = PcmConvert::SourceToTargetBytes(*Converter, dwNewPosition);
+	}
+
 	return ProxyInterface->SetCurrentPosition(dwNewPosition);
 }
 
@@ -221,6 +389,8 @@ HRESULT m_IDirectSoundBuffer8::SetFormat(_In_ LPCWAVEFORMATEX pcfxFormat)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	InvalidateCursorEstimate(true);
+
 	if (Config.ForcePrimaryBufferFormat && this->GetPrimaryBuffer())
 	{
 		WAVEFORMATEX fxFormat;
@@ -246,6 +416,8 @@ HRESULT m_IDirectSoundBuffer8::SetVolume(LONG lVolume)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
 	if (Config.AudioClipDetection)
 	{
 		bool VolumeSet = false;
@@ -281,6 +453,13 @@ HRESULT m_IDirectSoundBuffer8::SetFrequency(DWORD dwFrequency)
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	InvalidateCursorEstimate(true);
+
+	if (Converter && dwFrequency != DSBFREQUENCY_ORIGINAL)
+	{
+		dwFrequency = PcmConvert::SourceToTargetFrequency(*Converter, dwFrequency);
+	}
+
 	return ProxyInterface->SetFrequency(dwFrequency);
 }
 
@@ -288,19 +467,20 @@ HRESULT m_IDirectSoundBuffer8::Stop()
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
+	PROFILE_SCOPE();
+
+	InvalidateCursorEstimate(false);
+
 	if (Config.AudioClipDetection)
 	{
-		if (CheckThreadRunning())
-		{
-			return DS_OK;
-		}
+		bool ScheduleStop = false;
 
 		EnterCriticalSection(&AudioClip.dics);
 
 		DWORD dwStatus = 0;
 		ProxyInterface->GetStatus(&dwStatus);
 
-		if (!AudioClip.ds_ThreadID && (dwStatus & DSBSTATUS_PLAYING))
+		if (!AudioClip.PendingStop && (dwStatus & DSBSTATUS_PLAYING))
 		{
 			// Set pending stop
 			AudioClip.PendingStop = true;
@@ -311,16 +491,17 @@ HRESULT m_IDirectSoundBuffer8::Stop()
 			// Lower volume
 			ProxyInterface->SetVolume(DSBVOLUME_MIN);
 
-			// Start thread
-			if (CreateThread(nullptr, 0, ResetPending, &AudioClip, 0, &AudioClip.ds_ThreadID) == nullptr || !AudioClip.ds_ThreadID)
-			{
-				AudioClip.PendingStop = false;
-				AudioClip.ds_ThreadID = 0;
-			}
+			ScheduleStop = true;
 		}
 
 		LeaveCriticalSection(&AudioClip.dics);
 
+		// Schedule deferred stop on the shared worker, must be done outside of the buffer lock
+		if (ScheduleStop)
+		{
+			AudioClipTimer::Schedule(&AudioClip, (Config.AudioFadeOutDelayMS) ? Config.AudioFadeOutDelayMS : 20);
+		}
+
 		// Return
 		return DS_OK;
 	}
@@ -333,12 +514,55 @@ HRESULT m_IDirectSoundBuffer8::Unlock(_In_reads_bytes_(dwAudioBytes1) LPVOID pvA
 {
 	Logging::LogDebug() << __FUNCTION__ << " (" << this << ")";
 
-	return ProxyInterface->Unlock(pvAudioPtr1, dwAudioBytes1, pvAudioPtr2, dwAudioBytes2);
+	PROFILE_SCOPE();
+
+	// Content is hashed before unlocking since the pointers are not valid afterwards
+	LPDIRECTSOUND8 pDevice = nullptr;
+	ULONGLONG Key = 0;
+	if (BufferSharing.pDevice && BufferSharing.IsLocked && pvAudioPtr1 &&
+		dwAudioBytes1 + ((pvAudioPtr2) ? dwAudioBytes2 : 0) == BufferSharing.BufferBytes)
+	{
+		pDevice = BufferSharing.pDevice;
+		Key = SoundBufferCache::Hash(BufferSharing.FormatKey, pvAudioPtr1, dwAudioBytes1);
+		Key = SoundBufferCache::Hash(Key, pvAudioPtr2, (pvAudioPtr2) ? dwAudioBytes2 : 0);
+	}
+	BufferSharing.pDevice = nullptr;
+
+	HRESULT hr;
+	if (Converter)
+	{
+		hr = UnlockConverted(pvAudioPtr1, dwAudioBytes1);
+		if (SUCCEEDED(hr) && pvAudioPtr2 && dwAudioBytes2)
+		{
+			hr = UnlockConverted(pvAudioPtr2, dwAudioBytes2);
+		}
+	}
+	else
+	{
+		hr = ProxyInterface->Unlock(pvAudioPtr1, dwAudioBytes1, pvAudioPtr2, dwAudioBytes2);
+	}
+
+	if (SUCCEEDED(hr) && pDevice)
+	{
+		ShareBufferContent(pDevice, Key);
+	}
+
+	return hr;
 }
 
 HRESULT m_IDirectSoundBuffer8::Restore()
 {
-	return ProxyInterface->Restore();
+	InvalidateCursorEstimate(false);
+
+	HRESULT hr = ProxyInterface->Restore();
+
+	// The application copy survives a lost buffer, so the converted data can be rebuilt from it
+	if (SUCCEEDED(hr) && Converter)
+	{
+		UnlockConverted(Converter->SourceData.data(), (DWORD)Converter->SourceData.size());
+	}
+
+	return hr;
 }
 
 // IDirectSoundBuffer8 methods
@@ -371,72 +595,536 @@ HRESULT m_IDirectSoundBuffer8::GetObjectInPath(_In_ REFGUID rguidObject, DWORD d
 }
 
 // Helper functions
-bool m_IDirectSoundBuffer8::CheckThreadRunning()
+bool m_IDirectSoundBuffer8::IsStopPending()
 {
-	bool ThreadRunning = false;
+	if (!Config.AudioClipDetection)
+	{
+		return false;
+	}
 
 	EnterCriticalSection(&AudioClip.dics);
 
-	if (AudioClip.ds_ThreadID)
+	bool PendingStop = AudioClip.PendingStop;
+
+	LeaveCriticalSection(&AudioClip.dics);
+
+	return PendingStop;
+}
+
+void m_IDirectSoundBuffer8::ResetPendingStop()
+{
+	// Remove timer so the worker cannot fire while the stop is handled here
+	AudioClipTimer::Cancel(&AudioClip);
+
+	AudioClipTimer::FireClip(&AudioClip);
+}
+
+void m_IDirectSoundBuffer8::EnableBufferSharing(LPDIRECTSOUND8 pDevice, LPCDSBUFFERDESC pcDSBufferDesc)
+{
+	if (!pcDSBufferDesc || !pcDSBufferDesc->lpwfxFormat || !pcDSBufferDesc->dwBufferBytes)
 	{
-		ThreadRunning = true;
+		return;
 	}
 
-	LeaveCriticalSection(&AudioClip.dics);
+	// Buffers only share content when they also match in format and creation flags
+	const LPWAVEFORMATEX pFormat = pcDSBufferDesc->lpwfxFormat;
+	ULONGLONG FormatKey = SoundBufferCache::Hash(0, pFormat, sizeof(WAVEFORMATEX) + ((pFormat->wFormatTag != WAVE_FORMAT_PCM) ? pFormat->cbSize : 0));
+	FormatKey = SoundBufferCache::Hash(FormatKey, &pcDSBufferDesc->dwFlags, sizeof(DWORD));
+	FormatKey = SoundBufferCache::Hash(FormatKey, &pcDSBufferDesc->dwBufferBytes, sizeof(DWORD));
+	if (pcDSBufferDesc->dwSize >= sizeof(DSBUFFERDESC))
+	{
+		FormatKey = SoundBufferCache::Hash(FormatKey, &pcDSBufferDesc->guid3DAlgorithm, sizeof(GUID));
+		BufferSharing.guid3DAlgorithm = pcDSBufferDesc->guid3DAlgorithm;
+	}
 
-	return ThreadRunning;
+	BufferSharing.pDevice = pDevice;
+	BufferSharing.FormatKey = FormatKey;
+	BufferSharing.BufferBytes = pcDSBufferDesc->dwBufferBytes;
+	BufferSharing.IsLocked = false;
 }
 
-void m_IDirectSoundBuffer8::StopThread()
+// Locks the application format copy of the buffer
+HRESULT m_IDirectSoundBuffer8::LockConverted(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1, LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
 {
-	// Trigger thread
-	SetEvent(AudioClip.hTriggerEvent);
+	const DWORD BufferBytes = (DWORD)Converter->SourceData.size();
+
+	if (!ppvAudioPtr1 || !pdwAudioBytes1)
+	{
+		return DSERR_INVALIDPARAM;
+	}
 
-	// Wiat for thread to exit
-	bool flag = false;
-	do {
+	if (dwFlags & DSBLOCK_FROMWRITECURSOR)
+	{
+		HRESULT hr = GetCurrentPosition(nullptr, &dwOffset);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+	if (dwFlags & DSBLOCK_ENTIREBUFFER)
+	{
+		dwBytes = BufferBytes;
+	}
 
-		Utils::BusyWaitYield((DWORD)-1);
+	if (dwOffset >= BufferBytes || !dwBytes || dwBytes > BufferBytes)
+	{
+		return DSERR_INVALIDPARAM;
+	}
 
-		EnterCriticalSection(&AudioClip.dics);
+	*ppvAudioPtr1 = &Converter->SourceData[dwOffset];
+	*pdwAudioBytes1 = min(dwBytes, BufferBytes - dwOffset);
 
-		flag = (AudioClip.ds_ThreadID != 0);
+	const DWORD WrapBytes = dwBytes - *pdwAudioBytes1;
+	if (ppvAudioPtr2)
+	{
+		*ppvAudioPtr2 = (WrapBytes) ? Converter->SourceData.data() : nullptr;
+	}
+	if (pdwAudioBytes2)
+	{
+		*pdwAudioBytes2 = (ppvAudioPtr2) ? WrapBytes : 0;
+	}
 
-		LeaveCriticalSection(&AudioClip.dics);
+	return DS_OK;
+}
+
+// Converts an unlocked part of the application copy into the proxy buffer
+HRESULT m_IDirectSoundBuffer8::UnlockConverted(LPVOID pvAudioPtr, DWORD dwAudioBytes)
+{
+	const BYTE* pData = Converter->SourceData.data();
+	const DWORD BufferBytes = (DWORD)Converter->SourceData.size();
+
+	if ((BYTE*)pvAudioPtr < pData || (BYTE*)pvAudioPtr + dwAudioBytes > pData + BufferBytes)
+	{
+		return DSERR_INVALIDPARAM;
+	}
+
+	DWORD TargetOffset = 0, TargetBytes = 0;
+	PcmConvert::GetTargetRange(*Converter, (DWORD)((BYTE*)pvAudioPtr - pData), dwAudioBytes, TargetOffset, TargetBytes);
+	if (!TargetBytes)
+	{
+		return DS_OK;
+	}
+
+	LPVOID pTarget = nullptr;
+	DWORD LockedBytes = 0;
+	HRESULT hr = ProxyInterface->Lock(TargetOffset, TargetBytes, &pTarget, &LockedBytes, nullptr, nullptr, 0);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	PcmConvert::Convert(*Converter, TargetOffset / Converter->TargetFormat.nBlockAlign, LockedBytes / Converter->TargetFormat.nBlockAlign, (BYTE*)pTarget);
 
-	} while (flag);
+	return ProxyInterface->Unlock(pTarget, LockedBytes, nullptr, 0);
 }
 
-DWORD WINAPI ResetPending(LPVOID pvParam)
+// Replaces the proxy with a duplicate of a cached buffer holding the same content
+void m_IDirectSoundBuffer8::ShareBufferContent(LPDIRECTSOUND8 pDevice, ULONGLONG Key)
 {
-	if (!pvParam)
+	// Only safe while the caller holds the only reference and nothing is playing
+	DWORD dwStatus = 0;
+	ProxyInterface->AddRef();
+	if (ProxyInterface->Release() != 1 || FAILED(ProxyInterface->GetStatus(&dwStatus)) || (dwStatus & DSBSTATUS_PLAYING))
+	{
+		return;
+	}
+
+	LPDIRECTSOUNDBUFFER pDuplicate = nullptr;
+	if (SoundBufferCache::GetDuplicate(pDevice, Key, (LPDIRECTSOUNDBUFFER)ProxyInterface, BufferSharing.guid3DAlgorithm, &pDuplicate) != DS_OK || !pDuplicate)
+	{
+		return;
+	}
+
+	LOG_LIMIT(100, __FUNCTION__ << " Reusing cached sound buffer content (" << this << ")");
+
+	ReplaceProxyInterface(pDuplicate);
+
+	BufferSharing.pSharedDevice = pDevice;
+	BufferSharing.SharedKey = Key;
+}
+
+// Gives the buffer its own copy of the audio data before the application writes to it
+void m_IDirectSoundBuffer8::StopSharingBufferContent()
+{
+	LPDIRECTSOUND8 pDevice = BufferSharing.pSharedDevice;
+	BufferSharing.pSharedDevice = nullptr;
+
+	DWORD dwStatus = 0, dwPosition = 0;
+	ProxyInterface->GetStatus(&dwStatus);
+	ProxyInterface->GetCurrentPosition(&dwPosition, nullptr);
+
+	// Proxy cannot be replaced if other interfaces hold on to it
+	ProxyInterface->AddRef();
+	const bool IsOnlyReference = (ProxyInterface->Release() == 1);
+
+	LPDIRECTSOUNDBUFFER pCopy = nullptr;
+	if (!IsOnlyReference || FAILED(SoundBufferCache::CreateCopy(pDevice, (LPDIRECTSOUNDBUFFER)ProxyInterface, BufferSharing.guid3DAlgorithm, &pCopy)) || !pCopy)
+	{
+		// Other duplicates will see the write, but at least new buffers no longer pick up this content
+		LOG_LIMIT(100, __FUNCTION__ << " Warning: failed to copy shared sound buffer, dropping it from the cache (" << this << ")");
+		SoundBufferCache::RemoveEntry(pDevice, BufferSharing.SharedKey);
+		return;
+	}
+
+	ReplaceProxyInterface(pCopy);
+
+	if (dwStatus & DSBSTATUS_PLAYING)
 	{
-		return S_FALSE;
+		ProxyInterface->SetCurrentPosition(dwPosition);
+		ProxyInterface->Play(0, 0, (dwStatus & DSBSTATUS_LOOPING) ? DSBPLAY_LOOPING : 0);
 	}
+}
 
-	AUDIOCLIP &AudioClip = *(AUDIOCLIP*)pvParam;
+// Called before other interfaces or application duplicates take hold of the proxy, a shared proxy gets its own copy first
+void m_IDirectSoundBuffer8::DisableBufferSharing()
+{
+	BufferSharing.pDevice = nullptr;
 
-	// Add slight delay
-	WaitForSingleObject(AudioClip.hTriggerEvent, ((Config.AudioFadeOutDelayMS) ? Config.AudioFadeOutDelayMS : 20));
+	if (BufferSharing.pSharedDevice)
+	{
+		StopSharingBufferContent();
+	}
+}
+
+// Swaps the proxy for a buffer with the same content, the settings of the old proxy are carried over
+void m_IDirectSoundBuffer8::ReplaceProxyInterface(LPDIRECTSOUNDBUFFER pNewProxy)
+{
+	LONG lValue = 0;
+	DWORD dwValue = 0;
+	if (SUCCEEDED(ProxyInterface->GetVolume(&lValue)))
+	{
+		pNewProxy->SetVolume(lValue);
+	}
+	if (SUCCEEDED(ProxyInterface->GetPan(&lValue)))
+	{
+		pNewProxy->SetPan(lValue);
+	}
+	if (SUCCEEDED(ProxyInterface->GetFrequency(&dwValue)))
+	{
+		pNewProxy->SetFrequency(dwValue);
+	}
+	if (SUCCEEDED(ProxyInterface->GetCurrentPosition(&dwValue, nullptr)))
+	{
+		pNewProxy->SetCurrentPosition(dwValue);
+	}
 
 	EnterCriticalSection(&AudioClip.dics);
 
-	if (AudioClip.PendingStop && AudioClip.ProxyInterface)
+	ProxyAddressLookupTableDsound.DeleteAddress(this);
+
+	ProxyInterface->Release();
+	ProxyInterface = (LPDIRECTSOUNDBUFFER8)pNewProxy;
+	AudioClip.ProxyInterface = ProxyInterface;
+
+	ProxyAddressLookupTableDsound.SaveAddress(this, ProxyInterface);
+
+	LeaveCriticalSection(&AudioClip.dics);
+
+	InvalidateCursorEstimate(false);
+}
+
+// Extrapolates the cursors from the last driver query, returns false when the estimate needs a resync
+bool m_IDirectSoundBuffer8::GetEstimatedPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+	static LARGE_INTEGER Frequency = {};
+	if (!Frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&Frequency);
+	}
+
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+
+	EnterCriticalSection(&cecs);
+
+	DWORD PlayCursor = 0, WriteCursor = 0;
+	const bool IsValid = CursorEstimate.Get(Counter.QuadPart, Frequency.QuadPart, Config.AudioCursorResyncMS, PlayCursor, WriteCursor);
+
+	LeaveCriticalSection(&cecs);
+
+	if (IsValid)
+	{
+		if (pdwCurrentPlayCursor)
+		{
+			*pdwCurrentPlayCursor = PlayCursor;
+		}
+		if (pdwCurrentWriteCursor)
+		{
+			*pdwCurrentWriteCursor = WriteCursor;
+		}
+	}
+
+	return IsValid;
+}
+
+void m_IDirectSoundBuffer8::SyncCursorEstimate(DWORD PlayCursor, DWORD WriteCursor, DWORD dwStatus)
+{
+	EnterCriticalSection(&cecs);
+
+	CursorEstimate.Invalidate(false);
+
+	// Only looping buffers are extrapolated, one-shot buffers stop at the end of the data
+	if ((dwStatus & DSBSTATUS_PLAYING) && (dwStatus & DSBSTATUS_LOOPING))
+	{
+		if (!CursorEstimate.IsFormatSet)
+		{
+			DSBCAPS Caps = {};
+			Caps.dwSize = sizeof(DSBCAPS);
+			BYTE FormatData[sizeof(WAVEFORMATEX) + 22] = {};		// Large enough for WAVEFORMATEXTENSIBLE
+			LPWAVEFORMATEX pFormat = (LPWAVEFORMATEX)FormatData;
+			DWORD dwFrequency = 0;
+
+			if (SUCCEEDED(ProxyInterface->GetCaps(&Caps)) && SUCCEEDED(ProxyInterface->GetFormat(pFormat, sizeof(FormatData), nullptr)))
+			{
+				if (FAILED(ProxyInterface->GetFrequency(&dwFrequency)) || !dwFrequency)
+				{
+					dwFrequency = pFormat->nSamplesPerSec;
+				}
+
+				CursorEstimate.SetFormat(Caps.dwBufferBytes, pFormat->nBlockAlign, dwFrequency);
+			}
+		}
+
+		LARGE_INTEGER Counter;
+		QueryPerformanceCounter(&Counter);
+
+		CursorEstimate.Sync(PlayCursor, WriteCursor, Counter.QuadPart);
+	}
+
+	LeaveCriticalSection(&cecs);
+}
+
+void m_IDirectSoundBuffer8::InvalidateCursorEstimate(bool FormatChanged)
+{
+	EnterCriticalSection(&cecs);
+
+	CursorEstimate.Invalidate(FormatChanged);
+
+	LeaveCriticalSection(&cecs);
+}
+
+// Shared worker for deferred stops
+void AudioClipTimer::Initialize()
+{
+	if (!IsInitialized)
+	{
+		InitializeCriticalSection(&wtcs);
+		IsInitialized = true;
+	}
+}
+
+void AudioClipTimer::AddRef()
+{
+	Initialize();
+
+	EnterCriticalSection(&wtcs);
+
+	if (RefCount++ == 0)
+	{
+		// Start worker
+		LastTick = GetTickCount64();
+		EnableThreadFlag = true;
+		hWorkerEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		hWorkerThread = CreateThread(nullptr, 0, WorkerThreadFunction, nullptr, 0, nullptr);
+		if (!hWorkerThread)
+		{
+			Logging::Log() << __FUNCTION__ << " Error: failed to create audio clip worker thread!";
+		}
+	}
+
+	LeaveCriticalSection(&wtcs);
+}
+
+void AudioClipTimer::Release()
+{
+	if (!IsInitialized)
+	{
+		return;
+	}
+
+	HANDLE hThread = nullptr;
+	HANDLE hEvent = nullptr;
+
+	EnterCriticalSection(&wtcs);
+
+	if (RefCount && --RefCount == 0)
+	{
+		// Tell worker to exit
+		EnableThreadFlag = false;
+		hThread = hWorkerThread;
+		hEvent = hWorkerEvent;
+		hWorkerThread = nullptr;
+		hWorkerEvent = nullptr;
+		SetEvent(hEvent);
+	}
+
+	LeaveCriticalSection(&wtcs);
+
+	// Wait for worker to exit outside of the lock
+	if (hThread)
+	{
+		WaitForSingleObject(hThread, INFINITE);
+		CloseHandle(hThread);
+	}
+	if (hEvent)
+	{
+		CloseHandle(hEvent);
+	}
+}
+
+void AudioClipTimer::Schedule(AUDIOCLIP* pAudioClip, DWORD DelayMS)
+{
+	if (!pAudioClip || !IsInitialized)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&wtcs);
+
+	// Worker not running, fire now
+	if (!hWorkerThread)
+	{
+		LeaveCriticalSection(&wtcs);
+
+		FireClip(pAudioClip);
+
+		return;
+	}
+
+	if (pAudioClip->TimerScheduled)
+	{
+		RemoveFromSlot(pAudioClip);
+	}
+
+	pAudioClip->ExpireTick = GetTickCount64() + max(DelayMS, 1UL);
+	pAudioClip->TimerScheduled = true;
+	Wheel[pAudioClip->ExpireTick % WheelSlots].push_back(pAudioClip);
+
+	// Wake worker when the wheel goes from idle to busy
+	if (PendingCount++ == 0)
+	{
+		LastTick = GetTickCount64();
+		SetEvent(hWorkerEvent);
+	}
+
+	LeaveCriticalSection(&wtcs);
+}
+
+void AudioClipTimer::Cancel(AUDIOCLIP* pAudioClip)
+{
+	if (!pAudioClip || !IsInitialized)
+	{
+		return;
+	}
+
+	// Worker fires clips while holding this lock, so once this returns the timer can no longer fire
+	EnterCriticalSection(&wtcs);
+
+	if (pAudioClip->TimerScheduled)
+	{
+		RemoveFromSlot(pAudioClip);
+	}
+
+	LeaveCriticalSection(&wtcs);
+}
+
+void AudioClipTimer::RemoveFromSlot(AUDIOCLIP* pAudioClip)
+{
+	std::vector<AUDIOCLIP*>& Slot = Wheel[pAudioClip->ExpireTick % WheelSlots];
+
+	auto it = std::find(Slot.begin(), Slot.end(), pAudioClip);
+	if (it != Slot.end())
+	{
+		*it = Slot.back();
+		Slot.pop_back();
+		PendingCount--;
+	}
+
+	pAudioClip->TimerScheduled = false;
+}
+
+void AudioClipTimer::FireClip(AUDIOCLIP* pAudioClip)
+{
+	EnterCriticalSection(&pAudioClip->dics);
+
+	if (pAudioClip->PendingStop && pAudioClip->ProxyInterface)
 	{
 		// Stop
-		AudioClip.ProxyInterface->Stop();
+		pAudioClip->ProxyInterface->Stop();
 
 		// Reset volume
-		AudioClip.ProxyInterface->SetVolume(AudioClip.CurrentVolume);
+		pAudioClip->ProxyInterface->SetVolume(pAudioClip->CurrentVolume);
 	}
 
 	// Reset pending stop
-	AudioClip.PendingStop = false;
+	pAudioClip->PendingStop = false;
 
-	// Reset thread ID
-	AudioClip.ds_ThreadID = 0;
+	LeaveCriticalSection(&pAudioClip->dics);
+}
 
-	LeaveCriticalSection(&AudioClip.dics);
+DWORD WINAPI AudioClipTimer::WorkerThreadFunction(LPVOID)
+{
+	std::vector<AUDIOCLIP*> Expired;
+
+	while (true)
+	{
+		EnterCriticalSection(&wtcs);
+
+		bool Running = EnableThreadFlag;
+		HANDLE hEvent = hWorkerEvent;
+		DWORD Timeout = (PendingCount) ? 1 : INFINITE;
+
+		LeaveCriticalSection(&wtcs);
+
+		if (!Running)
+		{
+			break;
+		}
+
+		WaitForSingleObject(hEvent, Timeout);
+
+		EnterCriticalSection(&wtcs);
+
+		if (!EnableThreadFlag)
+		{
+			LeaveCriticalSection(&wtcs);
+			break;
+		}
+
+		// Advance the wheel to the current tick, visiting each slot at most once
+		ULONGLONG Now = GetTickCount64();
+		ULONGLONG Ticks = min(Now - LastTick, (ULONGLONG)WheelSlots - 1);
+		for (ULONGLONG x = 0; x <= Ticks && PendingCount; x++)
+		{
+			std::vector<AUDIOCLIP*>& Slot = Wheel[(Now - x) % WheelSlots];
+
+			for (size_t y = 0; y < Slot.size();)
+			{
+				if (Slot[y]->ExpireTick <= Now)
+				{
+					Slot[y]->TimerScheduled = false;
+					Expired.push_back(Slot[y]);
+					Slot[y] = Slot.back();
+					Slot.pop_back();
+					PendingCount--;
+				}
+				else
+				{
+					y++;
+				}
+			}
+		}
+		LastTick = Now;
+
+		// Fire while still holding the wheel lock so Cancel() can wait for buffers being released
+		for (AUDIOCLIP* pAudioClip : Expired)
+		{
+			FireClip(pAudioClip);
+		}
+		Expired.clear();
+
+		LeaveCriticalSection(&wtcs);
+	}
 
 	return S_OK;
 }
@@ -2,14 +2,22 @@
 
 struct AUDIOCLIP
 {
-	DWORD ds_ThreadID = 0;
 	CRITICAL_SECTION dics = {};
 	LPDIRECTSOUNDBUFFER8 ProxyInterface = nullptr;
 	LONG CurrentVolume = 0;
-	HANDLE hTriggerEvent = nullptr;
 	bool PendingStop = false;
+	bool TimerScheduled = false;				// Protected by the timer wheel lock
+	ULONGLONG ExpireTick = 0;					// Protected by the timer wheel lock
 };
 
+namespace AudioClipTimer
+{
+	void AddRef();
+	void Release();
+	void Schedule(AUDIOCLIP* pAudioClip, DWORD DelayMS);
+	void Cancel(AUDIOCLIP* pAudioClip);
+}
+
 class m_IDirectSoundBuffer8 : public IDirectSoundBuffer8, public AddressLookupTableDsoundObject
 {
 private:
@@ -18,11 +26,40 @@ private:
 	// Set variables
 	AUDIOCLIP AudioClip;
 
+	// Play and write cursors extrapolated from the last driver query
+	CRITICAL_SECTION cecs = {};
+	CURSORESTIMATE CursorEstimate;
+	bool GetEstimatedPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor);
+	void SyncCursorEstimate(DWORD PlayCursor, DWORD WriteCursor, DWORD dwStatus);
+	void InvalidateCursorEstimate(bool FormatChanged);
+	void CheckStoppedDriver(DWORD WriteCursor, DWORD dwStatus);
+
+	// Content sharing through the sound buffer cache, only the first fill of the whole buffer is checked
+	struct {
+		LPDIRECTSOUND8 pDevice = nullptr;
+		ULONGLONG FormatKey = 0;
+		DWORD BufferBytes = 0;
+		GUID guid3DAlgorithm = {};
+		bool IsLocked = false;
+		LPDIRECTSOUND8 pSharedDevice = nullptr;		// Set while the proxy shares its audio data with a cached master
+		ULONGLONG SharedKey = 0;
+	} BufferSharing;
+	void ShareBufferContent(LPDIRECTSOUND8 pDevice, ULONGLONG Key);
+	void StopSharingBufferContent();
+	void ReplaceProxyInterface(LPDIRECTSOUNDBUFFER pNewProxy);
+
+	// Application format view of a buffer that the proxy holds in a converted format
+	std::shared_ptr<PCMCONVERTER> Converter;
+	HRESULT GetProxyPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor);
+	HRESULT LockConverted(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1, LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags);
+	HRESULT UnlockConverted(LPVOID pvAudioPtr, DWORD dwAudioBytes);
+
 protected:
 	DWORD m_dwOldWriteCursorPos = 0;
 	BYTE m_nWriteCursorIdent = 0;
 
 	bool m_bIsPrimary = false;
+	LPDIRECTSOUND8 m_pParentDevice = nullptr;
 
 public:
 	m_IDirectSoundBuffer8(LPDIRECTSOUNDBUFFER8 pSound8) : ProxyInterface(pSound8)
@@ -33,9 +70,12 @@ public:
 
 		// Initialize Critical Section
 		InitializeCriticalSection(&AudioClip.dics);
-		char EventName[MAX_PATH];
-		sprintf_s(EventName, MAX_PATH, "Local\\SH2EAudioClipDetection-%u", (DWORD)this);
-		AudioClip.hTriggerEvent = CreateEvent(nullptr, FALSE, FALSE, EventName);
+		InitializeCriticalSection(&cecs);
+
+		if (Config.AudioClipDetection)
+		{
+			AudioClipTimer::AddRef();
+		}
 
 		ProxyAddressLookupTableDsound.SaveAddress(this, ProxyInterface);
 	}
@@ -43,9 +83,15 @@ public:
 	{
 		LOG_LIMIT(3, __FUNCTION__ << " (" << this << ")" << " deleting interface!");
 
+		if (Config.AudioClipDetection)
+		{
+			AudioClipTimer::Cancel(&AudioClip);
+			AudioClipTimer::Release();
+		}
+
 		// Delete Critical Section
 		DeleteCriticalSection(&AudioClip.dics);
-		CloseHandle(AudioClip.hTriggerEvent);
+		DeleteCriticalSection(&cecs);
 
 		ProxyAddressLookupTableDsound.DeleteAddress(this);
 	}
@@ -84,9 +130,13 @@ public:
 	STDMETHOD(GetObjectInPath)(THIS_ _In_ REFGUID rguidObject, DWORD dwIndex, _In_ REFGUID rguidInterface, _Outptr_ LPVOID *ppObject);
 
 	// Helper functions
-	bool CheckThreadRunning();
-	void StopThread();
+	bool IsStopPending();
+	void ResetPendingStop();
 	LPDIRECTSOUNDBUFFER8 GetProxyInterface() { return ProxyInterface; }
+	void EnableBufferSharing(LPDIRECTSOUND8 pDevice, LPCDSBUFFERDESC pcDSBufferDesc);
+	void DisableBufferSharing();
+	std::shared_ptr<PCMCONVERTER> GetConverter() { return Converter; }
+	void SetConverter(std::shared_ptr<PCMCONVERTER> pConverter) { Converter = pConverter; }
 	bool GetPrimaryBuffer()
 	{
 		return m_bIsPrimary;
@@ -95,4 +145,8 @@ public:
 	{
 		m_bIsPrimary = bIsPrimary;
 	};
+	void SetParentDevice(LPDIRECTSOUND8 pDevice)
+	{
+		m_pParentDevice = pDevice;
+	};
 };
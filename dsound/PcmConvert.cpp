@@ -0,0 +1,137 @@
+/**
+* Copyright (C) 2025 Elisha Riedlinger
+*
+* This software is  provided 'as-is', without any express  or implied  warranty. In no event will the
+* authors be held liable for any damages arising from the use of this software.
+* Permission  is granted  to anyone  to use  this software  for  any  purpose,  including  commercial
+* applications, and to alter it and redistribute it freely, subject to the following restrictions:
+*
+*   1. The origin of this software must not be misrepresented; you must not claim that you  wrote the
+*      original  software. If you use this  software  in a product, an  acknowledgment in the product
+*      documentation would be appreciated but is not required.
+*   2. Altered source versions must  be plainly  marked as such, and  must not be  misrepresented  as
+*      being the original software.
+*   3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "dsound.h"
+
+std::shared_ptr<PCMCONVERTER> PcmConvert::Create(LPCWAVEFORMATEX pFormat, DWORD dwBufferBytes, DWORD TargetRate)
+{
+	// Only 8-bit or lower rate mono and stereo PCM gains from converting
+	if (!pFormat || pFormat->wFormatTag != WAVE_FORMAT_PCM || pFormat->nChannels < 1 || pFormat->nChannels > 2 ||
+		(pFormat->wBitsPerSample != 8 && pFormat->wBitsPerSample != 16) ||
+		pFormat->nBlockAlign != pFormat->nChannels * pFormat->wBitsPerSample / 8 ||
+		!pFormat->nSamplesPerSec || pFormat->nSamplesPerSec > TargetRate ||
+		(pFormat->wBitsPerSample == 16 && pFormat->nSamplesPerSec == TargetRate))
+	{
+		return nullptr;
+	}
+
+	const DWORD SourceFrames = dwBufferBytes / pFormat->nBlockAlign;
+	const ULONGLONG TargetFrames = ((ULONGLONG)SourceFrames * TargetRate + pFormat->nSamplesPerSec / 2) / pFormat->nSamplesPerSec;
+	if (!SourceFrames || TargetFrames * pFormat->nChannels * sizeof(SHORT) > DSBSIZE_MAX)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<PCMCONVERTER> pConverter = std::make_shared<PCMCONVERTER>();
+
+	pConverter->SourceFormat = *pFormat;
+	pConverter->SourceFormat.cbSize = 0;
+
+	pConverter->TargetFormat.wFormatTag = WAVE_FORMAT_PCM;
+	pConverter->TargetFormat.nChannels = pFormat->nChannels;
+	pConverter->TargetFormat.wBitsPerSample = 16;
+	pConverter->TargetFormat.nSamplesPerSec = TargetRate;
+	pConverter->TargetFormat.nBlockAlign = pFormat->nChannels * sizeof(SHORT);
+	pConverter->TargetFormat.nAvgBytesPerSec = TargetRate * pConverter->TargetFormat.nBlockAlign;
+	pConverter->TargetFormat.cbSize = 0;
+
+	pConverter->SourceFrames = SourceFrames;
+	pConverter->TargetFrames = (DWORD)TargetFrames;
+
+	// Start out as silence like a newly created buffer
+	pConverter->SourceData.assign(dwBufferBytes, (BYTE)((pFormat->wBitsPerSample == 8) ? 0x80 : 0x00));
+
+	return pConverter;
+}
+
+DWORD PcmConvert::SourceToTargetBytes(const PCMCONVERTER& Converter, DWORD SourceBytes)
+{
+	const ULONGLONG Frame = SourceBytes / Converter.SourceFormat.nBlockAlign;
+	return (DWORD)(Frame * Converter.TargetFrames / Converter.SourceFrames) * Converter.TargetFormat.nBlockAlign;
+}
+
+DWORD PcmConvert::TargetToSourceBytes(const PCMCONVERTER& Converter, DWORD TargetBytes)
+{
+	const ULONGLONG Frame = TargetBytes / Converter.TargetFormat.nBlockAlign;
+	return (DWORD)(Frame * Converter.SourceFrames / Converter.TargetFrames) * Converter.SourceFormat.nBlockAlign;
+}
+
+DWORD PcmConvert::SourceToTargetFrequency(const PCMCONVERTER& Converter, DWORD dwFrequency)
+{
+	return (DWORD)((ULONGLONG)dwFrequency * Converter.TargetFormat.nSamplesPerSec / Converter.SourceFormat.nSamplesPerSec);
+}
+
+DWORD PcmConvert::TargetToSourceFrequency(const PCMCONVERTER& Converter, DWORD dwFrequency)
+{
+	return (DWORD)((ULONGLONG)dwFrequency * Converter.SourceFormat.nSamplesPerSec / Converter.TargetFormat.nSamplesPerSec);
+}
+
+// Gets the target bytes that depend on a source range, including the frames reached by the filter taps
+void PcmConvert::GetTargetRange(const PCMCONVERTER& Converter, DWORD SourceOffset, DWORD SourceBytes, DWORD& TargetOffset, DWORD& TargetBytes)
+{
+	const DWORD SourceBlock = Converter.SourceFormat.nBlockAlign;
+	const LONGLONG Margin = (Converter.SourceFormat.nSamplesPerSec == Converter.TargetFormat.nSamplesPerSec) ? 0 : PcmResample::HalfTaps + 1;
+
+	const LONGLONG First = (LONGLONG)(SourceOffset / SourceBlock) - Margin;
+	const LONGLONG End = (LONGLONG)(((ULONGLONG)SourceOffset + SourceBytes + SourceBlock - 1) / SourceBlock) + Margin;
+
+	// Filter taps wrap around the loop point, so changes near either end also affect the other end
+	if (First < 0 || End > (LONGLONG)Converter.SourceFrames)
+	{
+		TargetOffset = 0;
+		TargetBytes = Converter.TargetFrames * Converter.TargetFormat.nBlockAlign;
+		return;
+	}
+
+	const ULONGLONG TargetFirst = (ULONGLONG)First * Converter.TargetFrames / Converter.SourceFrames;
+	const ULONGLONG TargetEnd = min((ULONGLONG)Converter.TargetFrames,
+		((ULONGLONG)End * Converter.TargetFrames + Converter.SourceFrames - 1) / Converter.SourceFrames);
+
+	TargetOffset = (DWORD)TargetFirst * Converter.TargetFormat.nBlockAlign;
+	TargetBytes = (TargetEnd > TargetFirst) ? (DWORD)(TargetEnd - TargetFirst) * Converter.TargetFormat.nBlockAlign : 0;
+}
+
+// Writes target frames from the source data, the filter wraps around the end of the buffer like a looping buffer
+void PcmConvert::Convert(const PCMCONVERTER& Converter, DWORD TargetFrame, DWORD FrameCount, BYTE* pTarget)
+{
+	const DWORD Channels = Converter.SourceFormat.nChannels;
+	const bool Is8Bit = (Converter.SourceFormat.wBitsPerSample == 8);
+	SHORT* pOutput = (SHORT*)pTarget;
+
+	if (!FrameCount || TargetFrame + FrameCount > Converter.TargetFrames)
+	{
+		return;
+	}
+
+	// Same rate only changes the sample size
+	if (Converter.SourceFormat.nSamplesPerSec == Converter.TargetFormat.nSamplesPerSec)
+	{
+		const DWORD First = TargetFrame * Channels;
+		const DWORD Count = FrameCount * Channels;
+		if (Is8Bit)
+		{
+			PcmResample::Widen8To16(&Converter.SourceData[First], pOutput, Count);
+		}
+		else
+		{
+			memcpy(pOutput, &Converter.SourceData[First * sizeof(SHORT)], Count * sizeof(SHORT));
+		}
+		return;
+	}
+
+	PcmResample::Resample(Converter.SourceData.data(), Converter.SourceFrames, Converter.TargetFrames, Channels, Is8Bit,
+		TargetFrame, FrameCount, pOutput);
+}
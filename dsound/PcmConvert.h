@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Buffer that is kept in the application format and converted to 16-bit PCM at a higher rate when unlocked
+struct PCMCONVERTER
+{
+	WAVEFORMATEX SourceFormat = {};
+	WAVEFORMATEX TargetFormat = {};
+	DWORD SourceFrames = 0;
+	DWORD TargetFrames = 0;
+	std::vector<BYTE> SourceData;			// Buffer as seen by the application
+};
+
+namespace PcmConvert
+{
+	std::shared_ptr<PCMCONVERTER> Create(LPCWAVEFORMATEX pFormat, DWORD dwBufferBytes, DWORD TargetRate);
+	DWORD SourceToTargetBytes(const PCMCONVERTER& Converter, DWORD SourceBytes);
+	DWORD TargetToSourceBytes(const PCMCONVERTER& Converter, DWORD TargetBytes);
+	DWORD SourceToTargetFrequency(const PCMCONVERTER& Converter, DWORD dwFrequency);
+	DWORD TargetToSourceFrequency(const PCMCONVERTER& Converter, DWORD dwFrequency);
+	void GetTargetRange(const PCMCONVERTER& Converter, DWORD SourceOffset, DWORD SourceBytes, DWORD& TargetOffset, DWORD& TargetBytes);
+	void Convert(const PCMCONVERTER& Converter, DWORD TargetFrame, DWORD FrameCount, BYTE* pTarget);
+}
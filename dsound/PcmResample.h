@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <emmintrin.h>
+
+// Resampling kernels used by PcmConvert
+namespace PcmResample
+{
+	// Windowed sinc resampler, 16 taps with 128 phases between two source frames
+	constexpr LONG HalfTaps = 8;
+	constexpr LONG Taps = HalfTaps * 2;
+	constexpr DWORD Phases = 128;
+
+	struct COEFFICIENTS
+	{
+		alignas(16) float Table[Phases + 1][Taps];
+	};
+
+	// Blackman windowed sinc, each phase is normalized to unity gain
+	inline const COEFFICIENTS& GetCoefficients()
+	{
+		static const COEFFICIENTS Coefficients = []()
+		{
+			constexpr double Pi = 3.14159265358979323846;
+
+			COEFFICIENTS Data = {};
+			for (DWORD p = 0; p <= Phases; p++)
+			{
+				double Sum = 0.0;
+				double Row[Taps];
+				for (LONG j = 0; j < Taps; j++)
+				{
+					const double Distance = (double)(j - (HalfTaps - 1)) - (double)p / Phases;
+					const double Sinc = (Distance == 0.0) ? 1.0 : sin(Pi * Distance) / (Pi * Distance);
+					const double Window = (fabs(Distance) >= HalfTaps) ? 0.0 :
+						0.42 + 0.5 * cos(Pi * Distance / HalfTaps) + 0.08 * cos(2.0 * Pi * Distance / HalfTaps);
+					Row[j] = Sinc * Window;
+					Sum += Row[j];
+				}
+				for (LONG j = 0; j < Taps; j++)
+				{
+					Data.Table[p][j] = (float)(Row[j] / Sum);
+				}
+			}
+			return Data;
+		}();
+
+		return Coefficients;
+	}
+
+	inline float DotProduct(const float* pData, const float* pCoefficients)
+	{
+		__m128 Sum = _mm_mul_ps(_mm_loadu_ps(pData), _mm_load_ps(pCoefficients));
+		Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(pData + 4), _mm_load_ps(pCoefficients + 4)));
+		Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(pData + 8), _mm_load_ps(pCoefficients + 8)));
+		Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(pData + 12), _mm_load_ps(pCoefficients + 12)));
+
+		Sum = _mm_add_ps(Sum, _mm_movehl_ps(Sum, Sum));
+		Sum = _mm_add_ss(Sum, _mm_shuffle_ps(Sum, Sum, 1));
+		return _mm_cvtss_f32(Sum);
+	}
+
+	// Unsigned 8-bit to signed 16-bit, 16 samples per step
+	inline void Widen8To16(const BYTE* pSource, SHORT* pTarget, DWORD Count)
+	{
+		const __m128i Zero = _mm_setzero_si128();
+		const __m128i Bias = _mm_set1_epi16((SHORT)0x8000);
+
+		for (; Count >= 16; Count -= 16, pSource += 16, pTarget += 16)
+		{
+			const __m128i Bytes = _mm_loadu_si128((const __m128i*)pSource);
+			_mm_storeu_si128((__m128i*)pTarget, _mm_xor_si128(_mm_unpacklo_epi8(Zero, Bytes), Bias));
+			_mm_storeu_si128((__m128i*)(pTarget + 8), _mm_xor_si128(_mm_unpackhi_epi8(Zero, Bytes), Bias));
+		}
+		for (; Count; Count--)
+		{
+			*pTarget++ = (SHORT)(((LONG)*pSource++ - 128) * 256);
+		}
+	}
+
+	// Writes target frames from interleaved source frames. Taps outside of the buffer wrap around to the other end,
+	// so a looping buffer has no seam where the filter would read silence.
+	inline void Resample(const BYTE* pSource, DWORD SourceFrames, DWORD TargetFrames, DWORD Channels, bool Is8Bit,
+		DWORD TargetFrame, DWORD FrameCount, SHORT* pOutput)
+	{
+		// Source position of each target frame in 32.32 fixed point
+		const ULONGLONG Step = ((ULONGLONG)SourceFrames << 32) / TargetFrames;
+
+		// Decode the source frames under the filter to planar floats
+		const LONG WindowFirst = (LONG)(((ULONGLONG)TargetFrame * Step) >> 32) - (HalfTaps - 1);
+		const LONG WindowEnd = (LONG)(((ULONGLONG)(TargetFrame + FrameCount - 1) * Step) >> 32) + HalfTaps + 1;
+		const DWORD WindowFrames = (DWORD)(WindowEnd - WindowFirst);
+
+		std::vector<float> Window(WindowFrames * Channels);
+		for (DWORD c = 0; c < Channels; c++)
+		{
+			float* pWindow = &Window[c * WindowFrames];
+			for (DWORD x = 0; x < WindowFrames; x++)
+			{
+				LONG Frame = (WindowFirst + (LONG)x) % (LONG)SourceFrames;
+				if (Frame < 0)
+				{
+					Frame += SourceFrames;
+				}
+				pWindow[x] = (Is8Bit) ? ((LONG)pSource[Frame * Channels + c] - 128) * (1.0f / 128.0f) :
+					((const SHORT*)pSource)[Frame * Channels + c] * (1.0f / 32768.0f);
+			}
+		}
+
+		const COEFFICIENTS& Coefficients = GetCoefficients();
+
+		for (DWORD x = 0; x < FrameCount; x++)
+		{
+			const ULONGLONG Position = (ULONGLONG)(TargetFrame + x) * Step;
+			const LONG Index = (LONG)(Position >> 32) - (HalfTaps - 1) - WindowFirst;
+			const DWORD Phase = (DWORD)(((Position & 0xFFFFFFFF) * Phases + 0x80000000) >> 32);
+
+			for (DWORD c = 0; c < Channels; c++)
+			{
+				const float Value = DotProduct(&Window[c * WindowFrames + Index], Coefficients.Table[Phase]);
+				const LONG Sample = _mm_cvtss_si32(_mm_set_ss(Value * 32768.0f));
+				pOutput[x * Channels + c] = (SHORT)max(-32768L, min(32767L, Sample));
+			}
+		}
+	}
+}
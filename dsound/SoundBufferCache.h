@@ -0,0 +1,96 @@
+#pragma once
+
+namespace SoundBufferCache
+{
+	// 64-bit FNV-1a, run over whole qwords to keep hashing large buffers cheap, collisions are caught by GetDuplicate
+	inline ULONGLONG Hash(ULONGLONG Seed, const void* pData, DWORD Size)
+	{
+		constexpr ULONGLONG FnvPrime = 0x100000001B3ULL;
+
+		ULONGLONG Value = (Seed) ? Seed : 0xCBF29CE484222325ULL;
+		const BYTE* pByte = (const BYTE*)pData;
+
+		for (; pByte && Size >= sizeof(ULONGLONG); pByte += sizeof(ULONGLONG), Size -= sizeof(ULONGLONG))
+		{
+			ULONGLONG QWord;
+			memcpy(&QWord, pByte, sizeof(ULONGLONG));
+			Value = (Value ^ QWord) * FnvPrime;
+		}
+		for (; pByte && Size; pByte++, Size--)
+		{
+			Value = (Value ^ *pByte) * FnvPrime;
+		}
+
+		return Value;
+	}
+
+	// Only a lock covering the whole buffer from the start can be the fill that gets shared
+	inline bool IsWholeBufferLock(DWORD dwOffset, DWORD dwBytes, DWORD dwFlags, DWORD BufferBytes)
+	{
+		return (dwFlags & DSBLOCK_FROMWRITECURSOR) == 0 &&
+			((dwFlags & DSBLOCK_ENTIREBUFFER) || (dwOffset == 0 && dwBytes == BufferBytes));
+	}
+
+	// Cached masters, most recently used first. The list holds a reference on each master, callers hold the cache lock.
+	template <typename D, typename B>
+	struct CACHELIST
+	{
+		struct CACHEENTRY
+		{
+			D pDevice = nullptr;
+			ULONGLONG Key = 0;
+			B pMaster = nullptr;
+		};
+
+		std::vector<CACHEENTRY> Entries;
+
+		// Returns the master for the content and marks it as most recently used
+		B Find(D pDevice, ULONGLONG Key)
+		{
+			auto it = std::find_if(Entries.begin(), Entries.end(),
+				[=](const CACHEENTRY& Entry) -> bool { return Entry.pDevice == pDevice && Entry.Key == Key; });
+			if (it == Entries.end())
+			{
+				return nullptr;
+			}
+
+			std::rotate(Entries.begin(), it, it + 1);
+
+			return Entries.front().pMaster;
+		}
+
+		// Takes over the reference on pMaster, the least recently used masters past MaxSize are released
+		void Add(D pDevice, ULONGLONG Key, B pMaster, size_t MaxSize)
+		{
+			CACHEENTRY Entry;
+			Entry.pDevice = pDevice;
+			Entry.Key = Key;
+			Entry.pMaster = pMaster;
+			Entries.insert(Entries.begin(), Entry);
+
+			while (Entries.size() > MaxSize)
+			{
+				Entries.back().pMaster->Release();
+				Entries.pop_back();
+			}
+		}
+
+		void Remove(D pDevice, ULONGLONG Key)
+		{
+			auto it = std::find_if(Entries.begin(), Entries.end(),
+				[=](const CACHEENTRY& Entry) -> bool { return Entry.pDevice == pDevice && Entry.Key == Key; });
+			if (it != Entries.end())
+			{
+				it->pMaster->Release();
+				Entries.erase(it);
+			}
+		}
+
+		// Master buffers are freed along with the device, so they are only dropped here
+		void RemoveDevice(D pDevice)
+		{
+			Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+				[=](const CACHEENTRY& Entry) -> bool { return Entry.pDevice == pDevice; }), Entries.end());
+		}
+	};
+}
@@ -49,6 +49,11 @@ extern AddressLookupTableDsound<void> ProxyAddressLookupTableDsound;
 
 using namespace DsoundWrapper;
 
+#include "PcmResample.h"
+#include "PcmConvert.h"
+#include "Deferred3DUpdates.h"
+#include "CursorEstimate.h"
+#include "SoundBufferCache.h"
 #include "IDirectSound8.h"
 #include "IDirectSound3DBuffer8.h"
 #include "IDirectSound3DListener8.h"